@@ -0,0 +1,59 @@
+#!/bin/bash
+set -ex
+
+# Runs the benchmark matrix (`//neuropod/tests:benchmark_backends`) and writes the results to
+# `/tmp/neuropod_benchmarks/results.json`. If a baseline is passed in, the results are compared against it
+# using the tolerances in `build/benchmark_thresholds.json`. To update the baseline, store the results file.
+#
+# Usage: ./build/benchmark.sh [BASELINE_JSON [EXTRA_COMPARE_ARGS]] [-- EXTRA_BENCHMARK_ARGS]
+# This should be run after `./build/build.sh`
+BASELINE=""
+COMPARE_ARGS=()
+if [[ $# -gt 0 && "$1" != "--" ]]; then
+    BASELINE="$1"
+    shift
+
+    # Everything before `--` is passed to `compare_benchmarks.py` (e.g. `--allow-missing REGEX`)
+    while [[ $# -gt 0 && "$1" != "--" ]]; do
+        COMPARE_ARGS+=("$1")
+        shift
+    done
+fi
+
+if [[ "$1" == "--" ]]; then
+    shift
+fi
+
+RESULTS_DIR="/tmp/neuropod_benchmarks"
+mkdir -p "$RESULTS_DIR"
+
+# Use the virtualenv
+source .neuropod_venv/bin/activate
+
+# Use the backends installed by build.sh
+export NEUROPOD_BASE_DIR=`pwd`/.neuropod_test_base
+export NEUROPOD_ENABLE_PYTHON_ISOLATION=true
+
+pushd source
+
+# Add the python library to the pythonpath
+export PYTHONPATH=$PYTHONPATH:`pwd`/python
+
+bazel build -c opt //neuropod/tests:benchmark_backends //neuropod/multiprocess:neuropod_multiprocess_worker
+
+# The OPE benchmarks need to find the worker
+export PATH=$PATH:`pwd`/bazel-bin/neuropod/multiprocess/
+
+# Use the median of a few repetitions to reduce noise
+./bazel-bin/neuropod/tests/benchmark_backends \
+    --benchmark_repetitions=5 \
+    --benchmark_report_aggregates_only=true \
+    --benchmark_out="$RESULTS_DIR/results.json" \
+    --benchmark_out_format=json \
+    "$@"
+
+popd
+
+if [[ -n "$BASELINE" ]]; then
+    python build/compare_benchmarks.py "$BASELINE" "$RESULTS_DIR/results.json" "${COMPARE_ARGS[@]}"
+fi
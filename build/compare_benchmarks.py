@@ -0,0 +1,197 @@
+# Copyright (c) 2020 UATC, LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Compares benchmark results (in google benchmark's JSON format) against a stored baseline and fails if
+# any benchmark got slower by more than its tolerance or if a baseline benchmark is missing or failed to run.
+# See `build/benchmark.sh` and `build/benchmark_thresholds.json`
+#
+# Usage: python build/compare_benchmarks.py BASELINE_JSON CURRENT_JSON [--thresholds THRESHOLDS_JSON]
+#                                           [--allow-missing REGEX ...]
+import json
+import os
+import re
+import sys
+
+# Used to convert times to nanoseconds
+TIME_UNITS = {
+    "ns": 1,
+    "us": 1e3,
+    "ms": 1e6,
+    "s": 1e9,
+}
+
+
+def load_results(path):
+    """
+    Returns a map from benchmark name to real time in nanoseconds and a map from benchmark name to error
+    message for the benchmarks that failed (e.g. because a backend wasn't available).
+    If the benchmarks were run with repetitions, the median of each benchmark is used.
+    """
+    with open(path) as f:
+        benchmarks = json.load(f)["benchmarks"]
+
+    has_aggregates = any(item.get("run_type") == "aggregate" for item in benchmarks)
+
+    out = {}
+    errors = {}
+    for item in benchmarks:
+        if item.get("error_occurred"):
+            errors[item.get("run_name", item["name"])] = item.get("error_message", "unknown error")
+            continue
+
+        if has_aggregates:
+            if item.get("aggregate_name") != "median":
+                continue
+
+            name = item.get("run_name", item["name"][: -len("_median")])
+        else:
+            name = item["name"]
+
+        out[name] = item["real_time"] * TIME_UNITS[item.get("time_unit", "ns")]
+
+    # A benchmark that failed in any repetition doesn't have a usable time
+    for name in errors:
+        out.pop(name, None)
+
+    return out, errors
+
+
+def load_thresholds(path):
+    """
+    Returns the default tolerance, a list of (regex, tolerance) overrides and a list of regexes for benchmarks
+    that are allowed to be missing.
+    Tolerances are the allowed fractional slowdown (e.g. 0.1 allows a benchmark to get 10% slower)
+    """
+    with open(path) as f:
+        thresholds = json.load(f)
+
+    overrides = [(re.compile(item["pattern"]), item["tolerance"]) for item in thresholds.get("tolerances", [])]
+    allow_missing = [re.compile(pattern) for pattern in thresholds.get("allow_missing", [])]
+    return thresholds["default_tolerance"], overrides, allow_missing
+
+
+def get_tolerance(name, default_tolerance, overrides):
+    # The first matching pattern wins
+    for pattern, tolerance in overrides:
+        if pattern.search(name):
+            return tolerance
+
+    return default_tolerance
+
+
+def format_time(ns):
+    for unit in ["s", "ms", "us"]:
+        if ns >= TIME_UNITS[unit]:
+            return "{:.2f}{}".format(ns / TIME_UNITS[unit], unit)
+
+    return "{:.0f}ns".format(ns)
+
+
+def compare(baseline, current, current_errors, default_tolerance, overrides, allow_missing):
+    """
+    Prints a comparison of every benchmark and returns the names of the benchmarks that regressed and the
+    names of the benchmarks that are missing from (or failed in) the current results and aren't allowed to be
+    """
+    regressions = []
+    missing = []
+    name_width = max([len(name) for name in baseline] + [len("Benchmark")])
+    row = "{:<" + str(name_width) + "}  {:>10}  {:>10}  {:>8}  {:>9}  {}"
+    print(row.format("Benchmark", "Baseline", "Current", "Change", "Tolerance", "Status"))
+
+    for name in sorted(baseline):
+        if name not in current:
+            if name in current_errors:
+                status = "ERROR ({})".format(current_errors[name])
+            else:
+                status = "MISSING"
+
+            if any(pattern.search(name) for pattern in allow_missing):
+                status += " (allowed)"
+            else:
+                missing.append(name)
+
+            print(row.format(name, format_time(baseline[name]), "-", "-", "-", status))
+            continue
+
+        tolerance = get_tolerance(name, default_tolerance, overrides)
+        change = current[name] / baseline[name] - 1
+        if change > tolerance:
+            status = "REGRESSION"
+            regressions.append(name)
+        elif change < -tolerance:
+            status = "faster (consider updating the baseline)"
+        else:
+            status = "ok"
+
+        print(row.format(
+            name,
+            format_time(baseline[name]),
+            format_time(current[name]),
+            "{:+.1%}".format(change),
+            "{:.0%}".format(tolerance),
+            status,
+        ))
+
+    for name in sorted(set(current) - set(baseline)):
+        print("New benchmark (not in the baseline): {}".format(name))
+
+    return regressions, missing
+
+
+if __name__ == '__main__':
+    import argparse
+    parser = argparse.ArgumentParser(description="Compare benchmark results against a baseline")
+    parser.add_argument("baseline", help="The baseline results (JSON output from google benchmark)")
+    parser.add_argument("current", help="The results to check (JSON output from google benchmark)")
+    parser.add_argument(
+        "--thresholds",
+        default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "benchmark_thresholds.json"),
+        help="A JSON file with the default tolerance and per-benchmark overrides",
+    )
+    parser.add_argument(
+        "--allow-missing",
+        action="append",
+        default=[],
+        metavar="REGEX",
+        help="Don't fail if baseline benchmarks matching this regex are missing or failed to run (e.g. when only "
+        "running some of the benchmarks). Can be passed more than once",
+    )
+    args = parser.parse_args()
+
+    default_tolerance, overrides, allow_missing = load_thresholds(args.thresholds)
+    allow_missing += [re.compile(pattern) for pattern in args.allow_missing]
+
+    baseline, baseline_errors = load_results(args.baseline)
+    baseline_errors = {
+        name: error
+        for name, error in baseline_errors.items()
+        if not any(pattern.search(name) for pattern in allow_missing)
+    }
+    if baseline_errors:
+        # The baseline can't check these benchmarks so it needs to be regenerated
+        print("The baseline has benchmarks that failed to run:\n  {}".format("\n  ".join(
+            "{}: {}".format(name, error) for name, error in sorted(baseline_errors.items()))))
+        sys.exit(1)
+
+    current, current_errors = load_results(args.current)
+    regressions, missing = compare(baseline, current, current_errors, default_tolerance, overrides, allow_missing)
+    if regressions:
+        print("\n{} benchmarks regressed:\n  {}".format(len(regressions), "\n  ".join(regressions)))
+
+    if missing:
+        print("\n{} baseline benchmarks are missing or failed to run (see `--allow-missing`):\n  {}".format(
+            len(missing), "\n  ".join(missing)))
+
+    if regressions or missing:
+        sys.exit(1)
@@ -19,6 +19,11 @@ limitations under the License.
 #include "neuropod/internal/config_utils.hh"
 #include "neuropod/internal/error_utils.hh"
 #include "neuropod/internal/neuropod_loader.hh"
+#include "neuropod/internal/neuropod_tensor_raw_data_access.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
 
 namespace neuropod
 {
@@ -26,6 +31,34 @@ namespace neuropod
 namespace
 {
 
+// Copy the contents of `src` into `dst`. They must have the same type and shape
+void copy_tensor_into(const std::string &name, const NeuropodTensor &src, NeuropodTensor &dst)
+{
+    if (src.get_tensor_type() != dst.get_tensor_type())
+    {
+        NEUROPOD_ERROR("Output '{}' is of type {}, but the provided tensor is of type {}",
+                       name,
+                       src.get_tensor_type(),
+                       dst.get_tensor_type());
+    }
+
+    if (src.get_dims() != dst.get_dims())
+    {
+        NEUROPOD_ERROR(
+            "Output '{}' has shape {}, but the provided tensor has shape {}", name, src.get_dims(), dst.get_dims());
+    }
+
+    if (src.get_tensor_type() == STRING_TENSOR)
+    {
+        dst.as_typed_tensor<std::string>()->copy_from(src.as_typed_tensor<std::string>()->get_data_as_vector());
+        return;
+    }
+
+    std::memcpy(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(dst),
+                internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(src),
+                src.get_num_elements() * internal::NeuropodTensorRawDataAccess::get_bytes_per_element(src));
+}
+
 std::unordered_map<std::string, NeuropodDevice> get_device_mapping(const ModelConfig &   model_config,
                                                                    const RuntimeOptions &options)
 {
@@ -46,6 +79,18 @@ std::unordered_map<std::string, NeuropodDevice> get_device_mapping(const ModelCo
     return device_mapping;
 }
 
+std::vector<std::string> get_names(const std::vector<TensorSpec> &specs)
+{
+    std::vector<std::string> names;
+    names.reserve(specs.size());
+    for (const auto &spec : specs)
+    {
+        names.emplace_back(spec.name);
+    }
+
+    return names;
+}
+
 } // namespace
 
 Sealer::Sealer(std::unordered_map<std::string, NeuropodDevice> device_mapping)
@@ -76,150 +121,260 @@ NeuropodValueMap Sealer::seal(const NeuropodValueMap &inputs)
     return out;
 }
 
-void validate_tensors_against_specs(const NeuropodValueMap &       tensors,
-                                    const std::vector<TensorSpec> &specs,
-                                    const std::string &            debug_spec_name)
+NeuropodValueMap Sealer::seal(const IndexedValueMap &inputs)
 {
-    // A vector of all the tensor names in the spec.
-    // This is used to check for extra tensors that were provided,
-    // but not in the spec
-    std::unordered_set<std::string> spec_tensor_names;
-
-    // All instances of a symbol in a specification must
-    // resolve to the same value at runtime. See below for more detail
-    std::unordered_map<std::string, int64_t> symbol_actual_map;
+    const auto &layout = *inputs.get_layout();
 
-    for (const auto &spec : specs)
+    NeuropodValueMap out;
+    out.reserve(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
     {
-        // Add the item's name to a set used to check for extra tensors
-        spec_tensor_names.emplace(spec.name);
-
-        // Try to find a tensor with the same name as this item
-        auto tensor_it = tensors.find(spec.name);
-        if (tensor_it == tensors.end())
+        if (inputs[i])
         {
-            // For now, all tensors are optional
-            // TODO(vip): Fix this once we have a better way of marking items as optional
-            continue;
+            const auto &name = layout.get_name(i);
+            out.emplace(name, seal(name, inputs[i]));
         }
+    }
 
-        // Get the tensor
-        const auto &tensor = tensor_it->second->as_tensor();
-
-        // Validate data type
-        if (tensor->get_tensor_type() != spec.type)
-        {
-            // Throw an error
-            NEUROPOD_ERROR("Tensor '{}' in the {} is expected to be of type {}, but was of type {}",
-                           spec.name,
-                           debug_spec_name,
-                           spec.type,
-                           tensor->get_tensor_type());
-        }
+    return out;
+}
 
-        // Validate the number of dimensions
-        if (tensor->get_dims().size() != spec.dims.size())
-        {
-            // Throw an error
-            NEUROPOD_ERROR("Tensor '{}' in the {} is expected to have {} dimensions, but had {}",
-                           spec.name,
-                           debug_spec_name,
-                           spec.dims.size(),
-                           tensor->get_dims().size());
-        }
+SpecValidator::SpecValidator(const std::vector<TensorSpec> &specs, std::string debug_spec_name)
+    : debug_spec_name_(std::move(debug_spec_name))
+{
+    // Assign an integer slot to every symbol
+    std::unordered_map<std::string, int64_t> symbol_slots;
 
-        // Validate the shape
-        for (size_t i = 0; i < spec.dims.size(); i++)
+    specs_.reserve(specs.size());
+    for (const auto &spec : specs)
+    {
+        CompiledSpec compiled{spec.name, spec.type, {}};
+        compiled.dims.reserve(spec.dims.size());
+        for (const auto &dim : spec.dims)
         {
-            auto dim      = tensor->get_dims()[i];
-            auto expected = spec.dims[i];
-
-            if (expected.value == -1)
+            if (dim.value == -1)
             {
-                // Any value of dim is okay
-                continue;
+                compiled.dims.push_back({CompiledDim::ANY, 0});
             }
-            else if (expected.value > 0) // NOLINT(readability-else-after-return)
+            else if (dim.value > 0)
             {
-                // Check that we have the expected number of items
-                if (dim != expected.value)
-                {
-                    // Throw an error
-                    NEUROPOD_ERROR("Dim {} of tensor '{}' in the {} is expected to be of size {}, but was of size {}",
-                                   i,
-                                   spec.name,
-                                   debug_spec_name,
-                                   expected.value,
-                                   dim);
-                }
+                compiled.dims.push_back({CompiledDim::FIXED, dim.value});
             }
-            else if (expected.value < -1)
+            else if (dim.value < -1)
             {
-                // `expected` is a symbol.
-                // Every instance of `expected` should have the same value
-                // For example, if a symbol of "num_classes" is used multiple times in the spec,
-                // all instances must have the same value
-                auto actual_it = symbol_actual_map.find(expected.symbol);
-                if (actual_it != symbol_actual_map.end())
-                {
-                    // We've seen this symbol before
-                    auto actual_value = actual_it->second;
-
-                    // Make sure this usage matches the previous value
-                    if (dim != actual_value)
-                    {
-                        // Throw an error
-                        NEUROPOD_ERROR(
-                            "All dims with symbol '{}' should be the same size. "
-                            "Dim {} of tensor '{}' in the {} was expected to be of size {}, but was of size {}",
-                            expected.symbol,
-                            i,
-                            spec.name,
-                            debug_spec_name,
-                            actual_value,
-                            dim);
-                    }
-                }
-                else
+                auto slot = symbol_slots.find(dim.symbol);
+                if (slot == symbol_slots.end())
                 {
-                    // This is the first time we're seeing this symbol
-                    // Add it to the map so we can check future occurrances of this symbol
-                    symbol_actual_map[expected.symbol] = dim;
+                    slot = symbol_slots.emplace(dim.symbol, static_cast<int64_t>(symbols_.size())).first;
+                    symbols_.emplace_back(dim.symbol);
                 }
+
+                compiled.dims.push_back({CompiledDim::SYMBOL, slot->second});
             }
             else
             {
-                // Throw an error
-                NEUROPOD_ERROR(
-                    "Invalid value of expected shape for item in the {}: {}", debug_spec_name, expected.value);
+                // This is reported when a tensor is validated against this spec
+                compiled.dims.push_back({CompiledDim::INVALID, dim.value});
             }
         }
+
+        name_to_index_[spec.name] = specs_.size();
+        specs_.emplace_back(std::move(compiled));
+    }
+}
+
+SpecValidator::~SpecValidator() = default;
+
+template <typename Fn>
+void SpecValidator::with_symbol_values(Fn &&fn) const
+{
+    // The value each symbol resolved to in this call (or -1 if it hasn't been seen yet)
+    // Use the stack for the common case of a small number of symbols
+    constexpr size_t MAX_STACK_SYMBOLS = 32;
+    if (symbols_.size() <= MAX_STACK_SYMBOLS)
+    {
+        std::array<int64_t, MAX_STACK_SYMBOLS> symbol_values;
+        std::fill_n(symbol_values.begin(), symbols_.size(), -1);
+        fn(symbol_values.data());
+    }
+    else
+    {
+        std::vector<int64_t> symbol_values(symbols_.size(), -1);
+        fn(symbol_values.data());
     }
+}
+
+void SpecValidator::validate(const NeuropodValueMap &tensors) const
+{
+    with_symbol_values([&](int64_t *symbol_values) { validate(tensors, symbol_values); });
+}
+
+void SpecValidator::validate(const IndexedValueMap &tensors) const
+{
+    with_symbol_values([&](int64_t *symbol_values) { validate(tensors, symbol_values); });
+}
 
-    // Check for extra tensors that are not included in the spec
-    std::vector<std::string> unexpected_tensors;
+void SpecValidator::validate(const NeuropodValueMap &tensors, int64_t *symbol_values) const
+{
+    bool has_unexpected_tensors = false;
     for (const auto &item : tensors)
     {
-        if (spec_tensor_names.find(item.first) == spec_tensor_names.end())
+        const auto index_it = name_to_index_.find(item.first);
+        if (index_it == name_to_index_.end())
+        {
+            // This is reported after all the other tensors are validated
+            has_unexpected_tensors = true;
+            continue;
+        }
+
+        // Note: for now, all tensors are optional so we don't check for missing tensors
+        // TODO(vip): Fix this once we have a better way of marking items as optional
+        validate_tensor(specs_[index_it->second], *item.second->as_tensor(), symbol_values);
+    }
+
+    if (has_unexpected_tensors)
+    {
+        // Check for extra tensors that are not included in the spec
+        std::vector<std::string> unexpected_tensors;
+        for (const auto &item : tensors)
+        {
+            if (name_to_index_.find(item.first) == name_to_index_.end())
+            {
+                unexpected_tensors.emplace_back(item.first);
+            }
+        }
+
+        // Throw an error
+        NEUROPOD_ERROR("Tensor name(s) '{}' are not found in the {}", unexpected_tensors, debug_spec_name_);
+    }
+}
+
+void SpecValidator::validate(const IndexedValueMap &tensors, int64_t *symbol_values) const
+{
+    if (tensors.size() != specs_.size())
+    {
+        NEUROPOD_ERROR("Expected a value map with {} slots for the {}, but got {}",
+                       specs_.size(),
+                       debug_spec_name_,
+                       tensors.size());
+    }
+
+    for (size_t i = 0; i < specs_.size(); i++)
+    {
+        // Unset slots are allowed because all tensors are optional
+        if (tensors[i])
         {
-            unexpected_tensors.emplace_back(item.first);
+            validate_tensor(specs_[i], *tensors[i]->as_tensor(), symbol_values);
         }
     }
+}
+
+void SpecValidator::validate_tensor(const CompiledSpec &  spec,
+                                    const NeuropodTensor &tensor,
+                                    int64_t *             symbol_values) const
+{
+    // Validate data type
+    if (tensor.get_tensor_type() != spec.type)
+    {
+        // Throw an error
+        NEUROPOD_ERROR("Tensor '{}' in the {} is expected to be of type {}, but was of type {}",
+                       spec.name,
+                       debug_spec_name_,
+                       spec.type,
+                       tensor.get_tensor_type());
+    }
 
-    if (!unexpected_tensors.empty())
+    // Validate the number of dimensions
+    const auto &dims = tensor.get_dims();
+    if (dims.size() != spec.dims.size())
     {
         // Throw an error
-        NEUROPOD_ERROR("Tensor name(s) '{}' are not found in the {}", unexpected_tensors, debug_spec_name);
+        NEUROPOD_ERROR("Tensor '{}' in the {} is expected to have {} dimensions, but had {}",
+                       spec.name,
+                       debug_spec_name_,
+                       spec.dims.size(),
+                       dims.size());
+    }
+
+    // Validate the shape
+    for (size_t i = 0; i < spec.dims.size(); i++)
+    {
+        const auto  dim      = dims[i];
+        const auto &expected = spec.dims[i];
+        switch (expected.kind)
+        {
+        case CompiledDim::ANY:
+            // Any value of dim is okay
+            break;
+        case CompiledDim::FIXED:
+            // Check that we have the expected number of items
+            if (dim != expected.value)
+            {
+                // Throw an error
+                NEUROPOD_ERROR("Dim {} of tensor '{}' in the {} is expected to be of size {}, but was of size {}",
+                               i,
+                               spec.name,
+                               debug_spec_name_,
+                               expected.value,
+                               dim);
+            }
+            break;
+        case CompiledDim::SYMBOL: {
+            // `expected` is a symbol.
+            // Every instance of `expected` should have the same value
+            // For example, if a symbol of "num_classes" is used multiple times in the spec,
+            // all instances must have the same value
+            auto &actual_value = symbol_values[expected.value];
+            if (actual_value == -1)
+            {
+                // This is the first time we're seeing this symbol
+                actual_value = dim;
+            }
+            else if (dim != actual_value)
+            {
+                // Throw an error
+                NEUROPOD_ERROR("All dims with symbol '{}' should be the same size. "
+                               "Dim {} of tensor '{}' in the {} was expected to be of size {}, but was of size {}",
+                               symbols_[expected.value],
+                               i,
+                               spec.name,
+                               debug_spec_name_,
+                               actual_value,
+                               dim);
+            }
+            break;
+        }
+        case CompiledDim::INVALID:
+            // Throw an error
+            NEUROPOD_ERROR("Invalid value of expected shape for item in the {}: {}", debug_spec_name_, expected.value);
+        }
     }
 }
 
+void validate_tensors_against_specs(const NeuropodValueMap &       tensors,
+                                    const std::vector<TensorSpec> &specs,
+                                    const std::string &            debug_spec_name)
+{
+    SpecValidator(specs, debug_spec_name).validate(tensors);
+}
+
 NeuropodBackend::~NeuropodBackend() = default;
 
 NeuropodBackend::NeuropodBackend(const std::string &neuropod_path, RuntimeOptions options)
     : model_config_(load_model_config(neuropod_path)),
       neuropod_path_(neuropod_path),
       options_(std::move(options)),
-      sealer_(stdx::make_unique<Sealer>(get_device_mapping(*model_config_, options_)))
+      output_conversion_latency_(latency_registry_.get_histogram("output_conversion")),
+      sealer_(stdx::make_unique<Sealer>(get_device_mapping(*model_config_, options_))),
+      input_layout_(std::make_shared<ValueMapLayout>(get_names(model_config_->inputs))),
+      input_validator_(stdx::make_unique<SpecValidator>(model_config_->inputs, "input spec")),
+      output_validator_(stdx::make_unique<SpecValidator>(model_config_->outputs, "output spec")),
+      load_latency_(latency_registry_.get_histogram("load")),
+      infer_latency_(latency_registry_.get_histogram("infer")),
+      input_validation_latency_(latency_registry_.get_histogram("input_validation")),
+      sealing_latency_(latency_registry_.get_histogram("sealing")),
+      infer_internal_latency_(latency_registry_.get_histogram("infer_internal")),
+      output_validation_latency_(latency_registry_.get_histogram("output_validation"))
 {
     loader_ = get_loader(neuropod_path);
 }
@@ -228,7 +383,11 @@ void NeuropodBackend::load_model()
 {
     if (!is_model_loaded_)
     {
-        load_model_internal();
+        {
+            ScopedLatencyTimer timer(load_latency_);
+            load_model_internal();
+        }
+
         is_model_loaded_ = true;
     }
     else
@@ -259,8 +418,55 @@ const std::string &NeuropodBackend::get_platform() const
     return model_config_->platform;
 }
 
+bool NeuropodBackend::supports_concurrent_inference() const
+{
+    return false;
+}
+
+NeuropodStats NeuropodBackend::get_stats() const
+{
+    return latency_registry_.get_stats();
+}
+
 std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer(const NeuropodValueMap &        inputs,
                                                          const std::vector<std::string> &requested_outputs)
+{
+    return infer(inputs, requested_outputs, nullptr);
+}
+
+std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer(
+    const NeuropodValueMap &                        inputs,
+    const std::vector<std::string> &                requested_outputs,
+    const std::shared_ptr<NeuropodTensorAllocator> &output_allocator)
+{
+    return infer_validated(inputs, requested_outputs, output_allocator);
+}
+
+std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer(const IndexedValueMap &         inputs,
+                                                         const std::vector<std::string> &requested_outputs)
+{
+    return infer(inputs, requested_outputs, nullptr);
+}
+
+std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer(
+    const IndexedValueMap &                         inputs,
+    const std::vector<std::string> &                requested_outputs,
+    const std::shared_ptr<NeuropodTensorAllocator> &output_allocator)
+{
+    if (inputs.get_layout() != input_layout_)
+    {
+        // This map wasn't created by `make_input_map` so we can't rely on its order
+        return infer_validated(inputs.to_map(), requested_outputs, output_allocator);
+    }
+
+    return infer_validated(inputs, requested_outputs, output_allocator);
+}
+
+template <typename InputMap>
+std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer_validated(
+    const InputMap &                                inputs,
+    const std::vector<std::string> &                requested_outputs,
+    const std::shared_ptr<NeuropodTensorAllocator> &output_allocator)
 {
     // Make sure the model is loaded
     if (!is_model_loaded_)
@@ -269,27 +475,106 @@ std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer(const NeuropodValueMap
                        "`load_model_at_construction` was set to false and `load_model()` was not explicitly called");
     }
 
+    ScopedLatencyTimer infer_timer(infer_latency_);
     if (!options_.disable_shape_and_type_checking)
     {
-        // Validate inputs
-        validate_tensors_against_specs(inputs, get_inputs(), "input spec");
+        // Validate inputs (by index for an IndexedValueMap)
+        ScopedLatencyTimer timer(input_validation_latency_);
+        input_validator_->validate(inputs);
     }
 
-    // Seal the inputs
-    auto sealed = sealer_->seal(inputs);
+    // Seal the inputs. For an IndexedValueMap, this builds the only NeuropodValueMap for the inputs in this request
+    NeuropodValueMap sealed;
+    {
+        ScopedLatencyTimer timer(sealing_latency_);
+        sealed = sealer_->seal(inputs);
+    }
 
     // Run inference
-    auto out = infer_internal(sealed, requested_outputs);
+    std::unique_ptr<NeuropodValueMap> out;
+    {
+        ScopedLatencyTimer timer(infer_internal_latency_);
+        out = output_allocator ? infer_internal(sealed, requested_outputs, *output_allocator)
+                               : infer_internal(sealed, requested_outputs);
+    }
 
     if (!options_.disable_shape_and_type_checking)
     {
         // Validate outputs
-        validate_tensors_against_specs(*out, get_outputs(), "output spec");
+        ScopedLatencyTimer timer(output_validation_latency_);
+        output_validator_->validate(*out);
     }
 
     return out;
 }
 
+IndexedValueMap NeuropodBackend::make_input_map() const
+{
+    return IndexedValueMap(input_layout_);
+}
+
+void NeuropodBackend::infer_into(const NeuropodValueMap &inputs, NeuropodValueMap &outputs)
+{
+    // Make sure the model is loaded
+    if (!is_model_loaded_)
+    {
+        NEUROPOD_ERROR("The model was not loaded before calling `infer_into`. This usually means that "
+                       "`load_model_at_construction` was set to false and `load_model()` was not explicitly called");
+    }
+
+    if (outputs.empty())
+    {
+        NEUROPOD_ERROR("`infer_into` requires at least one output tensor");
+    }
+
+    ScopedLatencyTimer infer_timer(infer_latency_);
+    if (!options_.disable_shape_and_type_checking)
+    {
+        // Validate inputs and the provided output tensors
+        {
+            ScopedLatencyTimer timer(input_validation_latency_);
+            input_validator_->validate(inputs);
+        }
+
+        ScopedLatencyTimer timer(output_validation_latency_);
+        output_validator_->validate(outputs);
+    }
+
+    // Seal the inputs
+    NeuropodValueMap sealed;
+    {
+        ScopedLatencyTimer timer(sealing_latency_);
+        sealed = sealer_->seal(inputs);
+    }
+
+    // Run inference
+    ScopedLatencyTimer timer(infer_internal_latency_);
+    infer_into_internal(sealed, outputs);
+}
+
+void NeuropodBackend::infer_into_internal(const NeuropodValueMap &inputs, NeuropodValueMap &outputs)
+{
+    std::vector<std::string> requested_outputs;
+    requested_outputs.reserve(outputs.size());
+    for (const auto &item : outputs)
+    {
+        requested_outputs.emplace_back(item.first);
+    }
+
+    // Run inference and copy the results into the provided tensors
+    const auto results = infer_internal(inputs, requested_outputs);
+    for (auto &item : outputs)
+    {
+        const auto result = results->find(item.first);
+        if (result == results->end())
+        {
+            NEUROPOD_ERROR("Tried to request a tensor that does not exist: {}", item.first);
+        }
+
+        copy_tensor_into(item.first, *result->second->as_tensor(), *item.second->as_tensor());
+    }
+}
+
 std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer_internal(const NeuropodValueMap &        inputs,
                                                                   const std::vector<std::string> &requested_outputs)
 {
@@ -300,14 +585,31 @@ std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer_internal(const Neuropod
     }
 
     // Run inference and get all the outputs
-    auto data = infer_internal(inputs);
-    auto out  = stdx::make_unique<NeuropodValueMap>();
+    return filter_outputs(infer_internal(inputs), requested_outputs);
+}
+
+std::unique_ptr<NeuropodValueMap> NeuropodBackend::infer_internal(const NeuropodValueMap &        inputs,
+                                                                  const std::vector<std::string> &requested_outputs,
+                                                                  NeuropodTensorAllocator & /*unused*/)
+{
+    return infer_internal(inputs, requested_outputs);
+}
+
+std::unique_ptr<NeuropodValueMap> NeuropodBackend::filter_outputs(std::unique_ptr<NeuropodValueMap> outputs,
+                                                                  const std::vector<std::string> &  requested_outputs)
+{
+    if (requested_outputs.empty())
+    {
+        return outputs;
+    }
+
+    auto out = stdx::make_unique<NeuropodValueMap>();
 
     // Filter to the requested outputs
     for (const auto &tensor_name : requested_outputs)
     {
-        auto tensor = data->find(tensor_name);
-        if (tensor == data->end())
+        auto tensor = outputs->find(tensor_name);
+        if (tensor == outputs->end())
         {
             NEUROPOD_ERROR("Tried to request a tensor that does not exist: {}", tensor_name);
         }
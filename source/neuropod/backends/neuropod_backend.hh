@@ -18,6 +18,8 @@ limitations under the License.
 #include "neuropod/backends/tensor_allocator.hh"
 #include "neuropod/internal/backend_registration.hh"
 #include "neuropod/internal/deleter.hh"
+#include "neuropod/internal/indexed_value_map.hh"
+#include "neuropod/internal/latency_stats.hh"
 #include "neuropod/internal/neuropod_loader.hh"
 #include "neuropod/internal/neuropod_tensor.hh"
 #include "neuropod/internal/tensor_types.hh"
@@ -25,12 +27,15 @@ limitations under the License.
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace neuropod
 {
 
+class SpecValidator;
+
 class Sealer
 {
 private:
@@ -45,6 +50,9 @@ public:
 
     // Seal every item in the map
     NeuropodValueMap seal(const NeuropodValueMap &inputs);
+
+    // Seal every item that is set in `inputs` and return them as a NeuropodValueMap
+    NeuropodValueMap seal(const IndexedValueMap &inputs);
 };
 
 // The interface that every neuropod backend implements
@@ -61,6 +69,32 @@ public:
     std::unique_ptr<NeuropodValueMap> infer(const NeuropodValueMap &        inputs,
                                             const std::vector<std::string> &requested_outputs = {});
 
+    // Run inference and get a subset of the outputs. Backends that support it will put outputs in tensors
+    // allocated by `output_allocator` (e.g. OPE uses this to write outputs directly into shared memory).
+    // Backends that don't support it return outputs as usual
+    std::unique_ptr<NeuropodValueMap> infer(const NeuropodValueMap &                        inputs,
+                                            const std::vector<std::string> &                requested_outputs,
+                                            const std::shared_ptr<NeuropodTensorAllocator> &output_allocator);
+
+    // Run inference with inputs in a flat value map. If `inputs` was created with `make_input_map`,
+    // validation doesn't need to look up tensors by name and only one map is built per request.
+    std::unique_ptr<NeuropodValueMap> infer(const IndexedValueMap &         inputs,
+                                            const std::vector<std::string> &requested_outputs = {});
+
+    // Same as above, but with an `output_allocator` (see the NeuropodValueMap version)
+    std::unique_ptr<NeuropodValueMap> infer(const IndexedValueMap &                         inputs,
+                                            const std::vector<std::string> &                requested_outputs,
+                                            const std::shared_ptr<NeuropodTensorAllocator> &output_allocator);
+
+    // Create an empty flat value map for the inputs of this model (in the order of the input spec)
+    IndexedValueMap make_input_map() const;
+
+    // Run inference and write the outputs into the tensors in `outputs` (a map from output name to a tensor
+    // owned by the caller). Only the outputs in the map are requested. Each tensor must have the type and
+    // shape of the output the model produces. Backends write into these tensors directly if they can
+    // and copy into them otherwise
+    void infer_into(const NeuropodValueMap &inputs, NeuropodValueMap &outputs);
+
     // Get the inputs and outputs of this model
     const std::vector<TensorSpec> &get_inputs() const;
     const std::vector<TensorSpec> &get_outputs() const;
@@ -73,6 +107,14 @@ public:
     // Load the model if it has not already been loaded
     void load_model();
 
+    // Whether or not `infer` can be called from multiple threads at the same time on this backend
+    // (i.e. whether one loaded model can safely be shared between threads)
+    virtual bool supports_concurrent_inference() const;
+
+    // Get latency stats for each stage of loading and inference (e.g. "load", "infer", "sealing")
+    // Note: this is threadsafe
+    NeuropodStats get_stats() const;
+
 protected:
     // Used to load files in a Neuropod
     std::unique_ptr<NeuropodLoader> loader_;
@@ -86,6 +128,13 @@ protected:
     // The options this model was loaded with
     RuntimeOptions options_;
 
+    // Latency histograms for each stage of loading and inference (see `get_stats`)
+    // Backends can record their own stages with `latency_registry_.get_histogram(name)`
+    LatencyRegistry latency_registry_;
+
+    // Backends should record the time spent converting their outputs to neuropod tensors here
+    LatencyHistogram &output_conversion_latency_;
+
     // Run inference and get a subset of the outputs
     // The default implementation runs inference, gets all the outputs, and then filters the outputs
     // Backends can override this to more efficiently generate only the requested outputs
@@ -96,14 +145,53 @@ protected:
     // Backends must provide an implementation of infer_internal (either this signature or the one above)
     virtual std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &inputs);
 
+    // Run inference and get a subset of the outputs, putting outputs in tensors allocated by `output_allocator`
+    // The default implementation ignores `output_allocator`
+    // Backends can override this to write outputs directly into memory from `output_allocator`
+    virtual std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &        inputs,
+                                                             const std::vector<std::string> &requested_outputs,
+                                                             NeuropodTensorAllocator &       output_allocator);
+
+    // Run inference and write the outputs into the tensors in `outputs`
+    // The default implementation runs inference and then copies each output into the provided tensor
+    // Backends can override this to write outputs directly into the provided tensors
+    virtual void infer_into_internal(const NeuropodValueMap &inputs, NeuropodValueMap &outputs);
+
+    // Returns the subset of `outputs` named in `requested_outputs` (or all of them if
+    // `requested_outputs` is empty)
+    static std::unique_ptr<NeuropodValueMap> filter_outputs(std::unique_ptr<NeuropodValueMap> outputs,
+                                                            const std::vector<std::string> &  requested_outputs);
+
     // A method that loads the underlying model
     virtual void load_model_internal() = 0;
 
 private:
+    // Validates and seals `inputs`, runs inference, and validates the outputs (recording the latency of each stage)
+    // `InputMap` is either a NeuropodValueMap or an IndexedValueMap created by `make_input_map`
+    template <typename InputMap>
+    std::unique_ptr<NeuropodValueMap> infer_validated(const InputMap &                                inputs,
+                                                      const std::vector<std::string> &                requested_outputs,
+                                                      const std::shared_ptr<NeuropodTensorAllocator> &output_allocator);
+
     // Whether or not the underlying model has already been loaded
     bool is_model_loaded_ = false;
 
     std::unique_ptr<Sealer> sealer_;
+
+    // The layout of the flat value maps created by `make_input_map`
+    std::shared_ptr<const ValueMapLayout> input_layout_;
+
+    // Validators for the input and output specs
+    std::unique_ptr<SpecValidator> input_validator_;
+    std::unique_ptr<SpecValidator> output_validator_;
+
+    // Latency histograms for the stages that are recorded by this class
+    LatencyHistogram &load_latency_;
+    LatencyHistogram &infer_latency_;
+    LatencyHistogram &input_validation_latency_;
+    LatencyHistogram &sealing_latency_;
+    LatencyHistogram &infer_internal_latency_;
+    LatencyHistogram &output_validation_latency_;
 };
 
 template <template <class> class TensorImpl>
@@ -121,7 +209,69 @@ public:
     std::shared_ptr<NeuropodTensorAllocator> get_tensor_allocator() { return allocator_; }
 };
 
+// Validates tensors against a vector of specs. The specs are compiled once (symbols are assigned integer
+// slots and tensor names are mapped to spec indices) so validation only does one lookup per tensor and
+// doesn't allocate unless it fails.
+// Note: `validate` is threadsafe
+class SpecValidator
+{
+private:
+    // A dim in a compiled spec
+    struct CompiledDim
+    {
+        enum Kind
+        {
+            ANY,     // Any size is allowed
+            FIXED,   // `value` is the expected size
+            SYMBOL,  // `value` is the index of the symbol's slot
+            INVALID, // `value` is the invalid entry from the spec
+        };
+
+        Kind    kind;
+        int64_t value;
+    };
+
+    struct CompiledSpec
+    {
+        const std::string        name;
+        const TensorType         type;
+        std::vector<CompiledDim> dims;
+    };
+
+    std::vector<CompiledSpec> specs_;
+
+    // A mapping from tensor name to index in `specs_`
+    std::unordered_map<std::string, size_t> name_to_index_;
+
+    // The name of the symbol in each slot (used in error messages)
+    std::vector<std::string> symbols_;
+
+    std::string debug_spec_name_;
+
+    void validate(const NeuropodValueMap &tensors, int64_t *symbol_values) const;
+    void validate(const IndexedValueMap &tensors, int64_t *symbol_values) const;
+
+    // Validate one tensor against a compiled spec
+    void validate_tensor(const CompiledSpec &spec, const NeuropodTensor &tensor, int64_t *symbol_values) const;
+
+    // Calls `fn(symbol_values)` with storage for the value of each symbol
+    template <typename Fn>
+    void with_symbol_values(Fn &&fn) const;
+
+public:
+    SpecValidator(const std::vector<TensorSpec> &specs, std::string debug_spec_name = "spec");
+    ~SpecValidator();
+
+    // Throws an error if validation fails
+    void validate(const NeuropodValueMap &tensors) const;
+
+    // Validate a flat value map whose layout has the names of the specs in order
+    // (e.g. one created by `NeuropodBackend::make_input_map`). Throws an error if validation fails
+    void validate(const IndexedValueMap &tensors) const;
+};
+
 // A utility for validating tensors against a vector of specs. Throws an error if validation fails
+// This compiles the specs on every call. Use `SpecValidator` to validate against the same specs repeatedly
 // Note: This function is exposed in order to properly unit test it and should not be directly used
 void validate_tensors_against_specs(const NeuropodValueMap &       tensors,
                                     const std::vector<TensorSpec> &specs,
@@ -251,7 +251,8 @@ std::unique_ptr<NeuropodValueMap> PythonBridge::infer_internal(const NeuropodVal
     auto model_outputs_raw = neuropod_->attr("forward")(model_inputs).cast<py::dict>();
 
     // Postprocess for python 3
-    auto model_outputs = (*maybe_convert_bindings_types_)(model_outputs_raw).cast<py::dict>();
+    ScopedLatencyTimer timer(output_conversion_latency_);
+    auto               model_outputs = (*maybe_convert_bindings_types_)(model_outputs_raw).cast<py::dict>();
 
     // Get the outputs
     auto outputs = from_numpy_dict(*get_tensor_allocator(), model_outputs);
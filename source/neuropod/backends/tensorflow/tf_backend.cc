@@ -23,6 +23,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <mutex>
 #include <sstream>
@@ -119,25 +120,26 @@ tensorflow::SessionOptions get_tf_opts(const RuntimeOptions & /*unused*/)
 std::unordered_set<std::string> loaded_op_hashes;
 std::mutex                      loaded_op_mutex;
 
-std::string get_handle_cache_key(const std::map<std::string, tensorflow::Tensor> &tensor_feeds,
-                                 const std::map<std::string, std::string> &       tensor_fetches)
+// Set the bit for `index` in a bitmask that starts at `words`
+void set_bit(uint64_t *words, size_t index)
 {
-    std::string cache_key;
-    for (const auto &item : tensor_feeds)
-    {
-        // item.first is the node name in the TF graph
-        cache_key += item.first + ",";
-    }
-
-    cache_key += "->";
+    words[index / 64] |= uint64_t{1} << (index % 64);
+}
 
-    for (const auto &item : tensor_fetches)
+// Call `fn` with the index of every bit that is set in a bitmask of `num_words` words (in increasing order)
+template <typename Fn>
+void for_each_bit(const uint64_t *words, size_t num_words, Fn &&fn)
+{
+    for (size_t word = 0; word < num_words; word++)
     {
-        // item.first is the node name in the TF graph
-        cache_key += item.first + ",";
+        for (size_t bit = 0; bit < 64; bit++)
+        {
+            if (words[word] & (uint64_t{1} << bit))
+            {
+                fn(word * 64 + bit);
+            }
+        }
     }
-
-    return cache_key;
 }
 
 } // namespace
@@ -246,15 +248,49 @@ void TensorflowNeuropodBackend::load_model_internal()
     }
 
     // Setup the nodename mapping and get the init ops (if any)
-    std::vector<std::string> init_ops;
-    auto                     config_stream = loader_->get_istream_for_file("0/config.json");
-    setup_node_mapping_and_init_ops(*config_stream, node_name_mapping_, init_ops);
+    std::unordered_map<std::string, std::string> node_name_mapping;
+    std::vector<std::string>                     init_ops;
+    auto                                         config_stream = loader_->get_istream_for_file("0/config.json");
+    setup_node_mapping_and_init_ops(*config_stream, node_name_mapping, init_ops);
+
+    // Resolve the TF node for every item in the input and output specs (by spec index)
+    const auto get_tf_names = [&node_name_mapping](const std::vector<TensorSpec> &specs) {
+        std::vector<std::string> names;
+        names.reserve(specs.size());
+        for (const auto &spec : specs)
+        {
+            const auto item = node_name_mapping.find(spec.name);
+            if (item == node_name_mapping.end())
+            {
+                NEUROPOD_ERROR("Node {} not found in node_name_mapping. "
+                               "Ensure that all items in the input/output spec have a corresponding item "
+                               "in the node_name_mapping.",
+                               spec.name);
+            }
 
-    // Get a list of the output nodes
-    for (const auto &output : model_config_->outputs)
-    {
-        output_names_.emplace_back(output.name);
-    }
+            names.emplace_back(item->second);
+        }
+
+        return names;
+    };
+
+    const auto get_names = [](const std::vector<TensorSpec> &specs) {
+        std::vector<std::string> names;
+        names.reserve(specs.size());
+        for (const auto &spec : specs)
+        {
+            names.emplace_back(spec.name);
+        }
+
+        return names;
+    };
+
+    tf_feed_names_  = get_tf_names(model_config_->inputs);
+    tf_fetch_names_ = get_tf_names(model_config_->outputs);
+    feed_layout_    = stdx::make_unique<ValueMapLayout>(get_names(model_config_->inputs));
+    fetch_layout_   = stdx::make_unique<ValueMapLayout>(get_names(model_config_->outputs));
+    feed_words_     = (feed_layout_->size() + 63) / 64;
+    fetch_words_    = (fetch_layout_->size() + 63) / 64;
 
     for (const auto &op_name : init_ops)
     {
@@ -265,56 +301,106 @@ void TensorflowNeuropodBackend::load_model_internal()
 TensorflowNeuropodBackend::~TensorflowNeuropodBackend()
 {
     // Release all the callables we cached
-    for (const auto &item : callable_handle_cache_)
+    for (const auto &item : small_plan_cache_)
+    {
+        check_tf_status(session_->ReleaseCallable(item.second.handle));
+    }
+
+    for (const auto &item : plan_cache_)
     {
-        check_tf_status(session_->ReleaseCallable(item.second));
+        check_tf_status(session_->ReleaseCallable(item.second.handle));
     }
 }
 
-int64_t TensorflowNeuropodBackend::get_callable(const std::map<std::string, tensorflow::Tensor> &tensor_feeds,
-                                                const std::map<std::string, std::string> &       tensor_fetches)
+template <typename Signature>
+size_t TensorflowNeuropodBackend::SignatureHash::operator()(const Signature &signature) const
 {
-    tensorflow::Session::CallableHandle handle{};
-
-    const auto cache_key     = get_handle_cache_key(tensor_feeds, tensor_fetches);
-    auto       cached_handle = callable_handle_cache_.find(cache_key);
-    if (cached_handle != callable_handle_cache_.end())
+    size_t seed = signature.size();
+    for (const auto word : signature)
     {
-        // Cache hit!
-        handle = cached_handle->second;
+        seed ^= std::hash<uint64_t>()(word) + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
     }
-    else
-    {
-        // Cache miss...
-        SPDLOG_DEBUG("TF: Callable cache miss. Creating new callable...");
 
-        // Used for setting the inputs and outputs of the subgraph we want to run
-        tensorflow::CallableOptions opts;
+    return seed;
+}
 
-        for (const auto &item : tensor_feeds)
+void TensorflowNeuropodBackend::build_signature(const NeuropodValueMap &                 inputs,
+                                                const std::vector<std::string> &         requested_outputs,
+                                                uint64_t *                               signature,
+                                                std::vector<const tensorflow::Tensor *> &feeds) const
+{
+    uint64_t *fetch_signature = signature + feed_words_;
+    if (requested_outputs.empty())
+    {
+        // The default outputs are all the outputs in the output spec
+        for (size_t i = 0; i < fetch_layout_->size(); i++)
         {
-            // item.first is the node name in the TF graph
-            opts.add_feed(item.first);
-
-            // TODO(vip): Once we explicitly control devices, do something like this:
-            // opts.mutable_feed_devices()->insert({item, device_name});
+            set_bit(fetch_signature, i);
         }
-
-        for (const auto &item : tensor_fetches)
+    }
+    else
+    {
+        for (const auto &name : requested_outputs)
         {
-            // item.first is the node name in the TF graph
-            opts.add_fetch(item.first);
+            set_bit(fetch_signature, fetch_layout_->get_index(name));
         }
+    }
 
-        // Make the callable using the options we set above
-        // Note: this callable will be released in the destructor
-        check_tf_status(session_->MakeCallable(opts, &handle));
+    for (const auto &entry : inputs)
+    {
+        const auto index = feed_layout_->get_index(entry.first);
+        set_bit(signature, index);
+
+        // Get the TensorFlow tensor from the Neuropod tensor
+        feeds[index] =
+            &std::dynamic_pointer_cast<NativeDataContainer<tensorflow::Tensor &>>(entry.second)->get_native_data();
+    }
+}
 
-        // Add it to our cache
-        callable_handle_cache_[cache_key] = handle;
+template <typename Signature>
+const TensorflowNeuropodBackend::ExecutionPlan &TensorflowNeuropodBackend::get_plan(
+    std::unordered_map<Signature, ExecutionPlan, SignatureHash> &cache, const Signature &signature)
+{
+    std::lock_guard<std::mutex> lock(plan_cache_mutex_);
+    auto                        cached_plan = cache.find(signature);
+    if (cached_plan != cache.end())
+    {
+        // Cache hit!
+        return cached_plan->second;
     }
 
-    return handle;
+    // Cache miss...
+    SPDLOG_DEBUG("TF: Callable cache miss. Creating new callable...");
+
+    // Add it to our cache
+    return cache.emplace(signature, make_plan(signature.data())).first->second;
+}
+
+TensorflowNeuropodBackend::ExecutionPlan TensorflowNeuropodBackend::make_plan(const uint64_t *signature)
+{
+    // Used for setting the inputs and outputs of the subgraph we want to run
+    tensorflow::CallableOptions opts;
+    ExecutionPlan               plan;
+
+    for_each_bit(signature, feed_words_, [&](size_t index) {
+        opts.add_feed(tf_feed_names_[index]);
+
+        // TODO(vip): Once we explicitly control devices, do something like this:
+        // opts.mutable_feed_devices()->insert({item, device_name});
+    });
+
+    for_each_bit(signature + feed_words_, fetch_words_, [&](size_t index) {
+        opts.add_fetch(tf_fetch_names_[index]);
+        plan.output_names.emplace_back(fetch_layout_->get_name(index));
+    });
+
+    // Make the callable using the options we set above
+    // Note: this callable will be released in the destructor
+    tensorflow::Session::CallableHandle handle{};
+    check_tf_status(session_->MakeCallable(opts, &handle));
+    plan.handle = handle;
+
+    return plan;
 }
 
 // Run inference with a set of requested outputs
@@ -326,77 +412,48 @@ std::unique_ptr<NeuropodValueMap> TensorflowNeuropodBackend::infer_internal(
     // control over tensor devices. See https://github.com/tensorflow/tensorflow/issues/5902
     // for more details.
 
-    // Fetches and feeds for our callable
-    // Note: these are ordered maps to make it easy to cache callables
-    // Map from an output node_name to an output_name
-    std::map<std::string, std::string> tensor_fetches;
-
-    // Map from an input node_name to a Tensor
-    std::map<std::string, tensorflow::Tensor> tensor_feeds;
-
-    // Get the set of outputs we want to compute
-    const auto &output_names = !requested_outputs.empty() ? requested_outputs : output_names_;
-
-    // Transform neuropod output names to node names in the graph
-    for (const auto &name : output_names)
+    // Build the signature of this call. The first `feed_words_` words are the inputs and the rest
+    // are the outputs. The input tensors are stored by spec index
+    std::vector<const tensorflow::Tensor *> feeds(feed_layout_->size());
+    const ExecutionPlan *                   plan;
+    if (feed_words_ <= 1 && fetch_words_ <= 1)
     {
-        const auto node_name = node_name_mapping_.find(name);
-        if (node_name == node_name_mapping_.end())
-        {
-            NEUROPOD_ERROR("Node {} not found in node_name_mapping. "
-                           "Ensure that all items in the input/output spec have a corresponding item "
-                           "in the node_name_mapping.",
-                           name);
-        }
-
-        // Add this node name as an output of the subgraph we want to run
-        tensor_fetches.emplace(std::make_pair(node_name->second, name));
+        SmallSignature signature{};
+        build_signature(inputs, requested_outputs, signature.data(), feeds);
+        plan = &get_plan(small_plan_cache_, signature);
     }
-
-    // Loop through all the input tensors and setup the inputs
-    for (const auto &entry : inputs)
+    else
     {
-        const auto node_name = node_name_mapping_.find(entry.first);
-        if (node_name == node_name_mapping_.end())
-        {
-            NEUROPOD_ERROR("Node {} not found in node_name_mapping. "
-                           "Ensure that all items in the input/output spec have a corresponding item "
-                           "in the node_name_mapping.",
-                           entry.first);
-        }
-
-        // Get the TensorFlow tensor from the Neuropod tensor
-        const auto &input_data =
-            std::dynamic_pointer_cast<NativeDataContainer<tensorflow::Tensor &>>(entry.second)->get_native_data();
-
-        // Add this node name as an input to the subgraph we want to run
-        tensor_feeds.emplace(std::make_pair(node_name->second, input_data));
+        std::vector<uint64_t> signature(feed_words_ + fetch_words_);
+        build_signature(inputs, requested_outputs, signature.data(), feeds);
+        plan = &get_plan(plan_cache_, signature);
     }
 
-    // Create a callable handle and a vector to store our outputs
-    tensorflow::Session::CallableHandle handle = get_callable(tensor_feeds, tensor_fetches);
-    std::vector<tensorflow::Tensor>     outputs;
-
-    // Setup the inputs
+    // Setup the inputs (in order of spec index)
     std::vector<tensorflow::Tensor> tf_inputs;
-    tf_inputs.reserve(tensor_feeds.size());
-    for (auto &item : tensor_feeds)
+    tf_inputs.reserve(inputs.size());
+    for (const auto feed : feeds)
     {
-        tf_inputs.emplace_back(std::move(item.second));
+        if (feed != nullptr)
+        {
+            tf_inputs.emplace_back(*feed);
+        }
     }
 
+    std::vector<tensorflow::Tensor> outputs;
+
     // Run the callable
-    check_tf_status(session_->RunCallable(handle, tf_inputs, &outputs, nullptr));
+    check_tf_status(session_->RunCallable(plan->handle, tf_inputs, &outputs, nullptr));
 
     // Read the outputs and wrap them in `NeuropodTensor`s
-    auto   to_return = stdx::make_unique<NeuropodValueMap>();
-    size_t position  = 0;
-    for (const auto &item : tensor_fetches)
+    ScopedLatencyTimer timer(output_conversion_latency_);
+    auto               to_return = stdx::make_unique<NeuropodValueMap>();
+    for (size_t i = 0; i < plan->output_names.size(); i++)
     {
-        const auto &output_name   = item.second;
-        auto &      output_tensor = outputs[position++];
-        const auto  tensor_type   = get_neuropod_type_from_tf_type(output_tensor.dtype());
-        (*to_return)[output_name] = make_tensor<TensorflowNeuropodTensor>(tensor_type, std::move(output_tensor));
+        auto &     output_tensor = outputs[i];
+        const auto tensor_type   = get_neuropod_type_from_tf_type(output_tensor.dtype());
+        (*to_return)[plan->output_names[i]] =
+            make_tensor<TensorflowNeuropodTensor>(tensor_type, std::move(output_tensor));
     }
 
     return to_return;
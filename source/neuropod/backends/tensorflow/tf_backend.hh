@@ -19,7 +19,10 @@ limitations under the License.
 #include "neuropod/backends/tensorflow/tf_tensor.hh"
 #include "neuropod/neuropod.hh"
 
-#include <map>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -42,25 +45,71 @@ class TensorflowNeuropodBackend : public NeuropodBackendWithDefaultAllocator<Ten
 private:
     std::unique_ptr<tensorflow::Session> session_;
 
-    // Cached access to callable handles
-    std::unordered_map<std::string, int64_t> callable_handle_cache_;
-
-    // Map from a neuropod node name to the appropriate node in the TF graph
-    std::unordered_map<std::string, std::string> node_name_mapping_;
-
-    // The outputs of the model. This is from the neuropod model config
-    std::vector<std::string> output_names_;
-
-    // Get a callable given feeds and fetches
+    // The names in the input and output specs. A spec index is the position of a name in its layout and is used to
+    // build a cheap signature of the inputs and outputs of a call to `infer`
+    std::unique_ptr<ValueMapLayout> feed_layout_;
+    std::unique_ptr<ValueMapLayout> fetch_layout_;
+
+    // The TF graph node name for each input (and output) spec index
+    std::vector<std::string> tf_feed_names_;
+    std::vector<std::string> tf_fetch_names_;
+
+    // The number of 64 bit words in the feed (and fetch) part of a signature
+    size_t feed_words_  = 0;
+    size_t fetch_words_ = 0;
+
+    // How to run the graph for a specific set of inputs and requested outputs
+    struct ExecutionPlan
+    {
+        // The callable to run. Its feeds are the inputs in order of spec index
+        int64_t handle;
+
+        // The neuropod name of each fetch of the callable (in order)
+        std::vector<std::string> output_names;
+    };
+
+    // A signature is a bitmask of the spec indices of the inputs followed by a bitmask of the spec
+    // indices of the outputs
+    struct SignatureHash
+    {
+        template <typename Signature>
+        size_t operator()(const Signature &signature) const;
+    };
+
+    // Models with at most 64 inputs and 64 outputs (i.e. almost all of them) use a signature that is stored inline
+    // so a cache lookup doesn't allocate
+    using SmallSignature = std::array<uint64_t, 2>;
+
+    // Cached plans keyed by signature. Only one of these is used for a given model
+    // Note: plans are never removed so references to them stay valid
+    std::unordered_map<SmallSignature, ExecutionPlan, SignatureHash>        small_plan_cache_;
+    std::unordered_map<std::vector<uint64_t>, ExecutionPlan, SignatureHash> plan_cache_;
+    std::mutex                                                              plan_cache_mutex_;
+
+    // Set the bits for `inputs` and `requested_outputs` in `signature` and add the input tensors to `feeds`
+    // (by input spec index)
+    void build_signature(const NeuropodValueMap &                 inputs,
+                         const std::vector<std::string> &         requested_outputs,
+                         uint64_t *                               signature,
+                         std::vector<const tensorflow::Tensor *> &feeds) const;
+
+    // Get a plan given a signature
     // This will try to use a cached one if possible
-    int64_t get_callable(const std::map<std::string, tensorflow::Tensor> &tensor_feeds,
-                         const std::map<std::string, std::string> &       tensor_fetches);
+    template <typename Signature>
+    const ExecutionPlan &get_plan(std::unordered_map<Signature, ExecutionPlan, SignatureHash> &cache,
+                                  const Signature &                                            signature);
+
+    // Create the callable for a signature
+    ExecutionPlan make_plan(const uint64_t *signature);
 
 public:
     TensorflowNeuropodBackend(const std::string &neuropod_path, const RuntimeOptions &options);
 
     ~TensorflowNeuropodBackend();
 
+    // TF sessions support concurrent calls to `RunCallable`
+    bool supports_concurrent_inference() const override { return true; }
+
 protected:
     // Run inference with a set of requested outputs
     std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &        inputs,
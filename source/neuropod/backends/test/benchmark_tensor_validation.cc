@@ -0,0 +1,176 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Don't run infer on this file
+// NEUROPOD_CI_SKIP_INFER
+
+#include "benchmark/benchmark.h"
+#include "neuropod/backends/neuropod_backend.hh"
+#include "neuropod/core/generic_tensor.hh"
+#include "neuropod/internal/error_utils.hh"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+
+// A spec with `num_tensors` inputs of shape (batch_size, num_features, 4)
+std::vector<neuropod::TensorSpec> make_spec(int64_t num_tensors)
+{
+    std::vector<neuropod::TensorSpec> spec;
+    for (int64_t i = 0; i < num_tensors; i++)
+    {
+        spec.emplace_back("input_" + std::to_string(i),
+                          std::vector<neuropod::Dimension>{std::string("batch_size"), std::string("num_features"), 4},
+                          neuropod::FLOAT_TENSOR);
+    }
+
+    return spec;
+}
+
+neuropod::NeuropodValueMap make_inputs(int64_t num_tensors)
+{
+    auto                       allocator = neuropod::get_generic_tensor_allocator();
+    neuropod::NeuropodValueMap inputs;
+    for (int64_t i = 0; i < num_tensors; i++)
+    {
+        inputs["input_" + std::to_string(i)] = allocator->allocate_tensor<float>({8, 16, 4});
+    }
+
+    return inputs;
+}
+
+// The validation algorithm used before `SpecValidator` (kept as a baseline)
+// It builds a set of spec names and a map of symbol values on every call and looks up each spec by name
+void validate_previous(const neuropod::NeuropodValueMap &       tensors,
+                       const std::vector<neuropod::TensorSpec> &specs,
+                       const std::string &                      debug_spec_name)
+{
+    std::unordered_set<std::string>          spec_tensor_names;
+    std::unordered_map<std::string, int64_t> symbol_actual_map;
+    for (const auto &spec : specs)
+    {
+        spec_tensor_names.emplace(spec.name);
+
+        auto tensor_it = tensors.find(spec.name);
+        if (tensor_it == tensors.end())
+        {
+            continue;
+        }
+
+        const auto &tensor = tensor_it->second->as_tensor();
+        if (tensor->get_tensor_type() != spec.type)
+        {
+            NEUROPOD_ERROR("Tensor '{}' in the {} has the wrong type", spec.name, debug_spec_name);
+        }
+
+        if (tensor->get_dims().size() != spec.dims.size())
+        {
+            NEUROPOD_ERROR("Tensor '{}' in the {} has the wrong number of dimensions", spec.name, debug_spec_name);
+        }
+
+        for (size_t i = 0; i < spec.dims.size(); i++)
+        {
+            auto dim      = tensor->get_dims()[i];
+            auto expected = spec.dims[i];
+            if (expected.value == -1)
+            {
+                continue;
+            }
+            else if (expected.value > 0) // NOLINT(readability-else-after-return)
+            {
+                if (dim != expected.value)
+                {
+                    NEUROPOD_ERROR("Dim {} of tensor '{}' in the {} has the wrong size", i, spec.name, debug_spec_name);
+                }
+            }
+            else if (expected.value < -1)
+            {
+                auto actual_it = symbol_actual_map.find(expected.symbol);
+                if (actual_it != symbol_actual_map.end())
+                {
+                    if (dim != actual_it->second)
+                    {
+                        NEUROPOD_ERROR("All dims with symbol '{}' should be the same size", expected.symbol);
+                    }
+                }
+                else
+                {
+                    symbol_actual_map[expected.symbol] = dim;
+                }
+            }
+            else
+            {
+                NEUROPOD_ERROR("Invalid value of expected shape for item in the {}", debug_spec_name);
+            }
+        }
+    }
+
+    std::vector<std::string> unexpected_tensors;
+    for (const auto &item : tensors)
+    {
+        if (spec_tensor_names.find(item.first) == spec_tensor_names.end())
+        {
+            unexpected_tensors.emplace_back(item.first);
+        }
+    }
+
+    if (!unexpected_tensors.empty())
+    {
+        NEUROPOD_ERROR("Some tensors are not found in the {}", debug_spec_name);
+    }
+}
+
+} // namespace
+
+// The previous implementation
+static void benchmark_validate_previous(benchmark::State &state)
+{
+    const auto spec   = make_spec(state.range(0));
+    const auto inputs = make_inputs(state.range(0));
+    for (auto _ : state)
+    {
+        validate_previous(inputs, spec, "input spec");
+    }
+}
+BENCHMARK(benchmark_validate_previous)->Arg(8)->Arg(128);
+
+// Compiles the spec on every call (this is what `validate_tensors_against_specs` does)
+static void benchmark_validate_uncompiled(benchmark::State &state)
+{
+    const auto spec   = make_spec(state.range(0));
+    const auto inputs = make_inputs(state.range(0));
+    for (auto _ : state)
+    {
+        neuropod::validate_tensors_against_specs(inputs, spec, "input spec");
+    }
+}
+BENCHMARK(benchmark_validate_uncompiled)->Arg(8)->Arg(128);
+
+// Compiles the spec once (this is what backends do)
+static void benchmark_validate_compiled(benchmark::State &state)
+{
+    const auto                    spec   = make_spec(state.range(0));
+    const auto                    inputs = make_inputs(state.range(0));
+    const neuropod::SpecValidator validator(spec, "input spec");
+    for (auto _ : state)
+    {
+        validator.validate(inputs);
+    }
+}
+BENCHMARK(benchmark_validate_compiled)->Arg(8)->Arg(128);
@@ -182,3 +182,58 @@ TEST(test_spec_validation, test_string_tensors)
     // The tensor matches the spec so we don't expect an error
     neuropod::validate_tensors_against_specs(inputs, SPEC);
 }
+
+TEST(test_spec_validation, test_validator_reuse)
+{
+    auto allocator = neuropod::get_generic_tensor_allocator();
+
+    const std::vector<neuropod::TensorSpec> SPEC = {
+        // ("some_symbol", 2)
+        {"x", {neuropod::Dimension("some_symbol"), 2}, neuropod::FLOAT_TENSOR},
+
+        // (None, "some_symbol")
+        {"y", {-1, neuropod::Dimension("some_symbol")}, neuropod::FLOAT_TENSOR},
+    };
+
+    const neuropod::SpecValidator validator(SPEC, "input spec");
+
+    // Symbols can resolve to different values in different calls
+    for (int64_t size = 1; size <= 3; size++)
+    {
+        neuropod::NeuropodValueMap inputs;
+        inputs["x"] = allocator->allocate_tensor<float>({size, 2});
+        inputs["y"] = allocator->allocate_tensor<float>({2, size});
+        validator.validate(inputs);
+    }
+
+    neuropod::NeuropodValueMap inputs;
+    inputs["x"] = allocator->allocate_tensor<float>({1, 2});
+    inputs["y"] = allocator->allocate_tensor<float>({2, 3});
+    EXPECT_THROW(validator.validate(inputs), std::runtime_error);
+
+    inputs.erase("y");
+    inputs["bogus"] = allocator->allocate_tensor<float>({2, 2});
+    EXPECT_THROW(validator.validate(inputs), std::runtime_error);
+}
+
+TEST(test_spec_validation, test_many_symbols)
+{
+    auto allocator = neuropod::get_generic_tensor_allocator();
+
+    // More symbols than fit on the stack
+    std::vector<neuropod::TensorSpec> spec;
+    neuropod::NeuropodValueMap        inputs;
+    for (int i = 0; i < 40; i++)
+    {
+        const auto name   = "x" + std::to_string(i);
+        const auto symbol = "symbol" + std::to_string(i);
+        spec.emplace_back(name, std::vector<neuropod::Dimension>{symbol, symbol}, neuropod::FLOAT_TENSOR);
+        inputs[name] = allocator->allocate_tensor<float>({i + 1, i + 1});
+    }
+
+    const neuropod::SpecValidator validator(spec);
+    validator.validate(inputs);
+
+    inputs["x39"] = allocator->allocate_tensor<float>({40, 1});
+    EXPECT_THROW(validator.validate(inputs), std::runtime_error);
+}
@@ -13,8 +13,41 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include "neuropod/backends/torchscript/torch_backend.hh"
 #include "neuropod/tests/test_utils.hh"
 
+namespace
+{
+
+// Counts the calls that create a new map of outputs
+class CountingTorchBackend : public neuropod::TorchNeuropodBackend
+{
+public:
+    using TorchNeuropodBackend::TorchNeuropodBackend;
+
+    int num_output_maps = 0;
+
+protected:
+    using TorchNeuropodBackend::infer_internal;
+
+    std::unique_ptr<neuropod::NeuropodValueMap> infer_internal(const neuropod::NeuropodValueMap &inputs) override
+    {
+        num_output_maps++;
+        return TorchNeuropodBackend::infer_internal(inputs);
+    }
+
+    std::unique_ptr<neuropod::NeuropodValueMap> infer_internal(const neuropod::NeuropodValueMap &inputs,
+                                                               const std::vector<std::string> &  requested_outputs,
+                                                               neuropod::NeuropodTensorAllocator &output_allocator)
+        override
+    {
+        num_output_maps++;
+        return TorchNeuropodBackend::infer_internal(inputs, requested_outputs, output_allocator);
+    }
+};
+
+} // namespace
+
 TEST(test_torchscript_backend, test_torchscript_addition_model)
 {
     // Test the TorchScript addition model using the native torchscript backend
@@ -47,6 +80,39 @@ TEST(test_torchscript_backend, invalid_dtype)
     EXPECT_THROW(model.allocate_tensor<uint64_t>({2}), std::runtime_error);
 }
 
+TEST(test_torchscript_backend, infer_into)
+{
+    const std::string path    = "neuropod/tests/test_data/torchscript_addition_model/";
+    auto              backend = std::make_shared<CountingTorchBackend>(path, neuropod::RuntimeOptions{});
+    neuropod::Neuropod model(path, backend);
+
+    auto x = model.allocate_tensor<float>({2, 2});
+    auto y = model.allocate_tensor<float>({2, 2});
+    x->copy_from({1, 2, 3, 4});
+    y->copy_from({7, 8, 9, 10});
+
+    auto                       out = model.allocate_tensor<float>({2, 2});
+    const auto                 ptr = out->get_raw_data_ptr();
+    neuropod::NeuropodValueMap outputs;
+    outputs["out"] = out;
+
+    model.infer_into({{"x", x}, {"y", y}}, outputs);
+
+    // The outputs were written directly into `out` without creating a map of outputs
+    EXPECT_EQ(backend->num_output_maps, 0);
+    EXPECT_EQ(out->get_raw_data_ptr(), ptr);
+    EXPECT_EQ(out->get_data_as_vector(), (std::vector<float>{8, 10, 12, 14}));
+
+    // Mismatched and missing outputs are errors
+    neuropod::NeuropodValueMap wrong_shape;
+    wrong_shape["out"] = model.allocate_tensor<float>({4});
+    EXPECT_THROW(model.infer_into({{"x", x}, {"y", y}}, wrong_shape), std::runtime_error);
+
+    neuropod::NeuropodValueMap missing_output;
+    missing_output["not_an_output"] = model.allocate_tensor<float>({2, 2});
+    EXPECT_THROW(model.infer_into({{"x", x}, {"y", y}}, missing_output), std::runtime_error);
+}
+
 // TODO(vip): reenable this test once we have more complete support for directly loading models
 // TEST(test_torchscript_backend, load_model_from_path)
 // {
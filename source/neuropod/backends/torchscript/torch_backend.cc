@@ -15,11 +15,14 @@ limitations under the License.
 
 #include "torch_backend.hh"
 
+#include "fmt/ranges.h"
 #include "neuropod/backends/torchscript/type_utils.hh"
+#include "neuropod/internal/neuropod_tensor_raw_data_access.hh"
 #include "neuropod/internal/tensor_types.hh"
 
 #include <caffe2/core/macros.h>
 
+#include <functional>
 #include <iostream>
 #include <mutex>
 #include <sstream>
@@ -118,23 +121,49 @@ std::shared_ptr<torch::jit::script::Module> load_model_from_path(std::istream &
     return model;
 }
 
+// Copy a torch tensor (on any device) into a tensor allocated by `allocator`
+std::unique_ptr<NeuropodTensor> copy_to_allocator(NeuropodTensorAllocator &allocator, const torch::Tensor &tensor)
+{
+    auto neuropod_tensor_type = get_neuropod_type_from_torch_type(tensor.scalar_type());
+    auto out                  = allocator.allocate_tensor(tensor.sizes().vec(), neuropod_tensor_type);
+
+    // Wrap the allocated memory and copy into it
+    // For tensors on the GPU, this copies directly from the device into `out`
+    auto dst = torch::from_blob(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*out),
+                                tensor.sizes(),
+                                torch::TensorOptions().dtype(tensor.scalar_type()));
+    dst.copy_(tensor);
+
+    return out;
+}
+
 // insert IValue to the output map at key with some type validation
-void insert_value_in_output(NeuropodValueMap & output,
-                            const std::string  name,
-                            const c10::IValue &value,
-                            const bool         has_type    = false,
-                            const TensorType   tensor_type = FLOAT_TENSOR)
+// If `output_allocator` is not null, tensors are copied into tensors allocated by it
+void insert_value_in_output(NeuropodValueMap &       output,
+                            const std::string        name,
+                            const c10::IValue &      value,
+                            NeuropodTensorAllocator *output_allocator,
+                            const bool               has_type    = false,
+                            const TensorType         tensor_type = FLOAT_TENSOR)
 {
     if (value.isTensor())
     {
-        // Torch tensor
-        // Transfer it to CPU
-        // .to(device) is a no-op if the tensor is already transferred
-        auto tensor = value.toTensor().to(torch::kCPU);
-
-        // Get the type and make a TorchNeuropodTensor
-        auto neuropod_tensor_type = get_neuropod_type_from_torch_type(tensor.scalar_type());
-        auto neuropod_tensor      = make_tensor<TorchNeuropodTensor>(neuropod_tensor_type, tensor);
+        std::unique_ptr<NeuropodTensor> neuropod_tensor;
+        if (output_allocator != nullptr)
+        {
+            neuropod_tensor = copy_to_allocator(*output_allocator, value.toTensor());
+        }
+        else
+        {
+            // Torch tensor
+            // Transfer it to CPU
+            // .to(device) is a no-op if the tensor is already transferred
+            auto tensor = value.toTensor().to(torch::kCPU);
+
+            // Get the type and make a TorchNeuropodTensor
+            auto neuropod_tensor_type = get_neuropod_type_from_torch_type(tensor.scalar_type());
+            neuropod_tensor           = make_tensor<TorchNeuropodTensor>(neuropod_tensor_type, tensor);
+        }
 
         // Add it to our output
         auto &to_set = output[name];
@@ -204,16 +233,152 @@ void insert_value_in_output(NeuropodValueMap & output,
     }
 }
 
-// Insert all the elements of a dict into a NeuropodValueMap
-void process_dict(NeuropodValueMap &output, const c10::IValue &item)
+// Write a tensor or list of strings returned by the model directly into a tensor provided by the caller
+void write_value_into(const std::string &name, const c10::IValue &value, NeuropodTensor &dst)
+{
+    if (value.isTensor())
+    {
+        const auto &tensor = value.toTensor();
+        const auto  type   = get_neuropod_type_from_torch_type(tensor.scalar_type());
+        if (type != dst.get_tensor_type())
+        {
+            NEUROPOD_ERROR(
+                "Output '{}' is of type {}, but the provided tensor is of type {}", name, type, dst.get_tensor_type());
+        }
+
+        if (!tensor.sizes().equals(dst.get_dims()))
+        {
+            NEUROPOD_ERROR("Output '{}' has shape {}, but the provided tensor has shape {}",
+                           name,
+                           tensor.sizes().vec(),
+                           dst.get_dims());
+        }
+
+        // Wrap the provided memory and copy into it (from the device if the output is on the GPU)
+        auto out = torch::from_blob(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(dst),
+                                    tensor.sizes(),
+                                    torch::TensorOptions().dtype(tensor.scalar_type()));
+        out.copy_(tensor);
+        return;
+    }
+
+#if CAFFE2_NIGHTLY_VERSION >= 20200421
+    const bool is_list = value.isList();
+#else
+    const bool is_list = value.isGenericList();
+#endif
+    if (!is_list || dst.get_tensor_type() != STRING_TENSOR)
+    {
+        NEUROPOD_ERROR("Output '{}' can't be written into a tensor of type {}. Got type '{}'",
+                       name,
+                       dst.get_tensor_type(),
+                       value.tagKind());
+    }
+
+#if CAFFE2_NIGHTLY_VERSION >= 20200421
+    const auto &list = value.toListRef();
+#else
+    const auto &list = value.toGenericListRef();
+#endif
+
+    if (list.size() != dst.get_num_elements())
+    {
+        NEUROPOD_ERROR("Output '{}' has {} elements, but the provided tensor has shape {}",
+                       name,
+                       list.size(),
+                       dst.get_dims());
+    }
+
+    auto flat = dst.as_typed_tensor<std::string>()->flat();
+    for (size_t i = 0; i < list.size(); i++)
+    {
+        flat[i] = list[i].toStringRef();
+    }
+}
+
+// Called with the name of each output of a model. If the output wasn't named by the model, `has_type` is true
+// and `tensor_type` is the type from the output spec
+using OutputVisitor = std::function<void(
+    const std::string &name, const c10::IValue &value, const bool has_type, const TensorType tensor_type)>;
+
+// Visit all the elements of a dict
+void visit_dict(const c10::IValue &item, const OutputVisitor &visit)
 {
     const auto &dict = ELEMENTS(item.toGenericDict());
     for (const auto &elem : dict)
     {
         // Get the name of the tensor
         const std::string &name = KEY(elem).toString()->string();
-        insert_value_in_output(output, name, VALUE(elem));
+        visit(name, VALUE(elem), false, FLOAT_TENSOR);
+    }
+}
+
+// Visit each output in the result of `forward`
+void visit_outputs(const c10::IValue &result, const std::vector<TensorSpec> &output_specs, const OutputVisitor &visit)
+{
+    if (result.isGenericDict())
+    {
+        visit_dict(result, visit);
+    }
+#if CAFFE2_NIGHTLY_VERSION >= 20200421
+    else if (result.isTensor() || result.isList())
+#else
+    else if (result.isTensor() || result.isGenericList())
+#endif
+    {
+        if (output_specs.empty())
+        {
+            NEUROPOD_ERROR("Model did not return dict and output spec is empty");
+        }
+        if (output_specs.size() != 1)
+        {
+            NEUROPOD_ERROR("Model did not return dict and output spec is not size 1");
+        }
+
+        visit(output_specs[0].name, result, true, output_specs[0].type);
     }
+    else if (result.isTuple())
+    {
+        auto  tuple = result.toTuple();
+        auto &elems = tuple->elements();
+
+        // Macros to handle namedtuples (Torch >= 1.3.0)
+#if CAFFE2_NIGHTLY_VERSION >= 20191010
+        const auto tuple_type     = result.type()->cast<torch::TupleType>();
+        const bool is_named_tuple = tuple_type && tuple_type->schema();
+#define GET_NAME(i) tuple_type->schema()->arguments()[i].name()
+#else
+        const bool is_named_tuple = false;
+#define GET_NAME(i) ""
+#endif
+        if (is_named_tuple)
+        {
+            // This is a named tuple
+            // NOLINTNEXTLINE(modernize-loop-convert): Can't always use a range based loop here
+            for (size_t i = 0; i < elems.size(); i++)
+            {
+                visit(GET_NAME(i), elems.at(i), false, FLOAT_TENSOR);
+            }
+        }
+        else
+        {
+            // Each item in this tuple should be a dict
+            for (const auto &item : elems)
+            {
+                if (item.isGenericDict())
+                {
+                    visit_dict(item, visit);
+                }
+                else
+                {
+                    NEUROPOD_ERROR("When returning a tuple, each item must be a dict. Got {}", item.tagKind());
+                }
+            }
+        }
+
+#undef GET_NAME
+    }
+    else { NEUROPOD_ERROR("Torchscript model output type not supported in neuropod"); }
 }
 
 // Used to avoid loading the same custom op multiple times
@@ -269,6 +434,41 @@ void TorchNeuropodBackend::load_model_internal()
     {
         output_specs_.emplace_back(tensor_spec);
     }
+
+    build_input_plan();
+}
+
+void TorchNeuropodBackend::build_input_plan()
+{
+    const auto &method    = model_->get_method("forward");
+    const auto &schema    = SCHEMA(method);
+    const auto &arguments = schema.arguments();
+
+    // Torch 1.2.0 adds a ClassType argument to every model
+    size_t first_arg = 0;
+#if CAFFE2_NIGHTLY_VERSION >= 20190717
+    if (!arguments.empty() && arguments.at(0).type()->kind() == c10::TypeKind::ClassType)
+    {
+        first_arg = 1;
+    }
+#endif
+
+    input_plan_          = InputBindingPlan();
+    input_plan_.num_args = arguments.size() - first_arg;
+
+    // Whether or not this model expects a dictionary as an input
+    if (input_plan_.num_args == 1 && arguments.at(first_arg).type()->kind() == c10::TypeKind::DictType)
+    {
+        const auto &value_type     = arguments.at(first_arg).type()->cast<torch::DictType>()->getValueType();
+        input_plan_.is_dict_input  = true;
+        input_plan_.is_tensor_dict = *value_type == *torch::TensorType::get();
+        return;
+    }
+
+    for (size_t i = first_arg; i < arguments.size(); i++)
+    {
+        input_plan_.arg_slots.emplace(arguments[i].name(), i - first_arg);
+    }
 }
 
 TorchNeuropodBackend::~TorchNeuropodBackend() = default;
@@ -293,73 +493,111 @@ torch::Device TorchNeuropodBackend::get_torch_device(NeuropodDeviceType target_d
 // Run inference
 std::unique_ptr<NeuropodValueMap> TorchNeuropodBackend::infer_internal(const NeuropodValueMap &inputs)
 {
-    torch::NoGradGuard guard;
+    return run_model(inputs, nullptr);
+}
 
-    // Get inference schema
-    const auto &method    = model_->get_method("forward");
-    const auto &schema    = SCHEMA(method);
-    const auto &arguments = schema.arguments();
+// Run inference and copy the outputs directly into tensors from `output_allocator`
+std::unique_ptr<NeuropodValueMap> TorchNeuropodBackend::infer_internal(
+    const NeuropodValueMap &        inputs,
+    const std::vector<std::string> &requested_outputs,
+    NeuropodTensorAllocator &       output_allocator)
+{
+    return filter_outputs(run_model(inputs, &output_allocator), requested_outputs);
+}
 
-    // Whether or not this model expects a dictionary as an input
-    bool is_dict_input = false;
+// Run inference and write the outputs directly into the provided tensors
+void TorchNeuropodBackend::infer_into_internal(const NeuropodValueMap &inputs, NeuropodValueMap &outputs)
+{
+    torch::NoGradGuard guard;
+    const auto         result = run_forward(inputs);
+
+    ScopedLatencyTimer timer(output_conversion_latency_);
+    size_t             num_written = 0;
+    visit_outputs(
+        result,
+        output_specs_,
+        [&](const std::string &name, const c10::IValue &value, const bool /*unused*/, const TensorType /*unused*/) {
+            auto it = outputs.find(name);
+            if (it == outputs.end())
+            {
+                // Not requested
+                return;
+            }
 
-    // Torch 1.2.0 adds a ClassType argument to every model
-    bool has_class_type = false;
+            write_value_into(name, value, *it->second->as_tensor());
+            num_written++;
+        });
 
-#if CAFFE2_NIGHTLY_VERSION >= 20190717
-    if (arguments.size() > 0 && arguments.at(0).type()->kind() == c10::TypeKind::ClassType)
+    if (num_written != outputs.size())
     {
-        has_class_type = true;
+        NEUROPOD_ERROR("Tried to request a tensor that does not exist. The model returned {} of the {} requested "
+                       "outputs",
+                       num_written,
+                       outputs.size());
     }
-#endif
+}
 
-    if (arguments.size() == 2 && has_class_type && arguments.at(1).type()->kind() == c10::TypeKind::DictType)
-    {
-        is_dict_input = true;
-    }
+std::unique_ptr<NeuropodValueMap> TorchNeuropodBackend::run_model(const NeuropodValueMap & inputs,
+                                                                  NeuropodTensorAllocator *output_allocator)
+{
+    torch::NoGradGuard guard;
+    const auto         result = run_forward(inputs);
 
-    if (arguments.size() == 1 && arguments.at(0).type()->kind() == c10::TypeKind::DictType)
-    {
-        is_dict_input = true;
-    }
+    // Get outputs
+    ScopedLatencyTimer timer(output_conversion_latency_);
+    auto               to_return = stdx::make_unique<NeuropodValueMap>();
+    visit_outputs(
+        result,
+        output_specs_,
+        [&](const std::string &name, const c10::IValue &value, const bool has_type, const TensorType tensor_type) {
+            insert_value_in_output(*to_return, name, value, output_allocator, has_type, tensor_type);
+        });
 
-    // Define the vector of inputs and add the inputs
-    std::vector<torch::jit::IValue> torch_inputs(arguments.size() - (has_class_type ? 1 : 0));
-    if (is_dict_input)
-    {
-        // This model expects a dict as input
-        MAKE_DICT(tensor_input_dict, torch::Tensor);
-        MAKE_DICT(str_input_dict, torch::List<std::string>);
+    return to_return;
+}
 
-        for (const auto &entry : inputs)
-        {
-            const auto &value = get_ivalue_from_torch_tensor(entry.second);
+c10::IValue TorchNeuropodBackend::run_forward(const NeuropodValueMap &inputs)
+{
 
-            if (value.isTensor())
+    // Fill in the arguments to `forward` using the plan computed at load time
+    std::vector<torch::jit::IValue> torch_inputs(input_plan_.num_args);
+    if (input_plan_.is_dict_input)
+    {
+        // TODO(vip): This assumes a model only takes in string "tensors" or tensors, but not both
+        // Refactor to add support for both and add documentation
+        if (input_plan_.is_tensor_dict)
+        {
+            MAKE_DICT(tensor_input_dict, torch::Tensor);
+            for (const auto &entry : inputs)
             {
-                DICT_INSERT(tensor_input_dict, entry.first, value.toTensor());
+                const auto &value = get_ivalue_from_torch_tensor(entry.second);
+                if (value.isTensor())
+                {
+                    DICT_INSERT(tensor_input_dict, entry.first, value.toTensor());
+                }
             }
-            else
+
+            torch_inputs.at(0) = tensor_input_dict;
+        }
+        else
+        {
+            MAKE_DICT(str_input_dict, torch::List<std::string>);
+            for (const auto &entry : inputs)
             {
+                const auto &value = get_ivalue_from_torch_tensor(entry.second);
+                if (!value.isTensor())
+                {
 #if CAFFE2_NIGHTLY_VERSION >= 20200421
-                DICT_INSERT(str_input_dict, entry.first, c10::impl::toTypedList<std::string>(value.toList()));
+                    DICT_INSERT(str_input_dict, entry.first, c10::impl::toTypedList<std::string>(value.toList()));
 #elif CAFFE2_NIGHTLY_VERSION >= 20190717
-                DICT_INSERT(str_input_dict, entry.first, c10::impl::toTypedList<std::string>(value.toGenericList()));
+                    DICT_INSERT(
+                        str_input_dict, entry.first, c10::impl::toTypedList<std::string>(value.toGenericList()));
 #else
-                DICT_INSERT(str_input_dict, entry.first, value);
+                    DICT_INSERT(str_input_dict, entry.first, value);
 #endif
+                }
             }
-        }
 
-        // TODO(vip): This assumes a model only takes in string "tensors" or tensors, but not both
-        // Refactor to add support for both and add documentation
-        if (*arguments.at(has_class_type ? 1 : 0).type()->cast<torch::DictType>()->getValueType() ==
-            *torch::TensorType::get())
-        {
-            torch_inputs.at(0) = tensor_input_dict;
-        }
-        else
-        {
             torch_inputs.at(0) = str_input_dict;
         }
     }
@@ -368,96 +606,23 @@ std::unique_ptr<NeuropodValueMap> TorchNeuropodBackend::infer_internal(const Neu
         // Pass inputs normally
         for (const auto &entry : inputs)
         {
-            const auto  input_name = entry.first;
-            const auto &input_data = get_ivalue_from_torch_tensor(entry.second);
-
-            const auto arg_index = schema.argumentIndexWithName(input_name);
-            if (!arg_index.has_value())
+            const auto slot = input_plan_.arg_slots.find(entry.first);
+            if (slot == input_plan_.arg_slots.end())
             {
+                const auto &method = model_->get_method("forward");
                 NEUROPOD_ERROR(
                     "An tensor named '{}' was provided, but does not exist in the input schema of the "
                     "TorchScript model. Please ensure your model expects an input with that name. Schema: {}",
-                    input_name,
-                    schema);
+                    entry.first,
+                    SCHEMA(method));
             }
 
-            torch_inputs.at(static_cast<size_t>(arg_index.value() - (has_class_type ? 1 : 0))) = input_data;
+            torch_inputs[slot->second] = get_ivalue_from_torch_tensor(entry.second);
         }
     }
 
     // Run inference
-    c10::IValue result = model_->forward(torch_inputs);
-
-    // Get outputs
-    auto to_return = stdx::make_unique<NeuropodValueMap>();
-
-    if (result.isGenericDict())
-    {
-        process_dict(*to_return, result);
-    }
-#if CAFFE2_NIGHTLY_VERSION >= 20200421
-    else if (result.isTensor() || result.isList())
-#else
-    else if (result.isTensor() || result.isGenericList())
-#endif
-    {
-        if (output_specs_.empty())
-        {
-            NEUROPOD_ERROR("Model did not return dict and output spec is empty");
-        }
-        if (output_specs_.size() != 1)
-        {
-            NEUROPOD_ERROR("Model did not return dict and output spec is not size 1");
-        }
-
-        auto &name        = output_specs_[0].name;
-        auto &tensor_type = output_specs_[0].type;
-        insert_value_in_output(*to_return, name, result, true, tensor_type);
-    }
-    else if (result.isTuple())
-    {
-        auto  tuple = result.toTuple();
-        auto &elems = tuple->elements();
-
-        // Macros to handle namedtuples (Torch >= 1.3.0)
-#if CAFFE2_NIGHTLY_VERSION >= 20191010
-        const auto tuple_type     = result.type()->cast<torch::TupleType>();
-        const bool is_named_tuple = tuple_type && tuple_type->schema();
-#define GET_NAME(i) tuple_type->schema()->arguments()[i].name()
-#else
-        const bool is_named_tuple = false;
-#define GET_NAME(i) ""
-#endif
-        if (is_named_tuple)
-        {
-            // This is a named tuple
-            // NOLINTNEXTLINE(modernize-loop-convert): Can't always use a range based loop here
-            for (size_t i = 0; i < elems.size(); i++)
-            {
-                insert_value_in_output(*to_return, GET_NAME(i), elems.at(i));
-            }
-        }
-        else
-        {
-            // Each item in this tuple should be a dict
-            for (const auto &item : elems)
-            {
-                if (item.isGenericDict())
-                {
-                    process_dict(*to_return, item);
-                }
-                else
-                {
-                    NEUROPOD_ERROR("When returning a tuple, each item must be a dict. Got {}", item.tagKind());
-                }
-            }
-        }
-
-#undef GET_NAME
-    }
-    else { NEUROPOD_ERROR("Torchscript model output type not supported in neuropod"); }
-
-    return to_return;
+    return model_->forward(torch_inputs);
 }
 
 REGISTER_NEUROPOD_BACKEND(TorchNeuropodBackend, "torchscript", STR(TORCH_VERSION))
@@ -24,6 +24,7 @@ limitations under the License.
 #include <torch/torch.h>
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace neuropod
@@ -40,19 +41,59 @@ private:
     // The model output specification from ModelConfig
     std::vector<TensorSpec> output_specs_;
 
+    // How inputs are passed to `forward`. This only depends on the schema of the model so it's
+    // computed once at load time instead of on every call to `infer`
+    struct InputBindingPlan
+    {
+        // The number of arguments to `forward` (not including `self`)
+        size_t num_args = 0;
+
+        // Whether the model takes a single dict of inputs and whether the values of that dict are tensors
+        // (vs lists of strings)
+        bool is_dict_input  = false;
+        bool is_tensor_dict = false;
+
+        // The position of each named argument in the inputs to `forward` (if this isn't a dict input)
+        std::unordered_map<std::string, size_t> arg_slots;
+    };
+
+    InputBindingPlan input_plan_;
+
+    // Inspect the schema of `forward` and build `input_plan_`
+    void build_input_plan();
+
     // Get a torch device given a target neuropod device
     // (this also depends on the visible device in the options above)
     torch::Device get_torch_device(NeuropodDeviceType target_device);
 
+    // Build the inputs to `forward` and run it
+    c10::IValue run_forward(const NeuropodValueMap &inputs);
+
+    // Run the model. If `output_allocator` is not null, output tensors are copied into tensors allocated by it
+    std::unique_ptr<NeuropodValueMap> run_model(const NeuropodValueMap & inputs,
+                                                NeuropodTensorAllocator *output_allocator);
+
 public:
     TorchNeuropodBackend(const std::string &neuropod_path, const RuntimeOptions &options);
 
     ~TorchNeuropodBackend();
 
+    // TorchScript modules can run `forward` from multiple threads at the same time
+    bool supports_concurrent_inference() const override { return true; }
+
 protected:
     // Run inference
     std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &inputs);
 
+    // Run inference and write tensor outputs directly into memory from `output_allocator`
+    // This avoids an intermediate copy to CPU for models running on GPU
+    std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &        inputs,
+                                                     const std::vector<std::string> &requested_outputs,
+                                                     NeuropodTensorAllocator &       output_allocator);
+
+    // Run inference and copy tensor outputs directly into the provided tensors (without allocating outputs)
+    void infer_into_internal(const NeuropodValueMap &inputs, NeuropodValueMap &outputs);
+
     // A method that loads the underlying model
     void load_model_internal();
 };
@@ -0,0 +1,444 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/batching_neuropod.hh"
+
+#include "fmt/ranges.h"
+#include "neuropod/internal/error_utils.hh"
+#include "neuropod/internal/logging.hh"
+#include "neuropod/internal/memory_utils.hh"
+#include "neuropod/internal/neuropod_tensor_raw_data_access.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <future>
+
+namespace neuropod
+{
+
+namespace detail
+{
+
+struct BatchRequest
+{
+    const NeuropodValueMap &        inputs;
+    const std::vector<std::string> &requested_outputs;
+
+    // The size of the batch dimension of the inputs
+    int64_t batch_size;
+
+    std::chrono::steady_clock::time_point enqueued_at;
+
+    std::promise<std::unique_ptr<NeuropodValueMap>> result;
+
+    BatchRequest(const NeuropodValueMap &inputs, const std::vector<std::string> &requested_outputs, int64_t batch_size)
+        : inputs(inputs),
+          requested_outputs(requested_outputs),
+          batch_size(batch_size),
+          enqueued_at(std::chrono::steady_clock::now())
+    {
+    }
+};
+
+} // namespace detail
+
+namespace
+{
+
+// Make sure the leading dimension of every spec can be used as the batch dimension
+void validate_batch_dims(const std::vector<TensorSpec> &specs, std::string &batch_symbol)
+{
+    for (const auto &spec : specs)
+    {
+        if (spec.dims.empty())
+        {
+            NEUROPOD_ERROR("Cannot batch requests for tensor '{}' because it has no batch dimension", spec.name);
+        }
+
+        const auto &dim = spec.dims[0];
+        if (dim.value >= 0)
+        {
+            NEUROPOD_ERROR("Cannot batch requests for tensor '{}' because its leading dimension has a fixed size "
+                           "of {}. Expected a symbol or None.",
+                           spec.name,
+                           dim.value);
+        }
+
+        if (dim.value == -2)
+        {
+            if (batch_symbol.empty())
+            {
+                batch_symbol = dim.symbol;
+            }
+            else if (batch_symbol != dim.symbol)
+            {
+                NEUROPOD_ERROR("Cannot batch requests because the leading dimensions of the model's tensors have "
+                               "different symbols ('{}' and '{}')",
+                               batch_symbol,
+                               dim.symbol);
+            }
+        }
+    }
+}
+
+// Get the size of the batch dimension of `inputs` (which must be the same for all the inputs)
+int64_t get_batch_size(const NeuropodValueMap &inputs)
+{
+    if (inputs.empty())
+    {
+        NEUROPOD_ERROR("Cannot batch a request without any inputs");
+    }
+
+    int64_t batch_size = -1;
+    for (const auto &item : inputs)
+    {
+        const auto &dims = item.second->as_tensor()->get_dims();
+        if (dims.empty())
+        {
+            NEUROPOD_ERROR("Cannot batch input '{}' because it is a scalar", item.first);
+        }
+
+        if (batch_size == -1)
+        {
+            batch_size = dims[0];
+        }
+        else if (batch_size != dims[0])
+        {
+            NEUROPOD_ERROR("All the inputs of a batched request must have the same batch size. Input '{}' has a "
+                           "batch size of {}, but expected {}",
+                           item.first,
+                           dims[0],
+                           batch_size);
+        }
+    }
+
+    return batch_size;
+}
+
+// Whether or not two requests can be combined into one batch
+bool is_compatible(const detail::BatchRequest &a, const detail::BatchRequest &b)
+{
+    if (a.requested_outputs != b.requested_outputs || a.inputs.size() != b.inputs.size())
+    {
+        return false;
+    }
+
+    for (const auto &item : a.inputs)
+    {
+        auto other = b.inputs.find(item.first);
+        if (other == b.inputs.end())
+        {
+            return false;
+        }
+
+        const auto tensor       = item.second->as_tensor();
+        const auto other_tensor = other->second->as_tensor();
+        if (tensor->get_tensor_type() != other_tensor->get_tensor_type())
+        {
+            return false;
+        }
+
+        // Everything other than the batch dimension must match
+        const auto &dims       = tensor->get_dims();
+        const auto &other_dims = other_tensor->get_dims();
+        if (!std::equal(dims.begin() + 1, dims.end(), other_dims.begin() + 1, other_dims.end()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Concatenate `parts` along the batch dimension
+std::shared_ptr<NeuropodTensor> concat(NeuropodTensorAllocator &                   allocator,
+                                       const std::vector<const NeuropodTensor *> &parts,
+                                       int64_t                                     batch_size)
+{
+    auto dims = parts[0]->get_dims();
+    dims[0]   = batch_size;
+
+    std::shared_ptr<NeuropodTensor> out = allocator.allocate_tensor(dims, parts[0]->get_tensor_type());
+    if (out->get_tensor_type() == STRING_TENSOR)
+    {
+        std::vector<std::string> data;
+        data.reserve(out->get_num_elements());
+        for (const auto part : parts)
+        {
+            const auto part_data = part->as_typed_tensor<std::string>()->get_data_as_vector();
+            data.insert(data.end(), part_data.begin(), part_data.end());
+        }
+
+        out->as_typed_tensor<std::string>()->copy_from(data);
+        return out;
+    }
+
+    const auto bytes_per_element = internal::NeuropodTensorRawDataAccess::get_bytes_per_element(*out);
+    auto       dst = static_cast<uint8_t *>(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*out));
+    for (const auto part : parts)
+    {
+        const auto num_bytes = part->get_num_elements() * bytes_per_element;
+        std::memcpy(dst, internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*part), num_bytes);
+        dst += num_bytes;
+    }
+
+    return out;
+}
+
+// Copy `batch_size` items starting at `offset` along the batch dimension of `tensor`
+std::shared_ptr<NeuropodTensor> slice(NeuropodTensorAllocator &allocator,
+                                      const NeuropodTensor &   tensor,
+                                      int64_t                  offset,
+                                      int64_t                  batch_size)
+{
+    auto dims = tensor.get_dims();
+
+    // The number of elements per item in the batch
+    const auto item_elements = dims[0] == 0 ? 0 : tensor.get_num_elements() / dims[0];
+    dims[0]                  = batch_size;
+
+    std::shared_ptr<NeuropodTensor> out = allocator.allocate_tensor(dims, tensor.get_tensor_type());
+    if (out->get_tensor_type() == STRING_TENSOR)
+    {
+        // Only read the requested range so slicing a batch of N requests doesn't copy N batches worth of strings
+        std::vector<std::string> data(batch_size * item_elements);
+        if (!data.empty())
+        {
+            const auto src = tensor.as_typed_tensor<std::string>()->flat();
+            for (size_t i = 0; i < data.size(); i++)
+            {
+                data[i] = src[offset * item_elements + i];
+            }
+        }
+
+        out->as_typed_tensor<std::string>()->copy_from(data);
+        return out;
+    }
+
+    const auto item_bytes = item_elements * internal::NeuropodTensorRawDataAccess::get_bytes_per_element(tensor);
+    const auto src = static_cast<const uint8_t *>(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(tensor));
+    std::memcpy(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*out),
+                src + offset * item_bytes,
+                batch_size * item_bytes);
+
+    return out;
+}
+
+} // namespace
+
+BatchingNeuropod::BatchingNeuropod(std::shared_ptr<Neuropod> neuropod, const BatchingOptions &batching_options)
+    : neuropod_(std::move(neuropod)), options_(batching_options)
+{
+    if (options_.max_batch_size == 0)
+    {
+        NEUROPOD_ERROR("`max_batch_size` must be greater than 0");
+    }
+
+    // Make sure we can batch requests for this model
+    std::string batch_symbol;
+    validate_batch_dims(neuropod_->get_inputs(), batch_symbol);
+    validate_batch_dims(neuropod_->get_outputs(), batch_symbol);
+
+    dispatcher_ = std::thread(&BatchingNeuropod::dispatcher_loop, this);
+}
+
+BatchingNeuropod::BatchingNeuropod(const std::string &    neuropod_path,
+                                   const BatchingOptions &batching_options,
+                                   const RuntimeOptions & options)
+    : BatchingNeuropod(std::make_shared<Neuropod>(neuropod_path, options), batching_options)
+{
+}
+
+BatchingNeuropod::~BatchingNeuropod()
+{
+    // Let the dispatcher finish any queued requests and shut down
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+
+    cv_.notify_all();
+    dispatcher_.join();
+}
+
+std::unique_ptr<NeuropodValueMap> BatchingNeuropod::infer(const NeuropodValueMap &        inputs,
+                                                          const std::vector<std::string> &requested_outputs)
+{
+    auto request = std::make_shared<detail::BatchRequest>(inputs, requested_outputs, get_batch_size(inputs));
+    auto result  = request->result.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_items_ += request->batch_size;
+        queue_.emplace_back(std::move(request));
+    }
+
+    cv_.notify_all();
+
+    // Wait for the batch containing this request to finish
+    return result.get();
+}
+
+std::vector<std::shared_ptr<detail::BatchRequest>> BatchingNeuropod::take_batch()
+{
+    // The oldest request is always part of the batch (even if it's larger than `max_batch_size`)
+    std::vector<std::shared_ptr<detail::BatchRequest>> batch = {std::move(queue_.front())};
+    queue_.pop_front();
+
+    // Add compatible requests in the order they were queued
+    int64_t batch_size = batch[0]->batch_size;
+    for (auto it = queue_.begin(); it != queue_.end();)
+    {
+        const auto &request = *it;
+        if (batch_size + request->batch_size <= static_cast<int64_t>(options_.max_batch_size) &&
+            is_compatible(*batch[0], *request))
+        {
+            batch_size += request->batch_size;
+            batch.emplace_back(std::move(*it));
+            it = queue_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    queued_items_ -= batch_size;
+    return batch;
+}
+
+void BatchingNeuropod::dispatcher_loop()
+{
+    while (true)
+    {
+        std::vector<std::shared_ptr<detail::BatchRequest>> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&] { return shutdown_ || !queue_.empty(); });
+            if (queue_.empty())
+            {
+                // We're shutting down and there's nothing left to run
+                return;
+            }
+
+            // Wait until we have enough items for a full batch or the oldest request has waited long enough
+            const auto deadline = queue_.front()->enqueued_at + std::chrono::microseconds(options_.max_queue_delay_us);
+            cv_.wait_until(lock, deadline, [&] { return shutdown_ || queued_items_ >= options_.max_batch_size; });
+
+            batch = take_batch();
+        }
+
+        run_batch(batch);
+    }
+}
+
+void BatchingNeuropod::run_batch(const std::vector<std::shared_ptr<detail::BatchRequest>> &batch)
+{
+    try
+    {
+        if (batch.size() == 1)
+        {
+            // Nothing to combine
+            auto &request = *batch[0];
+            request.result.set_value(neuropod_->infer(request.inputs, request.requested_outputs));
+            return;
+        }
+
+        SPDLOG_TRACE("Running a batch of {} requests", batch.size());
+
+        // Concatenate the inputs
+        auto    allocator  = neuropod_->get_tensor_allocator();
+        int64_t batch_size = 0;
+        for (const auto &request : batch)
+        {
+            batch_size += request->batch_size;
+        }
+
+        NeuropodValueMap batched_inputs;
+        for (const auto &item : batch[0]->inputs)
+        {
+            std::vector<const NeuropodTensor *> parts;
+            parts.reserve(batch.size());
+            for (const auto &request : batch)
+            {
+                parts.emplace_back(request->inputs.at(item.first)->as_tensor());
+            }
+
+            batched_inputs[item.first] = concat(*allocator, parts, batch_size);
+        }
+
+        // Run inference
+        const auto outputs = neuropod_->infer(batched_inputs, batch[0]->requested_outputs);
+
+        // Split the outputs back up
+        std::vector<std::unique_ptr<NeuropodValueMap>> results;
+        results.reserve(batch.size());
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            results.emplace_back(stdx::make_unique<NeuropodValueMap>());
+        }
+
+        for (const auto &item : *outputs)
+        {
+            const auto  tensor = item.second->as_tensor();
+            const auto &dims   = tensor->get_dims();
+            if (dims.empty() || dims[0] != batch_size)
+            {
+                NEUROPOD_ERROR("Expected the batch dimension of output '{}' to be {}, but got a tensor with shape {}",
+                               item.first,
+                               batch_size,
+                               dims);
+            }
+
+            int64_t offset = 0;
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                (*results[i])[item.first] = slice(*allocator, *tensor, offset, batch[i]->batch_size);
+                offset += batch[i]->batch_size;
+            }
+        }
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            batch[i]->result.set_value(std::move(results[i]));
+        }
+    }
+    catch (...)
+    {
+        // Pass the error to every request in the batch
+        for (const auto &request : batch)
+        {
+            request->result.set_exception(std::current_exception());
+        }
+    }
+}
+
+const std::vector<TensorSpec> &BatchingNeuropod::get_inputs() const
+{
+    return neuropod_->get_inputs();
+}
+
+const std::vector<TensorSpec> &BatchingNeuropod::get_outputs() const
+{
+    return neuropod_->get_outputs();
+}
+
+std::shared_ptr<NeuropodTensorAllocator> BatchingNeuropod::get_tensor_allocator()
+{
+    return neuropod_->get_tensor_allocator();
+}
+
+} // namespace neuropod
@@ -0,0 +1,114 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "neuropod/neuropod.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace neuropod
+{
+
+struct BatchingOptions
+{
+    // The maximum number of items (the sum of the batch dimensions of the requests) in a batch
+    // Requests that are larger than this run in a batch by themselves
+    size_t max_batch_size = 32;
+
+    // The maximum amount of time a request waits for other requests to batch with before
+    // inference is run
+    size_t max_queue_delay_us = 1000;
+};
+
+namespace detail
+{
+
+// A queued call to `BatchingNeuropod::infer`
+struct BatchRequest;
+
+} // namespace detail
+
+// A wrapper around a `Neuropod` that combines concurrent calls to `infer` into a single call to the
+// underlying model.
+//
+// The leading dimension of every input and output in the model spec must be the batch dimension
+// (i.e. the same symbol (e.g. `batch_size`) or unspecified). Queued requests are concatenated along the
+// batch dimension until the batch reaches `max_batch_size` items or the oldest request has waited for
+// `max_queue_delay_us`. Inference is then run once and the outputs are split back up per request.
+//
+// Requests are only batched together if they have the same inputs (with the same types and
+// non-batch dimensions) and request the same outputs.
+//
+// Note: the underlying model is only called from a single thread so this can also be used
+// with backends that don't support concurrent inference
+class BatchingNeuropod
+{
+private:
+    std::shared_ptr<Neuropod> neuropod_;
+
+    BatchingOptions options_;
+
+    // Queued requests
+    std::deque<std::shared_ptr<detail::BatchRequest>> queue_;
+    std::mutex                                        mutex_;
+    std::condition_variable                           cv_;
+    bool                                              shutdown_ = false;
+
+    // The total number of items (along the batch dimension) in `queue_`
+    size_t queued_items_ = 0;
+
+    // The thread that builds batches and runs inference
+    std::thread dispatcher_;
+
+    void dispatcher_loop();
+
+    // Remove a batch of compatible requests from the queue
+    // Note: `mutex_` must be held when calling this
+    std::vector<std::shared_ptr<detail::BatchRequest>> take_batch();
+
+    // Run inference for a batch of requests and set their results
+    void run_batch(const std::vector<std::shared_ptr<detail::BatchRequest>> &batch);
+
+public:
+    BatchingNeuropod(std::shared_ptr<Neuropod> neuropod, const BatchingOptions &batching_options = {});
+
+    // Load a neuropod and batch requests to it
+    BatchingNeuropod(const std::string &    neuropod_path,
+                     const BatchingOptions &batching_options = {},
+                     const RuntimeOptions & options          = {});
+
+    ~BatchingNeuropod();
+
+    // Run inference. This blocks until the batch containing this request is complete.
+    // Note: this is threadsafe
+    std::unique_ptr<NeuropodValueMap> infer(const NeuropodValueMap &        inputs,
+                                            const std::vector<std::string> &requested_outputs = {});
+
+    // Get the inputs and outputs of the underlying Neuropod
+    const std::vector<TensorSpec> &get_inputs() const;
+    const std::vector<TensorSpec> &get_outputs() const;
+
+    // Returns a tensor allocator that can allocate tensors compatible with the underlying neuropod
+    std::shared_ptr<NeuropodTensorAllocator> get_tensor_allocator();
+};
+
+} // namespace neuropod
@@ -23,6 +23,8 @@ limitations under the License.
 #include "neuropod/bindings/c/np_valuemap_internal.h"
 #include "neuropod/core/generic_tensor.hh"
 
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <string>
 #include <vector>
@@ -35,8 +37,21 @@ void NP_LoadNeuropodWithOpts(const char *             neuropod_path,
 {
     try
     {
+        neuropod::RuntimeOptions cpp_options;
+        cpp_options.use_ope                         = options->use_ope;
+        cpp_options.visible_device                  = static_cast<neuropod::NeuropodDevice>(options->visible_device);
+        cpp_options.load_model_at_construction      = options->load_model_at_construction;
+        cpp_options.disable_shape_and_type_checking = options->disable_shape_and_type_checking;
+        cpp_options.num_async_threads               = options->num_async_threads;
+
+        auto &ope_options                   = cpp_options.ope_options;
+        ope_options.free_memory_every_cycle = options->ope_options.free_memory_every_cycle;
+        ope_options.control_queue_name      = std::string(
+            options->ope_options.control_queue_name,
+            strnlen(options->ope_options.control_queue_name, sizeof(options->ope_options.control_queue_name)));
+
         *model          = new NP_Neuropod();
-        (*model)->model = std::make_unique<neuropod::Neuropod>(neuropod_path);
+        (*model)->model = std::make_unique<neuropod::Neuropod>(neuropod_path, cpp_options);
         NP_ClearStatus(status);
     }
     catch (std::exception &e)
@@ -57,6 +72,7 @@ NP_RuntimeOptions NP_DefaultRuntimeOptions()
     options.visible_device                  = static_cast<NP_RuntimeOptions::NP_Device>(default_options.visible_device);
     options.load_model_at_construction      = default_options.load_model_at_construction;
     options.disable_shape_and_type_checking = default_options.disable_shape_and_type_checking;
+    options.num_async_threads               = default_options.num_async_threads;
 
     auto ope_options                     = &options.ope_options;
     ope_options->free_memory_every_cycle = default_options.ope_options.free_memory_every_cycle;
@@ -118,6 +134,61 @@ void NP_InferWithRequestedOutputs(NP_Neuropod *              model,
     }
 }
 
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
+void NP_InferAsync(NP_Neuropod *              model,
+                   const NP_NeuropodValueMap *inputs,
+                   size_t                     noutputs,
+                   const char **              requested_outputs,
+                   NP_InferCallback           callback,
+                   void *                     user_data,
+                   NP_Status *                status)
+{
+    try
+    {
+        std::vector<std::string> rout;
+        if (requested_outputs != nullptr)
+        {
+            for (size_t i = 0; i < noutputs; ++i)
+            {
+                rout.emplace_back(requested_outputs[i]);
+            }
+        }
+
+        model->model->infer_async(
+            inputs->data,
+            rout,
+            [callback, user_data](std::unique_ptr<neuropod::NeuropodValueMap> result, std::exception_ptr error) {
+                NP_Status            callback_status;
+                NP_NeuropodValueMap *outputs = nullptr;
+                try
+                {
+                    if (error)
+                    {
+                        std::rethrow_exception(error);
+                    }
+
+                    outputs       = new NP_NeuropodValueMap();
+                    outputs->data = std::move(*result);
+                    NP_ClearStatus(&callback_status);
+                }
+                catch (std::exception &e)
+                {
+                    callback_status.code    = NEUROPOD_ERROR;
+                    callback_status.message = e.what();
+                }
+
+                callback(outputs, &callback_status, user_data);
+            });
+
+        NP_ClearStatus(status);
+    }
+    catch (std::exception &e)
+    {
+        status->code    = NEUROPOD_ERROR;
+        status->message = e.what();
+    }
+}
+
 // NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
 const char *NP_GetName(NP_Neuropod *model)
 {
@@ -142,6 +213,44 @@ size_t NP_GetNumOutputs(NP_Neuropod *model)
     return model->model->get_outputs().size();
 }
 
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
+NP_LatencyStats *NP_GetStats(NP_Neuropod *model, size_t *num_stats)
+{
+    const auto stats = model->model->get_stats();
+
+    auto   out = static_cast<NP_LatencyStats *>(malloc(sizeof(NP_LatencyStats) * stats.size()));
+    size_t i   = 0;
+    for (const auto &item : stats)
+    {
+        const auto &stage = item.second;
+
+        out[i].name    = strdup(item.first.c_str());
+        out[i].count   = stage.count;
+        out[i].mean_us = stage.mean_us;
+        out[i].min_us  = stage.min_us;
+        out[i].max_us  = stage.max_us;
+        out[i].p50_us  = stage.p50_us;
+        out[i].p90_us  = stage.p90_us;
+        out[i].p99_us  = stage.p99_us;
+        out[i].p999_us = stage.p999_us;
+        i++;
+    }
+
+    *num_stats = stats.size();
+    return out;
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
+void NP_FreeLatencyStats(NP_LatencyStats *stats, size_t num_stats)
+{
+    for (size_t i = 0; i < num_stats; i++)
+    {
+        free(const_cast<char *>(stats[i].name));
+    }
+
+    free(stats);
+}
+
 // NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
 NP_TensorAllocator *NP_GetAllocator(NP_Neuropod *model)
 {
@@ -17,6 +17,7 @@ limitations under the License.
 
 #pragma once
 
+#include "neuropod/bindings/c/np_latency_stats.h"
 #include "neuropod/bindings/c/np_status.h"
 #include "neuropod/bindings/c/np_tensor.h"
 #include "neuropod/bindings/c/np_tensor_allocator.h"
@@ -62,8 +63,12 @@ typedef struct NP_RuntimeOptions
         GPU7 = 7
     } visible_device;
 
+    // There is no way to load a model after construction from the C API so this should be true
     bool load_model_at_construction;
     bool disable_shape_and_type_checking;
+
+    // The number of threads used to run NP_InferAsync requests
+    size_t num_async_threads;
 } NP_RuntimeOptions;
 
 // Creates default runtime options that used implicitly when load model w/o options.
@@ -96,6 +101,25 @@ void NP_InferWithRequestedOutputs(NP_Neuropod *              model,
                                   NP_NeuropodValueMap **     outputs,
                                   NP_Status *                status);
 
+// Called when an async inference request completes.
+// On success, `outputs` contains the outputs and the caller is responsible for freeing it.
+// On failure, `outputs` is NULL. `status` is only valid until the callback returns.
+// Note: This is called from an internal thread
+typedef void (*NP_InferCallback)(NP_NeuropodValueMap *outputs, NP_Status *status, void *user_data);
+
+// Run inference asynchronously and call `callback` with `user_data` once it is done.
+// requested_outputs and noutputs are the same as in NP_InferWithRequestedOutputs (pass 0 and NULL to get all
+// the outputs). The inputs and requested_outputs are copied so they can be freed as soon as this returns.
+// `status` is only set if the request could not be started (in which case `callback` is not called).
+// Note: The model can be freed before all the callbacks have run (including from within a callback).
+void NP_InferAsync(NP_Neuropod *              model,
+                   const NP_NeuropodValueMap *inputs,
+                   size_t                     noutputs,
+                   const char **              requested_outputs,
+                   NP_InferCallback           callback,
+                   void *                     user_data,
+                   NP_Status *                status);
+
 // Get name of the model.
 const char *NP_GetName(NP_Neuropod *model);
 
@@ -118,6 +142,11 @@ NP_TensorSpec *NP_GetInputSpec(NP_Neuropod *model, size_t index);
 // Note: The caller is responsible for freeing the returned TensorSpec
 NP_TensorSpec *NP_GetOutputSpec(NP_Neuropod *model, size_t index);
 
+// Get latency stats for each stage of loading and inference (e.g. "load", "infer", "sealing").
+// `num_stats` is set to the number of items in the returned array.
+// Note: The caller is responsible for freeing the returned array with NP_FreeLatencyStats
+NP_LatencyStats *NP_GetStats(NP_Neuropod *model, size_t *num_stats);
+
 // Get an allocator for a model.
 // Note: The caller is responsible for freeing the returned TensorAllocator
 NP_TensorAllocator *NP_GetAllocator(NP_Neuropod *model);
@@ -0,0 +1,50 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Inspired by the TensorFlow C API
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Latency stats for one stage of loading or inference. See neuropod/internal/latency_stats.hh
+// All times are in microseconds
+typedef struct NP_LatencyStats
+{
+    // The name of the stage (e.g. "infer")
+    const char *name;
+
+    // The number of times this stage was recorded
+    uint64_t count;
+
+    double mean_us;
+    double min_us;
+    double max_us;
+    double p50_us;
+    double p90_us;
+    double p99_us;
+    double p999_us;
+} NP_LatencyStats;
+
+// Free an array of NP_LatencyStats returned by NP_GetStats
+void NP_FreeLatencyStats(NP_LatencyStats *stats, size_t num_stats);
+
+#ifdef __cplusplus
+}
+#endif
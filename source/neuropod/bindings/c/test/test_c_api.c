@@ -24,6 +24,7 @@ limitations under the License.
 #error "This file should be compiled as C code, not as C++."
 #endif
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -240,6 +241,166 @@ static void TestLoadAndInferenceWithOptions(void)
     NP_FreeNeuropod(model);
 }
 
+// The state shared between TestInferAsync and the callback
+typedef struct AsyncResult
+{
+    pthread_mutex_t      mutex;
+    pthread_cond_t       cond;
+    int                  done;
+    NP_Code              code;
+    NP_NeuropodValueMap *outputs;
+} AsyncResult;
+
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
+static void OnInferDone(NP_NeuropodValueMap *outputs, NP_Status *status, void *user_data)
+{
+    AsyncResult *result = (AsyncResult *) user_data;
+    pthread_mutex_lock(&result->mutex);
+    result->done    = 1;
+    result->code    = NP_GetCode(status);
+    result->outputs = outputs;
+    pthread_cond_signal(&result->cond);
+    pthread_mutex_unlock(&result->mutex);
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
+static void WaitForResult(AsyncResult *result)
+{
+    pthread_mutex_lock(&result->mutex);
+    while (!result->done)
+    {
+        pthread_cond_wait(&result->cond, &result->mutex);
+    }
+    pthread_mutex_unlock(&result->mutex);
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
+static void TestInferAsync(void)
+{
+    NP_Neuropod *model  = NULL;
+    NP_Status *  status = NP_NewStatus();
+
+    NP_RuntimeOptions opts = NP_DefaultRuntimeOptions();
+    ASSERT_EQ(1, opts.num_async_threads);
+    opts.num_async_threads = 2;
+    NP_LoadNeuropodWithOpts("neuropod/tests/test_data/tf_addition_model/", &opts, &model, status);
+    ASSERT_EQ(NP_GetCode(status), NEUROPOD_OK);
+
+    NP_TensorAllocator *allocator = NP_GetAllocator(model);
+    int64_t             dims[]    = {2, 2};
+    NP_NeuropodTensor * x         = NP_AllocateTensor(allocator, sizeof(dims) / sizeof(int64_t), dims, FLOAT_TENSOR);
+    NP_NeuropodTensor * y         = NP_AllocateTensor(allocator, sizeof(dims) / sizeof(int64_t), dims, FLOAT_TENSOR);
+
+    const float x_data[] = {1, 2, 3, 4};
+    const float y_data[] = {7, 8, 9, 10};
+    const float target[] = {8, 10, 12, 14};
+    memcpy(NP_GetData(x), x_data, sizeof(x_data));
+    memcpy(NP_GetData(y), y_data, sizeof(y_data));
+
+    NP_NeuropodValueMap *inputs = NP_NewValueMap();
+    NP_InsertTensor(inputs, "x", x);
+    NP_InsertTensor(inputs, "y", y);
+    NP_FreeTensor(x);
+    NP_FreeTensor(y);
+    NP_FreeAllocator(allocator);
+
+    // Run succcessful inference
+    AsyncResult result = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, NEUROPOD_ERROR, NULL};
+    NP_InferAsync(model, inputs, 0, NULL, OnInferDone, &result, status);
+    ASSERT_EQ(NP_GetCode(status), NEUROPOD_OK);
+
+    // The inputs are copied so they can be freed before inference is done
+    NP_FreeValueMap(inputs);
+
+    WaitForResult(&result);
+    ASSERT_EQ(result.code, NEUROPOD_OK);
+    ASSERT_NE(result.outputs, NULL);
+
+    NP_NeuropodTensor *out      = NP_GetTensor(result.outputs, "out");
+    float *            out_data = (float *) NP_GetData(out);
+    for (size_t i = 0; i < NP_GetNumElements(out); ++i)
+    {
+        ASSERT_EQ(out_data[i], target[i]);
+    }
+
+    NP_FreeTensor(out);
+    NP_FreeValueMap(result.outputs);
+
+    // Errors are passed to the callback
+    AsyncResult          error_result = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, NEUROPOD_OK, NULL};
+    NP_NeuropodValueMap *empty_inputs = NP_NewValueMap();
+    NP_InferAsync(model, empty_inputs, 0, NULL, OnInferDone, &error_result, status);
+    ASSERT_EQ(NP_GetCode(status), NEUROPOD_OK);
+    NP_FreeValueMap(empty_inputs);
+
+    WaitForResult(&error_result);
+    ASSERT_EQ(error_result.code, NEUROPOD_ERROR);
+    ASSERT_EQ(error_result.outputs, NULL);
+
+    NP_DeleteStatus(status);
+    NP_FreeNeuropod(model);
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
+static void TestStats(void)
+{
+    NP_Neuropod *model  = NULL;
+    NP_Status *  status = NP_NewStatus();
+    NP_LoadNeuropod("neuropod/tests/test_data/tf_addition_model/", &model, status);
+    ASSERT_EQ(NP_GetCode(status), NEUROPOD_OK);
+
+    // Run inference a few times
+    NP_TensorAllocator *allocator = NP_GetAllocator(model);
+    int64_t             dims[]    = {2, 2};
+    NP_NeuropodTensor * x         = NP_AllocateTensor(allocator, sizeof(dims) / sizeof(int64_t), dims, FLOAT_TENSOR);
+    NP_NeuropodTensor * y         = NP_AllocateTensor(allocator, sizeof(dims) / sizeof(int64_t), dims, FLOAT_TENSOR);
+
+    NP_NeuropodValueMap *inputs = NP_NewValueMap();
+    NP_InsertTensor(inputs, "x", x);
+    NP_InsertTensor(inputs, "y", y);
+    for (int i = 0; i < 3; i++)
+    {
+        NP_NeuropodValueMap *outputs;
+        NP_Infer(model, inputs, &outputs, status);
+        ASSERT_EQ(NP_GetCode(status), NEUROPOD_OK);
+        NP_FreeValueMap(outputs);
+    }
+
+    // Check the load and end to end inference stats
+    size_t           num_stats;
+    NP_LatencyStats *stats = NP_GetStats(model, &num_stats);
+    ASSERT_NE(stats, NULL);
+
+    bool found_load  = false;
+    bool found_infer = false;
+    for (size_t i = 0; i < num_stats; i++)
+    {
+        if (strcmp(stats[i].name, "load") == 0)
+        {
+            ASSERT_EQ(stats[i].count, 1);
+            found_load = true;
+        }
+        else if (strcmp(stats[i].name, "infer") == 0)
+        {
+            ASSERT_EQ(stats[i].count, 3);
+            CHECK(stats[i].min_us <= stats[i].p99_us);
+            CHECK(stats[i].p99_us <= stats[i].max_us);
+            found_infer = true;
+        }
+    }
+
+    CHECK(found_load);
+    CHECK(found_infer);
+
+    NP_FreeLatencyStats(stats, num_stats);
+    NP_FreeValueMap(inputs);
+    NP_FreeTensor(x);
+    NP_FreeTensor(y);
+    NP_FreeAllocator(allocator);
+    NP_DeleteStatus(status);
+    NP_FreeNeuropod(model);
+}
+
 // NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for C API methods
 static void TestTensorGetters(void)
 {
@@ -275,6 +436,8 @@ static void RunTests(void)
 {
     TestLoadAndInference();
     TestLoadAndInferenceWithOptions();
+    TestInferAsync();
+    TestStats();
     TestTensorGetters();
 }
 
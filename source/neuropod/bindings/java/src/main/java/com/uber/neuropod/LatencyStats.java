@@ -0,0 +1,141 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+package com.uber.neuropod;
+
+/**
+ * Latency stats for one stage of loading or inference (e.g. "infer"). All times are in microseconds.
+ * Percentiles are estimated from a histogram.
+ */
+public class LatencyStats {
+    private long count;
+    private double meanUs;
+    private double minUs;
+    private double maxUs;
+    private double p50Us;
+    private double p90Us;
+    private double p99Us;
+    private double p999Us;
+
+    /**
+     * Instantiates new latency stats.
+     *
+     * @param count  the number of times the stage was recorded
+     * @param meanUs the mean
+     * @param minUs  the min
+     * @param maxUs  the max
+     * @param p50Us  the 50th percentile
+     * @param p90Us  the 90th percentile
+     * @param p99Us  the 99th percentile
+     * @param p999Us the 99.9th percentile
+     */
+    public LatencyStats(long count, double meanUs, double minUs, double maxUs, double p50Us, double p90Us,
+                        double p99Us, double p999Us) {
+        this.count = count;
+        this.meanUs = meanUs;
+        this.minUs = minUs;
+        this.maxUs = maxUs;
+        this.p50Us = p50Us;
+        this.p90Us = p90Us;
+        this.p99Us = p99Us;
+        this.p999Us = p999Us;
+    }
+
+    /**
+     * Gets the number of times the stage was recorded.
+     *
+     * @return the count
+     */
+    public long getCount() {
+        return count;
+    }
+
+    /**
+     * Gets the mean.
+     *
+     * @return the mean in microseconds
+     */
+    public double getMeanUs() {
+        return meanUs;
+    }
+
+    /**
+     * Gets the min.
+     *
+     * @return the min in microseconds
+     */
+    public double getMinUs() {
+        return minUs;
+    }
+
+    /**
+     * Gets the max.
+     *
+     * @return the max in microseconds
+     */
+    public double getMaxUs() {
+        return maxUs;
+    }
+
+    /**
+     * Gets the 50th percentile.
+     *
+     * @return the 50th percentile in microseconds
+     */
+    public double getP50Us() {
+        return p50Us;
+    }
+
+    /**
+     * Gets the 90th percentile.
+     *
+     * @return the 90th percentile in microseconds
+     */
+    public double getP90Us() {
+        return p90Us;
+    }
+
+    /**
+     * Gets the 99th percentile.
+     *
+     * @return the 99th percentile in microseconds
+     */
+    public double getP99Us() {
+        return p99Us;
+    }
+
+    /**
+     * Gets the 99.9th percentile.
+     *
+     * @return the 99.9th percentile in microseconds
+     */
+    public double getP999Us() {
+        return p999Us;
+    }
+
+    @Override
+    public String toString() {
+        return "LatencyStats{" +
+                "count=" + count +
+                ", meanUs=" + meanUs +
+                ", minUs=" + minUs +
+                ", maxUs=" + maxUs +
+                ", p50Us=" + p50Us +
+                ", p90Us=" + p90Us +
+                ", p99Us=" + p99Us +
+                ", p999Us=" + p999Us +
+                '}';
+    }
+}
@@ -17,6 +17,7 @@ package com.uber.neuropod;
 
 import java.util.List;
 import java.util.Map;
+import java.util.concurrent.CompletableFuture;
 
 /**
  * This class holds the information of a Neuropod model. It has its underlying C++ Neuropod
@@ -90,6 +91,33 @@ public class Neuropod extends NativeClass {
         return nativeInfer(inputs.entrySet().toArray(), requestedOutputs, super.getNativeHandle());
     }
 
+    /**
+     * Run inference asynchronously on the internal executor (see RuntimeOptions.numAsyncThreads).
+     * The returned future is completed from a native thread.
+     *
+     * @param inputs the inputs
+     * @return a future for the inference result
+     */
+    public CompletableFuture<Map<String, NeuropodTensor>> inferAsync(Map<String, NeuropodTensor> inputs) {
+        return inferAsync(inputs, null);
+    }
+
+    /**
+     * Run inference asynchronously, only get output tensor with the keys specified by requestOutputs.
+     * The inputs are retained by the native side so they may be closed once this returns.
+     * Errors during inference complete the future exceptionally with a NeuropodJNIException.
+     *
+     * @param inputs           the inputs
+     * @param requestedOutputs only tensor with these keys will be output
+     * @return a future for the inference result
+     */
+    public CompletableFuture<Map<String, NeuropodTensor>> inferAsync(Map<String, NeuropodTensor> inputs,
+                                                                      List<String> requestedOutputs) {
+        CompletableFuture<Map<String, NeuropodTensor>> future = new CompletableFuture<>();
+        nativeInferAsync(inputs.entrySet().toArray(), requestedOutputs, super.getNativeHandle(), future);
+        return future;
+    }
+
     /**
      * Gets input tensor specs
      *
@@ -108,6 +136,16 @@ public class Neuropod extends NativeClass {
         return nativeGetOutputs(super.getNativeHandle());
     }
 
+    /**
+     * Gets latency stats for each stage of loading and inference (e.g. "load", "infer", "sealing").
+     * Stats are recorded for every successful call and are cumulative since the model was loaded.
+     *
+     * @return a map from stage name to the latency stats for that stage
+     */
+    public Map<String, LatencyStats> getStats() {
+        return nativeGetStats(super.getNativeHandle());
+    }
+
     /**
      * Load model. Used when setLoadModelAtConstruction is set to false in RuntimeOptions
      */
@@ -145,6 +183,8 @@ public class Neuropod extends NativeClass {
 
     private static native List<TensorSpec> nativeGetOutputs(long modelHandle);
 
+    private static native Map<String, LatencyStats> nativeGetStats(long modelHandle);
+
     private static native long nativeGetAllocator(long modelHandle);
 
     private static native long nativeGetGenericAllocator();
@@ -152,6 +192,9 @@ public class Neuropod extends NativeClass {
     private static native Map<String, NeuropodTensor> nativeInfer(Object[] inputs, List<String> requestedOutputs,
                                                                   long modelHandle);
 
+    private static native void nativeInferAsync(Object[] inputs, List<String> requestedOutputs, long modelHandle,
+                                                CompletableFuture<Map<String, NeuropodTensor>> future);
+
     @Override
     protected native void nativeDelete(long handle);
 }
@@ -78,6 +78,14 @@ public class RuntimeOptions {
      */
     public boolean disableShapeAndTypeChecking = false;
 
+    /**
+     * The number of async threads.
+     * <p>
+     * The number of threads used to run Neuropod.inferAsync requests. Values above 1
+     * only help if the backend supports concurrent inference.
+     */
+    public int numAsyncThreads = 1;
+
     /**
      * Instantiates a new Runtime options.
      */
@@ -95,7 +103,8 @@ public class RuntimeOptions {
                 controlQueueName,
                 visibleDevice,
                 loadModelAtConstruction,
-                disableShapeAndTypeChecking);
+                disableShapeAndTypeChecking,
+                numAsyncThreads);
     }
 
     /**
@@ -112,19 +121,22 @@ public class RuntimeOptions {
          * @param visibleDevice               the visible device
          * @param loadModelAtConstruction     the load model at construction
          * @param disableShapeAndTypeChecking the disable shape and type checking
+         * @param numAsyncThreads             the number of async threads
          */
         RuntimeOptionsNative(boolean useOpe,
                              boolean freeMemoryEveryCycle,
                              String controlQueueName,
                              int visibleDevice,
                              boolean loadModelAtConstruction,
-                             boolean disableShapeAndTypeChecking) {
+                             boolean disableShapeAndTypeChecking,
+                             int numAsyncThreads) {
             super(nativeCreate(useOpe,
                     freeMemoryEveryCycle,
                     controlQueueName,
                     visibleDevice,
                     loadModelAtConstruction,
-                    disableShapeAndTypeChecking));
+                    disableShapeAndTypeChecking,
+                    numAsyncThreads));
         }
 
         static private native long nativeCreate(boolean useOpe,
@@ -132,7 +144,8 @@ public class RuntimeOptions {
                                                 String controlQueueName,
                                                 int visibleDevice,
                                                 boolean loadModelAtConstruction,
-                                                boolean disableShapeAndTypeChecking);
+                                                boolean disableShapeAndTypeChecking,
+                                                int numAsyncThreads);
 
         @Override
         protected native void nativeDelete(long handle);
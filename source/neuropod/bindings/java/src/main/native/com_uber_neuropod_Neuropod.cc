@@ -78,6 +78,120 @@ jobject toJavaTensorSpecList(JNIEnv *env, const std::vector<neuropod::TensorSpec
     return ret;
 }
 
+std::vector<std::string> toRequestedOutputs(JNIEnv *env, jobject requestedOutputsJava)
+{
+    std::vector<std::string> requestedOutputs;
+    if (requestedOutputsJava != nullptr)
+    {
+        jsize size = env->CallIntMethod(requestedOutputsJava, njni::java_util_ArrayList_size);
+        for (jsize i = 0; i < size; i++)
+        {
+            jstring element =
+                static_cast<jstring>(env->CallObjectMethod(requestedOutputsJava, njni::java_util_ArrayList_get, i));
+            requestedOutputs.emplace_back(njni::to_string(env, element));
+            env->DeleteLocalRef(element);
+        }
+    }
+    return requestedOutputs;
+}
+
+neuropod::NeuropodValueMap toNativeMap(JNIEnv *env, jobjectArray entryArray)
+{
+    jsize                      entrySize = env->GetArrayLength(entryArray);
+    neuropod::NeuropodValueMap nativeMap;
+    for (jsize i = 0; i < entrySize; i++)
+    {
+        jobject     entry = env->GetObjectArrayElement(entryArray, i);
+        std::string key   = njni::to_string(
+            env, static_cast<jstring>(env->CallObjectMethod(entry, njni::java_util_Map_Entry_getKey)));
+        jobject value        = env->CallObjectMethod(entry, njni::java_util_Map_Entry_getValue);
+        jlong   tensorHandle = env->CallLongMethod(value, njni::com_uber_neuropod_NeuropodTensor_getHandle);
+        if (tensorHandle == 0 || env->ExceptionCheck())
+        {
+            throw std::runtime_error("invalid tensor handle");
+        }
+        nativeMap.insert(
+            std::make_pair(key, *reinterpret_cast<std::shared_ptr<neuropod::NeuropodValue> *>(tensorHandle)));
+        env->DeleteLocalRef(entry);
+        env->DeleteLocalRef(value);
+    }
+    return nativeMap;
+}
+
+jobject toJavaMap(JNIEnv *env, neuropod::NeuropodValueMap &inferredMap)
+{
+    auto ret = env->NewObject(njni::java_util_HashMap, njni::java_util_HashMap_);
+    if (!ret || env->ExceptionCheck())
+    {
+        throw std::runtime_error("NewObject failed: cannot create HashMap");
+    }
+
+    for (auto &entry : inferredMap)
+    {
+        jobject javaTensor = env->NewObject(njni::com_uber_neuropod_NeuropodTensor,
+                                            njni::com_uber_neuropod_NeuropodTensor_,
+                                            reinterpret_cast<jlong>(njni::toHeap(entry.second)));
+
+        if (!javaTensor || env->ExceptionCheck())
+        {
+            throw std::runtime_error("NewObject failed: cannot create Tensor");
+        }
+
+        env->CallObjectMethod(ret, njni::java_util_HashMap_put, env->NewStringUTF(entry.first.c_str()), javaTensor);
+        env->DeleteLocalRef(javaTensor);
+    }
+    return ret;
+}
+
+// Complete a CompletableFuture with the result of an async inference request.
+// This runs on a native executor thread so it attaches to the JVM for the duration of the call.
+void completeFuture(jobject                                     future,
+                    std::unique_ptr<neuropod::NeuropodValueMap> inferredMap,
+                    std::exception_ptr                          error)
+{
+    JNIEnv *env      = nullptr;
+    bool    attached = false;
+    if (njni::java_vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_8) == JNI_EDETACHED)
+    {
+        if (njni::java_vm->AttachCurrentThread(reinterpret_cast<void **>(&env), nullptr) != JNI_OK)
+        {
+            // There is no way to report this to the caller
+            return;
+        }
+        attached = true;
+    }
+
+    try
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        jobject ret = toJavaMap(env, *inferredMap);
+        env->CallBooleanMethod(future, njni::java_util_concurrent_CompletableFuture_complete, ret);
+        env->DeleteLocalRef(ret);
+    }
+    catch (const std::exception &e)
+    {
+        // Clear any pending Java exception before calling back into Java
+        env->ExceptionClear();
+        jstring message   = env->NewStringUTF(e.what());
+        jobject exception = env->NewObject(
+            njni::com_uber_neuropod_NeuropodJNIException, njni::com_uber_neuropod_NeuropodJNIException_, message);
+        env->CallBooleanMethod(future, njni::java_util_concurrent_CompletableFuture_completeExceptionally, exception);
+        env->DeleteLocalRef(exception);
+        env->DeleteLocalRef(message);
+    }
+
+    env->ExceptionClear();
+    env->DeleteGlobalRef(future);
+    if (attached)
+    {
+        njni::java_vm->DetachCurrentThread();
+    }
+}
+
 } // namespace
 
 // NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for Java API methods
@@ -195,6 +309,47 @@ JNIEXPORT jobject JNICALL Java_com_uber_neuropod_Neuropod_nativeGetOutputs(JNIEn
     return nullptr;
 }
 
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for Java API methods
+JNIEXPORT jobject JNICALL Java_com_uber_neuropod_Neuropod_nativeGetStats(JNIEnv *env, jclass, jlong handle)
+{
+    try
+    {
+        auto    model = reinterpret_cast<neuropod::Neuropod *>(handle);
+        jobject ret   = env->NewObject(njni::java_util_HashMap, njni::java_util_HashMap_);
+        if (!ret || env->ExceptionCheck())
+        {
+            throw std::runtime_error("NewObject failed: cannot create HashMap");
+        }
+
+        for (const auto &item : model->get_stats())
+        {
+            const auto &stage = item.second;
+
+            jstring name      = env->NewStringUTF(item.first.c_str());
+            jobject javaStats = env->NewObject(njni::com_uber_neuropod_LatencyStats,
+                                               njni::com_uber_neuropod_LatencyStats_,
+                                               static_cast<jlong>(stage.count),
+                                               stage.mean_us,
+                                               stage.min_us,
+                                               stage.max_us,
+                                               stage.p50_us,
+                                               stage.p90_us,
+                                               stage.p99_us,
+                                               stage.p999_us);
+            env->CallObjectMethod(ret, njni::java_util_HashMap_put, name, javaStats);
+            env->DeleteLocalRef(name);
+            env->DeleteLocalRef(javaStats);
+        }
+
+        return ret;
+    }
+    catch (const std::exception &e)
+    {
+        njni::throw_java_exception(env, e.what());
+    }
+    return nullptr;
+}
+
 // NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for Java API methods
 JNIEXPORT jlong JNICALL Java_com_uber_neuropod_Neuropod_nativeGetAllocator(JNIEnv *env, jclass, jlong handle)
 {
@@ -231,69 +386,56 @@ JNIEXPORT jobject JNICALL Java_com_uber_neuropod_Neuropod_nativeInfer(
 {
     try
     {
-        // Prepare requestedOutputs
-        std::vector<std::string> requestedOutputs;
-        if (requestedOutputsJava != nullptr)
-        {
-            jsize size = env->CallIntMethod(requestedOutputsJava, njni::java_util_ArrayList_size);
-            for (jsize i = 0; i < size; i++)
-            {
-                jstring element =
-                    static_cast<jstring>(env->CallObjectMethod(requestedOutputsJava, njni::java_util_ArrayList_get, i));
-                requestedOutputs.emplace_back(njni::to_string(env, element));
-                env->DeleteLocalRef(element);
-            }
-        }
-
-        // Fill in NeuropodValueMap
-        jsize                      entrySize = env->GetArrayLength(entryArray);
-        neuropod::NeuropodValueMap nativeMap;
-        for (jsize i = 0; i < entrySize; i++)
-        {
-            jobject     entry = env->GetObjectArrayElement(entryArray, i);
-            std::string key   = njni::to_string(
-                env, static_cast<jstring>(env->CallObjectMethod(entry, njni::java_util_Map_Entry_getKey)));
-            jobject value        = env->CallObjectMethod(entry, njni::java_util_Map_Entry_getValue);
-            jlong   tensorHandle = env->CallLongMethod(value, njni::com_uber_neuropod_NeuropodTensor_getHandle);
-            if (tensorHandle == 0 || env->ExceptionCheck())
-            {
-                throw std::runtime_error("invalid tensor handle");
-            }
-            nativeMap.insert(
-                std::make_pair(key, *reinterpret_cast<std::shared_ptr<neuropod::NeuropodValue> *>(tensorHandle)));
-            env->DeleteLocalRef(entry);
-            env->DeleteLocalRef(value);
-        }
+        auto requestedOutputs = toRequestedOutputs(env, requestedOutputsJava);
+        auto nativeMap        = toNativeMap(env, entryArray);
 
         auto model       = reinterpret_cast<neuropod::Neuropod *>(modelHandle);
         auto inferredMap = model->infer(nativeMap, requestedOutputs);
 
         // Put data to Java Map
-        auto ret = env->NewObject(njni::java_util_HashMap, njni::java_util_HashMap_);
-        if (!ret || env->ExceptionCheck())
+        return toJavaMap(env, *inferredMap);
+    }
+    catch (const std::exception &e)
+    {
+        njni::throw_java_exception(env, e.what());
+    }
+    return nullptr;
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming): Ignore function case for Java API methods
+JNIEXPORT void JNICALL Java_com_uber_neuropod_Neuropod_nativeInferAsync(JNIEnv *     env,
+                                                                        jclass /* unused */,
+                                                                        jobjectArray entryArray,
+                                                                        jobject      requestedOutputsJava,
+                                                                        jlong        modelHandle,
+                                                                        jobject      future)
+{
+    try
+    {
+        auto requestedOutputs = toRequestedOutputs(env, requestedOutputsJava);
+        auto nativeMap        = toNativeMap(env, entryArray);
+
+        // The future is completed from another thread so it needs a global reference
+        jobject futureRef = env->NewGlobalRef(future);
+        auto    model     = reinterpret_cast<neuropod::Neuropod *>(modelHandle);
+        try
         {
-            throw std::runtime_error("NewObject failed: cannot create HashMap");
+            model->infer_async(
+                nativeMap,
+                requestedOutputs,
+                [futureRef](std::unique_ptr<neuropod::NeuropodValueMap> inferredMap, std::exception_ptr error) {
+                    completeFuture(futureRef, std::move(inferredMap), error);
+                });
         }
-
-        for (auto &entry : *inferredMap)
+        catch (...)
         {
-            jobject javaTensor = env->NewObject(njni::com_uber_neuropod_NeuropodTensor,
-                                                njni::com_uber_neuropod_NeuropodTensor_,
-                                                reinterpret_cast<jlong>(njni::toHeap(entry.second)));
-
-            if (!javaTensor || env->ExceptionCheck())
-            {
-                throw std::runtime_error("NewObject failed: cannot create Tensor");
-            }
-
-            env->CallObjectMethod(ret, njni::java_util_HashMap_put, env->NewStringUTF(entry.first.c_str()), javaTensor);
-            env->DeleteLocalRef(javaTensor);
+            // The callback won't run so it won't release the reference
+            env->DeleteGlobalRef(futureRef);
+            throw;
         }
-        return ret;
     }
     catch (const std::exception &e)
     {
         njni::throw_java_exception(env, e.what());
     }
-    return nullptr;
 }
@@ -46,6 +46,13 @@ JNIEXPORT jobject JNICALL Java_com_uber_neuropod_Neuropod_nativeGetInputs(JNIEnv
  */
 JNIEXPORT jobject JNICALL Java_com_uber_neuropod_Neuropod_nativeGetOutputs(JNIEnv *, jclass, jlong);
 
+/*
+ * Class:     com_uber_neuropod_Neuropod
+ * Method:    nativeGetStats
+ * Signature: (J)Ljava/util/Map;
+ */
+JNIEXPORT jobject JNICALL Java_com_uber_neuropod_Neuropod_nativeGetStats(JNIEnv *, jclass, jlong);
+
 /*
  * Class:     com_uber_neuropod_Neuropod
  * Method:    nativeLoadModel
@@ -88,6 +95,14 @@ JNIEXPORT jlong JNICALL Java_com_uber_neuropod_Neuropod_nativeGetGenericAllocato
  */
 JNIEXPORT jobject JNICALL Java_com_uber_neuropod_Neuropod_nativeInfer(JNIEnv *, jclass, jobjectArray, jobject, jlong);
 
+/*
+ * Class:     com_uber_neuropod_Neuropod
+ * Method:    nativeInferAsync
+ * Signature: ([Ljava/lang/Object;Ljava/util/List;JLjava/util/concurrent/CompletableFuture;)V
+ */
+JNIEXPORT void JNICALL
+Java_com_uber_neuropod_Neuropod_nativeInferAsync(JNIEnv *, jclass, jobjectArray, jobject, jlong, jobject);
+
 /*
  * Class:     com_uber_neuropod_Neuropod
  * Method:    nativeDelete
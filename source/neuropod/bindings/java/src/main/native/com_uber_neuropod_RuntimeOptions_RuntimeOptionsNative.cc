@@ -34,7 +34,8 @@ Java_com_uber_neuropod_RuntimeOptions_00024RuntimeOptionsNative_nativeCreate(JNI
                                                                              jstring  jControlQueueName,
                                                                              jint     visibleDevice,
                                                                              jboolean loadModelAtConstruction,
-                                                                             jboolean disableShapeAndTypeChecking)
+                                                                             jboolean disableShapeAndTypeChecking,
+                                                                             jint     numAsyncThreads)
 {
     try
     {
@@ -46,6 +47,7 @@ Java_com_uber_neuropod_RuntimeOptions_00024RuntimeOptionsNative_nativeCreate(JNI
         opts->visible_device                      = static_cast<int32_t>(visibleDevice);
         opts->load_model_at_construction          = (loadModelAtConstruction == JNI_TRUE);
         opts->disable_shape_and_type_checking     = (disableShapeAndTypeChecking == JNI_TRUE);
+        opts->num_async_threads                   = static_cast<size_t>(numAsyncThreads);
         return reinterpret_cast<jlong>(opts);
     }
     catch (const std::exception &e)
@@ -25,10 +25,10 @@ extern "C" {
 /*
  * Class:     com_uber_neuropod_RuntimeOptions_RuntimeOptionsNative
  * Method:    nativeCreate
- * Signature: (ZZLjava/lang/String;IZZ)J
+ * Signature: (ZZLjava/lang/String;IZZI)J
  */
 JNIEXPORT jlong JNICALL Java_com_uber_neuropod_RuntimeOptions_00024RuntimeOptionsNative_nativeCreate(
-    JNIEnv *, jclass, jboolean, jboolean, jstring, jint, jboolean, jboolean);
+    JNIEnv *, jclass, jboolean, jboolean, jstring, jint, jboolean, jboolean, jint);
 
 /*
  * Class:     com_uber_neuropod_RuntimeOptions_RuntimeOptionsNative
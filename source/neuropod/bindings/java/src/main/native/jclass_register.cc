@@ -37,6 +37,11 @@ jclass    java_util_HashMap;
 jmethodID java_util_HashMap_;
 jmethodID java_util_HashMap_put;
 
+// The inferAsync method completes a CompletableFuture from a native thread.
+jclass    java_util_concurrent_CompletableFuture;
+jmethodID java_util_concurrent_CompletableFuture_complete;
+jmethodID java_util_concurrent_CompletableFuture_completeExceptionally;
+
 jclass    java_util_Map_Entry;
 jmethodID java_util_Map_Entry_getKey;
 jmethodID java_util_Map_Entry_getValue;
@@ -50,11 +55,17 @@ jmethodID com_uber_neuropod_Dimension_symbol_;
 
 jclass com_uber_neuropod_TensorType;
 
+jclass    com_uber_neuropod_LatencyStats;
+jmethodID com_uber_neuropod_LatencyStats_;
+
 jclass    com_uber_neuropod_NeuropodTensor;
 jmethodID com_uber_neuropod_NeuropodTensor_;
 jmethodID com_uber_neuropod_NeuropodTensor_getHandle;
 
-jclass com_uber_neuropod_NeuropodJNIException;
+jclass    com_uber_neuropod_NeuropodJNIException;
+jmethodID com_uber_neuropod_NeuropodJNIException_;
+
+JavaVM *java_vm;
 
 jint JNI_VERSION = JNI_VERSION_1_8;
 
@@ -75,6 +86,7 @@ jint JNI_OnLoad(JavaVM *vm, void *reserved)
     {
         return JNI_ERR;
     }
+    java_vm = vm;
     // Move this exception class out of try catch block to avoid unexpected error when throw a java exception and the
     // exception type is wrong
     com_uber_neuropod_NeuropodJNIException =
@@ -92,6 +104,16 @@ jint JNI_OnLoad(JavaVM *vm, void *reserved)
         java_util_HashMap_put =
             get_method_id(env, java_util_HashMap, "put", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
 
+        java_util_concurrent_CompletableFuture =
+            static_cast<jclass>(env->NewGlobalRef(find_class(env, "java/util/concurrent/CompletableFuture")));
+        java_util_concurrent_CompletableFuture_complete =
+            get_method_id(env, java_util_concurrent_CompletableFuture, "complete", "(Ljava/lang/Object;)Z");
+        java_util_concurrent_CompletableFuture_completeExceptionally = get_method_id(
+            env, java_util_concurrent_CompletableFuture, "completeExceptionally", "(Ljava/lang/Throwable;)Z");
+
+        com_uber_neuropod_NeuropodJNIException_ =
+            get_method_id(env, com_uber_neuropod_NeuropodJNIException, "<init>", "(Ljava/lang/String;)V");
+
         java_util_Map_Entry          = static_cast<jclass>(env->NewGlobalRef(find_class(env, "java/util/Map$Entry")));
         java_util_Map_Entry_getKey   = get_method_id(env, java_util_Map_Entry, "getKey", "()Ljava/lang/Object;");
         java_util_Map_Entry_getValue = get_method_id(env, java_util_Map_Entry, "getValue", "()Ljava/lang/Object;");
@@ -113,6 +135,10 @@ jint JNI_OnLoad(JavaVM *vm, void *reserved)
         com_uber_neuropod_TensorType =
             static_cast<jclass>(env->NewGlobalRef(find_class(env, "com/uber/neuropod/TensorType")));
 
+        com_uber_neuropod_LatencyStats =
+            static_cast<jclass>(env->NewGlobalRef(find_class(env, "com/uber/neuropod/LatencyStats")));
+        com_uber_neuropod_LatencyStats_ = get_method_id(env, com_uber_neuropod_LatencyStats, "<init>", "(JDDDDDDD)V");
+
         com_uber_neuropod_NeuropodTensor =
             static_cast<jclass>(env->NewGlobalRef(find_class(env, "com/uber/neuropod/NeuropodTensor")));
         com_uber_neuropod_NeuropodTensor_ = get_method_id(env, com_uber_neuropod_NeuropodTensor, "<init>", "(J)V");
@@ -138,10 +164,12 @@ void JNI_OnUnload(JavaVM *vm, void *reserved)
     env->DeleteGlobalRef(java_util_ArrayList);
     env->DeleteGlobalRef(java_util_HashMap);
     env->DeleteGlobalRef(java_util_Map_Entry);
+    env->DeleteGlobalRef(java_util_concurrent_CompletableFuture);
 
     env->DeleteGlobalRef(com_uber_neuropod_Dimension);
     env->DeleteGlobalRef(com_uber_neuropod_TensorSpec);
     env->DeleteGlobalRef(com_uber_neuropod_TensorType);
+    env->DeleteGlobalRef(com_uber_neuropod_LatencyStats);
     env->DeleteGlobalRef(com_uber_neuropod_NeuropodTensor);
     env->DeleteGlobalRef(com_uber_neuropod_NeuropodJNIException);
 }
@@ -31,12 +31,19 @@ extern jclass    java_util_HashMap;
 extern jmethodID java_util_HashMap_;
 extern jmethodID java_util_HashMap_put;
 
+extern jclass    java_util_concurrent_CompletableFuture;
+extern jmethodID java_util_concurrent_CompletableFuture_complete;
+extern jmethodID java_util_concurrent_CompletableFuture_completeExceptionally;
+
 extern jclass    java_util_Map_Entry;
 extern jmethodID java_util_Map_Entry_getKey;
 extern jmethodID java_util_Map_Entry_getValue;
 
 extern jclass com_uber_neuropod_TensorType;
 
+extern jclass    com_uber_neuropod_LatencyStats;
+extern jmethodID com_uber_neuropod_LatencyStats_;
+
 extern jclass    com_uber_neuropod_TensorSpec;
 extern jmethodID com_uber_neuropod_TensorSpec_;
 
@@ -48,7 +55,11 @@ extern jclass    com_uber_neuropod_NeuropodTensor;
 extern jmethodID com_uber_neuropod_NeuropodTensor_;
 extern jmethodID com_uber_neuropod_NeuropodTensor_getHandle;
 
-extern jclass com_uber_neuropod_NeuropodJNIException;
+extern jclass    com_uber_neuropod_NeuropodJNIException;
+extern jmethodID com_uber_neuropod_NeuropodJNIException_;
+
+// The VM that loaded the library. Used to attach native threads that call back into Java
+extern JavaVM *java_vm;
 
 } // namespace jni
 } // namespace neuropod
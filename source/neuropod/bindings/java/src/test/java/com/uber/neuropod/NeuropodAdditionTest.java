@@ -25,6 +25,8 @@ import java.nio.FloatBuffer;
 import java.nio.DoubleBuffer;
 
 import java.util.*;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ExecutionException;
 
 import static org.junit.Assert.*;
 
@@ -212,6 +214,85 @@ public class NeuropodAdditionTest {
         allocator.close();
     }
 
+    @Test
+    public void inferAsync() throws Exception {
+        NeuropodTensorAllocator allocator = model.getTensorAllocator();
+        TensorType type = TensorType.FLOAT_TENSOR;
+        ByteBuffer bufferX = ByteBuffer.allocateDirect(type.getBytesPerElement() * 2).order(ByteOrder.nativeOrder());
+        bufferX.asFloatBuffer().put(new float[]{1.0f, 2.0f});
+        ByteBuffer bufferY = ByteBuffer.allocateDirect(type.getBytesPerElement() * 2).order(ByteOrder.nativeOrder());
+        bufferY.asFloatBuffer().put(new float[]{3.0f, 4.0f});
+
+        Map<String, NeuropodTensor> inputs = new HashMap<>();
+        inputs.put("x", allocator.tensorFromMemory(bufferX, new long[]{1L, 2L}, type));
+        inputs.put("y", allocator.tensorFromMemory(bufferY, new long[]{1L, 2L}, type));
+
+        List<CompletableFuture<Map<String, NeuropodTensor>>> futures = new ArrayList<>();
+        for (int i = 0; i < 4; i++) {
+            futures.add(model.inferAsync(inputs));
+        }
+
+        // The inputs are retained by the native side
+        for (NeuropodTensor tensor : inputs.values()) {
+            tensor.close();
+        }
+
+        for (CompletableFuture<Map<String, NeuropodTensor>> future : futures) {
+            Map<String, NeuropodTensor> res = future.get();
+            NeuropodTensor out = res.get("out");
+            FloatBuffer outBuffer = out.toFloatBuffer();
+            assertEquals(4.0f, outBuffer.get(0), EPSILON);
+            assertEquals(6.0f, outBuffer.get(1), EPSILON);
+            out.close();
+        }
+
+        // Errors complete the future exceptionally
+        CompletableFuture<Map<String, NeuropodTensor>> failed = model.inferAsync(new HashMap<>());
+        try {
+            failed.get();
+            fail("Exception is expected because the inputs are missing");
+        } catch (ExecutionException expected) {
+            assertTrue(expected.getCause() instanceof NeuropodJNIException);
+        }
+
+        allocator.close();
+    }
+
+    @Test
+    public void getStats() {
+        NeuropodTensorAllocator allocator = model.getTensorAllocator();
+        TensorType type = TensorType.FLOAT_TENSOR;
+        ByteBuffer bufferX = ByteBuffer.allocateDirect(type.getBytesPerElement() * 2).order(ByteOrder.nativeOrder());
+        bufferX.asFloatBuffer().put(new float[]{1.0f, 2.0f});
+        ByteBuffer bufferY = ByteBuffer.allocateDirect(type.getBytesPerElement() * 2).order(ByteOrder.nativeOrder());
+        bufferY.asFloatBuffer().put(new float[]{3.0f, 4.0f});
+
+        Map<String, NeuropodTensor> inputs = new HashMap<>();
+        inputs.put("x", allocator.tensorFromMemory(bufferX, new long[]{1L, 2L}, type));
+        inputs.put("y", allocator.tensorFromMemory(bufferY, new long[]{1L, 2L}, type));
+        for (int i = 0; i < 3; i++) {
+            for (NeuropodTensor out : model.infer(inputs).values()) {
+                out.close();
+            }
+        }
+
+        Map<String, LatencyStats> stats = model.getStats();
+        assertEquals(1, stats.get("load").getCount());
+
+        LatencyStats infer = stats.get("infer");
+        assertEquals(3, infer.getCount());
+        assertTrue(infer.getMinUs() <= infer.getP99Us());
+        assertTrue(infer.getP99Us() <= infer.getMaxUs());
+
+        // The model runs out of process
+        assertEquals(3, stats.get("ope_worker_compute").getCount());
+
+        for (NeuropodTensor tensor : inputs.values()) {
+            tensor.close();
+        }
+        allocator.close();
+    }
+
     @After
     public void tearDown() throws Exception {
         model.close();
@@ -17,13 +17,21 @@ limitations under the License.
 #include "neuropod/core/generic_tensor.hh"
 #include "neuropod/neuropod.hh"
 #include "neuropod/serialization/serialization.hh"
+#include "neuropod/serialization/stream_serialization.hh"
 
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <future>
 #include <sstream>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace neuropod
 {
 
@@ -55,12 +63,78 @@ py::dict infer(Neuropod &neuropod, py::dict &inputs_dict)
     NeuropodValueMap inputs    = from_numpy_dict(*allocator, inputs_dict);
 
     // Run inference
-    auto outputs = neuropod.infer(inputs);
+    // We don't need the GIL while running the model so we release it to let other python threads run.
+    // (The deleters of the input tensors reacquire it if necessary)
+    std::unique_ptr<NeuropodValueMap> outputs;
+    {
+        py::gil_scoped_release gil_release;
+        outputs = neuropod.infer(inputs);
+    }
 
     // Convert the outputs to a python dict of numpy arrays
     return to_numpy_dict(*outputs);
 }
 
+// The result of an asynchronous call to `infer`
+// Inference runs on a separate thread without holding the GIL
+class InferenceFuture
+{
+private:
+    std::future<std::unique_ptr<NeuropodValueMap>> future_;
+
+    // Block until inference is complete without holding the GIL
+    void wait_without_gil() const
+    {
+        py::gil_scoped_release gil_release;
+        future_.wait();
+    }
+
+public:
+    explicit InferenceFuture(std::future<std::unique_ptr<NeuropodValueMap>> future) : future_(std::move(future)) {}
+
+    ~InferenceFuture()
+    {
+        // Wait for the request to finish so its inputs are freed before the `Neuropod` can be destroyed.
+        // The executor thread may need the GIL to free numpy-backed inputs so we can't wait while holding it
+        if (future_.valid())
+        {
+            wait_without_gil();
+        }
+    }
+
+    // Whether or not inference is complete
+    bool done() const
+    {
+        return !future_.valid() || future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // Wait for inference to complete and return the outputs
+    // Rethrows any exception thrown during inference
+    py::dict result()
+    {
+        if (!future_.valid())
+        {
+            NEUROPOD_ERROR("The result of this inference call has already been retrieved");
+        }
+
+        wait_without_gil();
+        auto outputs = future_.get();
+        return to_numpy_dict(*outputs);
+    }
+};
+
+std::unique_ptr<InferenceFuture> infer_async(Neuropod &neuropod, py::dict &inputs_dict)
+{
+    // Convert the inputs while we have the GIL
+    auto allocator = neuropod.get_tensor_allocator();
+    auto inputs    = from_numpy_dict(*allocator, inputs_dict);
+
+    // Run inference on the Neuropod's executor (see `num_async_threads`). It releases its copy of the inputs
+    // before the future is ready; the copy here is freed when this function returns
+    // Note: the python `Neuropod` object is kept alive by the returned future (see `keep_alive` below)
+    return stdx::make_unique<InferenceFuture>(neuropod.infer_async(inputs));
+}
+
 py::array deserialize_tensor_binding(py::bytes buffer)
 {
     // Deserialize to a NeuropodTensor
@@ -107,6 +181,58 @@ py::bytes serialize_valuemap_binding(py::dict items)
     return py::bytes(buffer_stream.str());
 }
 
+void serialize_valuemap_to_file_binding(py::dict items, const std::string &path)
+{
+    auto allocator = get_generic_tensor_allocator();
+    auto valuemap  = from_numpy_dict(*allocator, items);
+
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        NEUROPOD_ERROR("Failed to open '{}' for writing: {}", path, strerror(errno));
+    }
+
+    // Stream the tensors to the file one at a time instead of building the whole buffer in memory
+    try
+    {
+        ValueMapStreamWriter writer(fd);
+        writer.write(valuemap);
+        writer.finish();
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+
+    close(fd);
+}
+
+py::dict deserialize_valuemap_from_file_binding(const std::string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        NEUROPOD_ERROR("Failed to open '{}' for reading: {}", path, strerror(errno));
+    }
+
+    auto             allocator = get_generic_tensor_allocator();
+    NeuropodValueMap valuemap;
+    try
+    {
+        ValueMapStreamReader reader(fd, *allocator);
+        valuemap = reader.read_all();
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+
+    close(fd);
+    return to_numpy_dict(valuemap);
+}
+
 RuntimeOptions get_options_from_kwargs(py::kwargs &kwargs)
 {
     RuntimeOptions options;
@@ -131,6 +257,10 @@ RuntimeOptions get_options_from_kwargs(py::kwargs &kwargs)
         {
             options.use_ope = value.cast<bool>();
         }
+        else if (key == "num_async_threads")
+        {
+            options.num_async_threads = value.cast<size_t>();
+        }
         else
         {
             NEUROPOD_ERROR("Got unexpected keyword argument {}", key);
@@ -157,11 +287,16 @@ PYBIND11_MODULE(neuropod_native, m)
                          const std::vector<BackendLoadSpec> &default_backend_overrides,
                          py::kwargs kwargs) { return make_neuropod(kwargs, path, default_backend_overrides); }))
         .def("infer", &infer)
+        .def("infer_async", &infer_async, py::keep_alive<0, 1>())
         .def("get_inputs", &Neuropod::get_inputs)
         .def("get_outputs", &Neuropod::get_outputs)
         .def("get_name", &Neuropod::get_name)
         .def("get_platform", &Neuropod::get_platform);
 
+    py::class_<InferenceFuture>(m, "InferenceFuture")
+        .def("done", &InferenceFuture::done)
+        .def("result", &InferenceFuture::result);
+
     py::class_<TensorSpec>(m, "TensorSpec")
         .def_readonly("name", &TensorSpec::name)
         .def_readonly("type", &TensorSpec::type)
@@ -191,6 +326,12 @@ PYBIND11_MODULE(neuropod_native, m)
     m.def("deserialize_dict",
           &deserialize_valuemap_binding,
           "Deserialize a string of bytes to a NeuropodValueMap (and return it as a dict of numpy arrays)");
+    m.def("serialize_to_file",
+          &serialize_valuemap_to_file_binding,
+          "Convert a dict of numpy arrays to a NeuropodValueMap and stream it to a file");
+    m.def("deserialize_dict_from_file",
+          &deserialize_valuemap_from_file_binding,
+          "Read a file written by `serialize_to_file` (and return it as a dict of numpy arrays)");
 }
 
 } // namespace neuropod
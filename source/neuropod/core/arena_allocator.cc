@@ -0,0 +1,158 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/core/arena_allocator.hh"
+
+#include "neuropod/core/generic_tensor.hh"
+#include "neuropod/internal/error_utils.hh"
+
+#include <algorithm>
+
+namespace neuropod
+{
+
+namespace detail
+{
+
+namespace
+{
+
+constexpr size_t ARENA_ALIGNMENT = 64;
+
+size_t round_up(size_t num_bytes)
+{
+    return (num_bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+} // namespace
+
+TensorArena::TensorArena(size_t initial_size_bytes)
+{
+    add_chunk(std::max(round_up(initial_size_bytes), ARENA_ALIGNMENT));
+}
+
+TensorArena::~TensorArena() = default;
+
+void TensorArena::add_chunk(size_t size)
+{
+    // `size` is a nonzero multiple of the alignment as required by `aligned_alloc`
+    auto data = static_cast<uint8_t *>(aligned_alloc(ARENA_ALIGNMENT, size));
+    if (data == nullptr)
+    {
+        NEUROPOD_ERROR("Failed to allocate a {} byte chunk for a tensor arena", size);
+    }
+
+    chunks_.push_back({std::unique_ptr<uint8_t, FreeDeleter>(data), size});
+    offset_ = 0;
+}
+
+void *TensorArena::allocate(size_t num_bytes)
+{
+    const auto size = round_up(num_bytes);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (offset_ + size > chunks_.back().size)
+    {
+        // Grow the arena geometrically
+        add_chunk(std::max(size, chunks_.back().size * 2));
+    }
+
+    auto out = chunks_.back().data.get() + offset_;
+    offset_ += size;
+    num_live_++;
+    return out;
+}
+
+void TensorArena::release()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--num_live_ > 0)
+    {
+        return;
+    }
+
+    if (chunks_.size() > 1)
+    {
+        // Replace all the chunks with one that fits everything so the next request is contiguous
+        size_t total = 0;
+        for (const auto &chunk : chunks_)
+        {
+            total += chunk.size;
+        }
+
+        chunks_.clear();
+        add_chunk(total);
+    }
+
+    offset_ = 0;
+}
+
+size_t TensorArena::get_num_chunks()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size();
+}
+
+size_t TensorArena::get_capacity_bytes()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t total = 0;
+    for (const auto &chunk : chunks_)
+    {
+        total += chunk.size;
+    }
+
+    return total;
+}
+
+} // namespace detail
+
+ArenaTensorAllocator::ArenaTensorAllocator(size_t initial_size_bytes)
+    : arena_(std::make_shared<detail::TensorArena>(initial_size_bytes))
+{
+}
+
+ArenaTensorAllocator::~ArenaTensorAllocator() = default;
+
+std::unique_ptr<NeuropodTensor> ArenaTensorAllocator::allocate_tensor(const std::vector<int64_t> &input_dims,
+                                                                      TensorType                  tensor_type)
+{
+    if (tensor_type == STRING_TENSOR)
+    {
+        return make_tensor<GenericNeuropodTensor>(tensor_type, input_dims);
+    }
+
+    return make_tensor_no_string<ArenaNeuropodTensor>(tensor_type, input_dims, arena_);
+}
+
+std::unique_ptr<NeuropodTensor> ArenaTensorAllocator::tensor_from_memory(const std::vector<int64_t> &input_dims,
+                                                                         TensorType                  tensor_type,
+                                                                         void *                      data,
+                                                                         const Deleter &             deleter)
+{
+    return make_tensor_no_string<GenericNeuropodTensor>(tensor_type, input_dims, data, deleter);
+}
+
+size_t ArenaTensorAllocator::get_num_chunks()
+{
+    return arena_->get_num_chunks();
+}
+
+size_t ArenaTensorAllocator::get_capacity_bytes()
+{
+    return arena_->get_capacity_bytes();
+}
+
+} // namespace neuropod
@@ -0,0 +1,145 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "neuropod/backends/tensor_allocator.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace neuropod
+{
+
+namespace detail
+{
+
+// A bump pointer arena for tensor data. Allocations are 64 byte aligned and are not freed individually.
+// Once every allocation has been released, the arena is reset and its memory is reused.
+// Note: this is threadsafe
+class TensorArena
+{
+private:
+    struct FreeDeleter
+    {
+        void operator()(uint8_t *data) const { free(data); }
+    };
+
+    struct Chunk
+    {
+        std::unique_ptr<uint8_t, FreeDeleter> data;
+        size_t                                size;
+    };
+
+    std::mutex mutex_;
+
+    // The chunks of memory in the arena. Allocations come from the last one
+    std::vector<Chunk> chunks_;
+
+    // The offset of the next allocation in the last chunk
+    size_t offset_ = 0;
+
+    // The number of allocations that haven't been released
+    size_t num_live_ = 0;
+
+    void add_chunk(size_t size);
+
+public:
+    explicit TensorArena(size_t initial_size_bytes);
+    ~TensorArena();
+
+    // Allocate `num_bytes` bytes aligned to 64 bytes
+    void *allocate(size_t num_bytes);
+
+    // Release an allocation. When the last allocation is released, the arena is reset. If it had to grow
+    // since the last reset, its chunks are replaced by one chunk large enough for all of them
+    void release();
+
+    // The number of chunks in the arena
+    size_t get_num_chunks();
+
+    // The total size of the chunks in the arena
+    size_t get_capacity_bytes();
+};
+
+} // namespace detail
+
+// A tensor whose data is allocated from a `TensorArena`
+template <typename T>
+class ArenaNeuropodTensor : public TypedNeuropodTensor<T>
+{
+private:
+    // Keeps the arena alive until this tensor is released
+    std::shared_ptr<detail::TensorArena> arena_;
+
+    // A pointer to the data contained in the tensor
+    void *data_;
+
+public:
+    ArenaNeuropodTensor(const std::vector<int64_t> &dims, std::shared_ptr<detail::TensorArena> arena)
+        : TypedNeuropodTensor<T>(dims),
+          arena_(std::move(arena)),
+          data_(arena_->allocate(this->get_num_elements() * sizeof(T)))
+    {
+    }
+
+    ~ArenaNeuropodTensor() { arena_->release(); }
+
+protected:
+    // Get a pointer to the underlying data
+    void *get_untyped_data_ptr() { return data_; }
+
+    const void *get_untyped_data_ptr() const { return data_; }
+};
+
+// A `NeuropodTensorAllocator` that allocates tensor data from a bump pointer arena instead of calling `malloc`
+// for each tensor. The tensors for a request are laid out contiguously (with 64 byte alignment) and the
+// arena is reset in one step once all of them are deallocated.
+//
+// This works best when each thread uses its own allocator and all the tensors from one request are
+// released before the next request starts allocating (otherwise the arena keeps growing until they are).
+//
+// String tensors and `tensor_from_memory` don't use the arena. The tensors created by this allocator are
+// compatible with the ones from `get_generic_tensor_allocator`
+class ArenaTensorAllocator : public NeuropodTensorAllocator
+{
+private:
+    std::shared_ptr<detail::TensorArena> arena_;
+
+public:
+    explicit ArenaTensorAllocator(size_t initial_size_bytes = 1024 * 1024);
+    ~ArenaTensorAllocator();
+
+    // Don't hide the templated versions
+    using NeuropodTensorAllocator::allocate_tensor;
+    using NeuropodTensorAllocator::tensor_from_memory;
+
+    std::unique_ptr<NeuropodTensor> allocate_tensor(const std::vector<int64_t> &input_dims, TensorType tensor_type);
+
+    std::unique_ptr<NeuropodTensor> tensor_from_memory(const std::vector<int64_t> &input_dims,
+                                                       TensorType                  tensor_type,
+                                                       void *                      data,
+                                                       const Deleter &             deleter);
+
+    // The number of chunks and the total size of the arena
+    size_t get_num_chunks();
+    size_t get_capacity_bytes();
+};
+
+} // namespace neuropod
@@ -0,0 +1,78 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/internal/indexed_value_map.hh"
+
+#include "neuropod/internal/error_utils.hh"
+
+namespace neuropod
+{
+
+ValueMapLayout::ValueMapLayout(std::vector<std::string> names) : names_(std::move(names))
+{
+    indices_.reserve(names_.size());
+    for (size_t i = 0; i < names_.size(); i++)
+    {
+        if (!indices_.emplace(names_[i], i).second)
+        {
+            NEUROPOD_ERROR("Duplicate name in value map layout: '{}'", names_[i]);
+        }
+    }
+}
+
+ValueMapLayout::~ValueMapLayout() = default;
+
+size_t ValueMapLayout::get_index(const std::string &name) const
+{
+    const auto it = indices_.find(name);
+    if (it == indices_.end())
+    {
+        NEUROPOD_ERROR("Tensor name '{}' is not in the value map layout", name);
+    }
+
+    return it->second;
+}
+
+IndexedValueMap::IndexedValueMap(std::shared_ptr<const ValueMapLayout> layout)
+    : layout_(std::move(layout)), values_(layout_->size())
+{
+}
+
+IndexedValueMap::~IndexedValueMap() = default;
+
+void IndexedValueMap::clear()
+{
+    for (auto &value : values_)
+    {
+        value.reset();
+    }
+}
+
+NeuropodValueMap IndexedValueMap::to_map() const
+{
+    NeuropodValueMap out;
+    out.reserve(values_.size());
+    for (size_t i = 0; i < values_.size(); i++)
+    {
+        if (values_[i])
+        {
+            out.emplace(layout_->get_name(i), values_[i]);
+        }
+    }
+
+    return out;
+}
+
+} // namespace neuropod
@@ -0,0 +1,94 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "neuropod/internal/neuropod_tensor.hh"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace neuropod
+{
+
+// An ordered set of tensor names (e.g. the names in the input spec of a model).
+// Names are resolved to indices once so an `IndexedValueMap` can be filled without hashing names
+class ValueMapLayout
+{
+private:
+    std::vector<std::string>                names_;
+    std::unordered_map<std::string, size_t> indices_;
+
+public:
+    explicit ValueMapLayout(std::vector<std::string> names);
+    ~ValueMapLayout();
+
+    // The number of names in the layout
+    size_t size() const { return names_.size(); }
+
+    // Get the name at an index
+    const std::string &get_name(size_t index) const { return names_.at(index); }
+
+    // Get the index of a name. Throws an error if the name is not in the layout
+    size_t get_index(const std::string &name) const;
+};
+
+// A value map with a fixed set of names that stores values in a flat array indexed by
+// position in a `ValueMapLayout`. This avoids allocating a hash map node and a string per item
+// on every request. Use `Neuropod::make_input_map` to create one for the inputs of a model.
+//
+// Example:
+//   auto inputs = neuropod.make_input_map();
+//   const auto x = inputs.get_index("x");
+//
+//   // Every request
+//   inputs[x] = some_tensor;
+//   neuropod.infer(inputs);
+class IndexedValueMap
+{
+private:
+    std::shared_ptr<const ValueMapLayout>       layout_;
+    std::vector<std::shared_ptr<NeuropodValue>> values_;
+
+public:
+    explicit IndexedValueMap(std::shared_ptr<const ValueMapLayout> layout);
+    ~IndexedValueMap();
+
+    const std::shared_ptr<const ValueMapLayout> &get_layout() const { return layout_; }
+
+    // The number of slots (i.e. the size of the layout). Slots that weren't set are nullptr
+    size_t size() const { return values_.size(); }
+
+    // Shorthand for `get_layout()->get_index(name)`. Resolve indices once and reuse them
+    size_t get_index(const std::string &name) const { return layout_->get_index(name); }
+
+    // Access a value by index
+    std::shared_ptr<NeuropodValue> &      operator[](size_t index) { return values_[index]; }
+    const std::shared_ptr<NeuropodValue> &operator[](size_t index) const { return values_[index]; }
+
+    // Access a value by name (this looks up the index of `name`)
+    std::shared_ptr<NeuropodValue> &      at(const std::string &name) { return values_[get_index(name)]; }
+    const std::shared_ptr<NeuropodValue> &at(const std::string &name) const { return values_[get_index(name)]; }
+
+    // Unset all the values (without releasing the storage)
+    void clear();
+
+    // Convert to a NeuropodValueMap. Slots that weren't set are skipped
+    NeuropodValueMap to_map() const;
+};
+
+} // namespace neuropod
@@ -0,0 +1,164 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/internal/latency_stats.hh"
+
+#include "neuropod/internal/memory_utils.hh"
+
+#include <algorithm>
+
+namespace neuropod
+{
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (auto &bucket : buckets_)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::~LatencyHistogram() = default;
+
+size_t LatencyHistogram::get_bucket(uint64_t value_ns)
+{
+    if (value_ns < NUM_SUB_BUCKETS)
+    {
+        // Small values have a bucket each
+        return value_ns;
+    }
+
+    // The position of the highest set bit (>= SUB_BUCKET_BITS) and the next SUB_BUCKET_BITS bits below it
+    const int    exponent   = 63 - __builtin_clzll(value_ns);
+    const size_t sub_bucket = (value_ns >> (exponent - SUB_BUCKET_BITS)) & (NUM_SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * NUM_SUB_BUCKETS + sub_bucket;
+}
+
+double LatencyHistogram::get_bucket_value(size_t bucket)
+{
+    if (bucket < NUM_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    const int      exponent = bucket / NUM_SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    const uint64_t width    = uint64_t{1} << (exponent - SUB_BUCKET_BITS);
+    const uint64_t lower    = (NUM_SUB_BUCKETS + bucket % NUM_SUB_BUCKETS) * width;
+    return lower + (width - 1) / 2.0;
+}
+
+void LatencyHistogram::record(uint64_t duration_ns)
+{
+    buckets_[get_bucket(duration_ns)].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+
+    auto current_min = min_ns_.load(std::memory_order_relaxed);
+    while (duration_ns < current_min &&
+           !min_ns_.compare_exchange_weak(current_min, duration_ns, std::memory_order_relaxed))
+    {
+    }
+
+    auto current_max = max_ns_.load(std::memory_order_relaxed);
+    while (duration_ns > current_max &&
+           !max_ns_.compare_exchange_weak(current_max, duration_ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+LatencyStats LatencyHistogram::get_stats() const
+{
+    // Copy the buckets so the percentiles are computed from a consistent set of counts
+    std::array<uint64_t, NUM_BUCKETS> counts;
+    uint64_t                          total = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    LatencyStats stats;
+    if (total == 0)
+    {
+        return stats;
+    }
+
+    const double min_ns = min_ns_.load(std::memory_order_relaxed);
+    const double max_ns = max_ns_.load(std::memory_order_relaxed);
+
+    stats.count   = total;
+    stats.mean_us = sum_ns_.load(std::memory_order_relaxed) / 1000.0 / total;
+    stats.min_us  = min_ns / 1000;
+    stats.max_us  = max_ns / 1000;
+
+    // Returns the value at a quantile in microseconds
+    const auto quantile = [&](double q) {
+        // The rank of the value we want (1-indexed)
+        const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * total + 0.5));
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < NUM_BUCKETS; i++)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                return std::min(std::max(get_bucket_value(i), min_ns), max_ns) / 1000;
+            }
+        }
+
+        return max_ns / 1000;
+    };
+
+    stats.p50_us  = quantile(0.5);
+    stats.p90_us  = quantile(0.9);
+    stats.p99_us  = quantile(0.99);
+    stats.p999_us = quantile(0.999);
+    return stats;
+}
+
+LatencyRegistry::LatencyRegistry()  = default;
+LatencyRegistry::~LatencyRegistry() = default;
+
+LatencyHistogram &LatencyRegistry::get_histogram(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &item : histograms_)
+    {
+        if (item.first == name)
+        {
+            return *item.second;
+        }
+    }
+
+    histograms_.emplace_back(name, stdx::make_unique<LatencyHistogram>());
+    return *histograms_.back().second;
+}
+
+NeuropodStats LatencyRegistry::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    NeuropodStats               out;
+    for (const auto &item : histograms_)
+    {
+        auto stats = item.second->get_stats();
+        if (stats.count > 0)
+        {
+            out[item.first] = stats;
+        }
+    }
+
+    return out;
+}
+
+} // namespace neuropod
@@ -0,0 +1,135 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace neuropod
+{
+
+// Summary statistics for one stage of loading or inference. Times are in microseconds.
+// Percentiles are estimated from a histogram and are accurate to within ~6%
+struct LatencyStats
+{
+    uint64_t count = 0;
+
+    double mean_us = 0;
+    double min_us  = 0;
+    double max_us  = 0;
+    double p50_us  = 0;
+    double p90_us  = 0;
+    double p99_us  = 0;
+    double p999_us = 0;
+};
+
+// A map from stage name (e.g. "infer") to the latency stats for that stage
+using NeuropodStats = std::map<std::string, LatencyStats>;
+
+// A histogram of durations in nanoseconds. Recording is lock-free (a few relaxed atomic operations)
+// so this can be left on in production.
+//
+// Buckets are log-linear: every power of two is split into 8 equal buckets
+class LatencyHistogram
+{
+private:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int NUM_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int NUM_BUCKETS     = (64 - SUB_BUCKET_BITS + 1) * NUM_SUB_BUCKETS;
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_;
+
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> min_ns_{UINT64_MAX};
+    std::atomic<uint64_t> max_ns_{0};
+
+    static size_t get_bucket(uint64_t value_ns);
+
+    // The midpoint of a bucket
+    static double get_bucket_value(size_t bucket);
+
+public:
+    LatencyHistogram();
+    ~LatencyHistogram();
+
+    // Record a duration
+    // Note: this is threadsafe
+    void record(uint64_t duration_ns);
+
+    // Get summary stats for the durations recorded so far
+    // Note: this is threadsafe, but durations recorded while this runs may not be included
+    LatencyStats get_stats() const;
+};
+
+// Records the time between construction and destruction in a histogram.
+// Nothing is recorded if the scope is exited because of an exception (so failed requests don't
+// skew the stats)
+class ScopedLatencyTimer
+{
+private:
+    LatencyHistogram &                    histogram_;
+    std::chrono::steady_clock::time_point start_;
+    int                                   uncaught_exceptions_;
+
+public:
+    explicit ScopedLatencyTimer(LatencyHistogram &histogram)
+        : histogram_(histogram),
+          start_(std::chrono::steady_clock::now()),
+          uncaught_exceptions_(std::uncaught_exceptions())
+    {
+    }
+
+    ~ScopedLatencyTimer()
+    {
+        if (std::uncaught_exceptions() == uncaught_exceptions_)
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - start_;
+            histogram_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+};
+
+// A set of named latency histograms (one per stage of loading or inference)
+class LatencyRegistry
+{
+private:
+    std::vector<std::pair<std::string, std::unique_ptr<LatencyHistogram>>> histograms_;
+    mutable std::mutex                                                     mutex_;
+
+public:
+    LatencyRegistry();
+    ~LatencyRegistry();
+
+    // Get the histogram for a stage (creating it if necessary). The returned reference is valid for the
+    // lifetime of the registry so callers should look up stages once and keep the reference
+    // Note: this is threadsafe
+    LatencyHistogram &get_histogram(const std::string &name);
+
+    // Get the stats for every stage that has recorded at least one duration
+    // Note: this is threadsafe
+    NeuropodStats get_stats() const;
+};
+
+} // namespace neuropod
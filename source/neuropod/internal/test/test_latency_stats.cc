@@ -0,0 +1,127 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/internal/latency_stats.hh"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(test_latency_stats, empty)
+{
+    neuropod::LatencyHistogram histogram;
+    const auto                 stats = histogram.get_stats();
+    EXPECT_EQ(stats.count, 0);
+    EXPECT_EQ(stats.p99_us, 0);
+}
+
+TEST(test_latency_stats, percentiles)
+{
+    // 1us to 10ms
+    neuropod::LatencyHistogram histogram;
+    for (uint64_t i = 1; i <= 10000; i++)
+    {
+        histogram.record(i * 1000);
+    }
+
+    const auto stats = histogram.get_stats();
+    EXPECT_EQ(stats.count, 10000);
+    EXPECT_DOUBLE_EQ(stats.min_us, 1);
+    EXPECT_DOUBLE_EQ(stats.max_us, 10000);
+    EXPECT_DOUBLE_EQ(stats.mean_us, 5000.5);
+
+    // Percentiles are estimates so they should be within the bucket error
+    EXPECT_NEAR(stats.p50_us, 5000, 5000 * 0.07);
+    EXPECT_NEAR(stats.p90_us, 9000, 9000 * 0.07);
+    EXPECT_NEAR(stats.p99_us, 9900, 9900 * 0.07);
+    EXPECT_NEAR(stats.p999_us, 9990, 9990 * 0.07);
+    EXPECT_LE(stats.p999_us, stats.max_us);
+}
+
+TEST(test_latency_stats, small_and_large_values)
+{
+    neuropod::LatencyHistogram histogram;
+    histogram.record(0);
+    histogram.record(7);
+    histogram.record(UINT64_MAX);
+
+    const auto stats = histogram.get_stats();
+    EXPECT_EQ(stats.count, 3);
+    EXPECT_DOUBLE_EQ(stats.min_us, 0);
+    EXPECT_DOUBLE_EQ(stats.p50_us, 0.007);
+    EXPECT_DOUBLE_EQ(stats.max_us, UINT64_MAX / 1000.0);
+}
+
+TEST(test_latency_stats, concurrent_records)
+{
+    neuropod::LatencyHistogram histogram;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++)
+    {
+        threads.emplace_back([&histogram]() {
+            for (uint64_t j = 0; j < 10000; j++)
+            {
+                histogram.record(j);
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(histogram.get_stats().count, 80000);
+}
+
+TEST(test_latency_stats, timer)
+{
+    neuropod::LatencyHistogram histogram;
+    {
+        neuropod::ScopedLatencyTimer timer(histogram);
+    }
+
+    EXPECT_EQ(histogram.get_stats().count, 1);
+
+    // Nothing is recorded if the scope exits because of an exception
+    try
+    {
+        neuropod::ScopedLatencyTimer timer(histogram);
+        throw std::runtime_error("failed");
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+
+    EXPECT_EQ(histogram.get_stats().count, 1);
+}
+
+TEST(test_latency_stats, registry)
+{
+    neuropod::LatencyRegistry registry;
+
+    auto &infer = registry.get_histogram("infer");
+    EXPECT_EQ(&infer, &registry.get_histogram("infer"));
+
+    // Stages without any records are not included
+    registry.get_histogram("load");
+    infer.record(1000);
+
+    const auto stats = registry.get_stats();
+    EXPECT_EQ(stats.size(), 1);
+    EXPECT_EQ(stats.at("infer").count, 1);
+}
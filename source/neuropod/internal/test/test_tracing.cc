@@ -0,0 +1,108 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/internal/tracing.hh"
+
+#include <json/json.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+// Load a trace the same way trace viewers do (the closing bracket is optional)
+Json::Value read_trace(const std::string &path)
+{
+    std::ifstream     file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    auto content = buffer.str();
+    while (!content.empty() && (content.back() == '\n' || content.back() == ','))
+    {
+        content.pop_back();
+    }
+
+    content += "]";
+
+    Json::Value             trace;
+    Json::CharReaderBuilder builder;
+    std::string             errors;
+    std::istringstream      stream(content);
+    EXPECT_TRUE(Json::parseFromStream(builder, stream, &trace, &errors)) << errors;
+    return trace;
+}
+
+} // namespace
+
+TEST(test_tracing, spans)
+{
+    const std::string path = "/tmp/neuropod_test_tracing_" + std::to_string(getpid()) + ".json";
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(neuropod::is_tracing_enabled());
+    {
+        // Nothing is written when tracing is disabled
+        neuropod::ScopedTraceSpan span("disabled");
+    }
+
+    neuropod::set_trace_file(path);
+    EXPECT_TRUE(neuropod::is_tracing_enabled());
+    EXPECT_EQ(neuropod::get_trace_file(), path);
+
+    neuropod::set_trace_process_name("test process");
+    {
+        neuropod::ScopedTraceSpan span("outer");
+        span.set_request_id(7);
+    }
+
+    neuropod::write_trace_span("inner", 1500, 3750, 0);
+
+    neuropod::set_trace_file("");
+    EXPECT_FALSE(neuropod::is_tracing_enabled());
+
+    {
+        // Tracing is disabled again
+        neuropod::ScopedTraceSpan span("disabled");
+    }
+
+    const auto trace = read_trace(path);
+    ASSERT_EQ(trace.size(), 3);
+
+    EXPECT_EQ(trace[0]["ph"].asString(), "M");
+    EXPECT_EQ(trace[0]["args"]["name"].asString(), "test process");
+
+    EXPECT_EQ(trace[1]["name"].asString(), "outer");
+    EXPECT_EQ(trace[1]["ph"].asString(), "X");
+    EXPECT_EQ(trace[1]["pid"].asInt(), getpid());
+    EXPECT_EQ(trace[1]["args"]["request_id"].asUInt64(), 7);
+
+    EXPECT_EQ(trace[2]["name"].asString(), "inner");
+    EXPECT_DOUBLE_EQ(trace[2]["ts"].asDouble(), 1.5);
+    EXPECT_DOUBLE_EQ(trace[2]["dur"].asDouble(), 2.25);
+    EXPECT_FALSE(trace[2].isMember("args"));
+
+    // Enabling tracing again appends to the existing file
+    neuropod::set_trace_file(path);
+    neuropod::write_trace_span("appended", 0, 1);
+    neuropod::set_trace_file("");
+    EXPECT_EQ(read_trace(path).size(), 4);
+
+    std::remove(path.c_str());
+}
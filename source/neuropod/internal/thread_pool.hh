@@ -0,0 +1,122 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace neuropod
+{
+
+// A fixed size pool of threads that runs tasks in the order they were submitted
+//
+// The pool can be destroyed from one of its own threads (e.g. by a task that drops the last reference to the
+// object that owns the pool). In that case, that thread is detached instead of joined and exits once the
+// task returns
+class ThreadPool
+{
+private:
+    // The state shared with the threads. It outlives the pool if a thread is detached
+    struct State
+    {
+        std::queue<std::function<void()>> tasks;
+        std::mutex                        mutex;
+        std::condition_variable           cv;
+        bool                              shutdown = false;
+    };
+
+    std::shared_ptr<State>   state_;
+    std::vector<std::thread> threads_;
+
+    static void worker_loop(const std::shared_ptr<State> &state)
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                state->cv.wait(lock, [&] { return state->shutdown || !state->tasks.empty(); });
+
+                // Finish any queued tasks before shutting down
+                if (state->tasks.empty())
+                {
+                    return;
+                }
+
+                task = std::move(state->tasks.front());
+                state->tasks.pop();
+            }
+
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t num_threads) : state_(std::make_shared<State>())
+    {
+        threads_.reserve(num_threads);
+        for (size_t i = 0; i < num_threads; i++)
+        {
+            threads_.emplace_back(&ThreadPool::worker_loop, state_);
+        }
+    }
+
+    // Runs all the queued tasks and then stops the threads
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->shutdown = true;
+        }
+
+        state_->cv.notify_all();
+        for (auto &thread : threads_)
+        {
+            if (thread.get_id() == std::this_thread::get_id())
+            {
+                // A thread can't join itself
+                thread.detach();
+            }
+            else
+            {
+                thread.join();
+            }
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Queue a task to run on one of the threads.
+    // Note: tasks should not throw
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->tasks.emplace(std::move(task));
+        }
+
+        state_->cv.notify_one();
+    }
+
+    size_t get_num_threads() const { return threads_.size(); }
+};
+
+} // namespace neuropod
@@ -0,0 +1,204 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/internal/tracing.hh"
+
+#include "neuropod/internal/logging.hh"
+#include "spdlog/details/os.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace neuropod
+{
+
+namespace
+{
+
+class TraceWriter
+{
+private:
+    std::mutex       mutex_;
+    std::atomic_bool enabled_{false};
+    std::string      path_;
+    int              fd_ = -1;
+
+    // Note: `mutex_` must be held when calling this
+    void close_file()
+    {
+        enabled_ = false;
+        if (fd_ >= 0)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+
+        path_.clear();
+    }
+
+    // Write a string with a single `write` call. Since the file is opened with `O_APPEND`, events written
+    // by different processes don't interleave
+    // Note: `mutex_` must be held when calling this
+    void write_string(const std::string &data)
+    {
+        if (write(fd_, data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+        {
+            SPDLOG_ERROR("Failed to write to trace file {}: {}. Disabling tracing", path_, strerror(errno));
+            close_file();
+        }
+    }
+
+public:
+    TraceWriter()
+    {
+        const char *path = std::getenv("NEUROPOD_TRACE_FILE");
+        if (path != nullptr)
+        {
+            set_file(path);
+        }
+    }
+
+    ~TraceWriter()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        close_file();
+    }
+
+    bool is_enabled() const { return enabled_; }
+
+    void set_file(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        close_file();
+        if (path.empty())
+        {
+            return;
+        }
+
+        // The process that creates the file writes the opening bracket of the JSON array. Chrome and Perfetto
+        // don't require the closing bracket so every event can just be appended
+        bool created = true;
+        fd_          = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_EXCL, 0644);
+        if (fd_ < 0 && errno == EEXIST)
+        {
+            created = false;
+            fd_     = open(path.c_str(), O_WRONLY | O_APPEND);
+        }
+
+        if (fd_ < 0)
+        {
+            SPDLOG_ERROR("Failed to open trace file {}: {}", path, strerror(errno));
+            return;
+        }
+
+        path_    = path;
+        enabled_ = true;
+        if (created)
+        {
+            write_string("[\n");
+        }
+    }
+
+    std::string get_file()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return path_;
+    }
+
+    void write_event(const std::string &event)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd_ >= 0)
+        {
+            write_string(event);
+        }
+    }
+};
+
+TraceWriter &get_trace_writer()
+{
+    static TraceWriter writer;
+    return writer;
+}
+
+// Format a time in nanoseconds as microseconds (the unit used in trace events)
+std::string format_us(uint64_t ns)
+{
+    return fmt::format("{}.{:03}", ns / 1000, ns % 1000);
+}
+
+} // namespace
+
+void set_trace_file(const std::string &path)
+{
+    get_trace_writer().set_file(path);
+}
+
+std::string get_trace_file()
+{
+    return get_trace_writer().get_file();
+}
+
+bool is_tracing_enabled()
+{
+    return get_trace_writer().is_enabled();
+}
+
+void set_trace_process_name(const std::string &name)
+{
+    if (!is_tracing_enabled())
+    {
+        return;
+    }
+
+    get_trace_writer().write_event(
+        fmt::format(R"({{"name":"process_name","ph":"M","pid":{},"args":{{"name":"{}"}}}},)"
+                    "\n",
+                    spdlog::details::os::pid(),
+                    name));
+}
+
+uint64_t get_trace_time_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void write_trace_span(const char *name, uint64_t start_ns, uint64_t end_ns, uint64_t request_id)
+{
+    if (!is_tracing_enabled())
+    {
+        return;
+    }
+
+    const auto args = request_id != 0 ? fmt::format(R"(,"args":{{"request_id":{}}})", request_id) : std::string();
+    get_trace_writer().write_event(
+        fmt::format(R"({{"name":"{}","cat":"neuropod","ph":"X","ts":{},"dur":{},"pid":{},"tid":{}{}}},)"
+                    "\n",
+                    name,
+                    format_us(start_ns),
+                    format_us(end_ns - start_ns),
+                    spdlog::details::os::pid(),
+                    spdlog::details::os::thread_id(),
+                    args));
+}
+
+} // namespace neuropod
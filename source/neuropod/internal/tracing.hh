@@ -0,0 +1,82 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace neuropod
+{
+
+// Tracing writes spans (e.g. serializing the inputs of a request) to a file in the Chrome trace event format.
+// The file can be loaded in `chrome://tracing` or https://ui.perfetto.dev
+//
+// Tracing is enabled by setting the `NEUROPOD_TRACE_FILE` environment variable (or by calling `set_trace_file`).
+// OPE worker processes inherit the trace file from the main process and append to the same file so a request
+// can be followed across processes by its `request_id`.
+//
+// Note: events are appended to the file if it already exists
+
+// Start writing trace events to `path`. An empty path disables tracing
+// Note: this is threadsafe
+void set_trace_file(const std::string &path);
+
+// Get the current trace file (or an empty string if tracing is disabled)
+std::string get_trace_file();
+
+// Whether or not tracing is enabled. This is cheap so it can be checked before doing any work for a span
+bool is_tracing_enabled();
+
+// Set the name of this process in the trace (e.g. "neuropod worker")
+void set_trace_process_name(const std::string &name);
+
+// Get the current time in nanoseconds. This is `CLOCK_MONOTONIC` so it's comparable across processes
+uint64_t get_trace_time_ns();
+
+// Write a span to the trace file (if tracing is enabled)
+// `request_id` is included in the args of the span if it is nonzero
+void write_trace_span(const char *name, uint64_t start_ns, uint64_t end_ns, uint64_t request_id = 0);
+
+// Records a span from construction to destruction (if tracing is enabled)
+class ScopedTraceSpan
+{
+private:
+    const char *name_;
+    uint64_t    request_id_;
+    uint64_t    start_ns_ = 0;
+
+public:
+    explicit ScopedTraceSpan(const char *name, uint64_t request_id = 0) : name_(name), request_id_(request_id)
+    {
+        if (is_tracing_enabled())
+        {
+            start_ns_ = get_trace_time_ns();
+        }
+    }
+
+    ~ScopedTraceSpan()
+    {
+        if (start_ns_ != 0)
+        {
+            write_trace_span(name_, start_ns_, get_trace_time_ns(), request_id_);
+        }
+    }
+
+    // Set the request ID if it wasn't known when the span started
+    void set_request_id(uint64_t request_id) { request_id_ = request_id; }
+};
+
+} // namespace neuropod
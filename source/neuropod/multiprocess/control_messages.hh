@@ -33,16 +33,18 @@ enum MessageType
     LOAD_SUCCESS,
 
     // Sent by the main process when passing tensors to the worker process
-    // Valid next messages: INFER
+    // Each request is tagged with a request ID (see `ope_request.hh`) so the inputs
+    // for several requests can be added before any of them complete.
+    // Valid next messages: INFER (for this request)
     ADD_INPUT,
 
-    // Sent by the main process once all inputs have been added and we're ready
+    // Sent by the main process once all inputs for a request have been added and we're ready
     // to run inference
-    // Valid next messages: RETURN_OUTPUT
+    // Valid next messages: RETURN_OUTPUT (for this request)
     INFER,
 
     // Sent by the worker process when passing tensors to the main process
-    // Valid next messages: ADD_INPUT, LOAD_NEUROPOD
+    // Valid next messages: ADD_INPUT, LOAD_NEUROPOD (once no requests are in flight)
     RETURN_OUTPUT,
 
     // A message sent by the main process to ask the worker to terminate
@@ -50,6 +52,7 @@ enum MessageType
     SHUTDOWN,
 
     // A message sent by the worker process to let the main process know there was an exception
+    // If the exception happened while running a request, this completes that request.
     // Note: it is valid to send this message at any time.
     EXCEPTION,
 };
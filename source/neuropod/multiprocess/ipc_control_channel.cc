@@ -26,9 +26,24 @@ namespace neuropod
 void TransitionVerifier::assert_transition_allowed(MessageType current_type)
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (current_type == SHUTDOWN || current_type == EXCEPTION)
+    if (current_type == SHUTDOWN)
     {
-        // These messages are allowed at any time
+        // This message is allowed at any time
+        return;
+    }
+
+    if (current_type == EXCEPTION)
+    {
+        // This message is allowed at any time. It either completes a request or a failed load
+        if (in_flight_ > 0)
+        {
+            in_flight_--;
+        }
+        else
+        {
+            is_loading_ = false;
+        }
+
         return;
     }
 
@@ -38,26 +53,60 @@ void TransitionVerifier::assert_transition_allowed(MessageType current_type)
         NEUROPOD_ERROR("OPE: Invalid state transition. Expected LOAD_NEUROPOD as first state. Got {}", current_type);
     }
 
-    // Using `set` instead of `unordered_set` because it doesn't require the type to be
-    // hashable
-    static const std::set<std::pair<MessageType, MessageType>> allowed_transitions = {
-        std::make_pair(LOAD_NEUROPOD, LOAD_SUCCESS),
-        std::make_pair(LOAD_SUCCESS, ADD_INPUT),
-        std::make_pair(LOAD_SUCCESS, LOAD_NEUROPOD),
-        std::make_pair(ADD_INPUT, INFER),
-        std::make_pair(INFER, RETURN_OUTPUT),
-        std::make_pair(RETURN_OUTPUT, ADD_INPUT),
-        std::make_pair(RETURN_OUTPUT, LOAD_NEUROPOD),
-    };
-
-    if (!is_first_message_ &&
-        allowed_transitions.find(std::make_pair(last_type_, current_type)) == allowed_transitions.end())
+    is_first_message_ = false;
+
+    switch (current_type)
     {
-        NEUROPOD_ERROR("OPE: Invalid state transition. Got transition from state {} to {}", last_type_, current_type);
+    case LOAD_NEUROPOD:
+        // We can only load a model once all requests have completed
+        if (is_loading_ || pending_inputs_ != 0 || in_flight_ != 0)
+        {
+            NEUROPOD_ERROR("OPE: Invalid state transition. Got LOAD_NEUROPOD with {} pending and {} in flight "
+                           "requests",
+                           pending_inputs_,
+                           in_flight_);
+        }
+
+        is_loading_ = true;
+        break;
+    case LOAD_SUCCESS:
+        if (!is_loading_)
+        {
+            NEUROPOD_ERROR("OPE: Invalid state transition. Got LOAD_SUCCESS without a LOAD_NEUROPOD");
+        }
+
+        is_loading_ = false;
+        break;
+    case ADD_INPUT:
+        if (is_loading_)
+        {
+            NEUROPOD_ERROR("OPE: Invalid state transition. Got ADD_INPUT while loading a model");
+        }
+
+        pending_inputs_++;
+        break;
+    case INFER:
+        if (pending_inputs_ == 0)
+        {
+            NEUROPOD_ERROR("OPE: Invalid state transition. Got INFER without a corresponding ADD_INPUT");
+        }
+
+        pending_inputs_--;
+        in_flight_++;
+        break;
+    case RETURN_OUTPUT:
+        if (in_flight_ == 0)
+        {
+            NEUROPOD_ERROR("OPE: Invalid state transition. Got RETURN_OUTPUT without a corresponding INFER");
+        }
+
+        in_flight_--;
+        break;
+    case SHUTDOWN:
+    case EXCEPTION:
+        // Handled above
+        break;
     }
-
-    last_type_        = current_type;
-    is_first_message_ = false;
 }
 
 IPCControlChannel::IPCControlChannel(const std::string &control_queue_name, ProcessType type)
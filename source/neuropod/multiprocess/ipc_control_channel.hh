@@ -24,12 +24,16 @@ namespace neuropod
 {
 
 // Validates that state machine transitions are happening correctly
+// Multiple requests can be in flight at the same time so this tracks the number of requests
+// in each stage instead of just the last message
 class TransitionVerifier
 {
 private:
-    MessageType last_type_;
-    bool        is_first_message_ = true;
-    std::mutex  mutex_;
+    bool       is_first_message_ = true;
+    bool       is_loading_       = false;
+    size_t     pending_inputs_   = 0;
+    size_t     in_flight_        = 0;
+    std::mutex mutex_;
 
 public:
     // Verifies that a state transition is allowed from the last state
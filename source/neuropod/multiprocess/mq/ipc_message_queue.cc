@@ -29,8 +29,8 @@ std::atomic_uint64_t msg_counter;
 void cleanup_control_channels(const std::string &control_queue_name)
 {
     // Delete the control channels
-    ipc::message_queue::remove(("neuropod_" + control_queue_name + "_tw").c_str());
-    ipc::message_queue::remove(("neuropod_" + control_queue_name + "_fw").c_str());
+    detail::SHMRingBuffer::remove("neuropod_" + control_queue_name + "_tw");
+    detail::SHMRingBuffer::remove("neuropod_" + control_queue_name + "_fw");
 }
 
 } // namespace neuropod
@@ -15,22 +15,20 @@ limitations under the License.
 
 #pragma once
 
-#include "neuropod/internal/blocking_spsc_queue.hh"
 #include "neuropod/internal/error_utils.hh"
 #include "neuropod/internal/memory_utils.hh"
 #include "neuropod/multiprocess/mq/heartbeat.hh"
+#include "neuropod/multiprocess/mq/shm_ring_buffer.hh"
 #include "neuropod/multiprocess/mq/wire_format.hh"
 
-#include <boost/interprocess/ipc/message_queue.hpp>
-
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 
-namespace ipc = boost::interprocess;
-
 namespace neuropod
 {
 
@@ -79,7 +77,9 @@ enum ProcessType
 
 // A bidirectional IPC message queue that supports cross-process moves or copies of payloads.
 // Includes an implementation of heartbeats and message acknowledgement (in the form of DONE messages)
-// This class starts a thread for reading from the underlying `recv_queue` and uses a `HeartbeatController`
+// Messages are sent over a pair of shared memory ring buffers (one in each direction).
+// Messages are read directly from the underlying `recv_queue` by the thread calling `recv_message`. This class
+// starts a thread that handles control messages while no thread is receiving and uses a `HeartbeatController`
 // to start a thread for sending heartbeats.
 template <typename UserPayloadType>
 class IPCMessageQueue : public std::enable_shared_from_this<IPCMessageQueue<UserPayloadType>>
@@ -87,13 +87,26 @@ class IPCMessageQueue : public std::enable_shared_from_this<IPCMessageQueue<User
 private:
     using WireFormat = detail::WireFormat<UserPayloadType>;
 
-    // A queue to store output messages received by the read thread
-    BlockingSPSCQueue<std::unique_ptr<WireFormat>> out_queue_;
-
     // Internal IPC queues to communicate with the other process
-    std::string                         control_queue_name_;
-    std::unique_ptr<ipc::message_queue> send_queue_;
-    std::unique_ptr<ipc::message_queue> recv_queue_;
+    std::string                            control_queue_name_;
+    std::unique_ptr<detail::SHMRingBuffer> send_queue_;
+    std::unique_ptr<detail::SHMRingBuffer> recv_queue_;
+
+    // The ring buffer only supports a single writer so sends from multiple threads
+    // (e.g. user threads, the heartbeat thread and DONE messages) are serialized
+    std::mutex send_mutex_;
+
+    // The ring buffer also only supports a single reader. The thread calling `recv_message` reads from it
+    // directly. While no thread is in `recv_message`, `idle_reader_` periodically handles control messages
+    // (heartbeats and DONE messages) so the other process isn't blocked by a full ring buffer
+    // The following are protected by `read_mutex_`
+    std::mutex read_mutex_;
+
+    // When we last received a message from the other process
+    std::chrono::steady_clock::time_point last_received_;
+
+    // User payloads received by `idle_reader_` that haven't been returned by `recv_message` yet
+    std::deque<detail::WireFormatPtr<UserPayloadType>> pending_;
 
     // Responsible for periodically sending a heartbeat
     friend class detail::HeartbeatController;
@@ -102,17 +115,29 @@ private:
     // Responsible for keeping things in scope during cross-process moves
     std::unique_ptr<detail::TransferrableController> transferrable_controller_;
 
-    // Whether or not a shutdown is in progress
-    bool shutdown_started_ = false;
-
     // If we lost the heartbeat from the other process
     std::atomic_bool lost_heartbeat_;
 
-    // A thread that handles incoming messages
-    std::thread read_worker_;
+    // Used to stop `idle_reader_`
+    std::mutex              idle_mutex_;
+    std::condition_variable idle_cv_;
+    bool                    stop_idle_reader_ = false;
+
+    // A thread that handles incoming control messages while no thread is in `recv_message`
+    std::thread idle_reader_;
+
+    // The worker loop for `idle_reader_`
+    void idle_reader_loop();
+
+    // Read a message from `recv_queue_`, waiting at most `timeout` for one to arrive
+    // Control messages are handled here. User payloads are put in `out`
+    // Note: the caller must hold `read_mutex_`
+    detail::RingBufferStatus receive(std::chrono::milliseconds                timeout,
+                                     detail::WireFormatPtr<UserPayloadType> &out);
 
-    // The worker loop for the message reading thread
-    void read_worker_loop();
+    // Mark the other process as lost if we haven't received a message from it recently
+    // Note: the caller must hold `read_mutex_`
+    void check_for_lost_heartbeat();
 
     // Send a message to the other process
     void send_message(const WireFormat &msg);
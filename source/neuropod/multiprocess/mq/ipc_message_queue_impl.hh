@@ -17,8 +17,6 @@ limitations under the License.
 
 #include "neuropod/multiprocess/mq/ipc_message_queue.hh"
 
-namespace ipc = boost::interprocess;
-
 namespace neuropod
 {
 
@@ -29,26 +27,29 @@ namespace detail
 extern std::atomic_uint64_t msg_counter;
 
 // The max size for the send and recv control queues
+// The ring buffers are sized so they can fit at least this many messages
+// (most messages are much smaller than the max size)
 constexpr auto MAX_QUEUE_SIZE = 20;
 
+// How often control messages are handled while no thread is in `recv_message`
+constexpr int IDLE_READ_INTERVAL_MS = 50;
+
 template <typename UserPayloadType>
-inline std::unique_ptr<ipc::message_queue> make_queue(const std::string &control_queue_name_, const std::string &suffix)
+inline std::unique_ptr<SHMRingBuffer> make_queue(const std::string &control_queue_name_, const std::string &suffix)
 {
-    return stdx::make_unique<ipc::message_queue>(ipc::open_or_create,
-                                                 ("neuropod_" + control_queue_name_ + suffix).c_str(),
-                                                 MAX_QUEUE_SIZE,
-                                                 sizeof(WireFormat<UserPayloadType>));
+    return stdx::make_unique<SHMRingBuffer>("neuropod_" + control_queue_name_ + suffix,
+                                            MAX_QUEUE_SIZE * (sizeof(uint32_t) + get_max_wire_size<UserPayloadType>()));
 }
 
 template <typename UserPayloadType>
-inline std::unique_ptr<ipc::message_queue> make_send_queue(const std::string &control_queue_name_, ProcessType type)
+inline std::unique_ptr<SHMRingBuffer> make_send_queue(const std::string &control_queue_name_, ProcessType type)
 {
     // Change the suffix depending on if this is the main process or worker process
     return make_queue<UserPayloadType>(control_queue_name_, type == MAIN_PROCESS ? "_tw" : "_fw");
 }
 
 template <typename UserPayloadType>
-inline std::unique_ptr<ipc::message_queue> make_recv_queue(const std::string &control_queue_name_, ProcessType type)
+inline std::unique_ptr<SHMRingBuffer> make_recv_queue(const std::string &control_queue_name_, ProcessType type)
 {
     // Change the suffix depending on if this is the main process or worker process
     return make_queue<UserPayloadType>(control_queue_name_, type == WORKER_PROCESS ? "_tw" : "_fw");
@@ -56,96 +57,101 @@ inline std::unique_ptr<ipc::message_queue> make_recv_queue(const std::string &co
 
 } // namespace detail
 
-// The worker loop for the message reading thread
 template <typename UserPayloadType>
-void IPCMessageQueue<UserPayloadType>::read_worker_loop()
+detail::RingBufferStatus IPCMessageQueue<UserPayloadType>::receive(std::chrono::milliseconds                timeout,
+                                                                   detail::WireFormatPtr<UserPayloadType> &out)
 {
-    while (true)
+    // Get a message (allocated with exactly enough space for it)
+    detail::WireFormatPtr<UserPayloadType> received;
+    const auto                             status = recv_queue_->timed_receive(
+        [&received](size_t size) {
+            received = detail::make_message<UserPayloadType>(size - sizeof(WireFormat));
+            return received.get();
+        },
+        std::chrono::steady_clock::now() + timeout);
+
+    if (status != detail::RING_BUFFER_OK)
     {
-        // Compute the timeout
-        auto timeout_at = boost::interprocess::microsec_clock::universal_time() +
-                          boost::posix_time::milliseconds(detail::MESSAGE_TIMEOUT_MS);
-
-        // Get a message
-        auto         received = stdx::make_unique<WireFormat>();
-        size_t       received_size;
-        unsigned int priority;
-        bool         successful_read =
-            recv_queue_->timed_receive(received.get(), sizeof(WireFormat), received_size, priority, timeout_at);
-
-        if (!successful_read)
-        {
-            // We timed out
-            SPDLOG_ERROR("Timed out waiting for a response from worker process. "
-                         "Didn't receive a message in {}ms, but expected a heartbeat every {}ms.",
-                         detail::MESSAGE_TIMEOUT_MS,
-                         detail::HEARTBEAT_INTERVAL_MS);
+        return status;
+    }
 
-            // Set a flag so that any pending writers know
-            lost_heartbeat_.store(true, std::memory_order_relaxed);
+    last_received_ = std::chrono::steady_clock::now();
+    if (received->type == detail::USER_PAYLOAD)
+    {
+        SPDLOG_TRACE("OPE: Received user payload {}.", received->payload_type);
+        out = std::move(received);
+        return status;
+    }
 
-            // Let any pending readers know
-            // (Because recv isn't threadsafe, there should only be one)
-            out_queue_.try_emplace(nullptr);
+    SPDLOG_TRACE("OPE: Received IPC control message {}.", received->type);
+    if (received->type == detail::DONE)
+    {
+        // Handle DONE messages by erasing all the in_transit items for that message
+        uint64_t acked_id;
+        detail::deserialize_payload(*received, acked_id);
 
-            // Shutdown this thread
-            break;
-        }
+        transferrable_controller_->done(acked_id);
+    }
 
-        if (received->type == detail::USER_PAYLOAD)
-        {
-            SPDLOG_TRACE("OPE: Read thread received user payload {}.", received->payload_type);
-        }
-        else
-        {
-            SPDLOG_TRACE("OPE: Read thread received IPC control message {}.", received->type);
-        }
+    return status;
+}
 
-        if (received->type == detail::HEARTBEAT)
-        {
-            // This is a heartbeat message so continue
-            continue;
-        }
-        else if (received->type == detail::DONE)
-        {
-            // Handle DONE messages by erasing all the in_transit items for that message
-            uint64_t acked_id;
-            detail::deserialize_payload(*received, acked_id);
+template <typename UserPayloadType>
+void IPCMessageQueue<UserPayloadType>::check_for_lost_heartbeat()
+{
+    if (std::chrono::steady_clock::now() - last_received_ < std::chrono::milliseconds(detail::MESSAGE_TIMEOUT_MS))
+    {
+        return;
+    }
 
-            transferrable_controller_->done(acked_id);
-        }
-        else if (received->type == detail::SHUTDOWN_QUEUES)
+    SPDLOG_ERROR("Timed out waiting for a response from worker process. "
+                 "Didn't receive a message in {}ms, but expected a heartbeat every {}ms.",
+                 detail::MESSAGE_TIMEOUT_MS,
+                 detail::HEARTBEAT_INTERVAL_MS);
+
+    // Set a flag so that any pending readers and writers know
+    lost_heartbeat_.store(true, std::memory_order_relaxed);
+}
+
+// The worker loop for the idle reader thread
+template <typename UserPayloadType>
+void IPCMessageQueue<UserPayloadType>::idle_reader_loop()
+{
+    while (!lost_heartbeat_.load(std::memory_order_relaxed))
+    {
         {
-            // Start a shutdown.
-            shutdown_started_ = true;
-
-            // Note: we're using the `try_` variant to avoid blocking shutdown here
-            // Note: out_queue_ should only have one listener at any given time
-            // (since recv isn't threadsafe). Because of this, this message should
-            // wake up a user thread that is blocked (if any)
-            out_queue_.try_emplace(std::move(received));
+            std::unique_lock<std::mutex> lock(idle_mutex_);
+            idle_cv_.wait_for(
+                lock, std::chrono::milliseconds(detail::IDLE_READ_INTERVAL_MS), [&] { return stop_idle_reader_; });
+            if (stop_idle_reader_)
+            {
+                return;
+            }
         }
-        else
+
+        // If a thread is in `recv_message`, it handles control messages itself
+        std::unique_lock<std::mutex> lock(read_mutex_, std::try_to_lock);
+        if (!lock.owns_lock())
         {
-            // This is a user-handled message
-            out_queue_.emplace(std::move(received));
+            continue;
         }
 
-        if (shutdown_started_)
+        // Handle everything that's available without blocking. User payloads are kept for `recv_message`
+        while (true)
         {
-            // Only shutdown once we've received DONEs for all the messages we've sent
-            const auto in_transit_count = transferrable_controller_->size();
-            if (in_transit_count == 0)
+            detail::WireFormatPtr<UserPayloadType> received;
+            if (receive(std::chrono::milliseconds(0), received) != detail::RING_BUFFER_OK)
             {
-                // We can finish shutting down
                 break;
             }
-            else
+
+            if (received != nullptr)
             {
-                SPDLOG_TRACE("OPE: Tried to shut down read worker thread, but still waiting on {} `DONE` messages.",
-                             in_transit_count);
+                pending_.emplace_back(std::move(received));
             }
         }
+
+        check_for_lost_heartbeat();
     }
 }
 
@@ -162,13 +168,16 @@ void IPCMessageQueue<UserPayloadType>::send_message(const WireFormat &msg)
         SPDLOG_TRACE("OPE: Sending IPC control message {}.", msg.type);
     }
 
+    // Only send the part of the message that is used
+    const auto wire_size = detail::get_wire_size(msg);
+
     // Send w/ timeout + heartbeat check
+    std::lock_guard<std::mutex> lock(send_mutex_);
     while (true)
     {
-        auto timeout_at = boost::interprocess::microsec_clock::universal_time() +
-                          boost::posix_time::milliseconds(detail::HEARTBEAT_INTERVAL_MS);
+        auto timeout_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(detail::HEARTBEAT_INTERVAL_MS);
 
-        if (send_queue_->timed_send(&msg, sizeof(msg), 0, timeout_at))
+        if (send_queue_->timed_send(&msg, wire_size, timeout_at))
         {
             // Successfully sent
             break;
@@ -192,14 +201,14 @@ void IPCMessageQueue<UserPayloadType>::throw_if_lost_heartbeat()
 
 template <typename UserPayloadType>
 IPCMessageQueue<UserPayloadType>::IPCMessageQueue(const std::string &control_queue_name, ProcessType type)
-    : out_queue_(detail::MAX_QUEUE_SIZE),
-      control_queue_name_(control_queue_name),
+    : control_queue_name_(control_queue_name),
       send_queue_(detail::make_send_queue<UserPayloadType>(control_queue_name_, type)),
       recv_queue_(detail::make_recv_queue<UserPayloadType>(control_queue_name_, type)),
+      last_received_(std::chrono::steady_clock::now()),
       heartbeat_controller_(stdx::make_unique<detail::HeartbeatController>(*this)),
       transferrable_controller_(stdx::make_unique<detail::TransferrableController>()),
       lost_heartbeat_(false),
-      read_worker_(&IPCMessageQueue<UserPayloadType>::read_worker_loop, this)
+      idle_reader_(&IPCMessageQueue<UserPayloadType>::idle_reader_loop, this)
 {
 }
 
@@ -208,14 +217,35 @@ IPCMessageQueue<UserPayloadType>::~IPCMessageQueue()
 {
     heartbeat_controller_.reset();
 
-    // Send a shutdown message to ourselves
-    WireFormat msg;
-    msg.type = detail::SHUTDOWN_QUEUES;
-    SPDLOG_TRACE("OPE: Shutting down read thread...");
-    recv_queue_->send(&msg, sizeof(msg), 0);
+    // Stop the idle reader thread
+    SPDLOG_TRACE("OPE: Shutting down idle reader thread...");
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+        stop_idle_reader_ = true;
+    }
+
+    idle_cv_.notify_all();
+    idle_reader_.join();
+
+    // Wait for DONEs for all the messages we've sent so the other process can finish using them
+    std::lock_guard<std::mutex> lock(read_mutex_);
+    while (!lost_heartbeat_.load(std::memory_order_relaxed))
+    {
+        const auto in_transit_count = transferrable_controller_->size();
+        if (in_transit_count == 0)
+        {
+            break;
+        }
+
+        SPDLOG_TRACE("OPE: Shutting down, but still waiting on {} `DONE` messages.", in_transit_count);
 
-    // Join the read thread
-    read_worker_.join();
+        // Any user payloads received now are dropped
+        detail::WireFormatPtr<UserPayloadType> unused;
+        if (receive(std::chrono::milliseconds(detail::MESSAGE_TIMEOUT_MS), unused) == detail::RING_BUFFER_TIMED_OUT)
+        {
+            check_for_lost_heartbeat();
+        }
+    }
 }
 
 // Send a message with a payload
@@ -224,25 +254,22 @@ template <typename UserPayloadType>
 template <typename Payload>
 void IPCMessageQueue<UserPayloadType>::send_message(UserPayloadType payload_type, const Payload &payload)
 {
-    // Create a message
-    WireFormat msg;
-    msg.id           = detail::msg_counter++;
-    msg.type         = detail::USER_PAYLOAD;
-    msg.payload_type = payload_type;
-
-    // Set the payload
+    // Create a message with the payload
     detail::Transferrables transferrables;
-    detail::serialize_payload(payload, msg, transferrables);
+    auto                   msg = detail::serialize_payload<UserPayloadType>(payload, transferrables);
+    msg->id                    = detail::msg_counter++;
+    msg->type                  = detail::USER_PAYLOAD;
+    msg->payload_type          = payload_type;
 
     // Check if there are any transferrable items attached
     if (!transferrables.empty())
     {
-        transferrable_controller_->add(msg.id, transferrables);
-        msg.requires_done_msg = true;
+        transferrable_controller_->add(msg->id, transferrables);
+        msg->requires_done_msg = true;
     }
 
     // Send the message
-    send_message(msg);
+    send_message(*msg);
 }
 
 // Send a message with a payload and ensure `payload` stays in
@@ -252,15 +279,12 @@ template <typename UserPayloadType>
 template <typename Payload>
 void IPCMessageQueue<UserPayloadType>::send_message_move(UserPayloadType payload_type, Payload payload)
 {
-    // Create a message
-    WireFormat msg;
-    msg.id           = detail::msg_counter++;
-    msg.type         = detail::USER_PAYLOAD;
-    msg.payload_type = payload_type;
-
-    // Set the payload
+    // Create a message with the payload
     detail::Transferrables transferrables;
-    detail::serialize_payload(payload, msg, transferrables);
+    auto                   msg = detail::serialize_payload<UserPayloadType>(payload, transferrables);
+    msg->id                    = detail::msg_counter++;
+    msg->type                  = detail::USER_PAYLOAD;
+    msg->payload_type          = payload_type;
 
     // Add the payload to transferrables
     transferrables.emplace_back(std::move(payload));
@@ -268,12 +292,12 @@ void IPCMessageQueue<UserPayloadType>::send_message_move(UserPayloadType payload
     // Check if there are any transferrable items attached
     if (!transferrables.empty())
     {
-        transferrable_controller_->add(msg.id, transferrables);
-        msg.requires_done_msg = true;
+        transferrable_controller_->add(msg->id, transferrables);
+        msg->requires_done_msg = true;
     }
 
     // Send the message
-    send_message(msg);
+    send_message(*msg);
 }
 
 // Send a message with just a payload_type
@@ -296,14 +320,25 @@ QueueMessage<UserPayloadType> IPCMessageQueue<UserPayloadType>::recv_message()
     // Make sure the worker process is still alive
     throw_if_lost_heartbeat();
 
-    // Read a message
-    std::unique_ptr<WireFormat> out;
-    out_queue_.pop(out);
-
-    if (out == nullptr)
+    // Read a message directly from the ring buffer (unless the idle reader already received one)
+    detail::WireFormatPtr<UserPayloadType> out;
     {
-        // We lost communication with the other processs while we were reading
-        NEUROPOD_ERROR("OPE lost communication with the other process. See logs for more details.");
+        std::lock_guard<std::mutex> lock(read_mutex_);
+        if (!pending_.empty())
+        {
+            out = std::move(pending_.front());
+            pending_.pop_front();
+        }
+
+        while (out == nullptr)
+        {
+            const auto status = receive(std::chrono::milliseconds(detail::MESSAGE_TIMEOUT_MS), out);
+            if (status == detail::RING_BUFFER_TIMED_OUT)
+            {
+                check_for_lost_heartbeat();
+                throw_if_lost_heartbeat();
+            }
+        }
     }
 
     SPDLOG_TRACE(
@@ -318,12 +353,9 @@ QueueMessage<UserPayloadType> IPCMessageQueue<UserPayloadType>::recv_message()
             // and any associated resources can be freed
 
             // Create a message to ack `msg`
-            WireFormat ack_msg;
-            ack_msg.type = detail::DONE;
-
-            // Serialize the payload
             detail::Transferrables transferrables;
-            detail::serialize_payload(msg->id, ack_msg, transferrables);
+            auto                   ack_msg = detail::serialize_payload<UserPayloadType>(msg->id, transferrables);
+            ack_msg->type                  = detail::DONE;
 
             if (!transferrables.empty())
             {
@@ -332,10 +364,10 @@ QueueMessage<UserPayloadType> IPCMessageQueue<UserPayloadType>::recv_message()
             }
 
             // Send the message
-            shared_this->send_message(ack_msg);
+            shared_this->send_message(*ack_msg);
         }
 
-        delete msg;
+        detail::WireFormatDeleter()(msg);
     });
 
     return QueueMessage<UserPayloadType>(std::move(received_shared));
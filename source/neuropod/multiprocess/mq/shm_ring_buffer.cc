@@ -0,0 +1,296 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "neuropod/multiprocess/mq/shm_ring_buffer.hh"
+
+#include "neuropod/internal/error_utils.hh"
+#include "neuropod/internal/memory_utils.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <climits>
+#include <ctime>
+#endif
+
+namespace neuropod
+{
+
+namespace detail
+{
+
+namespace
+{
+
+namespace ipc = boost::interprocess;
+
+// The number of times a reader or writer checks for data (or space) before going to sleep
+// A short spin avoids a syscall when the other process responds quickly
+constexpr int RING_BUFFER_SPIN_COUNT = 256;
+
+// Every message is prefixed with its size
+using MessageSize = uint32_t;
+
+// These are used as futex words so they must be plain 32 bit integers in memory
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> must be 4 bytes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "std::atomic<uint32_t> must be lock free");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "std::atomic<uint64_t> must be lock free");
+
+// Sleep until `word` no longer contains `expected`, we're woken up or `deadline` passes
+void futex_wait(std::atomic<uint32_t> &word, uint32_t expected, std::chrono::steady_clock::time_point deadline)
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    const auto      remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+    struct timespec timeout;
+    timeout.tv_sec  = remaining / 1000000000;
+    timeout.tv_nsec = remaining % 1000000000;
+
+    // Note: we're not using FUTEX_PRIVATE_FLAG because the word is shared across processes
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#else
+    // We don't have futexes on this platform so we'll poll instead
+    if (word.load() == expected)
+    {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(deadline - now,
+                                                                                  std::chrono::microseconds(50)));
+    }
+#endif
+}
+
+// Wake up any threads waiting on `word`
+void futex_wake(std::atomic<uint32_t> &word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+} // namespace
+
+// The part of the ring buffer stored at the beginning of the shared memory region
+// The producer and consumer fields are on separate cache lines to avoid false sharing
+// Note: an all zero header is a valid empty ring buffer so we don't need to initialize
+// anything after creating the shared memory region
+struct RingBufferHeader
+{
+    // The total number of bytes written (only modified by the producer)
+    alignas(64) std::atomic<uint64_t> write_pos;
+
+    // Incremented every time a message is written. Readers wait on this
+    std::atomic<uint32_t> data_seq;
+
+    // Whether or not the reader is (about to be) sleeping
+    std::atomic<uint32_t> reader_waiting;
+
+    // The total number of bytes read (only modified by the consumer)
+    alignas(64) std::atomic<uint64_t> read_pos;
+
+    // Incremented every time a message is read. Writers wait on this
+    std::atomic<uint32_t> space_seq;
+
+    // Whether or not the writer is (about to be) sleeping
+    std::atomic<uint32_t> writer_waiting;
+};
+
+SHMRingBuffer::SHMRingBuffer(const std::string &name, size_t capacity) : capacity_(capacity)
+{
+    shm_ = stdx::make_unique<ipc::shared_memory_object>(ipc::open_or_create, name.c_str(), ipc::read_write);
+
+    // Both processes set the same size so it doesn't matter who gets here first
+    // Newly created shared memory is zero filled
+    shm_->truncate(sizeof(RingBufferHeader) + capacity_);
+
+    // Map into memory
+    region_ = stdx::make_unique<ipc::mapped_region>(*shm_, ipc::read_write);
+    header_ = static_cast<RingBufferHeader *>(region_->get_address());
+    data_   = static_cast<char *>(region_->get_address()) + sizeof(RingBufferHeader);
+}
+
+SHMRingBuffer::~SHMRingBuffer() = default;
+
+void SHMRingBuffer::write_bytes(uint64_t pos, const void *data, size_t size)
+{
+    const auto offset = pos % capacity_;
+    const auto first  = std::min(size, capacity_ - offset);
+    memcpy(data_ + offset, data, first);
+    memcpy(data_, static_cast<const char *>(data) + first, size - first);
+}
+
+void SHMRingBuffer::read_bytes(uint64_t pos, void *out, size_t size) const
+{
+    const auto offset = pos % capacity_;
+    const auto first  = std::min(size, capacity_ - offset);
+    memcpy(out, data_ + offset, first);
+    memcpy(static_cast<char *>(out) + first, data_, size - first);
+}
+
+bool SHMRingBuffer::timed_send(const void *data, size_t size, std::chrono::steady_clock::time_point deadline)
+{
+    const auto needed = sizeof(MessageSize) + size;
+    if (needed > capacity_)
+    {
+        NEUROPOD_ERROR("OPE: Tried to send a message of {} bytes, but the ring buffer only has {} bytes",
+                       size,
+                       capacity_);
+    }
+
+    // We're the only writer so nobody else modifies `write_pos`
+    const auto write_pos = header_->write_pos.load(std::memory_order_relaxed);
+    for (int i = 0;; i++)
+    {
+        const auto seq      = header_->space_seq.load();
+        const auto read_pos = header_->read_pos.load(std::memory_order_acquire);
+        if (capacity_ - (write_pos - read_pos) >= needed)
+        {
+            break;
+        }
+
+        if (i < RING_BUFFER_SPIN_COUNT)
+        {
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+
+        // Let the reader know we're waiting and check again before going to sleep
+        header_->writer_waiting.store(1);
+        if (capacity_ - (write_pos - header_->read_pos.load()) < needed)
+        {
+            futex_wait(header_->space_seq, seq, deadline);
+        }
+
+        header_->writer_waiting.store(0);
+    }
+
+    // Write the message and then publish it
+    const MessageSize message_size = size;
+    write_bytes(write_pos, &message_size, sizeof(message_size));
+    write_bytes(write_pos + sizeof(message_size), data, size);
+    header_->write_pos.store(write_pos + needed, std::memory_order_release);
+
+    // Wake up the reader if necessary
+    header_->data_seq.fetch_add(1);
+    if (header_->reader_waiting.load())
+    {
+        futex_wake(header_->data_seq);
+    }
+
+    return true;
+}
+
+RingBufferStatus SHMRingBuffer::timed_receive(void *                                out,
+                                              size_t                                max_size,
+                                              size_t &                              received_size,
+                                              std::chrono::steady_clock::time_point deadline)
+{
+    return timed_receive(
+        [&](size_t message_size) {
+            if (message_size > max_size)
+            {
+                NEUROPOD_ERROR(
+                    "OPE: Received a message of {} bytes, but expected at most {} bytes", message_size, max_size);
+            }
+
+            received_size = message_size;
+            return out;
+        },
+        deadline);
+}
+
+RingBufferStatus SHMRingBuffer::timed_receive(const std::function<void *(size_t)> & get_buffer,
+                                              std::chrono::steady_clock::time_point deadline)
+{
+    // We're the only reader so nobody else modifies `read_pos`
+    const auto read_pos = header_->read_pos.load(std::memory_order_relaxed);
+    for (int i = 0;; i++)
+    {
+        if (interrupted_.exchange(false))
+        {
+            return RING_BUFFER_INTERRUPTED;
+        }
+
+        const auto seq = header_->data_seq.load();
+        if (header_->write_pos.load(std::memory_order_acquire) != read_pos)
+        {
+            break;
+        }
+
+        if (i < RING_BUFFER_SPIN_COUNT)
+        {
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return RING_BUFFER_TIMED_OUT;
+        }
+
+        // Let the writer know we're waiting and check again before going to sleep
+        header_->reader_waiting.store(1);
+        if (header_->write_pos.load() == read_pos && !interrupted_)
+        {
+            futex_wait(header_->data_seq, seq, deadline);
+        }
+
+        header_->reader_waiting.store(0);
+    }
+
+    // Read the message
+    MessageSize message_size;
+    read_bytes(read_pos, &message_size, sizeof(message_size));
+    read_bytes(read_pos + sizeof(message_size), get_buffer(message_size), message_size);
+
+    // Free the space and wake up the writer if necessary
+    header_->read_pos.store(read_pos + sizeof(message_size) + message_size, std::memory_order_release);
+    header_->space_seq.fetch_add(1);
+    if (header_->writer_waiting.load())
+    {
+        futex_wake(header_->space_seq);
+    }
+
+    return RING_BUFFER_OK;
+}
+
+void SHMRingBuffer::interrupt()
+{
+    interrupted_ = true;
+
+    // Wake up the reader. Bumping the sequence number ensures it doesn't go back to sleep
+    header_->data_seq.fetch_add(1);
+    futex_wake(header_->data_seq);
+}
+
+void SHMRingBuffer::remove(const std::string &name)
+{
+    ipc::shared_memory_object::remove(name.c_str());
+}
+
+} // namespace detail
+
+} // namespace neuropod
@@ -0,0 +1,107 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace neuropod
+{
+
+namespace detail
+{
+
+struct RingBufferHeader;
+
+// The result of a `timed_receive` call on an `SHMRingBuffer`
+enum RingBufferStatus
+{
+    // A message was read
+    RING_BUFFER_OK,
+
+    // The deadline passed before a message was available
+    RING_BUFFER_TIMED_OUT,
+
+    // `interrupt` was called on this ring buffer
+    RING_BUFFER_INTERRUPTED,
+};
+
+// A single producer single consumer (SPSC) ring buffer of variable length messages in shared memory.
+// The read and write positions are atomics in shared memory so sending and receiving a message does not
+// require a lock. A reader (or writer) that has to wait for data (or space) sleeps on a futex and is
+// woken up by the other side.
+//
+// Note: only one thread in one process may write to a given ring buffer at a time and only one thread
+// in one process may read from it at a time. Callers are responsible for any synchronization needed to
+// guarantee this.
+class SHMRingBuffer
+{
+private:
+    std::unique_ptr<boost::interprocess::shared_memory_object> shm_;
+    std::unique_ptr<boost::interprocess::mapped_region>        region_;
+
+    // Pointers into shared memory
+    RingBufferHeader *header_;
+    char *            data_;
+
+    // The size of the data section in bytes
+    size_t capacity_;
+
+    // Set by `interrupt` to wake up a reader in this process
+    std::atomic_bool interrupted_{false};
+
+    // Copy `size` bytes into or out of the data section starting at `pos` (handling wraparound)
+    void write_bytes(uint64_t pos, const void *data, size_t size);
+    void read_bytes(uint64_t pos, void *out, size_t size) const;
+
+public:
+    // Opens or creates a ring buffer with the given name and capacity (in bytes)
+    // Both processes must use the same capacity
+    SHMRingBuffer(const std::string &name, size_t capacity);
+    ~SHMRingBuffer();
+
+    // Send a message. Blocks until there's enough space or until `deadline` passes
+    // Returns false if we timed out
+    bool timed_send(const void *data, size_t size, std::chrono::steady_clock::time_point deadline);
+
+    // Receive a message into `out` (which must be able to store `max_size` bytes). Blocks until a message is
+    // available, `deadline` passes or `interrupt` is called
+    RingBufferStatus timed_receive(void *                                out,
+                                   size_t                                max_size,
+                                   size_t &                              received_size,
+                                   std::chrono::steady_clock::time_point deadline);
+
+    // Same as above, but the message is copied into the buffer returned by `get_buffer` (which is called with
+    // the size of the message). This lets callers allocate exactly enough space for variable length messages
+    RingBufferStatus timed_receive(const std::function<void *(size_t)> & get_buffer,
+                                   std::chrono::steady_clock::time_point deadline);
+
+    // Wake up a reader of this ring buffer in this process. The current (or next) call to
+    // `timed_receive` returns `RING_BUFFER_INTERRUPTED`
+    void interrupt();
+
+    // Remove the shared memory backing the ring buffer with the given name
+    static void remove(const std::string &name);
+};
+
+} // namespace detail
+
+} // namespace neuropod
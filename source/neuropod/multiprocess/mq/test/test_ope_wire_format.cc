@@ -33,17 +33,20 @@ TEST(test_ope_wire_format, small_payload)
     // Something that fits inline within the payload
     std::vector<std::string> expected = {"some", "vector", "of", "strings"};
 
-    neuropod::detail::WireFormat<MessageType> msg;
-    neuropod::detail::Transferrables          transferrables;
-    neuropod::detail::serialize_payload(expected, msg, transferrables);
+    neuropod::detail::Transferrables transferrables;
+    auto msg = neuropod::detail::serialize_payload<MessageType>(expected, transferrables);
 
     // This payload should fit within the message so transferrables should
     // be empty
     EXPECT_TRUE(transferrables.empty());
 
+    // Only the header and the used part of the payload should be sent
+    EXPECT_TRUE(msg->is_inline);
+    EXPECT_EQ(sizeof(*msg) + msg->payload_size, neuropod::detail::get_wire_size(*msg));
+
     // Get the payload
     std::vector<std::string> actual;
-    neuropod::detail::deserialize_payload(msg, actual);
+    neuropod::detail::deserialize_payload(*msg, actual);
 
     EXPECT_EQ(expected, actual);
 }
@@ -55,17 +58,40 @@ TEST(test_ope_wire_format, large_payload)
 
     std::vector<std::string> expected = {large_string};
 
-    neuropod::detail::WireFormat<MessageType> msg;
-    neuropod::detail::Transferrables          transferrables;
-    neuropod::detail::serialize_payload(expected, msg, transferrables);
+    neuropod::detail::Transferrables transferrables;
+    auto msg = neuropod::detail::serialize_payload<MessageType>(expected, transferrables);
 
     // This payload should not fit within the message so transferrables should
     // contain exactly one item
     EXPECT_EQ(1, transferrables.size());
+    EXPECT_FALSE(msg->is_inline);
+
+    // Get the payload
+    std::vector<std::string> actual;
+    neuropod::detail::deserialize_payload(*msg, actual);
+
+    EXPECT_EQ(expected, actual);
+}
+
+TEST(test_ope_wire_format, growing_payload)
+{
+    // Something that's larger than the first SHM block used while serializing
+    std::vector<std::string> expected;
+    for (int i = 0; i < 64; i++)
+    {
+        expected.emplace_back(1000 + i, 'a' + (i % 26));
+    }
+
+    neuropod::detail::Transferrables transferrables;
+    auto msg = neuropod::detail::serialize_payload<MessageType>(expected, transferrables);
+
+    EXPECT_EQ(1, transferrables.size());
+    EXPECT_FALSE(msg->is_inline);
+    EXPECT_GT(msg->payload_size, 2 * neuropod::detail::INLINE_PAYLOAD_SIZE_BYTES);
 
     // Get the payload
     std::vector<std::string> actual;
-    neuropod::detail::deserialize_payload(msg, actual);
+    neuropod::detail::deserialize_payload(*msg, actual);
 
     EXPECT_EQ(expected, actual);
 }
@@ -0,0 +1,140 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "neuropod/multiprocess/mq/shm_ring_buffer.hh"
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+std::chrono::steady_clock::time_point deadline_in(int ms)
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+}
+
+} // namespace
+
+TEST(test_shm_ring_buffer, simple)
+{
+    const std::string name = "neuropod_test_shm_ring_buffer_simple";
+    neuropod::detail::SHMRingBuffer::remove(name);
+
+    neuropod::detail::SHMRingBuffer writer(name, 1024);
+    neuropod::detail::SHMRingBuffer reader(name, 1024);
+
+    const std::string message = "hello world";
+    EXPECT_TRUE(writer.timed_send(message.data(), message.size(), deadline_in(100)));
+
+    char   buffer[64];
+    size_t received_size;
+    EXPECT_EQ(reader.timed_receive(buffer, sizeof(buffer), received_size, deadline_in(100)),
+              neuropod::detail::RING_BUFFER_OK);
+    EXPECT_EQ(std::string(buffer, received_size), message);
+
+    // The buffer is now empty
+    EXPECT_EQ(reader.timed_receive(buffer, sizeof(buffer), received_size, deadline_in(10)),
+              neuropod::detail::RING_BUFFER_TIMED_OUT);
+
+    neuropod::detail::SHMRingBuffer::remove(name);
+}
+
+TEST(test_shm_ring_buffer, full)
+{
+    const std::string name = "neuropod_test_shm_ring_buffer_full";
+    neuropod::detail::SHMRingBuffer::remove(name);
+
+    neuropod::detail::SHMRingBuffer writer(name, 64);
+
+    // Each message takes 4 + 28 bytes so only two fit
+    char data[28] = {};
+    EXPECT_TRUE(writer.timed_send(data, sizeof(data), deadline_in(10)));
+    EXPECT_TRUE(writer.timed_send(data, sizeof(data), deadline_in(10)));
+    EXPECT_FALSE(writer.timed_send(data, sizeof(data), deadline_in(10)));
+
+    // Messages larger than the buffer are an error
+    char large[128] = {};
+    EXPECT_ANY_THROW(writer.timed_send(large, sizeof(large), deadline_in(10)));
+
+    neuropod::detail::SHMRingBuffer::remove(name);
+}
+
+TEST(test_shm_ring_buffer, interrupt)
+{
+    const std::string name = "neuropod_test_shm_ring_buffer_interrupt";
+    neuropod::detail::SHMRingBuffer::remove(name);
+
+    neuropod::detail::SHMRingBuffer reader(name, 1024);
+
+    std::thread t([&reader]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        reader.interrupt();
+    });
+
+    char   buffer[64];
+    size_t received_size;
+    EXPECT_EQ(reader.timed_receive(buffer, sizeof(buffer), received_size, deadline_in(5000)),
+              neuropod::detail::RING_BUFFER_INTERRUPTED);
+
+    t.join();
+
+    // Interrupts only affect one read
+    EXPECT_EQ(reader.timed_receive(buffer, sizeof(buffer), received_size, deadline_in(10)),
+              neuropod::detail::RING_BUFFER_TIMED_OUT);
+
+    neuropod::detail::SHMRingBuffer::remove(name);
+}
+
+TEST(test_shm_ring_buffer, producer_consumer)
+{
+    const std::string name = "neuropod_test_shm_ring_buffer_producer_consumer";
+    neuropod::detail::SHMRingBuffer::remove(name);
+
+    // A small buffer so messages wrap around and the writer has to wait for the reader
+    constexpr size_t capacity     = 1000;
+    constexpr size_t num_messages = 10000;
+
+    neuropod::detail::SHMRingBuffer writer(name, capacity);
+    neuropod::detail::SHMRingBuffer reader(name, capacity);
+
+    std::thread producer([&writer]() {
+        for (size_t i = 0; i < num_messages; i++)
+        {
+            // Messages of varying size filled with their index
+            std::vector<uint8_t> message(1 + i % 200);
+            std::fill(message.begin(), message.end(), static_cast<uint8_t>(i));
+            EXPECT_TRUE(writer.timed_send(message.data(), message.size(), deadline_in(5000)));
+        }
+    });
+
+    for (size_t i = 0; i < num_messages; i++)
+    {
+        uint8_t buffer[capacity];
+        size_t  received_size;
+        ASSERT_EQ(reader.timed_receive(buffer, sizeof(buffer), received_size, deadline_in(5000)),
+                  neuropod::detail::RING_BUFFER_OK);
+
+        ASSERT_EQ(received_size, 1 + i % 200);
+        for (size_t j = 0; j < received_size; j++)
+        {
+            ASSERT_EQ(buffer[j], static_cast<uint8_t>(i));
+        }
+    }
+
+    producer.join();
+    neuropod::detail::SHMRingBuffer::remove(name);
+}
@@ -17,6 +17,8 @@ limitations under the License.
 
 #include "neuropod/multiprocess/mq/transferrables.hh"
 
+#include <memory>
+
 namespace neuropod
 {
 
@@ -28,13 +30,26 @@ namespace detail
 template <typename UserPayloadType>
 struct WireFormat;
 
-// Serialize a payload into `data` and add any created transferrables to `transferrables`
-// If the payload is small enough (less than the size of `payload_` in the wire format), it will be
-// stored inline in the message. Otherwise it'll be serialized and put into a shared memory
-// block. That block will be added to `transferrables` to ensure it stays in scope while the message
-// is in transit.
-template <typename Payload, typename UserPayloadType>
-void serialize_payload(const Payload &payload, WireFormat<UserPayloadType> &data, Transferrables &transferrables);
+// Messages are allocated with exactly enough space for their header and payload
+struct WireFormatDeleter
+{
+    void operator()(void *msg) const { ::operator delete(msg); }
+};
+
+template <typename UserPayloadType>
+using WireFormatPtr = std::unique_ptr<WireFormat<UserPayloadType>, WireFormatDeleter>;
+
+// Allocate a message with room for `payload_capacity` bytes of payload
+template <typename UserPayloadType>
+WireFormatPtr<UserPayloadType> make_message(size_t payload_capacity);
+
+// Serialize a payload into a new message and add any created transferrables to `transferrables`
+// If the payload is small enough (at most `INLINE_PAYLOAD_SIZE_BYTES`), it will be stored inline in the
+// message. Otherwise it'll be serialized into a shared memory block. That block will be added to
+// `transferrables` to ensure it stays in scope while the message is in transit.
+// In both cases, the payload is only serialized once.
+template <typename UserPayloadType, typename Payload>
+WireFormatPtr<UserPayloadType> serialize_payload(const Payload &payload, Transferrables &transferrables);
 
 // Get a payload of type `Payload` from a message
 template <typename Payload, typename UserPayloadType>
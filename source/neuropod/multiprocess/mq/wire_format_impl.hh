@@ -20,6 +20,12 @@ limitations under the License.
 #include "neuropod/multiprocess/serialization/ipc_serialization.hh"
 #include "neuropod/multiprocess/shm/shm_allocator.hh"
 
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
 namespace neuropod
 {
 
@@ -50,6 +56,9 @@ enum QueueMessageType
 
 // The on-the-wire format of the data
 // UserPayloadType should be an enum that specifies types of payloads
+//
+// This is a fixed size header followed by a variable length payload. Messages are only as large as
+// their header and payload (e.g. heartbeats and DONE messages are just a few bytes).
 template <typename UserPayloadType>
 struct __attribute__((__packed__)) WireFormat
 {
@@ -65,101 +74,187 @@ struct __attribute__((__packed__)) WireFormat
     bool requires_done_msg = false;
 
     // Whether or not the payload is inline
-    bool is_inline;
+    bool is_inline = true;
 
     // The size of the payload in bytes
-    uint32_t payload_size;
+    uint32_t payload_size = 0;
 
     // A user-defined type of the payload
     // Note: this field is only checked if `type` is USER_PAYLOAD
     UserPayloadType payload_type;
 
-    union {
-        // An inline payload
-        char payload[INLINE_PAYLOAD_SIZE_BYTES];
-
-        // An SHM id of the actual payload
-        // This is used for large messages that are serialized and put in
-        // shm
-        char payload_id[24];
-    };
+    // If `is_inline` is true, this is followed by `payload_size` bytes of payload. Otherwise, this is
+    // followed by the SHM id of the actual payload (for large messages that are serialized and put in shm)
+    char payload[];
 
     WireFormat() = default;
 
     // Delete the copy constructor and the copy assignment operator
     WireFormat(const WireFormat<UserPayloadType> &) = delete;
     WireFormat &operator=(const WireFormat<UserPayloadType> &other) = delete;
-
-    // Keep the move constructor and move assignment operator
-    WireFormat(WireFormat<UserPayloadType> &&) = default;
-    WireFormat &operator=(WireFormat<UserPayloadType> &&other) = default;
 };
 
-// Serialize a payload into `data` and add any created transferrables to `transferrables`
-// If the payload is small enough (less than the size of `payload_` in the wire format), it will be
-// stored inline in the message. Otherwise it'll be serialized and put into a shared memory
-// block. That block will be added to `transferrables` to ensure it stays in scope while the message
-// is in transit.
-template <typename Payload, typename UserPayloadType>
-void serialize_payload(const Payload &payload, WireFormat<UserPayloadType> &data, Transferrables &transferrables)
+// The size of the SHM id stored in the payload of messages that aren't inline
+constexpr size_t PAYLOAD_ID_SIZE_BYTES = std::tuple_size<SHMBlockID>::value;
+
+// The number of bytes of `msg` that need to be sent to the other process
+// This is the header and the used part of the payload
+template <typename UserPayloadType>
+size_t get_wire_size(const WireFormat<UserPayloadType> &msg)
 {
-    // Serialize the payload
-    std::stringstream ss;
-    ipc_serialize(ss, payload);
+    return sizeof(msg) + (msg.is_inline ? msg.payload_size : PAYLOAD_ID_SIZE_BYTES);
+}
 
-    // Set the size
-    auto size_bytes   = ss.tellp();
-    data.payload_size = size_bytes;
+// The largest possible wire size of a message
+template <typename UserPayloadType>
+constexpr size_t get_max_wire_size()
+{
+    return sizeof(WireFormat<UserPayloadType>) + INLINE_PAYLOAD_SIZE_BYTES;
+}
 
-    if (size_bytes <= sizeof(data.payload))
+// A streambuf that reads from or writes to an existing buffer without copying it
+class MemoryStreambuf : public std::streambuf
+{
+public:
+    MemoryStreambuf(char *data, size_t size)
     {
-        // We can store this message inline
-        ss.read(data.payload, size_bytes);
-        data.is_inline = true;
+        setp(data, data + size);
+        setg(data, data, data + size);
     }
-    else
+};
+
+// A streambuf that a payload is serialized into exactly once
+// Bytes are written into an inline buffer until they no longer fit in an inline payload. After that, they're
+// written into a shared memory block that doubles in size (copying what was written so far) whenever it's full
+class PayloadStreambuf : public std::streambuf
+{
+private:
+    char inline_buffer_[INLINE_PAYLOAD_SIZE_BYTES];
+
+    char * data_     = inline_buffer_;
+    size_t size_     = 0;
+    size_t capacity_ = INLINE_PAYLOAD_SIZE_BYTES;
+
+    // The shared memory block that `data_` points into once the payload is too large to be inline
+    std::shared_ptr<void> block_;
+    SHMBlockID            block_id_;
+
+    // Make sure there is room for `required` bytes
+    void reserve(size_t required)
     {
-        // Store in SHM and set msg.payload_id
-        SPDLOG_DEBUG("Could not fit data in inline message. Sending via SHM. Requested size: {}", size_bytes);
+        if (required <= capacity_)
+        {
+            return;
+        }
+
+        const auto capacity = std::max(2 * capacity_, required);
         SHMBlockID block_id;
+        auto       block = shm_allocator.allocate_shm(capacity, block_id);
+        memcpy(block.get(), data_, size_);
+
+        block_    = std::move(block);
+        block_id_ = block_id;
+        data_     = static_cast<char *>(block_.get());
+        capacity_ = capacity;
+    }
+
+protected:
+    std::streamsize xsputn(const char *s, std::streamsize count) override
+    {
+        reserve(size_ + count);
+        memcpy(data_ + size_, s, count);
+        size_ += count;
+        return count;
+    }
+
+    int_type overflow(int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            return traits_type::not_eof(ch);
+        }
+
+        reserve(size_ + 1);
+        data_[size_++] = traits_type::to_char_type(ch);
+        return ch;
+    }
+
+public:
+    const char *data() const { return data_; }
+    size_t      size() const { return size_; }
 
-        auto block = shm_allocator.allocate_shm(size_bytes, block_id);
+    // Whether the payload is small enough to be stored inline
+    bool is_inline() const { return block_ == nullptr; }
 
-        // Write the serialized message into the block
-        ss.read(static_cast<char *>(block.get()), size_bytes);
+    // The shared memory block containing the payload (if it isn't inline)
+    const SHMBlockID &     block_id() const { return block_id_; }
+    std::shared_ptr<void> &block() { return block_; }
+};
+
+template <typename UserPayloadType>
+WireFormatPtr<UserPayloadType> make_message(size_t payload_capacity)
+{
+    void *buffer = ::operator new(sizeof(WireFormat<UserPayloadType>) + payload_capacity);
+    return WireFormatPtr<UserPayloadType>(new (buffer) WireFormat<UserPayloadType>);
+}
 
-        // Copy the block id into the message
-        memcpy(data.payload_id, block_id.data(), sizeof(data.payload_id));
-        data.is_inline = false;
+template <typename UserPayloadType, typename Payload>
+WireFormatPtr<UserPayloadType> serialize_payload(const Payload &payload, Transferrables &transferrables)
+{
+    // Serialize the payload once. Small payloads end up in an inline buffer and larger ones directly in SHM
+    PayloadStreambuf buf;
+    {
+        std::ostream out(&buf);
+        ipc_serialize(out, payload);
+    }
 
-        // Add this block to our list of transferrables so it stays in scope until
-        // the other process reads the message
-        transferrables.emplace_back(std::move(block));
+    const auto size_bytes = buf.size();
+    if (buf.is_inline())
+    {
+        // We can store this message inline
+        auto msg          = make_message<UserPayloadType>(size_bytes);
+        msg->payload_size = size_bytes;
+        msg->is_inline    = true;
+        memcpy(msg->payload, buf.data(), size_bytes);
+        return msg;
     }
+
+    // The payload is in SHM so put the block id in the payload
+    SPDLOG_DEBUG("Could not fit data in inline message. Sent via SHM. Size: {}", size_bytes);
+
+    auto msg          = make_message<UserPayloadType>(PAYLOAD_ID_SIZE_BYTES);
+    msg->payload_size = size_bytes;
+    msg->is_inline    = false;
+    memcpy(msg->payload, buf.block_id().data(), PAYLOAD_ID_SIZE_BYTES);
+
+    // Add this block to our list of transferrables so it stays in scope until
+    // the other process reads the message
+    transferrables.emplace_back(std::move(buf.block()));
+    return msg;
 }
 
 // Get a payload of type `Payload` from a message
 template <typename Payload, typename UserPayloadType>
 void deserialize_payload(const WireFormat<UserPayloadType> &data, Payload &out)
 {
-    std::stringstream ss;
     if (data.is_inline)
     {
         // The message is inline so we can just read it
-        ss.write(data.payload, data.payload_size);
+        MemoryStreambuf buf(const_cast<char *>(data.payload), data.payload_size);
+        std::istream    in(&buf);
+        ipc_deserialize(in, out);
+        return;
     }
-    else
-    {
-        // The message is stored in SHM
-        SHMBlockID block_id;
-        memcpy(block_id.data(), data.payload_id, sizeof(data.payload_id));
 
-        // Load the block and get the data
-        auto block = shm_allocator.load_shm(block_id);
-        ss.write(static_cast<char *>(block.get()), data.payload_size);
-    }
+    // The message is stored in SHM
+    SHMBlockID block_id;
+    memcpy(block_id.data(), data.payload, PAYLOAD_ID_SIZE_BYTES);
 
-    ipc_deserialize(ss, out);
+    // Load the block and read the data directly from it
+    auto            block = shm_allocator.load_shm(block_id);
+    MemoryStreambuf buf(static_cast<char *>(block.get()), data.payload_size);
+    std::istream    in(&buf);
+    ipc_deserialize(in, out);
 }
 
 } // namespace detail
@@ -18,9 +18,11 @@ limitations under the License.
 #include "neuropod/backends/neuropod_backend.hh"
 #include "neuropod/internal/cuda_device_mapping.hh"
 #include "neuropod/internal/logging.hh"
+#include "neuropod/internal/tracing.hh"
 #include "neuropod/multiprocess/control_messages.hh"
 #include "neuropod/multiprocess/ipc_control_channel.hh"
 #include "neuropod/multiprocess/ope_load_config.hh"
+#include "neuropod/multiprocess/ope_request.hh"
 #include "neuropod/multiprocess/shm_tensor.hh"
 
 #include <boost/date_time/microsec_time_clock.hpp>
@@ -30,7 +32,13 @@ limitations under the License.
 #include <boost/uuid/uuid_io.hpp>
 #include <sys/wait.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include <spawn.h>
@@ -95,116 +103,153 @@ pid_t start_worker_process(const std::string &control_queue_name, std::vector<st
     return child_pid;
 }
 
-// Note: we don't register this with the library as a backend because it is not
-// a backend in the normal sense. It is only used here for out of process
-// execution
+// Build the environment for a worker process that should run on `visible_device`
+std::vector<std::string> get_worker_env(NeuropodDevice visible_device)
+{
+    auto env = get_env_map();
+
+    // Set the visible devices correctly when starting the worker process
+    if (visible_device == Device::CPU)
+    {
+        env["CUDA_VISIBLE_DEVICES"] = "";
+    }
+    else
+    {
+        // The GPU UUID is a standard id that is not affected by CUDA_VISIBLE_DEVICES so we can
+        // use it to have stable IDs across processes (e.g. for OPE)
+        env["CUDA_VISIBLE_DEVICES"] = get_gpu_uuid(visible_device);
+    }
+
+    // Write worker trace events to the same file as this process (even if tracing was enabled with
+    // `set_trace_file` instead of the environment variable)
+    const auto trace_file = get_trace_file();
+    if (!trace_file.empty())
+    {
+        env["NEUROPOD_TRACE_FILE"] = trace_file;
+    }
+
+    // Convert to a vector
+    std::vector<std::string> env_vec;
+    env_vec.reserve(env.size());
+    for (const auto &item : env)
+    {
+        env_vec.emplace_back(item.first + "=" + item.second);
+    }
 
-class MultiprocessNeuropodBackend : public NeuropodBackendWithDefaultAllocator<SHMNeuropodTensor>
+    return env_vec;
+}
+
+// Used to tag requests so responses can be matched back to them. This is shared by all workers
+// so request IDs are unique within a trace (see `tracing.hh`)
+std::atomic<uint64_t> next_request_id{1};
+
+uint64_t get_steady_clock_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// The result of a request as returned by a worker
+struct OPEResponse
+{
+    bool             is_exception = false;
+    NeuropodValueMap outputs;
+    std::string      error;
+
+    // Timing info for latency stats (see `ope_return_output`)
+    uint64_t start_time_ns           = 0;
+    uint64_t compute_time_ns         = 0;
+    uint64_t deserialization_time_ns = 0;
+};
+
+// A single worker process along with the control channel used to talk to it
+class OPEWorker
 {
 private:
     pid_t       child_pid_ = -1;
     std::string control_queue_name_;
-    bool        free_memory_every_cycle_;
-
-    // The load config to send to the worker process
-    ope_load_config load_config_;
 
     // Control channel for interacting with the worker
     IPCControlChannel control_channel_;
 
-    void wait_for_load_confirmation(const std::string &neuropod_path)
+    // Responses that have been received, but not yet picked up by the thread waiting for them
+    // Only one thread reads from the control channel at a time. That thread hands off
+    // responses for other requests via this map.
+    std::unordered_map<uint64_t, OPEResponse> responses_;
+    bool                                      is_reading_ = false;
+    std::mutex                                responses_mutex_;
+    std::condition_variable                   responses_cv_;
+
+    // Set if reading from the control channel failed (e.g. the worker died). We don't know which request
+    // the lost message was for so every request on this worker fails with this error
+    std::exception_ptr read_error_;
+
+    // Read a single response from the control channel
+    // Errors loading the response are returned in it so they reach the thread waiting for that request
+    std::pair<uint64_t, OPEResponse> recv_response()
     {
-        // Wait for confirmation that the model was loaded
-        SPDLOG_DEBUG("OPE: Waiting for load confirmation from worker...");
         auto received = control_channel_.recv_message();
         auto msg_type = received.get_payload_type();
 
-        if (msg_type == EXCEPTION)
+        // Every response starts with the ID of its request (see `ope_request.hh`)
+        uint64_t request_id;
+        received.get(request_id);
+
+        OPEResponse response;
+        try
         {
-            // Get the message
-            std::string msg;
-            received.get(msg);
+            if (msg_type == EXCEPTION)
+            {
+                ope_exception payload;
+                received.get(payload);
 
-            NEUROPOD_ERROR("Got an exception when loading the model at {}: {}", neuropod_path, msg);
-        }
+                response.is_exception = true;
+                response.error        = std::move(payload.message);
+                return std::make_pair(request_id, std::move(response));
+            }
 
-        if (msg_type != LOAD_SUCCESS)
+            if (msg_type != RETURN_OUTPUT)
+            {
+                NEUROPOD_ERROR("Got unexpected message from the worker process: {}", msg_type);
+            }
+
+            // Load the returned tensors
+            const auto        start = get_steady_clock_ns();
+            ScopedTraceSpan   span("ope_load_outputs", request_id);
+            ope_return_output payload;
+            received.get(payload);
+
+            response.outputs                 = std::move(payload.outputs);
+            response.start_time_ns           = payload.start_time_ns;
+            response.compute_time_ns         = payload.compute_time_ns;
+            response.deserialization_time_ns = get_steady_clock_ns() - start;
+        }
+        catch (const std::exception &e)
         {
-            // We got an unexpected message
-            NEUROPOD_ERROR("Expected LOAD_SUCCESS, but got unexpected message from the worker process: {}", msg_type);
+            response              = OPEResponse();
+            response.is_exception = true;
+            response.error        = std::string("Failed to read the response from the worker process: ") + e.what();
         }
+
+        return std::make_pair(request_id, std::move(response));
     }
 
 public:
-    MultiprocessNeuropodBackend(const std::string &neuropod_path,
-                                const std::string &control_queue_name,
-                                bool               free_memory_every_cycle)
-        : NeuropodBackendWithDefaultAllocator<SHMNeuropodTensor>(neuropod_path, {}),
-          control_queue_name_(control_queue_name),
-          free_memory_every_cycle_(free_memory_every_cycle),
-          control_channel_(control_queue_name, MAIN_PROCESS)
+    // Connect to an existing worker
+    explicit OPEWorker(const std::string &control_queue_name)
+        : control_queue_name_(control_queue_name), control_channel_(control_queue_name_, MAIN_PROCESS)
     {
-        // Setup the load configuration
-        load_config_.neuropod_path = neuropod_path_;
-
-        // Load the model
-        load_model();
     }
 
     // Generate a control queue name and start a worker
-    MultiprocessNeuropodBackend(const std::string &                 neuropod_path,
-                                const RuntimeOptions &              options,
-                                bool                                free_memory_every_cycle,
-                                const std::vector<BackendLoadSpec> &default_backend_overrides)
-        : NeuropodBackendWithDefaultAllocator<SHMNeuropodTensor>(neuropod_path, options),
-          control_queue_name_(boost::uuids::to_string(boost::uuids::random_generator()())),
-          free_memory_every_cycle_(free_memory_every_cycle),
+    explicit OPEWorker(const std::vector<std::string> &env)
+        : control_queue_name_(boost::uuids::to_string(boost::uuids::random_generator()())),
           control_channel_(control_queue_name_, MAIN_PROCESS)
     {
-        auto env = get_env_map();
-
-        // Set the visible devices correctly when starting the worker process
-        if (options.visible_device == Device::CPU)
-        {
-            env["CUDA_VISIBLE_DEVICES"] = "";
-        }
-        else
-        {
-            // The GPU UUID is a standard id that is not affected by CUDA_VISIBLE_DEVICES so we can
-            // use it to have stable IDs across processes (e.g. for OPE)
-            env["CUDA_VISIBLE_DEVICES"] = get_gpu_uuid(options.visible_device);
-        }
-
-        // Convert to a vector
-        std::vector<std::string> env_vec;
-        env_vec.reserve(env.size());
-        for (const auto &item : env)
-        {
-            env_vec.emplace_back(item.first + "=" + item.second);
-        }
-
-        // Start the worker process
-        child_pid_ = start_worker_process(control_queue_name_, env_vec);
-
-        // Setup the load configuration
-        load_config_.neuropod_path             = neuropod_path_;
-        load_config_.default_backend_overrides = default_backend_overrides;
-
-        // Copy options into the load configuration
-        // Note: some of these options will be overridden in the worker process
-        load_config_.opts = options_;
-
-        // Since we're using CUDA_VISIBLE_DEVICES to set the appropriate device above,
-        // we'll just tell the worker to use GPU0
-        load_config_.opts.visible_device = Device::GPU0;
-
-        if (options.load_model_at_construction)
-        {
-            load_model();
-        }
+        child_pid_ = start_worker_process(control_queue_name_, env);
     }
 
-    ~MultiprocessNeuropodBackend() override
+    ~OPEWorker()
     {
         // We only need to clean up all of this if we started the worker process
         if (child_pid_ > 0)
@@ -241,38 +286,315 @@ public:
         }
     }
 
-protected:
-    // Run inference
-    std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &        inputs,
-                                                     const std::vector<std::string> &requested_outputs) override
+    IPCControlChannel &get_control_channel() { return control_channel_; }
+
+    // Send a request to the worker without waiting for it to complete and return the ID of the request
+    uint64_t send_request(const NeuropodValueMap &inputs, const std::vector<std::string> &requested_outputs)
     {
+        const uint64_t request_id = next_request_id++;
+
         // Add inputs
-        control_channel_.send_message_move(ADD_INPUT, std::move(inputs));
+        {
+            ScopedTraceSpan span("ope_send_inputs", request_id);
+            control_channel_.send_message_move(ADD_INPUT, ope_add_input{request_id, inputs});
+        }
 
         // Run inference with a set of requested outputs
-        control_channel_.send_message(INFER, requested_outputs);
+        ScopedTraceSpan span("ope_send_infer", request_id);
+        control_channel_.send_message(INFER, ope_infer{request_id, requested_outputs});
 
-        // Get the outputs from the worker
+        return request_id;
+    }
+
+    // Wait for the response to a request sent with `send_request`
+    OPEResponse wait_for_response(uint64_t request_id)
+    {
+        std::unique_lock<std::mutex> lock(responses_mutex_);
+        while (true)
+        {
+            auto it = responses_.find(request_id);
+            if (it != responses_.end())
+            {
+                auto response = std::move(it->second);
+                responses_.erase(it);
+                return response;
+            }
+
+            if (read_error_)
+            {
+                std::rethrow_exception(read_error_);
+            }
+
+            if (is_reading_)
+            {
+                // Another thread is reading from the control channel. Wait for it to hand off a response
+                responses_cv_.wait(lock);
+                continue;
+            }
+
+            // No other thread is reading so we'll read the next response
+            is_reading_ = true;
+            lock.unlock();
+
+            std::pair<uint64_t, OPEResponse> item;
+            try
+            {
+                item = recv_response();
+            }
+            catch (...)
+            {
+                lock.lock();
+                is_reading_ = false;
+                read_error_ = std::current_exception();
+                responses_cv_.notify_all();
+                throw;
+            }
+
+            lock.lock();
+            is_reading_ = false;
+            responses_.emplace(std::move(item));
+            responses_cv_.notify_all();
+        }
+    }
+
+    void wait_for_load_confirmation(const std::string &neuropod_path)
+    {
+        // Wait for confirmation that the model was loaded
+        SPDLOG_DEBUG("OPE: Waiting for load confirmation from worker {}...", control_queue_name_);
         auto received = control_channel_.recv_message();
         auto msg_type = received.get_payload_type();
 
         if (msg_type == EXCEPTION)
         {
             // Get the message
-            std::string msg;
-            received.get(msg);
+            ope_exception payload;
+            received.get(payload);
 
-            NEUROPOD_ERROR("Got an exception during inference: {}", msg);
+            NEUROPOD_ERROR("Got an exception when loading the model at {}: {}", neuropod_path, payload.message);
         }
 
-        if (msg_type != RETURN_OUTPUT)
+        if (msg_type != LOAD_SUCCESS)
         {
-            NEUROPOD_ERROR("Got unexpected message from the worker process: {}", msg_type);
+            // We got an unexpected message
+            NEUROPOD_ERROR("Expected LOAD_SUCCESS, but got unexpected message from the worker process: {}", msg_type);
         }
+    }
+};
 
-        // Load the returned tensors
-        auto to_return = stdx::make_unique<NeuropodValueMap>();
-        received.get(*to_return);
+// Note: we don't register this with the library as a backend because it is not
+// a backend in the normal sense. It is only used here for out of process
+// execution
+
+class MultiprocessNeuropodBackend : public NeuropodBackend
+{
+private:
+    // Allocates small tensors on the heap and everything else in shared memory
+    std::shared_ptr<NeuropodTensorAllocator> allocator_ = std::make_shared<OPETensorAllocator>();
+
+    bool free_memory_every_cycle_;
+
+    // The load config to send to the worker processes
+    ope_load_config load_config_;
+
+    // The pool of workers that requests are dispatched to
+    std::vector<std::unique_ptr<OPEWorker>> workers_;
+
+    // The number of requests currently running on each worker and the
+    // total number of requests dispatched to each worker
+    // These are protected by `dispatch_mutex_`
+    std::vector<size_t> in_flight_;
+    std::vector<size_t> dispatched_;
+
+    std::mutex              dispatch_mutex_;
+    std::condition_variable dispatch_cv_;
+
+    // The maximum number of requests that can be in flight on a single worker
+    size_t max_in_flight_per_worker_;
+
+    // Latency histograms for the OPE specific stages of inference
+    LatencyHistogram &dispatch_wait_latency_   = latency_registry_.get_histogram("ope_dispatch_wait");
+    LatencyHistogram &serialization_latency_   = latency_registry_.get_histogram("ope_serialization");
+    LatencyHistogram &queue_wait_latency_      = latency_registry_.get_histogram("ope_queue_wait");
+    LatencyHistogram &worker_compute_latency_  = latency_registry_.get_histogram("ope_worker_compute");
+    LatencyHistogram &deserialization_latency_ = latency_registry_.get_histogram("ope_deserialization");
+
+    // Pick the least loaded worker that can accept another request and mark it as busy
+    // Blocks until a worker is available
+    size_t acquire_worker()
+    {
+        std::unique_lock<std::mutex> lock(dispatch_mutex_);
+
+        size_t worker_idx = 0;
+        dispatch_cv_.wait(lock, [&] {
+            bool found = false;
+            for (size_t i = 0; i < workers_.size(); i++)
+            {
+                if (in_flight_[i] >= max_in_flight_per_worker_)
+                {
+                    continue;
+                }
+
+                // Prefer the worker with the fewest requests in flight and then the one
+                // that has handled the fewest requests
+                if (!found || in_flight_[i] < in_flight_[worker_idx] ||
+                    (in_flight_[i] == in_flight_[worker_idx] && dispatched_[i] < dispatched_[worker_idx]))
+                {
+                    worker_idx = i;
+                    found      = true;
+                }
+            }
+
+            return found;
+        });
+
+        in_flight_[worker_idx]++;
+        dispatched_[worker_idx]++;
+        return worker_idx;
+    }
+
+    void release_worker(size_t worker_idx)
+    {
+        {
+            std::lock_guard<std::mutex> lock(dispatch_mutex_);
+            in_flight_[worker_idx]--;
+        }
+
+        dispatch_cv_.notify_one();
+    }
+
+    // Holds a worker for the duration of a request
+    struct WorkerLease
+    {
+        MultiprocessNeuropodBackend &backend;
+        const size_t                 worker_idx;
+
+        explicit WorkerLease(MultiprocessNeuropodBackend &b) : backend(b), worker_idx(b.acquire_worker()) {}
+        ~WorkerLease() { backend.release_worker(worker_idx); }
+    };
+
+    void init_dispatch_state()
+    {
+        in_flight_.assign(workers_.size(), 0);
+        dispatched_.assign(workers_.size(), 0);
+    }
+
+    static void maybe_enable_shm_arena(const RuntimeOptions::OPEOptions &ope_options)
+    {
+        if (ope_options.shm_arena_segment_size_bytes > 0)
+        {
+            shm_allocator.enable_arena(ope_options.shm_arena_segment_size_bytes);
+        }
+    }
+
+public:
+    // Use an existing worker
+    MultiprocessNeuropodBackend(const std::string &neuropod_path, const RuntimeOptions::OPEOptions &ope_options)
+        : NeuropodBackend(neuropod_path, {}),
+          free_memory_every_cycle_(ope_options.free_memory_every_cycle),
+          max_in_flight_per_worker_(ope_options.max_in_flight_per_worker)
+    {
+        maybe_enable_shm_arena(ope_options);
+
+        workers_.emplace_back(stdx::make_unique<OPEWorker>(ope_options.control_queue_name));
+        init_dispatch_state();
+
+        // Setup the load configuration
+        load_config_.neuropod_path                                 = neuropod_path_;
+        load_config_.opts.ope_options.shm_arena_segment_size_bytes = ope_options.shm_arena_segment_size_bytes;
+
+        // Load the model
+        load_model();
+    }
+
+    // Start `ope_options.num_workers` workers
+    MultiprocessNeuropodBackend(const std::string &                 neuropod_path,
+                                const RuntimeOptions &              options,
+                                const std::vector<BackendLoadSpec> &default_backend_overrides)
+        : NeuropodBackend(neuropod_path, options),
+          free_memory_every_cycle_(options.ope_options.free_memory_every_cycle),
+          max_in_flight_per_worker_(options.ope_options.max_in_flight_per_worker)
+    {
+        maybe_enable_shm_arena(options.ope_options);
+
+        // Start the worker processes
+        const auto num_workers = options.ope_options.num_workers;
+        const auto env         = get_worker_env(options.visible_device);
+        workers_.reserve(num_workers);
+        for (size_t i = 0; i < num_workers; i++)
+        {
+            workers_.emplace_back(stdx::make_unique<OPEWorker>(env));
+        }
+
+        init_dispatch_state();
+
+        // Setup the load configuration
+        load_config_.neuropod_path             = neuropod_path_;
+        load_config_.default_backend_overrides = default_backend_overrides;
+
+        // Copy options into the load configuration
+        // Note: some of these options will be overridden in the worker process
+        load_config_.opts = options_;
+
+        // Since we're using CUDA_VISIBLE_DEVICES to set the appropriate device above,
+        // we'll just tell the worker to use GPU0
+        load_config_.opts.visible_device = Device::GPU0;
+
+        // Requests are recorded in this process (if enabled) so the worker shouldn't record them again
+        load_config_.opts.recording_options = {};
+
+        if (options.load_model_at_construction)
+        {
+            load_model();
+        }
+    }
+
+    ~MultiprocessNeuropodBackend() override = default;
+
+    std::shared_ptr<NeuropodTensorAllocator> get_tensor_allocator() override { return allocator_; }
+
+    // Concurrent requests are dispatched to the worker processes, but they only run concurrently if more than one
+    // can be in flight. Otherwise, callers (e.g. `NeuropodPool`) should load more instances
+    bool supports_concurrent_inference() const override { return workers_.size() * max_in_flight_per_worker_ > 1; }
+
+protected:
+    // Run inference
+    std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &        inputs,
+                                                     const std::vector<std::string> &requested_outputs) override
+    {
+        ScopedTraceSpan infer_span("ope_infer");
+
+        // Pick a worker to run this request on. It is released when `lease` goes out of scope
+        const auto  dispatch_start = get_steady_clock_ns();
+        WorkerLease lease(*this);
+        auto &      worker = *workers_[lease.worker_idx];
+        dispatch_wait_latency_.record(get_steady_clock_ns() - dispatch_start);
+        write_trace_span("ope_dispatch_wait", dispatch_start, get_steady_clock_ns());
+
+        // Send the request and wait for the outputs
+        // Other requests can be sent to the same worker while this one is running
+        uint64_t request_id;
+        {
+            ScopedLatencyTimer timer(serialization_latency_);
+            request_id = worker.send_request(inputs, requested_outputs);
+        }
+
+        infer_span.set_request_id(request_id);
+
+        const auto sent_time_ns = get_steady_clock_ns();
+        auto       response     = worker.wait_for_response(request_id);
+        write_trace_span("ope_wait_for_response", sent_time_ns, get_steady_clock_ns(), request_id);
+
+        if (response.is_exception)
+        {
+            NEUROPOD_ERROR("Got an exception during inference: {}", response.error);
+        }
+
+        // The worker may have started the request before we read the clock above
+        queue_wait_latency_.record(response.start_time_ns > sent_time_ns ? response.start_time_ns - sent_time_ns : 0);
+        worker_compute_latency_.record(response.compute_time_ns);
+        deserialization_latency_.record(response.deserialization_time_ns);
+
+        auto to_return = stdx::make_unique<NeuropodValueMap>(std::move(response.outputs));
 
         if (free_memory_every_cycle_)
         {
@@ -285,11 +607,17 @@ protected:
 
     void load_model_internal() override
     {
-        // Send a message to load the model
-        control_channel_.send_message(LOAD_NEUROPOD, load_config_);
+        // Send a message to load the model to all the workers so they can load in parallel
+        for (auto &worker : workers_)
+        {
+            worker->get_control_channel().send_message(LOAD_NEUROPOD, load_config_);
+        }
 
-        // Wait until the worker process confirms it has loaded the model
-        wait_for_load_confirmation(neuropod_path_);
+        // Wait until the worker processes confirm they have loaded the model
+        for (auto &worker : workers_)
+        {
+            worker->wait_for_load_confirmation(neuropod_path_);
+        }
     }
 };
 
@@ -304,13 +632,28 @@ std::unique_ptr<NeuropodBackend> load_neuropod_ope(const std::string &
         NEUROPOD_ERROR("`load_neuropod_ope` was called, but `options.use_ope` was false");
     }
 
-    const auto  free_memory_every_cycle = options.ope_options.free_memory_every_cycle;
-    const auto &control_queue_name      = options.ope_options.control_queue_name;
-    if (control_queue_name.empty())
+    const auto &ope_options = options.ope_options;
+    if (ope_options.num_workers == 0)
+    {
+        NEUROPOD_ERROR("`num_workers` must be at least 1 when using OPE");
+    }
+
+    if (ope_options.max_in_flight_per_worker == 0)
     {
-        // Start a new worker
-        return stdx::make_unique<MultiprocessNeuropodBackend>(
-            neuropod_path, options, free_memory_every_cycle, default_backend_overrides);
+        NEUROPOD_ERROR("`max_in_flight_per_worker` must be at least 1 when using OPE");
+    }
+
+    if (ope_options.control_queue_name.empty())
+    {
+        // Start new workers
+        return stdx::make_unique<MultiprocessNeuropodBackend>(neuropod_path, options, default_backend_overrides);
+    }
+
+    if (ope_options.num_workers != 1)
+    {
+        // An existing worker is a single process so we can't build a pool out of it
+        NEUROPOD_ERROR("`num_workers` cannot be greater than 1 when using an existing worker (i.e. when "
+                       "`control_queue_name` is not empty)");
     }
 
     if (!default_backend_overrides.empty())
@@ -321,7 +664,7 @@ std::unique_ptr<NeuropodBackend> load_neuropod_ope(const std::string &
     }
 
     // Use an existing worker
-    return stdx::make_unique<MultiprocessNeuropodBackend>(neuropod_path, control_queue_name, free_memory_every_cycle);
+    return stdx::make_unique<MultiprocessNeuropodBackend>(neuropod_path, ope_options);
 }
 
 } // namespace neuropod
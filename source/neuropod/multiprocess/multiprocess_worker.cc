@@ -14,35 +14,60 @@ limitations under the License.
 */
 
 #include "neuropod/internal/logging.hh"
+#include "neuropod/internal/tracing.hh"
 #include "neuropod/multiprocess/control_messages.hh"
 #include "neuropod/multiprocess/ipc_control_channel.hh"
 #include "neuropod/multiprocess/ope_load_config.hh"
+#include "neuropod/multiprocess/ope_request.hh"
 #include "neuropod/multiprocess/shm_tensor.hh"
 #include "neuropod/multiprocess/tensor_utils.hh"
 #include "neuropod/neuropod.hh"
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <iostream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace neuropod
 {
 
+namespace
+{
+
+uint64_t to_nanoseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+} // namespace
+
 // The main loop for a worker that runs a neuropod
 void multiprocess_worker_loop(const std::string &control_queue_name)
 {
     // Open the control channels
     IPCControlChannel control_channel(control_queue_name, WORKER_PROCESS);
 
+    // Label this process in the trace (if tracing is enabled)
+    set_trace_process_name("neuropod_multiprocess_worker");
+
     // A pointer to a neuropod (that will be loaded)
     std::unique_ptr<Neuropod>                neuropod;
     std::shared_ptr<NeuropodTensorAllocator> allocator;
 
-    // A map to store the inputs
-    NeuropodValueMap inputs;
+    // Backends that support it write their outputs directly into memory allocated by this
+    // (small tensors on the heap and everything else in shared memory)
+    const auto output_allocator = std::make_shared<OPETensorAllocator>();
+
+    // The inputs for each request that hasn't run yet (keyed by request ID)
+    std::unordered_map<uint64_t, NeuropodValueMap> inputs;
+
+    // Errors that happened while adding inputs for a request. These are sent back
+    // to the main process when we get the INFER message for that request
+    std::unordered_map<uint64_t, std::string> input_errors;
 
     while (true)
     {
@@ -50,6 +75,9 @@ void multiprocess_worker_loop(const std::string &control_queue_name)
         auto received = control_channel.recv_message();
         auto msg_type = received.get_payload_type();
 
+        // The request that the current message is for (if any)
+        uint64_t request_id = 0;
+
         try
         {
             if (msg_type == LOAD_NEUROPOD)
@@ -62,53 +90,135 @@ void multiprocess_worker_loop(const std::string &control_queue_name)
                 opts.load_model_at_construction = true;
                 opts.use_ope                    = false;
 
+                // Allocate outputs from an arena if the main process asked for it
+                if (opts.ope_options.shm_arena_segment_size_bytes > 0)
+                {
+                    shm_allocator.enable_arena(opts.ope_options.shm_arena_segment_size_bytes);
+                }
+
                 // Load a neuropod
                 neuropod  = stdx::make_unique<Neuropod>(config.neuropod_path, config.default_backend_overrides, opts);
                 allocator = neuropod->get_tensor_allocator();
                 inputs.clear();
+                input_errors.clear();
                 control_channel.send_message(LOAD_SUCCESS);
             }
             else if (msg_type == ADD_INPUT)
             {
-                NeuropodValueMap tmp;
-                received.get(tmp);
+                // Loading the inputs includes getting tensors out of shared memory
+                ScopedTraceSpan span("worker_load_inputs");
+                ope_add_input   tmp;
+                tmp.request_id = 0;
 
-                for (auto &item : tmp)
+                try
+                {
+                    // `request_id` is read first so we know which request failed even if the inputs can't be read
+                    received.get(tmp);
+                    span.set_request_id(tmp.request_id);
+
+                    auto &request_inputs = inputs[tmp.request_id];
+                    for (auto &item : tmp.inputs)
+                    {
+                        // Wrap in a tensor type that this neuropod expects
+                        request_inputs[item.first] =
+                            wrap_existing_tensor(*allocator, std::dynamic_pointer_cast<NeuropodTensor>(item.second));
+                    }
+                }
+                catch (const std::exception &e)
                 {
-                    // Wrap in a tensor type that this neuropod expects
-                    inputs[item.first] =
-                        wrap_existing_tensor(*allocator, std::dynamic_pointer_cast<NeuropodTensor>(item.second));
+                    if (tmp.request_id == 0)
+                    {
+                        // We don't know which request this is for. The error is reported when the request runs
+                        // and has no inputs
+                        SPDLOG_ERROR("OPE: Failed to read an ADD_INPUT message: {}", e.what());
+                    }
+                    else
+                    {
+                        // There is exactly one response per request so we'll report this when the request runs
+                        input_errors[tmp.request_id] = e.what();
+                    }
                 }
             }
             else if (msg_type == INFER)
             {
-                // Get the requested tensor names
-                std::vector<std::string> requested_outputs;
-                received.get(requested_outputs);
+                // Get the request ID and the requested tensor names
+                ope_infer request;
+                received.get(request);
+                request_id = request.request_id;
+
+                // Take the inputs for this request
+                NeuropodValueMap request_inputs;
+                bool             found_inputs = false;
+                auto             inputs_it    = inputs.find(request_id);
+                if (inputs_it != inputs.end())
+                {
+                    found_inputs   = true;
+                    request_inputs = std::move(inputs_it->second);
+                    inputs.erase(inputs_it);
+                }
+
+                auto error_it = input_errors.find(request_id);
+                if (error_it != input_errors.end())
+                {
+                    const auto msg = std::move(error_it->second);
+                    input_errors.erase(error_it);
+                    NEUROPOD_ERROR("Failed to add inputs for request {}: {}", request_id, msg);
+                }
+
+                if (!found_inputs)
+                {
+                    NEUROPOD_ERROR("No inputs were received for request {}", request_id);
+                }
 
                 // Run inference
-                auto outputs = neuropod->infer(inputs, requested_outputs);
+                const auto start   = std::chrono::steady_clock::now();
+                auto       outputs = neuropod->infer(request_inputs, request.requested_outputs, output_allocator);
+                const auto end     = std::chrono::steady_clock::now();
+                write_trace_span("worker_infer",
+                                 to_nanoseconds(start.time_since_epoch()),
+                                 to_nanoseconds(end.time_since_epoch()),
+                                 request_id);
 
                 // Turn these "native" tensors into shm tensors
-                NeuropodValueMap transformed_outputs;
+                ope_return_output transformed_outputs;
+                transformed_outputs.request_id      = request_id;
+                transformed_outputs.start_time_ns   = to_nanoseconds(start.time_since_epoch());
+                transformed_outputs.compute_time_ns = to_nanoseconds(end - start);
+
+                const auto copy_start = get_trace_time_ns();
                 for (const auto &entry : *outputs)
                 {
-                    // Unfortunately, this requires a copy (done within SHMNeuropodTensor)
-                    auto shm_tensor = wrap_existing_tensor<SHMNeuropodTensor>(
-                        std::dynamic_pointer_cast<NeuropodTensor>(entry.second));
-
-                    // This ensures that the tensor stays around long enough for the other process to load it
-                    transformed_outputs[entry.first] = shm_tensor;
+                    // Outputs that the backend already wrote into shared memory can be sent as is
+                    // (this ensures that the tensor stays around long enough for the other process to load it)
+                    // Small tensors are copied into the message so they don't need to be in shared memory
+                    auto tensor = std::dynamic_pointer_cast<NeuropodTensor>(entry.second);
+                    if (std::dynamic_pointer_cast<NativeDataContainer<SHMBlockID>>(entry.second) ||
+                        should_inline_tensor(tensor->get_dims(), tensor->get_tensor_type()))
+                    {
+                        transformed_outputs.outputs[entry.first] = entry.second;
+                        continue;
+                    }
+
+                    // Otherwise, this requires a copy (done within SHMNeuropodTensor)
+                    auto shm_tensor = wrap_existing_tensor<SHMNeuropodTensor>(tensor);
+
+                    transformed_outputs.outputs[entry.first] = shm_tensor;
                 }
 
-                control_channel.send_message_move(RETURN_OUTPUT, std::move(transformed_outputs));
+                write_trace_span("worker_copy_outputs", copy_start, get_trace_time_ns(), request_id);
+
+                {
+                    ScopedTraceSpan span("worker_send_outputs", request_id);
+                    control_channel.send_message_move(RETURN_OUTPUT, std::move(transformed_outputs));
+                }
 
                 // Clean up any unused shm tensors that haven't been reused
                 shm_allocator.free_unused_shm_blocks();
 
-                // Empty the inputs set. This is done after sending outputs back to the main process
+                // Free the inputs for this request. This is done after sending outputs back to the main process
                 // because this takes a nontrivial amount of time
-                inputs.clear();
+                ScopedTraceSpan span("worker_free_inputs", request_id);
+                request_inputs.clear();
             }
             else if (msg_type == SHUTDOWN)
             {
@@ -122,12 +232,12 @@ void multiprocess_worker_loop(const std::string &control_queue_name)
         catch (const std::exception &e)
         {
             // Send the exception info back to the main process
-            std::string msg = e.what();
-            control_channel.send_message(EXCEPTION, msg);
+            control_channel.send_message(EXCEPTION, ope_exception{request_id, e.what()});
         }
         catch (...)
         {
-            control_channel.send_message(EXCEPTION, "An unknown exception occurred during inference");
+            control_channel.send_message(EXCEPTION,
+                                         ope_exception{request_id, "An unknown exception occurred during inference"});
         }
 
         SPDLOG_TRACE("OPE: BOTTOM OF WORKER LOOP");
@@ -0,0 +1,75 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include "neuropod/internal/neuropod_tensor.hh"
+#include "neuropod/multiprocess/serialization/ipc_serialization.hh"
+#include "neuropod/multiprocess/shm_tensor.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace neuropod
+{
+
+// Every inference request sent to a worker is tagged with an ID so multiple requests can be
+// in flight on the same control channel. Responses are matched back to requests using this ID.
+// `request_id` must be the first field of each payload. It is read on its own before the rest of the message
+// so errors reading a message can be reported to the right request.
+
+// The payload of an ADD_INPUT message
+struct ope_add_input
+{
+    // The worker uses this to report errors if the inputs can't be deserialized
+    uint64_t request_id;
+
+    // The inputs for this request
+    NeuropodValueMap inputs;
+};
+
+// The payload of an INFER message
+struct ope_infer
+{
+    uint64_t request_id;
+
+    // The names of the outputs to return (or empty for all outputs)
+    std::vector<std::string> requested_outputs;
+};
+
+// The payload of a RETURN_OUTPUT message
+struct ope_return_output
+{
+    uint64_t request_id;
+
+    NeuropodValueMap outputs;
+
+    // When the worker started running this request (`steady_clock` time in nanoseconds) and how long inference
+    // took in the worker. These are used for latency stats in the main process
+    // Note: `steady_clock` is `CLOCK_MONOTONIC` so these times are comparable across processes on the same machine
+    uint64_t start_time_ns;
+    uint64_t compute_time_ns;
+};
+
+// The payload of an EXCEPTION message
+struct ope_exception
+{
+    // The request that failed or 0 if the exception isn't tied to a request (e.g. a failed load)
+    uint64_t request_id;
+
+    std::string message;
+};
+
+} // namespace neuropod
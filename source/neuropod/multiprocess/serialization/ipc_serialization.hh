@@ -55,21 +55,37 @@ inline void checked_read(std::istream &stream, Params &&... params)
 
 } // namespace detail
 
+// Overloads for containers
+// These are declared before the generic implementation below so they can be found when
+// serializing struct fields that contain only types from `std` (e.g. `std::vector<std::string>`)
+template <typename T>
+inline void ipc_serialize(std::ostream &out, const std::vector<T> &item);
+
+template <typename T>
+inline void ipc_deserialize(std::istream &in, std::vector<T> &item);
+
+template <typename K, typename V>
+inline void ipc_serialize(std::ostream &out, const std::unordered_map<K, V> &item);
+
+template <typename K, typename V>
+inline void ipc_deserialize(std::istream &in, std::unordered_map<K, V> &item);
+
 // Serialization used for IPC
 // This type of serialization has less strict requirements than normal serialization
 // because the data is transient and will be written and read in different processes
 // on the same machine (so we don't need to worry about things like endianness).
 //
-// These methods handle primitive types (other than bool)
+// These methods handle primitive types (integers and floating point numbers other than bool)
 template <typename T>
 inline void ipc_serialize(std::ostream &out, const T &item)
 {
-    constexpr bool is_integral  = std::is_integral<T>::value;
+    constexpr bool is_primitive = std::is_arithmetic<T>::value;
     constexpr bool is_aggregate = std::is_aggregate<T>::value;
 
-    static_assert(is_integral || is_aggregate, "The ipc_serialize function must be specialized for the requested type");
+    static_assert(is_primitive || is_aggregate,
+                  "The ipc_serialize function must be specialized for the requested type");
 
-    if constexpr (is_integral)
+    if constexpr (is_primitive)
     {
         // Primitive types
         detail::checked_write(out, reinterpret_cast<const char *>(&item), sizeof(item));
@@ -84,13 +100,13 @@ inline void ipc_serialize(std::ostream &out, const T &item)
 template <typename T>
 inline void ipc_deserialize(std::istream &in, T &item)
 {
-    constexpr bool is_integral  = std::is_integral<T>::value;
+    constexpr bool is_primitive = std::is_arithmetic<T>::value;
     constexpr bool is_aggregate = std::is_aggregate<T>::value;
 
-    static_assert(is_integral || is_aggregate,
+    static_assert(is_primitive || is_aggregate,
                   "The ipc_deserialize function must be specialized for the requested type");
 
-    if constexpr (is_integral)
+    if constexpr (is_primitive)
     {
         // Primitive types
         detail::checked_read(in, reinterpret_cast<char *>(&item), sizeof(item));
@@ -116,6 +116,34 @@ TEST(test_ipc_serialization, neuropod_value_map)
     EXPECT_EQ(*float_tensor_1D, *actual.at("float"));
 }
 
+TEST(test_ipc_serialization, neuropod_value_map_inline)
+{
+    // Small tensors are allocated on the heap and written inline. Large ones are in shared memory
+    std::unique_ptr<neuropod::NeuropodTensorAllocator> allocator =
+        neuropod::stdx::make_unique<neuropod::OPETensorAllocator>();
+
+    const auto small = allocator->allocate_tensor<float>({10, 5});
+    const auto large = allocator->allocate_tensor<float>({1024, 1024});
+    small->copy_from(std::vector<float>(50, 1.5));
+    large->copy_from(std::vector<float>(1024 * 1024, 2.5));
+
+    EXPECT_FALSE(std::dynamic_pointer_cast<neuropod::NativeDataContainer<neuropod::SHMBlockID>>(small));
+    EXPECT_TRUE(std::dynamic_pointer_cast<neuropod::NativeDataContainer<neuropod::SHMBlockID>>(large));
+
+    neuropod::NeuropodValueMap expected;
+    expected["small"] = small;
+    expected["large"] = large;
+
+    const auto actual = serialize_deserialize(expected);
+
+    EXPECT_EQ(*small, *actual.at("small"));
+    EXPECT_EQ(*large, *actual.at("large"));
+
+    // Tensors that were received inline can be sent again
+    const auto resent = serialize_deserialize(actual);
+    EXPECT_EQ(*small, *resent.at("small"));
+}
+
 TEST(test_ipc_serialization, empty_neuropod_value_map)
 {
     neuropod::NeuropodValueMap expected;
@@ -22,9 +22,12 @@ limitations under the License.
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <list>
+#include <map>
 #include <mutex>
-#include <unordered_map>
+#include <vector>
 
 namespace neuropod
 {
@@ -45,7 +48,7 @@ struct __attribute__((__packed__)) SHMBlockInternal
 
     // These blocks of memory can be reused
     // This is incremented on each reuse to invalidate stale blocks
-    uint64_t reuse_count = 0;
+    uint32_t reuse_count = 0;
 
     // The data in this block
     uint8_t data[];
@@ -59,55 +62,127 @@ struct __attribute__((__packed__)) SHMBlockInternal
 };
 
 // A unique ID for a SHM block
+// A block is either a raw block of its own or a part of an arena segment (which is also a raw block).
+// `block_handle` is the handle of the raw block and `offset` is where the block starts within it
+// (in units of `BLOCK_ALIGNMENT`). `offset` is always 0 for blocks that aren't in an arena.
+// `in_arena` is set for blocks in an arena segment so processes loading them can keep the segment mapped.
+//
 // Since blocks of memory can be reused, the UUID used to load
 // the block isn't enough. An additional `reuse_count` field is
 // used to detect when stale IDs are used and throw an error.
 struct __attribute__((__packed__)) SHMBlockIDInternal
 {
     RawSHMHandle block_handle;
-    uint64_t     reuse_count = 0;
+    uint32_t     offset : 31;
+    uint32_t     in_arena : 1;
+    uint32_t     reuse_count = 0;
+
+    SHMBlockIDInternal() : offset(0), in_arena(0) {}
 };
 
+// The largest `offset` that fits in a block ID
+constexpr uint32_t MAX_BLOCK_OFFSET = (uint32_t{1} << 31) - 1;
+
 // Make sure the size of the ID struct matches the size of the user facing version
 static_assert(sizeof(SHMBlockIDInternal) == std::tuple_size<SHMBlockID>::value,
               "The size of SHMBlockIDInternal must match the size of SHMBlockID");
 
+// The smallest size class (in bytes). Smaller blocks don't save anything because mappings are page granular
+constexpr size_t MIN_SIZE_CLASS = 4096;
+
+// All size classes are multiples of this so blocks in an arena always start at a multiple of it
+constexpr size_t BLOCK_ALIGNMENT = 1024;
+
+// Round `size_bytes` up to a size class
+// There are 4 evenly spaced classes between consecutive powers of two (e.g. 4096, 5120, 6144, 7168, 8192, ...)
+size_t get_size_class(size_t size_bytes)
+{
+    if (size_bytes <= MIN_SIZE_CLASS)
+    {
+        return MIN_SIZE_CLASS;
+    }
+
+    // The largest power of two that is smaller than `size_bytes`
+    const size_t prev_pow2 = size_t{1} << (63 - __builtin_clzll(size_bytes - 1));
+    const size_t step      = prev_pow2 / 4;
+    return (size_bytes + step - 1) / step * step;
+}
+
 } // namespace
 
 // A cache for raw blocks we've loaded before
+// Raw blocks stay in the cache while they're in use because several blocks can share a raw block
+// (i.e. blocks in the same arena segment).
+//
+// Arena segments are pinned: they're never removed by `clear` so each segment is only mapped once per process
+// (instead of once per request). This is okay because arena segments are never freed by the allocating process
 class LoadCache
 {
 private:
-    std::map<RawSHMHandle, std::shared_ptr<void>> loaded_cache_;
-    std::mutex                                    loaded_cache_mutex_;
+    struct LoadedBlock
+    {
+        std::shared_ptr<void> raw_block;
+        bool                  pinned;
+    };
+
+    std::map<RawSHMHandle, LoadedBlock> loaded_cache_;
+    std::mutex                          loaded_cache_mutex_;
+
+    // The number of raw blocks we've mapped
+    uint64_t mappings_ = 0;
 
 public:
     LoadCache()  = default;
     ~LoadCache() = default;
 
-    // Try to get a raw block from the loaded cache
-    // If this returns a block, it removes it from the cache
-    void maybe_get_and_pop(const RawSHMHandle &handle, std::shared_ptr<void> &raw_block)
+    // Get a raw block from the loaded cache or load it (and add it to the cache) if it isn't there
+    // If `pinned` is true, the block stays in the cache until the cache is destroyed
+    std::shared_ptr<void> get_or_load(const RawSHMHandle &handle, RawSHMBlockAllocator &allocator, bool pinned)
     {
+        {
+            std::lock_guard<std::mutex> lock(loaded_cache_mutex_);
+            auto                        item = loaded_cache_.find(handle);
+            if (item != loaded_cache_.end())
+            {
+                return item->second.raw_block;
+            }
+        }
+
+        // Load it without holding the lock
+        auto raw_block = allocator.load_shm(handle);
+
+        // If another thread loaded the same block in the meantime, use that one
         std::lock_guard<std::mutex> lock(loaded_cache_mutex_);
-        auto                        item = loaded_cache_.find(handle);
-        if (item != loaded_cache_.end())
+        auto                        inserted = loaded_cache_.emplace(handle, LoadedBlock{std::move(raw_block), pinned});
+        if (inserted.second)
         {
-            raw_block = item->second;
-            loaded_cache_.erase(item);
+            mappings_++;
         }
+
+        return inserted.first->second.raw_block;
     }
 
-    void insert(RawSHMHandle handle, std::shared_ptr<void> item)
+    // Remove all blocks that aren't pinned
+    void clear()
     {
         std::lock_guard<std::mutex> lock(loaded_cache_mutex_);
-        loaded_cache_[handle] = std::move(item);
+        for (auto it = loaded_cache_.begin(); it != loaded_cache_.end();)
+        {
+            if (it->second.pinned)
+            {
+                it++;
+            }
+            else
+            {
+                it = loaded_cache_.erase(it);
+            }
+        }
     }
 
-    void clear()
+    void add_stats(SHMAllocatorStats &stats)
     {
         std::lock_guard<std::mutex> lock(loaded_cache_mutex_);
-        loaded_cache_.clear();
+        stats.mappings = mappings_;
     }
 };
 
@@ -120,76 +195,310 @@ private:
     {
         std::shared_ptr<void> block;
         RawSHMHandle          block_handle;
+
+        // Incremented on every insert. Used to find the least recently cached block
+        uint64_t insert_seq;
     };
 
     // In our cache, the main operations we care about are the following:
-    //  - equal_range (give me all raw blocks of a certain size)
+    //  - lower_bound (give me the smallest size class that can fit a request)
     //  - erase       (remove a specific raw block from the cache)
-    //  - insert      (add a raw block of a specific size to the cache)
-    //
-    // By using an unordered_map with a list, all the operations we care about can be implemented
-    // in an O(1) way. This is better than using an `std::unordered_multimap` or a `std::multimap`
-    // directly
+    //  - insert      (add a raw block of a specific size class to the cache)
     //
-    // More importantly, using this structure has a significant improvement on benchmarks over
-    // using a multimap or an unordered_multimap
-    std::unordered_map<size_t, std::list<RawBlockWrapper>> created_cache_;
-    std::mutex                                             created_cache_mutex_;
+    // There are only a few size classes per power of two so the ordered map stays small. Within a size class,
+    // blocks are stored in the order they were inserted
+    std::map<size_t, std::list<RawBlockWrapper>> created_cache_;
+    std::mutex                                   created_cache_mutex_;
+
+    size_t   budget_bytes_ = DEFAULT_SHM_CACHE_BUDGET_BYTES;
+    uint64_t next_seq_     = 0;
+
+    SHMAllocatorStats stats_;
+
+    // Free the least recently cached blocks until the cache is within its budget
+    // Note: `created_cache_mutex_` must be held when calling this
+    void evict_over_budget()
+    {
+        while (stats_.cached_bytes > budget_bytes_)
+        {
+            // Find the size class with the oldest block
+            // This is linear in the number of size classes in the cache, but there are few of them
+            auto oldest = created_cache_.end();
+            for (auto it = created_cache_.begin(); it != created_cache_.end(); it++)
+            {
+                if (oldest == created_cache_.end() ||
+                    it->second.front().insert_seq < oldest->second.front().insert_seq)
+                {
+                    oldest = it;
+                }
+            }
+
+            // Free it
+            oldest->second.pop_front();
+            stats_.cached_bytes -= oldest->first;
+            stats_.cached_blocks--;
+            stats_.evictions++;
+
+            if (oldest->second.empty())
+            {
+                created_cache_.erase(oldest);
+            }
+        }
+    }
 
 public:
     AllocationCache()  = default;
     ~AllocationCache() = default;
 
     // Maybe get an unused raw block from the created cache
+    // The returned block (if any) is at least `size_class` bytes and at most twice that
     // Increments the refcount and reuse count of the returned block (if any)
-    // If this returns a block, it removes it from the cache
-    void maybe_get_and_pop(size_t requested_size, std::shared_ptr<void> &raw_block, SHMBlockIDInternal &id)
+    // If this returns a block, it removes it from the cache and sets `size_class` to the size of the block
+    void maybe_get_and_pop(size_t &size_class, std::shared_ptr<void> &raw_block, SHMBlockIDInternal &id)
     {
         std::lock_guard<std::mutex> lock(created_cache_mutex_);
-        auto &                      range = created_cache_[requested_size];
-        for (auto it = range.begin(); it != range.end(); it++)
-        {
-            auto &cache_item   = *it;
-            auto *cached_block = static_cast<SHMBlockInternal *>(cache_item.block.get());
-
-            ipc::scoped_lock<ipc::interprocess_mutex> lock(cached_block->mutex);
+        stats_.allocations++;
 
-            // Check whether or not this block is used in another process
-            if (cached_block->refcount == 0)
+        const auto end = created_cache_.upper_bound(size_class * 2);
+        for (auto range = created_cache_.lower_bound(size_class); range != end; range++)
+        {
+            auto &blocks = range->second;
+            for (auto it = blocks.begin(); it != blocks.end(); it++)
             {
-                // The block is unused so we can use it!
-                // Increment the refcount
-                cached_block->refcount++;
+                auto &cache_item   = *it;
+                auto *cached_block = static_cast<SHMBlockInternal *>(cache_item.block.get());
+
+                ipc::scoped_lock<ipc::interprocess_mutex> lock(cached_block->mutex);
+
+                // Check whether or not this block is used in another process
+                if (cached_block->refcount == 0)
+                {
+                    // The block is unused so we can use it!
+                    // Increment the refcount
+                    cached_block->refcount++;
+
+                    // Increase the reuse_count so that stale IDs will no longer work
+                    cached_block->reuse_count++;
+
+                    raw_block       = cache_item.block;
+                    id.reuse_count  = cached_block->reuse_count;
+                    id.block_handle = cache_item.block_handle;
+                    size_class      = range->first;
+
+                    stats_.cache_hits++;
+                    stats_.cached_bytes -= range->first;
+                    stats_.cached_blocks--;
+
+                    blocks.erase(it);
+                    if (blocks.empty())
+                    {
+                        created_cache_.erase(range);
+                    }
+
+                    return;
+                }
+            }
+        }
+    }
 
-                // Increase the reuse_count so that stale IDs will no longer work
-                cached_block->reuse_count++;
+    void insert(size_t size_class, RawSHMHandle handle, std::shared_ptr<void> item)
+    {
+        std::lock_guard<std::mutex> lock(created_cache_mutex_);
+        RawBlockWrapper             wrapper = {std::move(item), handle, next_seq_++};
+        created_cache_[size_class].emplace_back(std::move(wrapper));
 
-                raw_block       = cache_item.block;
-                id.reuse_count  = cached_block->reuse_count;
-                id.block_handle = cache_item.block_handle;
+        stats_.cached_bytes += size_class;
+        stats_.cached_blocks++;
+        evict_over_budget();
+    }
 
-                range.erase(it);
-                return;
-            }
-        }
+    void set_budget(size_t budget_bytes)
+    {
+        std::lock_guard<std::mutex> lock(created_cache_mutex_);
+        budget_bytes_ = budget_bytes;
+        evict_over_budget();
     }
 
-    void insert(size_t size_bytes, RawSHMHandle handle, std::shared_ptr<void> item)
+    SHMAllocatorStats get_stats()
     {
         std::lock_guard<std::mutex> lock(created_cache_mutex_);
-        RawBlockWrapper             wrapper = {std::move(item), handle};
-        created_cache_[size_bytes].emplace_back(std::move(wrapper));
+        return stats_;
     }
 
     void clear()
     {
         std::lock_guard<std::mutex> lock(created_cache_mutex_);
         created_cache_.clear();
+        stats_.cached_bytes  = 0;
+        stats_.cached_blocks = 0;
+    }
+};
+
+// Sub-allocates blocks from a few large raw blocks ("segments") instead of creating a raw block per allocation.
+// The receiving process only maps each segment once and loads blocks within it with pointer arithmetic.
+//
+// The arena grows by adding segments (each twice as large as the previous one) so existing mappings stay valid.
+// Blocks are never returned to the OS. Released blocks are kept by size class and reused once they're
+// unused in all processes.
+class SHMArena
+{
+private:
+    struct Segment
+    {
+        std::shared_ptr<void> raw_block;
+        RawSHMHandle          handle;
+        size_t                size;
+
+        // The number of bytes at the start of this segment that have been handed out as blocks
+        size_t used;
+    };
+
+    // A block that was released by the allocating process
+    struct ReleasedBlock
+    {
+        SHMBlockInternal *block;
+        RawSHMHandle      segment_handle;
+        uint32_t          offset;
+    };
+
+    RawSHMBlockAllocator &allocator_;
+
+    // The size of the next segment to create. If this is 0, the arena is disabled
+    std::atomic<size_t> next_segment_size_{0};
+
+    std::vector<Segment>                       segments_;
+    std::map<size_t, std::list<ReleasedBlock>> released_blocks_;
+    std::mutex                                 mutex_;
+
+    uint64_t allocations_ = 0;
+    uint64_t reuses_      = 0;
+    size_t   total_bytes_ = 0;
+
+    // Get a segment with at least `size_bytes` of unused space, creating one if necessary
+    // Note: `mutex_` must be held when calling this
+    Segment &get_segment(size_t size_bytes)
+    {
+        if (!segments_.empty())
+        {
+            auto &segment = segments_.back();
+            if (segment.size - segment.used >= size_bytes)
+            {
+                return segment;
+            }
+        }
+
+        // The rest of the current segment (if any) stays unused
+        const size_t segment_size = std::max(next_segment_size_.load(), size_bytes);
+        next_segment_size_        = segment_size * 2;
+
+        if ((segment_size - size_bytes) / BLOCK_ALIGNMENT > MAX_BLOCK_OFFSET)
+        {
+            NEUROPOD_ERROR("Tried to create an SHM arena segment that is too large: {} bytes", segment_size);
+        }
+
+        Segment segment;
+        segment.raw_block = allocator_.allocate_shm(segment_size, segment.handle);
+        segment.size      = segment_size;
+        segment.used      = 0;
+        total_bytes_ += segment_size;
+
+        segments_.emplace_back(std::move(segment));
+        return segments_.back();
+    }
+
+public:
+    explicit SHMArena(RawSHMBlockAllocator &allocator) : allocator_(allocator) {}
+    ~SHMArena() = default;
+
+    // Start allocating blocks from the arena
+    // `segment_size_bytes` is the size of the first segment. This has no effect if the arena is already enabled
+    void enable(size_t segment_size_bytes)
+    {
+        size_t expected = 0;
+        next_segment_size_.compare_exchange_strong(expected, segment_size_bytes);
+    }
+
+    bool is_enabled() const { return next_segment_size_ != 0; }
+
+    // Allocate a block of `size_class` bytes (potentially reusing a released block up to twice that size)
+    // Increments the refcount of the returned block and sets `size_class` to the size of the block
+    SHMBlockInternal *allocate(size_t &size_class, SHMBlockIDInternal &id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        allocations_++;
+
+        // Try to reuse a released block
+        const auto end = released_blocks_.upper_bound(size_class * 2);
+        for (auto range = released_blocks_.lower_bound(size_class); range != end; range++)
+        {
+            auto &blocks = range->second;
+            for (auto it = blocks.begin(); it != blocks.end(); it++)
+            {
+                auto *block = it->block;
+
+                ipc::scoped_lock<ipc::interprocess_mutex> block_lock(block->mutex);
+
+                // Check whether or not this block is used in another process
+                if (block->refcount == 0)
+                {
+                    block->refcount++;
+                    block->reuse_count++;
+
+                    id.block_handle = it->segment_handle;
+                    id.offset       = it->offset;
+                    id.in_arena     = 1;
+                    id.reuse_count  = block->reuse_count;
+                    size_class      = range->first;
+                    reuses_++;
+
+                    blocks.erase(it);
+                    if (blocks.empty())
+                    {
+                        released_blocks_.erase(range);
+                    }
+
+                    return block;
+                }
+            }
+        }
+
+        // Carve a new block out of a segment
+        auto &segment = get_segment(size_class);
+        auto *block   = new (static_cast<uint8_t *>(segment.raw_block.get()) + segment.used) SHMBlockInternal;
+
+        // Note: we don't need to lock the mutex here because no one else has a reference to this block
+        block->refcount++;
+
+        id.block_handle = segment.handle;
+        id.offset       = static_cast<uint32_t>(segment.used / BLOCK_ALIGNMENT);
+        id.in_arena     = 1;
+        id.reuse_count  = block->reuse_count;
+
+        segment.used += size_class;
+        return block;
+    }
+
+    // Release a block so it can be reused
+    void release(size_t size_class, SHMBlockInternal *block, const SHMBlockIDInternal &id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_blocks_[size_class].emplace_back(ReleasedBlock{block, id.block_handle, id.offset});
+    }
+
+    void add_stats(SHMAllocatorStats &stats)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.allocations += allocations_;
+        stats.cache_hits += reuses_;
+        stats.arena_segments = segments_.size();
+        stats.arena_bytes    = total_bytes_;
     }
 };
 
 SHMAllocator::SHMAllocator()
-    : allocation_cache_(stdx::make_unique<AllocationCache>()), load_cache_(stdx::make_unique<LoadCache>())
+    : allocation_cache_(stdx::make_unique<AllocationCache>()),
+      load_cache_(stdx::make_unique<LoadCache>()),
+      arena_(stdx::make_unique<SHMArena>(allocator_))
 {
 }
 
@@ -203,17 +512,38 @@ std::shared_ptr<void> SHMAllocator::allocate_shm(size_t size_bytes, SHMBlockID &
     // The underlying raw block
     std::shared_ptr<void> raw_block;
 
-    // Include the size of our metadata
-    auto requested_size = size_bytes + sizeof(SHMBlockInternal);
+    // Include the size of our metadata and round up to a size class
+    auto size_class = get_size_class(size_bytes + sizeof(SHMBlockInternal));
 
-    // Maybe get a raw block of the requested size from the cache
-    allocation_cache_->maybe_get_and_pop(requested_size, raw_block, id);
+    if (arena_->is_enabled())
+    {
+        // Get a block from the arena
+        auto *block = arena_->allocate(size_class, id);
+        memcpy(block_id.data(), &id, sizeof(id));
+
+        // Release the block back to the arena on destruction
+        return std::shared_ptr<void>(block->data, [this, block, size_class, id](void *unused) {
+            {
+                // Lock the block's mutex
+                ipc::scoped_lock<ipc::interprocess_mutex> lock(block->mutex);
+
+                // Decrement the refcount
+                block->refcount--;
+            }
+
+            arena_->release(size_class, block, id);
+        });
+    }
+
+    // Maybe get a raw block that can fit the requested size from the cache
+    // (this updates `size_class` to the size of the returned block)
+    allocation_cache_->maybe_get_and_pop(size_class, raw_block, id);
 
     // If we didn't get anything from the cache
     if (raw_block == nullptr)
     {
-        // Create a block of the requested size
-        raw_block = allocator_.allocate_shm(requested_size, id.block_handle);
+        // Create a block of the requested size class
+        raw_block = allocator_.allocate_shm(size_class, id.block_handle);
 
         // Get a pointer to the struct and initialize it
         auto *block = new (raw_block.get()) SHMBlockInternal;
@@ -231,7 +561,7 @@ std::shared_ptr<void> SHMAllocator::allocate_shm(size_t size_bytes, SHMBlockID &
     // Create a shared pointer to the underlying data with a custom deleter
     // that keeps the block alive. Add the block to the cache on destruction.
     return std::shared_ptr<void>(
-        block->data, [this, block, raw_block = std::move(raw_block), requested_size, id](void *unused) mutable {
+        block->data, [this, block, raw_block = std::move(raw_block), size_class, id](void *unused) mutable {
             {
                 // Lock the block's mutex
                 ipc::scoped_lock<ipc::interprocess_mutex> lock(block->mutex);
@@ -241,7 +571,7 @@ std::shared_ptr<void> SHMAllocator::allocate_shm(size_t size_bytes, SHMBlockID &
             }
 
             // Add it to the created cache
-            allocation_cache_->insert(requested_size, id.block_handle, std::move(raw_block));
+            allocation_cache_->insert(size_class, id.block_handle, std::move(raw_block));
         });
 }
 
@@ -251,20 +581,12 @@ std::shared_ptr<void> SHMAllocator::load_shm(const SHMBlockID &block_id)
     auto id     = reinterpret_cast<const SHMBlockIDInternal *>(block_id.data());
     auto handle = id->block_handle;
 
-    // The underlying raw block
-    std::shared_ptr<void> raw_block;
-
-    // Check if we can get it from the cache
-    load_cache_->maybe_get_and_pop(handle, raw_block);
-
-    // If not, load it from scratch
-    if (raw_block == nullptr)
-    {
-        raw_block = allocator_.load_shm(handle);
-    }
+    // Get the underlying raw block from the cache or load it from scratch
+    auto raw_block = load_cache_->get_or_load(handle, allocator_, id->in_arena);
 
     // Get the block from the raw block
-    auto *block = static_cast<SHMBlockInternal *>(raw_block.get());
+    auto *block = reinterpret_cast<SHMBlockInternal *>(static_cast<uint8_t *>(raw_block.get()) +
+                                                       static_cast<size_t>(id->offset) * BLOCK_ALIGNMENT);
 
     // Sanity checks to avoid race conditions + increment the refcount
     {
@@ -300,20 +622,14 @@ std::shared_ptr<void> SHMAllocator::load_shm(const SHMBlockID &block_id)
     }
 
     // Create a shared pointer to the underlying data with a custom deleter
-    // that keeps the block alive. Add the block to the cache on destruction.
-    return std::shared_ptr<void>(block->data,
-                                 [this, block, raw_block = std::move(raw_block), handle](void *unused) mutable {
-                                     {
-                                         // Lock the block's mutex
-                                         ipc::scoped_lock<ipc::interprocess_mutex> lock(block->mutex);
-
-                                         // Decrement the refcount
-                                         block->refcount--;
-                                     }
-
-                                     // Add it to the load cache
-                                     load_cache_->insert(handle, std::move(raw_block));
-                                 });
+    // that keeps the raw block alive
+    return std::shared_ptr<void>(block->data, [block, raw_block = std::move(raw_block)](void *unused) {
+        // Lock the block's mutex
+        ipc::scoped_lock<ipc::interprocess_mutex> lock(block->mutex);
+
+        // Decrement the refcount
+        block->refcount--;
+    });
 }
 
 void SHMAllocator::free_unused_shm_blocks()
@@ -323,6 +639,29 @@ void SHMAllocator::free_unused_shm_blocks()
     load_cache_->clear();
 }
 
+void SHMAllocator::set_cache_budget(size_t budget_bytes)
+{
+    allocation_cache_->set_budget(budget_bytes);
+}
+
+void SHMAllocator::enable_arena(size_t segment_size_bytes)
+{
+    if (segment_size_bytes == 0)
+    {
+        NEUROPOD_ERROR("The SHM arena segment size must be greater than 0");
+    }
+
+    arena_->enable(segment_size_bytes);
+}
+
+SHMAllocatorStats SHMAllocator::get_stats()
+{
+    auto stats = allocation_cache_->get_stats();
+    arena_->add_stats(stats);
+    load_cache_->add_stats(stats);
+    return stats;
+}
+
 // A shared memory allocator that is used by the WireFormat and by SHMNeuropodTensor
 // TODO(vip): Remove global allocator instance
 SHMAllocator shm_allocator;
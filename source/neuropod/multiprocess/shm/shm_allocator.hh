@@ -18,6 +18,8 @@ limitations under the License.
 #include "neuropod/multiprocess/shm/raw_shm_block_allocator.hh"
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 namespace neuropod
@@ -29,13 +31,19 @@ namespace neuropod
 // with deep learning models.
 //
 // Internally, we maintain a pool of blocks of memory that we have allocated in the past.
-// If any of those blocks are unused and match the size being requested, we reuse one
+// If any of those blocks are unused and large enough for the size being requested, we reuse one
 // of those blocks instead of allocating new memory.
 //
 // This is important because reusing previously allocated blocks leads to significantly
 // faster memory operations than using newly allocated blocks.
-// Note: we don't yet optimally handle cases where tensor sizes change every cycle.
-// This will be added in the future.
+//
+// To handle cases where tensor sizes change every cycle (e.g. a variable batch size), blocks are
+// allocated in size classes. There are 4 classes between each pair of consecutive powers of two so
+// at most 25% of a block is wasted. A request can reuse a cached block of its own size class or of
+// a larger class up to twice its size.
+//
+// The total size of unused blocks in the pool is limited by a byte budget (see `set_cache_budget`).
+// If the pool grows past the budget, the least recently cached blocks are freed.
 //
 // To free all the currently unused blocks, call `free_unused_shm_blocks`. This should
 // periodically be called to ensure that unused shared memory is freed.
@@ -53,9 +61,38 @@ namespace neuropod
 // The block ID is just 24 opaque bytes (from the perspective of users of this allocator)
 using SHMBlockID = std::array<char, 24>;
 
+// The default maximum size (in bytes) of unused allocated blocks to keep around for reuse
+constexpr size_t DEFAULT_SHM_CACHE_BUDGET_BYTES = 512 * 1024 * 1024;
+
+// Statistics about the allocation cache of an `SHMAllocator`
+struct SHMAllocatorStats
+{
+    // The number of calls to `allocate_shm`
+    uint64_t allocations = 0;
+
+    // The number of allocations that reused a cached block
+    uint64_t cache_hits = 0;
+
+    // The number of unused blocks that were freed because the cache went over its byte budget
+    uint64_t evictions = 0;
+
+    // The number of unused blocks currently in the cache and their total size in bytes
+    size_t cached_blocks = 0;
+    size_t cached_bytes  = 0;
+
+    // The number of arena segments and their total size in bytes (see `enable_arena`)
+    size_t arena_segments = 0;
+    size_t arena_bytes    = 0;
+
+    // The number of shared memory objects this process has mapped in `load_shm`
+    // Each arena segment is only mapped once
+    uint64_t mappings = 0;
+};
+
 // Forward declarations of caches we're using
 class AllocationCache;
 class LoadCache;
+class SHMArena;
 
 // This allocator builds on top of RawSHMBlockAllocator to implement the optimizations
 // described above
@@ -68,6 +105,7 @@ private:
 
     std::unique_ptr<AllocationCache> allocation_cache_;
     std::unique_ptr<LoadCache>       load_cache_;
+    std::unique_ptr<SHMArena>        arena_;
 
 public:
     SHMAllocator();
@@ -82,6 +120,24 @@ public:
 
     // Free all currently unused blocks that were allocated by this process
     void free_unused_shm_blocks();
+
+    // Set the maximum size (in bytes) of unused allocated blocks to keep around for reuse
+    // If the cache is currently larger than this, the least recently used blocks are freed
+    void set_cache_budget(size_t budget_bytes);
+
+    // Allocate all new blocks from an arena of large shared memory segments instead of creating a separate
+    // shared memory object for each block. Blocks in the arena are referenced by an offset within a segment
+    // so processes loading them only need to map each segment once.
+    //
+    // `segment_size_bytes` is the size of the first segment. When a segment is full, a new one that is twice
+    // as large is added. Arena memory is reused, but it is not freed by `free_unused_shm_blocks`. Processes that
+    // load blocks from the arena keep its segments mapped (`free_unused_shm_blocks` doesn't unmap them either).
+    //
+    // This has no effect if the arena is already enabled
+    void enable_arena(size_t segment_size_bytes);
+
+    // Get statistics about the allocation cache
+    SHMAllocatorStats get_stats();
 };
 
 // A shared memory allocator that is used by the WireFormat and by SHMNeuropodTensor
@@ -20,6 +20,8 @@ limitations under the License.
 #include "neuropod/multiprocess/shm/shm_allocator.hh"
 
 #include <cstring>
+#include <random>
+#include <vector>
 
 namespace
 {
@@ -66,6 +68,40 @@ static void benchmark_shm(benchmark::State &state)
 }
 BENCHMARK(benchmark_shm);
 
+// Allocate blocks of randomly varying sizes (e.g. from a variable batch size)
+// This should reuse blocks of memory from previous allocations with a similar size
+static void benchmark_shm_random_sizes(benchmark::State &state)
+{
+    neuropod::SHMAllocator allocator;
+
+    // Generate the sizes up front so it isn't part of the timing
+    // Each size is between 1/4 and all of the sample image
+    std::mt19937                          gen(42);
+    std::uniform_int_distribution<size_t> dist(num_bytes / 4, num_bytes);
+    std::vector<size_t>                   sizes(1024);
+    for (auto &size : sizes)
+    {
+        size = dist(gen);
+    }
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        const auto size = sizes[i++ % sizes.size()];
+
+        // Allocate some memory
+        neuropod::SHMBlockID block_id;
+        auto                 data = allocator.allocate_shm(size, block_id);
+
+        // Copy in data
+        memcpy(data.get(), some_image_data, size);
+    }
+
+    const auto stats           = allocator.get_stats();
+    state.counters["hit_rate"] = static_cast<double>(stats.cache_hits) / stats.allocations;
+}
+BENCHMARK(benchmark_shm_random_sizes);
+
 static void benchmark_malloc(benchmark::State &state)
 {
     neuropod::SHMAllocator allocator;
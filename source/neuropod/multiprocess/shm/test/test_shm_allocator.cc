@@ -16,6 +16,9 @@ limitations under the License.
 #include "gtest/gtest.h"
 #include "neuropod/multiprocess/shm/shm_allocator.hh"
 
+#include <cstring>
+#include <vector>
+
 TEST(test_shm_allocator, simple)
 {
     neuropod::SHMAllocator allocator;
@@ -71,3 +74,177 @@ TEST(test_shm_allocator, stale)
     // This should throw an error because the block of memory has been reused
     EXPECT_ANY_THROW(allocator.load_shm(block_id));
 }
+
+TEST(test_shm_allocator, reuse_different_size)
+{
+    neuropod::SHMAllocator allocator;
+
+    // Allocate a block and let it go out of scope
+    {
+        neuropod::SHMBlockID block_id;
+        auto                 data = allocator.allocate_shm(1000000, block_id);
+    }
+
+    // A slightly smaller allocation should reuse the cached block
+    {
+        neuropod::SHMBlockID block_id;
+        auto                 data = allocator.allocate_shm(900000, block_id);
+        memset(data.get(), 1, 900000);
+    }
+
+    auto stats = allocator.get_stats();
+    EXPECT_EQ(stats.allocations, 2);
+    EXPECT_EQ(stats.cache_hits, 1);
+    EXPECT_EQ(stats.cached_blocks, 1);
+
+    // A much smaller allocation shouldn't use the large block
+    {
+        neuropod::SHMBlockID block_id;
+        auto                 data = allocator.allocate_shm(1000, block_id);
+    }
+
+    stats = allocator.get_stats();
+    EXPECT_EQ(stats.allocations, 3);
+    EXPECT_EQ(stats.cache_hits, 1);
+    EXPECT_EQ(stats.cached_blocks, 2);
+
+    // Neither should a larger one
+    {
+        neuropod::SHMBlockID block_id;
+        auto                 data = allocator.allocate_shm(2000000, block_id);
+    }
+
+    stats = allocator.get_stats();
+    EXPECT_EQ(stats.cache_hits, 1);
+    EXPECT_EQ(stats.cached_blocks, 3);
+
+    allocator.free_unused_shm_blocks();
+    stats = allocator.get_stats();
+    EXPECT_EQ(stats.cached_blocks, 0);
+    EXPECT_EQ(stats.cached_bytes, 0);
+}
+
+TEST(test_shm_allocator, budget)
+{
+    neuropod::SHMAllocator allocator;
+    allocator.set_cache_budget(3 * 1024 * 1024);
+
+    // Allocate 4 blocks of 1MB and let them go out of scope
+    {
+        std::vector<std::shared_ptr<void>> blocks;
+        for (int i = 0; i < 4; i++)
+        {
+            neuropod::SHMBlockID block_id;
+            blocks.emplace_back(allocator.allocate_shm(1024 * 1024, block_id));
+        }
+    }
+
+    // Only some of them should fit in the cache
+    auto stats = allocator.get_stats();
+    EXPECT_LE(stats.cached_bytes, 3 * 1024 * 1024);
+    EXPECT_EQ(stats.cached_blocks + stats.evictions, 4);
+    EXPECT_GT(stats.evictions, 0);
+
+    // Shrinking the budget should free everything
+    allocator.set_cache_budget(0);
+    stats = allocator.get_stats();
+    EXPECT_EQ(stats.cached_blocks, 0);
+    EXPECT_EQ(stats.cached_bytes, 0);
+    EXPECT_EQ(stats.evictions, 4);
+}
+
+TEST(test_shm_allocator, arena)
+{
+    neuropod::SHMAllocator allocator;
+    allocator.enable_arena(1024 * 1024);
+
+    // Allocate more blocks than fit in the first segment so the arena has to grow
+    std::vector<std::shared_ptr<void>> blocks;
+    std::vector<neuropod::SHMBlockID>  ids(16);
+    for (uint8_t i = 0; i < ids.size(); i++)
+    {
+        auto data = allocator.allocate_shm(100000, ids[i]);
+        memset(data.get(), i, 100000);
+        blocks.emplace_back(std::move(data));
+    }
+
+    auto stats = allocator.get_stats();
+    EXPECT_EQ(stats.allocations, 16);
+    EXPECT_EQ(stats.cache_hits, 0);
+    EXPECT_EQ(stats.arena_segments, 2);
+
+    // Load the blocks and ensure the data is what we expect
+    for (uint8_t i = 0; i < ids.size(); i++)
+    {
+        const std::vector<uint8_t> expected(100000, i);
+        auto                       loaded = allocator.load_shm(ids[i]);
+        EXPECT_EQ(memcmp(loaded.get(), expected.data(), expected.size()), 0);
+    }
+
+    // Release the blocks. Freeing unused blocks shouldn't affect the arena
+    blocks.clear();
+    allocator.free_unused_shm_blocks();
+
+    // This allocation should reuse a released block from the arena
+    neuropod::SHMBlockID block_id;
+    auto                 data = allocator.allocate_shm(90000, block_id);
+
+    stats = allocator.get_stats();
+    EXPECT_EQ(stats.cache_hits, 1);
+    EXPECT_EQ(stats.arena_segments, 2);
+
+    // The new block can be loaded, but none of the released blocks can
+    EXPECT_NO_THROW(allocator.load_shm(block_id));
+    for (const auto &id : ids)
+    {
+        EXPECT_ANY_THROW(allocator.load_shm(id));
+    }
+}
+
+TEST(test_shm_allocator, arena_mappings)
+{
+    // One allocator creates blocks and the other loads them (like the worker and the main process)
+    neuropod::SHMAllocator creator;
+    neuropod::SHMAllocator loader;
+    creator.enable_arena(1024 * 1024);
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        // Each iteration is a request that allocates, loads and releases a few blocks
+        {
+            std::vector<std::shared_ptr<void>> blocks;
+            for (uint8_t j = 0; j < 4; j++)
+            {
+                neuropod::SHMBlockID block_id;
+                auto                 data = creator.allocate_shm(10000, block_id);
+                memset(data.get(), i, 10000);
+
+                auto loaded = loader.load_shm(block_id);
+                EXPECT_EQ(static_cast<uint8_t *>(loaded.get())[9999], i);
+
+                blocks.emplace_back(std::move(data));
+                blocks.emplace_back(std::move(loaded));
+            }
+        }
+
+        // This is called after every request
+        creator.free_unused_shm_blocks();
+        loader.free_unused_shm_blocks();
+    }
+
+    // The arena segment is only mapped once
+    EXPECT_EQ(creator.get_stats().arena_segments, 1);
+    EXPECT_EQ(loader.get_stats().mappings, 1);
+
+    // Blocks that aren't in the arena are mapped every time they're loaded after being freed
+    neuropod::SHMAllocator non_arena_creator;
+    for (int i = 0; i < 2; i++)
+    {
+        neuropod::SHMBlockID block_id;
+        auto                 data = non_arena_creator.allocate_shm(10000, block_id);
+        loader.load_shm(block_id);
+        loader.free_unused_shm_blocks();
+    }
+
+    EXPECT_EQ(loader.get_stats().mappings, 3);
+}
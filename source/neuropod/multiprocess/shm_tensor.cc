@@ -15,9 +15,116 @@ limitations under the License.
 
 #include "neuropod/multiprocess/shm_tensor.hh"
 
+#include "neuropod/core/generic_tensor.hh"
+#include "neuropod/internal/neuropod_tensor_raw_data_access.hh"
+#include "neuropod/internal/type_macros.hh"
+
+#include <cstdlib>
+
 namespace neuropod
 {
 
+namespace
+{
+
+// How a tensor is stored in a serialized message
+enum SerializedTensorKind : uint8_t
+{
+    // The message contains the ID of a block of shared memory that contains the tensor
+    SHM_TENSOR,
+
+    // The message contains the type, shape and data of the tensor
+    INLINE_TENSOR,
+};
+
+size_t get_bytes_per_element(TensorType tensor_type)
+{
+#define GET_BYTES_PER_ELEMENT(CPP_TYPE, NEUROPOD_TYPE) \
+    case NEUROPOD_TYPE:                                \
+        return sizeof(CPP_TYPE);
+
+    switch (tensor_type)
+    {
+        FOR_EACH_TYPE_MAPPING_EXCEPT_STRING(GET_BYTES_PER_ELEMENT)
+    default:
+        NEUROPOD_ERROR("Tried to get the element size of an unsupported tensor type: {}", tensor_type);
+    }
+
+#undef GET_BYTES_PER_ELEMENT
+}
+
+// Get the size of the data in a numeric tensor
+size_t get_num_bytes(const std::vector<int64_t> &dims, TensorType tensor_type)
+{
+    size_t num_bytes = get_bytes_per_element(tensor_type);
+    for (const auto dim : dims)
+    {
+        num_bytes *= dim;
+    }
+
+    return num_bytes;
+}
+
+size_t get_num_bytes(const NeuropodTensor &tensor)
+{
+    return tensor.get_num_elements() * internal::NeuropodTensorRawDataAccess::get_bytes_per_element(tensor);
+}
+
+// Allocate a tensor on the heap
+// The data is 64 byte aligned so backends can wrap it without making a copy
+std::unique_ptr<NeuropodTensor> allocate_heap_tensor(const std::vector<int64_t> &dims, TensorType tensor_type)
+{
+    static const auto allocator = get_generic_tensor_allocator();
+
+    // `aligned_alloc` requires the size to be a nonzero multiple of the alignment
+    const auto num_bytes = get_num_bytes(dims, tensor_type);
+    void *     data      = aligned_alloc(64, std::max<size_t>(64, (num_bytes + 63) / 64 * 64));
+    if (data == nullptr)
+    {
+        NEUROPOD_ERROR("Failed to allocate {} bytes for a tensor", num_bytes);
+    }
+
+    return allocator->tensor_from_memory(dims, tensor_type, data, [](void *data) { free(data); });
+}
+
+} // namespace
+
+bool should_inline_tensor(const std::vector<int64_t> &dims, TensorType tensor_type)
+{
+    if (tensor_type == STRING_TENSOR)
+    {
+        return false;
+    }
+
+    return get_num_bytes(dims, tensor_type) <= MAX_INLINE_TENSOR_BYTES;
+}
+
+std::unique_ptr<NeuropodTensor> OPETensorAllocator::allocate_tensor(const std::vector<int64_t> &input_dims,
+                                                                    TensorType                  tensor_type)
+{
+    if (should_inline_tensor(input_dims, tensor_type))
+    {
+        return allocate_heap_tensor(input_dims, tensor_type);
+    }
+
+    return make_tensor<SHMNeuropodTensor>(tensor_type, input_dims);
+}
+
+std::unique_ptr<NeuropodTensor> OPETensorAllocator::tensor_from_memory(const std::vector<int64_t> &input_dims,
+                                                                       TensorType                  tensor_type,
+                                                                       void *                      data,
+                                                                       const Deleter &             deleter)
+{
+    if (should_inline_tensor(input_dims, tensor_type))
+    {
+        // This tensor will be copied into messages so we can wrap the memory directly
+        static const auto allocator = get_generic_tensor_allocator();
+        return allocator->tensor_from_memory(input_dims, tensor_type, data, deleter);
+    }
+
+    return make_tensor_no_string<SHMNeuropodTensor>(tensor_type, input_dims, data, deleter);
+}
+
 std::shared_ptr<NeuropodTensor> tensor_from_id(const SHMBlockID &block_id)
 {
     // Load the block of shared memory
@@ -34,10 +141,25 @@ std::shared_ptr<NeuropodTensor> tensor_from_id(const SHMBlockID &block_id)
 
 // Serialization specializations for SHMNeuropodTensor
 // Note: the specialization is for `shared_ptr<NeuropodValue>`, but we check internally
-// that the item is a SHMNeuropodTensor
+// that the item is a SHMNeuropodTensor (unless it is small enough to be written inline)
 template <>
 void ipc_serialize(std::ostream &out, const std::shared_ptr<NeuropodValue> &item)
 {
+    // Small tensors are written inline (regardless of their type)
+    auto tensor = std::dynamic_pointer_cast<NeuropodTensor>(item);
+    if (tensor && should_inline_tensor(tensor->get_dims(), tensor->get_tensor_type()))
+    {
+        const auto &dims      = tensor->get_dims();
+        const auto  num_bytes = get_num_bytes(*tensor);
+        const auto *data      = internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*tensor);
+
+        ipc_serialize(out, static_cast<uint8_t>(INLINE_TENSOR));
+        ipc_serialize(out, static_cast<int32_t>(tensor->get_tensor_type()));
+        ipc_serialize(out, dims);
+        detail::checked_write(out, static_cast<const char *>(data), num_bytes);
+        return;
+    }
+
     // Cast to a `NativeDataContainer`
     auto container = std::dynamic_pointer_cast<NativeDataContainer<SHMBlockID>>(item);
     if (!container)
@@ -49,12 +171,33 @@ void ipc_serialize(std::ostream &out, const std::shared_ptr<NeuropodValue> &item
     // Write the block ID
     const auto &block_id = container->get_native_data();
 
+    ipc_serialize(out, static_cast<uint8_t>(SHM_TENSOR));
     detail::checked_write(out, reinterpret_cast<const char *>(block_id.data()), block_id.size());
 }
 
 template <>
 void ipc_deserialize(std::istream &in, std::shared_ptr<NeuropodValue> &item)
 {
+    uint8_t kind;
+    ipc_deserialize(in, kind);
+
+    if (kind == INLINE_TENSOR)
+    {
+        int32_t              tensor_type;
+        std::vector<int64_t> dims;
+        ipc_deserialize(in, tensor_type);
+        ipc_deserialize(in, dims);
+
+        // Copy the data into a new tensor
+        auto       tensor    = allocate_heap_tensor(dims, static_cast<TensorType>(tensor_type));
+        auto       data      = internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*tensor);
+        const auto num_bytes = get_num_bytes(*tensor);
+        detail::checked_read(in, static_cast<char *>(data), num_bytes);
+
+        item = std::move(tensor);
+        return;
+    }
+
     // Read the block ID
     SHMBlockID block_id;
     detail::checked_read(in, reinterpret_cast<char *>(block_id.data()), block_id.size());
@@ -139,6 +139,29 @@ public:
 
 std::shared_ptr<NeuropodTensor> tensor_from_id(const SHMBlockID &block_id);
 
+// Numeric tensors with at most this many bytes of data are written inline when serialized for IPC
+// instead of being sent as a block of shared memory. This means all the small tensors in a message
+// are sent together as part of the message payload (which is either inline in the message or in a
+// single block of shared memory).
+constexpr size_t MAX_INLINE_TENSOR_BYTES = 16 * 1024;
+
+// Whether or not a tensor with the given shape and type is written inline when serialized for IPC
+bool should_inline_tensor(const std::vector<int64_t> &dims, TensorType tensor_type);
+
+// The tensor allocator used with OPE
+// Tensors that are written inline when serialized (see above) don't need to be in shared memory so they're
+// allocated on the heap. Everything else is a SHMNeuropodTensor
+class OPETensorAllocator : public NeuropodTensorAllocator
+{
+public:
+    std::unique_ptr<NeuropodTensor> allocate_tensor(const std::vector<int64_t> &input_dims, TensorType tensor_type);
+
+    std::unique_ptr<NeuropodTensor> tensor_from_memory(const std::vector<int64_t> &input_dims,
+                                                       TensorType                  tensor_type,
+                                                       void *                      data,
+                                                       const Deleter &             deleter);
+};
+
 inline std::vector<int64_t> copy_and_strip_last_dim(std::vector<int64_t> vec)
 {
     vec.pop_back();
@@ -163,7 +186,8 @@ struct __attribute__((__packed__)) string_wrapper
 } // namespace
 
 // This tensor operates on a local vector and then copies everything into shared memory when `get_native_data` is called
-// For now, we only call `get_native_data` once per tensor so this should be okay
+// The shared memory block is reused until the tensor is modified so repeated calls (e.g. when the same tensor is sent
+// more than once) only copy once
 // TODO(vip): Optimize
 // It's hard to make this zero-copy because of different string representations and variable string lengths
 // Even so, this implementation makes more copies than necessary
@@ -178,6 +202,9 @@ private:
     // This is the last shm block we created (if any)
     std::unique_ptr<SHMNeuropodTensor<uint8_t>> last_shm_block_;
 
+    // Whether `write_buffer_` was modified after `last_shm_block_` was created
+    bool modified_ = true;
+
 public:
     SHMNeuropodTensor(const std::vector<int64_t> &dims)
         : TypedNeuropodTensor<std::string>(dims), write_buffer_(this->get_num_elements())
@@ -210,10 +237,19 @@ public:
 
     ~SHMNeuropodTensor() = default;
 
-    void copy_from(const std::vector<std::string> &vec) { write_buffer_ = vec; }
+    void copy_from(const std::vector<std::string> &vec)
+    {
+        write_buffer_ = vec;
+        modified_     = true;
+    }
 
     SHMBlockID get_native_data()
     {
+        if (last_shm_block_ && !modified_)
+        {
+            return last_shm_block_->get_native_data();
+        }
+
         // Compute the last dim size
         size_t max_len = 0;
         for (const auto &item : write_buffer_)
@@ -248,18 +284,23 @@ public:
             pos += max_len;
         }
 
+        modified_ = false;
         return last_shm_block_->get_native_data();
     };
 
 protected:
     std::string get(size_t index) const { return write_buffer_.at(index); }
 
-    void set(size_t index, const std::string &value) { write_buffer_[index] = value; }
+    void set(size_t index, const std::string &value)
+    {
+        write_buffer_[index] = value;
+        modified_            = true;
+    }
 };
 
 // Serialization specializations for SHMNeuropodTensor
 // Note: the specialization is for `shared_ptr<NeuropodValue>`, but we check internally
-// that the item is a SHMNeuropodTensor
+// that the item is a SHMNeuropodTensor (unless it is small enough to be written inline)
 template <>
 void ipc_serialize(std::ostream &out, const std::shared_ptr<NeuropodValue> &item);
 
@@ -88,3 +88,45 @@ TEST(test_multiprocess_allowed_transitions, load_neuropod)
     // Loading another neuropod is valid
     verifier.assert_transition_allowed(neuropod::LOAD_NEUROPOD);
 }
+
+TEST(test_multiprocess_allowed_transitions, pipelined)
+{
+    neuropod::TransitionVerifier verifier;
+
+    verifier.assert_transition_allowed(neuropod::LOAD_NEUROPOD);
+    verifier.assert_transition_allowed(neuropod::LOAD_SUCCESS);
+
+    // Multiple requests can be in flight at the same time
+    verifier.assert_transition_allowed(neuropod::ADD_INPUT);
+    verifier.assert_transition_allowed(neuropod::INFER);
+    verifier.assert_transition_allowed(neuropod::ADD_INPUT);
+    verifier.assert_transition_allowed(neuropod::INFER);
+    verifier.assert_transition_allowed(neuropod::RETURN_OUTPUT);
+    verifier.assert_transition_allowed(neuropod::ADD_INPUT);
+
+    // Loading another neuropod is not valid while requests are in flight
+    EXPECT_ANY_THROW(verifier.assert_transition_allowed(neuropod::LOAD_NEUROPOD));
+
+    verifier.assert_transition_allowed(neuropod::INFER);
+    verifier.assert_transition_allowed(neuropod::RETURN_OUTPUT);
+
+    // An exception completes a request
+    verifier.assert_transition_allowed(neuropod::EXCEPTION);
+
+    // There are no more requests in flight
+    EXPECT_ANY_THROW(verifier.assert_transition_allowed(neuropod::RETURN_OUTPUT));
+    verifier.assert_transition_allowed(neuropod::LOAD_NEUROPOD);
+}
+
+TEST(test_multiprocess_allowed_transitions, infer_without_input)
+{
+    neuropod::TransitionVerifier verifier;
+
+    verifier.assert_transition_allowed(neuropod::LOAD_NEUROPOD);
+    verifier.assert_transition_allowed(neuropod::LOAD_SUCCESS);
+    verifier.assert_transition_allowed(neuropod::ADD_INPUT);
+    verifier.assert_transition_allowed(neuropod::INFER);
+
+    // Every INFER needs its own ADD_INPUT
+    EXPECT_ANY_THROW(verifier.assert_transition_allowed(neuropod::INFER));
+}
@@ -16,6 +16,22 @@ limitations under the License.
 #include "gtest/gtest.h"
 #include "neuropod/multiprocess/ipc_control_channel.hh"
 #include "neuropod/multiprocess/multiprocess_worker.hh"
+#include "neuropod/multiprocess/ope_load_config.hh"
+#include "neuropod/multiprocess/ope_request.hh"
+#include "neuropod/multiprocess/shm_tensor.hh"
+#include "neuropod/tests/fake_addition_backend.hh"
+
+#include <thread>
+
+namespace neuropod
+{
+namespace
+{
+
+REGISTER_NEUROPOD_BACKEND(FakeAdditionBackend, "tensorflow", "1.15.0")
+
+} // namespace
+} // namespace neuropod
 
 TEST(test_multiprocess_worker, shutdown)
 {
@@ -33,3 +49,56 @@ TEST(test_multiprocess_worker, shutdown)
     // Cleanup
     control_channel.cleanup();
 }
+
+TEST(test_multiprocess_worker, add_input_error)
+{
+    // Run the worker loop in this process
+    const std::string           control_queue_name = "test_multiprocess_worker_add_input_error";
+    neuropod::IPCControlChannel control_channel(control_queue_name, neuropod::MAIN_PROCESS);
+    std::thread                 worker([&]() { neuropod::multiprocess_worker_loop(control_queue_name); });
+
+    neuropod::ope_load_config config;
+    config.neuropod_path = "neuropod/tests/test_data/tf_addition_model/";
+    control_channel.send_message(neuropod::LOAD_NEUROPOD, config);
+    EXPECT_EQ(control_channel.recv_message().get_payload_type(), neuropod::LOAD_SUCCESS);
+
+    // A payload that starts with a request ID, but can't be read as an `ope_add_input`
+    control_channel.send_message(neuropod::ADD_INPUT, neuropod::ope_exception{5, "not inputs"});
+    control_channel.send_message(neuropod::INFER, neuropod::ope_infer{5, {}});
+
+    // The error is reported once for that request
+    auto received = control_channel.recv_message();
+    ASSERT_EQ(received.get_payload_type(), neuropod::EXCEPTION);
+
+    neuropod::ope_exception error;
+    received.get(error);
+    EXPECT_EQ(error.request_id, 5);
+    EXPECT_NE(error.message.find("Failed to add inputs for request 5"), std::string::npos);
+
+    // The next response is for the next request
+    neuropod::OPETensorAllocator allocator;
+    neuropod::ope_add_input      valid_inputs;
+    valid_inputs.request_id  = 6;
+    valid_inputs.inputs["x"] = allocator.full<float>({1, 2}, 1);
+    valid_inputs.inputs["y"] = allocator.full<float>({1, 2}, 2);
+    control_channel.send_message(neuropod::ADD_INPUT, valid_inputs);
+    control_channel.send_message(neuropod::INFER, neuropod::ope_infer{6, {}});
+
+    {
+        // The worker waits for the outputs to be released before it shuts down
+        auto output_message = control_channel.recv_message();
+        ASSERT_EQ(output_message.get_payload_type(), neuropod::RETURN_OUTPUT);
+
+        neuropod::ope_return_output outputs;
+        output_message.get(outputs);
+        EXPECT_EQ(outputs.request_id, 6);
+        EXPECT_EQ(outputs.outputs.at("out")->as_typed_tensor<float>()->get_data_as_vector(),
+                  std::vector<float>(2, 3));
+    }
+
+    control_channel.send_message(neuropod::SHUTDOWN);
+    worker.join();
+
+    // Cleanup
+    control_channel.cleanup();
+}
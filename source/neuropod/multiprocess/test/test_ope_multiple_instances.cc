@@ -15,8 +15,12 @@ limitations under the License.
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "neuropod/multiprocess/ipc_control_channel.hh"
+#include "neuropod/multiprocess/ope_request.hh"
 #include "neuropod/neuropod.hh"
+#include "neuropod/neuropod_pool.hh"
 
+#include <future>
 #include <thread>
 
 TEST(test_ope_multiple_instances, multithreaded)
@@ -74,3 +78,215 @@ TEST(test_ope_multiple_instances, multithreaded)
     // Join threads
     std::for_each(workers.begin(), workers.end(), [](std::thread &t) { t.join(); });
 }
+
+namespace
+{
+
+// Run inference on a shared model from several threads at once
+void run_strings_model_concurrently(neuropod::Neuropod &model, size_t num_threads, size_t num_requests)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (size_t t = 0; t < num_threads; t++)
+    {
+        threads.emplace_back([&model, num_requests]() {
+            const std::vector<int64_t>     shape  = {3};
+            const std::vector<std::string> target = {"apple sauce", "banana pudding", "carrot cake"};
+
+            for (size_t i = 0; i < num_requests; ++i)
+            {
+                auto x_ten = model.allocate_tensor<std::string>(shape);
+                auto y_ten = model.allocate_tensor<std::string>(shape);
+
+                x_ten->copy_from({"apple", "banana", "carrot"});
+                y_ten->copy_from({"sauce", "pudding", "cake"});
+
+                // Run inference
+                const auto output_data = model.infer({{"x", x_ten}, {"y", y_ten}});
+                const auto out_tensor  = output_data->at("out")->as_typed_tensor<std::string>();
+
+                EXPECT_TRUE(out_tensor->get_data_as_vector() == target);
+                EXPECT_TRUE(out_tensor->get_dims() == shape);
+            }
+        });
+    }
+
+    std::for_each(threads.begin(), threads.end(), [](std::thread &t) { t.join(); });
+}
+
+} // namespace
+
+TEST(test_ope_multiple_instances, worker_pool)
+{
+    // Create a single model backed by a pool of workers
+    neuropod::RuntimeOptions opts;
+    opts.use_ope                 = true;
+    opts.ope_options.num_workers = 4;
+    neuropod::Neuropod model("neuropod/tests/test_data/pytorch_strings_model/", opts);
+
+    run_strings_model_concurrently(model, 8, 512);
+}
+
+TEST(test_ope_multiple_instances, pipelined)
+{
+    // Allow several requests to be in flight on a single worker
+    neuropod::RuntimeOptions opts;
+    opts.use_ope                              = true;
+    opts.ope_options.max_in_flight_per_worker = 4;
+    neuropod::Neuropod model("neuropod/tests/test_data/pytorch_strings_model/", opts);
+
+    run_strings_model_concurrently(model, 4, 512);
+}
+
+TEST(test_ope_multiple_instances, pipelined_worker_pool)
+{
+    neuropod::RuntimeOptions opts;
+    opts.use_ope                              = true;
+    opts.ope_options.num_workers              = 2;
+    opts.ope_options.max_in_flight_per_worker = 2;
+    neuropod::Neuropod model("neuropod/tests/test_data/pytorch_strings_model/", opts);
+
+    run_strings_model_concurrently(model, 8, 512);
+}
+
+TEST(test_ope_multiple_instances, neuropod_pool)
+{
+    // With the default options, an OPE model runs one request at a time so each instance starts a worker
+    neuropod::RuntimeOptions opts;
+    opts.use_ope = true;
+    neuropod::NeuropodPool separate("neuropod/tests/test_data/pytorch_strings_model/", 2, opts);
+    EXPECT_EQ(separate.get_num_loaded_models(), 2);
+
+    // A model with several workers can be shared
+    opts.ope_options.num_workers = 2;
+    neuropod::NeuropodPool shared("neuropod/tests/test_data/pytorch_strings_model/", 2, opts);
+    EXPECT_EQ(shared.get_num_loaded_models(), 1);
+}
+
+TEST(test_ope_multiple_instances, worker_pool_with_existing_worker)
+{
+    // A pool can't be built from a single existing worker
+    neuropod::RuntimeOptions opts;
+    opts.use_ope                        = true;
+    opts.ope_options.num_workers        = 2;
+    opts.ope_options.control_queue_name = "some_queue";
+    EXPECT_ANY_THROW(neuropod::Neuropod("neuropod/tests/test_data/pytorch_strings_model/", opts));
+}
+
+TEST(test_ope_multiple_instances, shm_arena)
+{
+    // Sub-allocate tensors from a shared memory arena in both processes
+    // Note: this enables the arena for the rest of this process
+    neuropod::RuntimeOptions opts;
+    opts.use_ope                                  = true;
+    opts.ope_options.num_workers                  = 2;
+    opts.ope_options.max_in_flight_per_worker     = 2;
+    opts.ope_options.shm_arena_segment_size_bytes = 1024 * 1024;
+    neuropod::Neuropod model("neuropod/tests/test_data/pytorch_strings_model/", opts);
+
+    run_strings_model_concurrently(model, 8, 512);
+}
+
+TEST(test_ope_multiple_instances, stats)
+{
+    neuropod::RuntimeOptions opts;
+    opts.use_ope                              = true;
+    opts.ope_options.num_workers              = 2;
+    opts.ope_options.max_in_flight_per_worker = 2;
+    neuropod::Neuropod model("neuropod/tests/test_data/pytorch_strings_model/", opts);
+
+    run_strings_model_concurrently(model, 4, 64);
+
+    // The OPE specific stages are recorded along with the usual ones
+    const auto stats = model.get_stats();
+    EXPECT_EQ(stats.at("load").count, 1);
+    for (const auto &stage : {"infer",
+                              "infer_internal",
+                              "ope_dispatch_wait",
+                              "ope_serialization",
+                              "ope_queue_wait",
+                              "ope_worker_compute",
+                              "ope_deserialization"})
+    {
+        ASSERT_EQ(stats.count(stage), 1) << stage;
+        EXPECT_EQ(stats.at(stage).count, 256) << stage;
+    }
+
+    // The time spent in the worker is part of the time spent in the backend
+    EXPECT_LE(stats.at("ope_worker_compute").min_us, stats.at("infer_internal").max_us);
+}
+
+TEST(test_ope_multiple_instances, response_errors)
+{
+    // A fake worker in this process that fails the two requests it gets
+    const std::string  control_queue_name = "test_ope_multiple_instances_response_errors";
+    std::promise<void> done;
+    std::thread        worker([&]() {
+        neuropod::IPCControlChannel control_channel(control_queue_name, neuropod::WORKER_PROCESS);
+        EXPECT_EQ(control_channel.recv_message().get_payload_type(), neuropod::LOAD_NEUROPOD);
+        control_channel.send_message(neuropod::LOAD_SUCCESS);
+
+        std::vector<uint64_t> request_ids;
+        while (request_ids.size() < 2)
+        {
+            auto received = control_channel.recv_message();
+            if (received.get_payload_type() == neuropod::INFER)
+            {
+                neuropod::ope_infer request;
+                received.get(request);
+                request_ids.emplace_back(request.request_id);
+            }
+        }
+
+        // A response that starts with a request ID, but can't be read as an `ope_return_output`
+        // The thread that reads it may not be the one waiting for it
+        control_channel.send_message(neuropod::RETURN_OUTPUT, neuropod::ope_exception{request_ids[0], "x"});
+        control_channel.send_message(neuropod::EXCEPTION, neuropod::ope_exception{request_ids[1], "failed"});
+
+        done.get_future().wait();
+        control_channel.cleanup();
+    });
+
+    {
+        neuropod::RuntimeOptions opts;
+        opts.use_ope                              = true;
+        opts.ope_options.control_queue_name       = control_queue_name;
+        opts.ope_options.max_in_flight_per_worker = 2;
+        neuropod::Neuropod model("neuropod/tests/test_data/pytorch_strings_model/", opts);
+
+        // Each request gets its own error
+        std::vector<std::string> errors(2);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < errors.size(); i++)
+        {
+            threads.emplace_back([&, i]() {
+                auto x = model.allocate_tensor<std::string>({1});
+                auto y = model.allocate_tensor<std::string>({1});
+                x->copy_from({"apple"});
+                y->copy_from({"sauce"});
+                try
+                {
+                    model.infer({{"x", x}, {"y", y}});
+                }
+                catch (const std::exception &e)
+                {
+                    errors[i] = e.what();
+                }
+            });
+        }
+
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        const bool  first_is_read_error = errors[0].find("Failed to read the response") != std::string::npos;
+        const auto &read_error          = errors[first_is_read_error ? 0 : 1];
+        const auto &worker_error        = errors[first_is_read_error ? 1 : 0];
+        EXPECT_THAT(read_error, ::testing::HasSubstr("Failed to read the response from the worker process"));
+        EXPECT_THAT(worker_error, ::testing::HasSubstr("Got an exception during inference: failed"));
+    }
+
+    done.set_value();
+    worker.join();
+}
@@ -0,0 +1,125 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/internal/tracing.hh"
+#include "neuropod/neuropod.hh"
+
+#include <json/json.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+// Load a trace the same way trace viewers do (the closing bracket is optional)
+Json::Value read_trace(const std::string &path)
+{
+    std::ifstream     file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    auto content = buffer.str();
+    while (!content.empty() && (content.back() == '\n' || content.back() == ','))
+    {
+        content.pop_back();
+    }
+
+    content += "]";
+
+    Json::Value             trace;
+    Json::CharReaderBuilder builder;
+    std::string             errors;
+    std::istringstream      stream(content);
+    EXPECT_TRUE(Json::parseFromStream(builder, stream, &trace, &errors)) << errors;
+    return trace;
+}
+
+} // namespace
+
+TEST(test_ope_tracing, spans_from_both_processes)
+{
+    const std::string path = "/tmp/neuropod_test_ope_tracing_" + std::to_string(getpid()) + ".json";
+    std::remove(path.c_str());
+    neuropod::set_trace_file(path);
+
+    {
+        // The worker inherits the trace file
+        neuropod::RuntimeOptions opts;
+        opts.use_ope = true;
+        neuropod::Neuropod model("neuropod/tests/test_data/pytorch_strings_model/", opts);
+
+        for (int i = 0; i < 2; i++)
+        {
+            auto x = model.allocate_tensor<std::string>({3});
+            auto y = model.allocate_tensor<std::string>({3});
+            x->copy_from({"apple", "banana", "carrot"});
+            y->copy_from({"sauce", "pudding", "cake"});
+            model.infer({{"x", x}, {"y", y}});
+        }
+    }
+
+    // The worker has exited so all of its events are in the file
+    neuropod::set_trace_file("");
+    const auto trace = read_trace(path);
+    std::remove(path.c_str());
+
+    // The spans for each request ID (along with the process they came from)
+    std::map<uint64_t, std::set<std::string>> spans;
+    std::set<int>                             worker_pids;
+    for (const auto &event : trace)
+    {
+        if (event["ph"].asString() == "M")
+        {
+            EXPECT_EQ(event["args"]["name"].asString(), "neuropod_multiprocess_worker");
+            worker_pids.insert(event["pid"].asInt());
+            continue;
+        }
+
+        if (event.isMember("args"))
+        {
+            const bool is_main = event["pid"].asInt() == getpid();
+            spans[event["args"]["request_id"].asUInt64()].insert((is_main ? "main:" : "worker:") +
+                                                                 event["name"].asString());
+        }
+    }
+
+    EXPECT_EQ(worker_pids.size(), 1);
+    EXPECT_EQ(worker_pids.count(getpid()), 0);
+
+    // Every request can be followed across both processes
+    ASSERT_EQ(spans.size(), 2);
+    for (const auto &item : spans)
+    {
+        for (const auto &name : {"main:ope_infer",
+                                 "main:ope_send_inputs",
+                                 "main:ope_send_infer",
+                                 "main:ope_wait_for_response",
+                                 "main:ope_load_outputs",
+                                 "worker:worker_load_inputs",
+                                 "worker:worker_infer",
+                                 "worker:worker_copy_outputs",
+                                 "worker:worker_send_outputs",
+                                 "worker:worker_free_inputs"})
+        {
+            EXPECT_EQ(item.second.count(name), 1) << name << " for request " << item.first;
+        }
+    }
+}
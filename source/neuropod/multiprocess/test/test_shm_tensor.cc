@@ -69,3 +69,20 @@ TEST(test_shm_tensor, simple)
         EXPECT_EQ(memcmp(actual_data, expected_data, num_items * sizeof(uint8_t)), 0);
     }
 }
+
+TEST(test_shm_tensor, string_block_reuse)
+{
+    neuropod::SHMNeuropodTensor<std::string> tensor({2});
+    tensor.copy_from({"some", "strings"});
+
+    // The data is only copied into shared memory once unless the tensor changes
+    const auto allocations = neuropod::shm_allocator.get_stats().allocations;
+    const auto block_id    = tensor.get_native_data();
+    EXPECT_EQ(tensor.get_native_data(), block_id);
+    EXPECT_EQ(neuropod::shm_allocator.get_stats().allocations, allocations + 1);
+
+    // Modifying the tensor creates a new block
+    tensor.flat()[1] = "other strings";
+    EXPECT_NE(tensor.get_native_data(), block_id);
+    EXPECT_EQ(neuropod::shm_allocator.get_stats().allocations, allocations + 2);
+}
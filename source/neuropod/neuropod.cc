@@ -19,12 +19,84 @@ limitations under the License.
 #include "neuropod/internal/backend_registration.hh"
 #include "neuropod/internal/config_utils.hh"
 #include "neuropod/internal/error_utils.hh"
+#include "neuropod/internal/memory_utils.hh"
 #include "neuropod/internal/neuropod_tensor.hh"
+#include "neuropod/internal/thread_pool.hh"
 #include "neuropod/multiprocess/multiprocess.hh"
+#include "neuropod/recording.hh"
+
+#include <functional>
+#include <mutex>
 
 namespace neuropod
 {
 
+namespace detail
+{
+
+class AsyncExecutor
+{
+private:
+    const size_t                num_threads_;
+    std::mutex                  mutex_;
+    std::unique_ptr<ThreadPool> pool_;
+
+public:
+    explicit AsyncExecutor(size_t num_threads) : num_threads_(num_threads)
+    {
+        if (num_threads_ == 0)
+        {
+            NEUROPOD_ERROR("`num_async_threads` must be at least 1");
+        }
+    }
+
+    // Start the threads on the first request so they don't exist unless `infer_async` is used
+    void submit(std::function<void()> task)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!pool_)
+        {
+            pool_ = stdx::make_unique<ThreadPool>(num_threads_);
+        }
+
+        lock.unlock();
+        pool_->submit(std::move(task));
+    }
+};
+
+} // namespace detail
+
+namespace
+{
+
+const NeuropodValueMap &as_value_map(const NeuropodValueMap &inputs)
+{
+    return inputs;
+}
+
+NeuropodValueMap as_value_map(const IndexedValueMap &inputs)
+{
+    return inputs.to_map();
+}
+
+// Run inference with `run_inference` and record the request if `recorder` (if any) samples it
+// Unsampled requests don't convert `inputs` or wrap `run_inference`
+template <typename InputMap, typename RunInference>
+std::unique_ptr<NeuropodValueMap> maybe_record(detail::RequestRecorder *       recorder,
+                                               const InputMap &                inputs,
+                                               const std::vector<std::string> &requested_outputs,
+                                               RunInference &&                 run_inference)
+{
+    if (recorder && recorder->should_record())
+    {
+        return recorder->record(as_value_map(inputs), requested_outputs, run_inference);
+    }
+
+    return run_inference();
+}
+
+} // namespace
+
 Neuropod::Neuropod(const std::string &neuropod_path, const RuntimeOptions &options)
     : Neuropod(neuropod_path, {}, options)
 {
@@ -34,6 +106,7 @@ Neuropod::Neuropod(const std::string &neuropod_path, const RuntimeOptions &optio
 Neuropod::Neuropod(const std::string &                 neuropod_path,
                    const std::vector<BackendLoadSpec> &default_backend_overrides,
                    const RuntimeOptions &              options)
+    : async_executor_(std::make_shared<detail::AsyncExecutor>(options.num_async_threads))
 {
     if (options.use_ope)
     {
@@ -48,11 +121,16 @@ Neuropod::Neuropod(const std::string &                 neuropod_path,
                                         model_config->platform,
                                         model_config->platform_version_semver)(neuropod_path, options);
     }
+
+    if (!options.recording_options.path.empty())
+    {
+        recorder_ = detail::RequestRecorder::get(options.recording_options);
+    }
 }
 
 // Load the model config and use the backend that was provided by the user
 Neuropod::Neuropod(const std::string &neuropod_path, std::shared_ptr<NeuropodBackend> backend)
-    : backend_(std::move(backend))
+    : backend_(std::move(backend)), async_executor_(std::make_shared<detail::AsyncExecutor>(1))
 {
 }
 
@@ -68,7 +146,110 @@ std::unique_ptr<NeuropodValueMap> Neuropod::infer(const NeuropodValueMap &
 {
     // TODO(vip): make sure that names in `inputs` are not repeated
     // Run inference
-    return backend_->infer(inputs, requested_outputs);
+    return maybe_record(
+        recorder_.get(), inputs, requested_outputs, [&]() { return backend_->infer(inputs, requested_outputs); });
+}
+
+std::unique_ptr<NeuropodValueMap> Neuropod::infer(const NeuropodValueMap &                        inputs,
+                                                  const std::vector<std::string> &                requested_outputs,
+                                                  const std::shared_ptr<NeuropodTensorAllocator> &output_allocator)
+{
+    return maybe_record(recorder_.get(), inputs, requested_outputs, [&]() {
+        return backend_->infer(inputs, requested_outputs, output_allocator);
+    });
+}
+
+std::unique_ptr<NeuropodValueMap> Neuropod::infer(const IndexedValueMap &         inputs,
+                                                  const std::vector<std::string> &requested_outputs)
+{
+    return maybe_record(
+        recorder_.get(), inputs, requested_outputs, [&]() { return backend_->infer(inputs, requested_outputs); });
+}
+
+std::unique_ptr<NeuropodValueMap> Neuropod::infer(const IndexedValueMap &                         inputs,
+                                                  const std::vector<std::string> &                requested_outputs,
+                                                  const std::shared_ptr<NeuropodTensorAllocator> &output_allocator)
+{
+    return maybe_record(recorder_.get(), inputs, requested_outputs, [&]() {
+        return backend_->infer(inputs, requested_outputs, output_allocator);
+    });
+}
+
+IndexedValueMap Neuropod::make_input_map() const
+{
+    return backend_->make_input_map();
+}
+
+void Neuropod::infer_into(const NeuropodValueMap &inputs, NeuropodValueMap &outputs)
+{
+    if (recorder_ && recorder_->should_record())
+    {
+        // The requested outputs are the ones in `outputs`
+        std::vector<std::string> requested_outputs;
+        for (const auto &item : outputs)
+        {
+            requested_outputs.emplace_back(item.first);
+        }
+
+        recorder_->record(inputs, requested_outputs, [&]() {
+            backend_->infer_into(inputs, outputs);
+            return stdx::make_unique<NeuropodValueMap>(outputs);
+        });
+
+        return;
+    }
+
+    backend_->infer_into(inputs, outputs);
+}
+
+std::future<std::unique_ptr<NeuropodValueMap>> Neuropod::infer_async(const NeuropodValueMap &        inputs,
+                                                                     const std::vector<std::string> &requested_outputs)
+{
+    // `std::function` must be copyable so the promise is in a shared_ptr
+    auto promise = std::make_shared<std::promise<std::unique_ptr<NeuropodValueMap>>>();
+    auto future  = promise->get_future();
+
+    auto callback = [promise](std::unique_ptr<NeuropodValueMap> outputs, std::exception_ptr error) {
+        if (error)
+        {
+            promise->set_exception(error);
+        }
+        else
+        {
+            promise->set_value(std::move(outputs));
+        }
+    };
+
+    infer_async(inputs, requested_outputs, std::move(callback));
+
+    return future;
+}
+
+void Neuropod::infer_async(const NeuropodValueMap &        inputs,
+                           const std::vector<std::string> &requested_outputs,
+                           InferCallback                   callback)
+{
+    // The task keeps the backend (and recorder) alive so it can outlive this Neuropod
+    async_executor_->submit(
+        [backend = backend_, recorder = recorder_, inputs = inputs, requested_outputs, callback]() mutable {
+            std::unique_ptr<NeuropodValueMap> outputs;
+            std::exception_ptr                error;
+            try
+            {
+                outputs = maybe_record(recorder.get(), inputs, requested_outputs, [&]() {
+                    return backend->infer(inputs, requested_outputs);
+                });
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            // Release the inputs before signalling completion so the caller knows this thread no longer references
+            // them (the python bindings rely on this to free numpy-backed tensors before a Neuropod is destroyed)
+            inputs.clear();
+            callback(std::move(outputs), error);
+        });
 }
 
 const std::vector<TensorSpec> &Neuropod::get_inputs() const
@@ -81,6 +262,11 @@ const std::vector<TensorSpec> &Neuropod::get_outputs() const
     return backend_->get_outputs();
 }
 
+bool Neuropod::supports_concurrent_inference() const
+{
+    return backend_->supports_concurrent_inference();
+}
+
 const std::string &Neuropod::get_name() const
 {
     return backend_->get_name();
@@ -91,6 +277,11 @@ const std::string &Neuropod::get_platform() const
     return backend_->get_platform();
 }
 
+NeuropodStats Neuropod::get_stats() const
+{
+    return backend_->get_stats();
+}
+
 std::shared_ptr<NeuropodTensorAllocator> Neuropod::get_tensor_allocator()
 {
     return backend_->get_tensor_allocator();
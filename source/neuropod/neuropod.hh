@@ -20,6 +20,9 @@ limitations under the License.
 #include "neuropod/options.hh"
 #include "neuropod/version.hh"
 
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -28,12 +31,32 @@ limitations under the License.
 namespace neuropod
 {
 
+namespace detail
+{
+
+// Lazily starts the threads that run `infer_async` requests
+class AsyncExecutor;
+
+// Records a sample of requests (see `RuntimeOptions::recording_options`)
+class RequestRecorder;
+
+} // namespace detail
+
+// Called with the outputs of an async inference request or the exception it threw (if any)
+using InferCallback = std::function<void(std::unique_ptr<NeuropodValueMap>, std::exception_ptr)>;
+
 class Neuropod
 {
 private:
     // The backend used to load and run the neuropod
     std::shared_ptr<NeuropodBackend> backend_;
 
+    // Runs `infer_async` requests. This is shared by copies of this Neuropod (like `backend_`)
+    std::shared_ptr<detail::AsyncExecutor> async_executor_;
+
+    // Only set if recording is enabled
+    std::shared_ptr<detail::RequestRecorder> recorder_;
+
 public:
     // Load a neuropod.
     Neuropod(const std::string &neuropod_path, const RuntimeOptions &options = {});
@@ -75,6 +98,46 @@ public:
     std::unique_ptr<NeuropodValueMap> infer(const NeuropodValueMap &        inputs,
                                             const std::vector<std::string> &requested_outputs = {});
 
+    // Run inference and put outputs in tensors allocated by `output_allocator` if the backend supports it.
+    // Backends that don't support this return outputs as usual so callers should not assume that outputs
+    // were allocated by `output_allocator`
+    std::unique_ptr<NeuropodValueMap> infer(const NeuropodValueMap &                        inputs,
+                                            const std::vector<std::string> &                requested_outputs,
+                                            const std::shared_ptr<NeuropodTensorAllocator> &output_allocator);
+
+    // Run inference with inputs in a flat value map (see `IndexedValueMap`). This is cheaper than using a
+    // NeuropodValueMap for models with many inputs if `inputs` was created by `make_input_map`
+    std::unique_ptr<NeuropodValueMap> infer(const IndexedValueMap &         inputs,
+                                            const std::vector<std::string> &requested_outputs = {});
+
+    // Same as above, but with an `output_allocator` (see the NeuropodValueMap version)
+    std::unique_ptr<NeuropodValueMap> infer(const IndexedValueMap &                         inputs,
+                                            const std::vector<std::string> &                requested_outputs,
+                                            const std::shared_ptr<NeuropodTensorAllocator> &output_allocator);
+
+    // Create an empty flat value map for the inputs of this model. Create it once and
+    // reuse it (along with indices from `get_index`) for every request
+    IndexedValueMap make_input_map() const;
+
+    // Run inference and write the outputs into tensors owned by the caller (a map from output name to tensor).
+    // Only the outputs in `outputs` are computed. Each tensor must have the type and shape of the corresponding
+    // output (e.g. allocated once from the output spec and reused for every call). Backends that can't write
+    // into these tensors directly copy each output into them once.
+    void infer_into(const NeuropodValueMap &inputs, NeuropodValueMap &outputs);
+
+    // Run inference on an internal executor (see `RuntimeOptions::num_async_threads`) and return a future
+    // for the outputs. Exceptions thrown during inference are rethrown by `future.get()`.
+    // `inputs` is copied so it doesn't need to outlive the call (the tensors themselves are shared). The copy is
+    // released before the future becomes ready
+    std::future<std::unique_ptr<NeuropodValueMap>> infer_async(const NeuropodValueMap &        inputs,
+                                                               const std::vector<std::string> &requested_outputs = {});
+
+    // Same as above, but calls `callback` on the executor thread once inference is done
+    // `callback` should not throw
+    void infer_async(const NeuropodValueMap &        inputs,
+                     const std::vector<std::string> &requested_outputs,
+                     InferCallback                   callback);
+
     // If `load_model_at_construction` is false in the RuntimeOptions passed into the constructor,
     // this method loads the model
     void load_model();
@@ -83,11 +146,19 @@ public:
     const std::vector<TensorSpec> &get_inputs() const;
     const std::vector<TensorSpec> &get_outputs() const;
 
+    // Whether or not `infer` can be called from multiple threads at the same time on this Neuropod
+    bool supports_concurrent_inference() const;
+
     // Get the name of the loaded Neuropod.
     const std::string &get_name() const;
     // Get the platform of the loaded Neuropod.
     const std::string &get_platform() const;
 
+    // Get latency stats for each stage of loading and inference (e.g. "infer", "sealing", "infer_internal").
+    // Stats are recorded for every successful call and are cumulative since the model was loaded.
+    // See `docs/advanced/stats.md` for the list of stages
+    NeuropodStats get_stats() const;
+
     // Returns a tensor allocator that can allocate tensors compatible with this neuropod
     std::shared_ptr<NeuropodTensorAllocator> get_tensor_allocator();
 
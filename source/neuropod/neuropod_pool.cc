@@ -0,0 +1,152 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/neuropod_pool.hh"
+
+#include "neuropod/internal/error_utils.hh"
+#include "neuropod/internal/logging.hh"
+#include "neuropod/internal/neuropod_loader.hh"
+
+namespace neuropod
+{
+
+NeuropodPool::NeuropodPool(const std::string &neuropod_path, size_t num_instances, const RuntimeOptions &options)
+    : NeuropodPool(neuropod_path, num_instances, {}, options)
+{
+}
+
+NeuropodPool::NeuropodPool(const std::string &                 neuropod_path,
+                           size_t                              num_instances,
+                           const std::vector<BackendLoadSpec> &default_backend_overrides,
+                           const RuntimeOptions &              options)
+{
+    if (num_instances == 0)
+    {
+        NEUROPOD_ERROR("A NeuropodPool must have at least one instance");
+    }
+
+    // Extract the neuropod once (if necessary) and load every instance from the same local path
+    loader_               = get_loader(neuropod_path);
+    const auto local_path = loader_->ensure_local();
+
+    auto first         = std::make_shared<Neuropod>(local_path, default_backend_overrides, options);
+    num_loaded_models_ = 1;
+
+    instances_.reserve(num_instances);
+    instances_.emplace_back(first);
+    for (size_t i = 1; i < num_instances; i++)
+    {
+        if (first->supports_concurrent_inference())
+        {
+            // Share the loaded model
+            instances_.emplace_back(first);
+        }
+        else
+        {
+            instances_.emplace_back(std::make_shared<Neuropod>(local_path, default_backend_overrides, options));
+            num_loaded_models_++;
+        }
+    }
+
+    SPDLOG_DEBUG("Created a pool with {} instances of '{}' ({} loaded models)",
+                 num_instances,
+                 first->get_name(),
+                 num_loaded_models_);
+
+    for (size_t i = 0; i < num_instances; i++)
+    {
+        free_instances_.emplace_back(i);
+    }
+}
+
+NeuropodPool::~NeuropodPool()
+{
+    // Unload the models before the loader cleans up any extracted files
+    instances_.clear();
+}
+
+size_t NeuropodPool::acquire_instance()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return !free_instances_.empty(); });
+
+    const auto index = free_instances_.back();
+    free_instances_.pop_back();
+    return index;
+}
+
+void NeuropodPool::release_instance(size_t index)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_instances_.emplace_back(index);
+    }
+
+    cv_.notify_one();
+}
+
+std::unique_ptr<NeuropodValueMap> NeuropodPool::infer(const NeuropodValueMap &        inputs,
+                                                      const std::vector<std::string> &requested_outputs)
+{
+    // Release the instance even if inference throws
+    struct InstanceLease
+    {
+        NeuropodPool &pool;
+        const size_t  index;
+
+        explicit InstanceLease(NeuropodPool &p) : pool(p), index(p.acquire_instance()) {}
+        ~InstanceLease() { pool.release_instance(index); }
+    };
+
+    InstanceLease lease(*this);
+    return instances_[lease.index]->infer(inputs, requested_outputs);
+}
+
+size_t NeuropodPool::get_num_instances() const
+{
+    return instances_.size();
+}
+
+size_t NeuropodPool::get_num_loaded_models() const
+{
+    return num_loaded_models_;
+}
+
+const std::vector<TensorSpec> &NeuropodPool::get_inputs() const
+{
+    return instances_[0]->get_inputs();
+}
+
+const std::vector<TensorSpec> &NeuropodPool::get_outputs() const
+{
+    return instances_[0]->get_outputs();
+}
+
+const std::string &NeuropodPool::get_name() const
+{
+    return instances_[0]->get_name();
+}
+
+const std::string &NeuropodPool::get_platform() const
+{
+    return instances_[0]->get_platform();
+}
+
+std::shared_ptr<NeuropodTensorAllocator> NeuropodPool::get_tensor_allocator()
+{
+    return instances_[0]->get_tensor_allocator();
+}
+
+} // namespace neuropod
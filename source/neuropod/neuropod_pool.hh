@@ -0,0 +1,96 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "neuropod/neuropod.hh"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace neuropod
+{
+
+class NeuropodLoader;
+
+// A pool of instances of a neuropod that lets multiple threads run inference at the same time.
+// Each call to `infer` runs on a free instance and blocks if all of them are busy.
+//
+// If the backend supports concurrent inference on a single loaded model (TensorFlow, TorchScript and OPE),
+// the model is only loaded once and shared by all the instances (so `num_instances` just limits the number
+// of concurrent requests). Otherwise (e.g. the python backend), the model is loaded `num_instances` times.
+// In both cases, the neuropod is only extracted once if it's a zipfile.
+class NeuropodPool
+{
+private:
+    // Keeps the (possibly extracted) neuropod around while the instances are loaded
+    std::unique_ptr<NeuropodLoader> loader_;
+
+    // The instances in the pool. These may all point to the same `Neuropod`
+    std::vector<std::shared_ptr<Neuropod>> instances_;
+
+    // The indices of the instances that aren't running inference
+    std::vector<size_t>     free_instances_;
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+
+    // The number of distinct models that were loaded
+    size_t num_loaded_models_ = 0;
+
+    // Wait for a free instance and mark it as busy
+    size_t acquire_instance();
+
+    // Mark an instance as free
+    void release_instance(size_t index);
+
+public:
+    NeuropodPool(const std::string &neuropod_path, size_t num_instances, const RuntimeOptions &options = {});
+
+    // See the `Neuropod` constructor for details on `default_backend_overrides`
+    NeuropodPool(const std::string &                 neuropod_path,
+                 size_t                              num_instances,
+                 const std::vector<BackendLoadSpec> &default_backend_overrides,
+                 const RuntimeOptions &              options = {});
+
+    ~NeuropodPool();
+
+    // Run inference on a free instance. Blocks until one is available.
+    // Note: this is threadsafe
+    std::unique_ptr<NeuropodValueMap> infer(const NeuropodValueMap &        inputs,
+                                            const std::vector<std::string> &requested_outputs = {});
+
+    // The number of instances in the pool
+    size_t get_num_instances() const;
+
+    // The number of times the model was actually loaded
+    // (1 if the backend supports concurrent inference, otherwise `get_num_instances()`)
+    size_t get_num_loaded_models() const;
+
+    // Get the inputs and outputs of the neuropod
+    const std::vector<TensorSpec> &get_inputs() const;
+    const std::vector<TensorSpec> &get_outputs() const;
+
+    // Get the name and platform of the neuropod
+    const std::string &get_name() const;
+    const std::string &get_platform() const;
+
+    // Returns a tensor allocator that can allocate tensors compatible with every instance in the pool
+    std::shared_ptr<NeuropodTensorAllocator> get_tensor_allocator();
+};
+
+} // namespace neuropod
@@ -15,6 +15,7 @@ limitations under the License.
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 namespace neuropod
@@ -59,6 +60,27 @@ struct RuntimeOptions
         // This option can be used to run the neuropod in an existing worker process
         // If this string is empty, a new worker will be started.
         std::string control_queue_name;
+
+        // The number of worker processes to start for this neuropod.
+        // Each call to `infer` is dispatched to the least loaded idle worker so multiple threads
+        // can run inference concurrently on a single `Neuropod` instance.
+        // This must be 1 if `control_queue_name` is set.
+        size_t num_workers = 1;
+
+        // The maximum number of requests that can be in flight on a single worker at the same time.
+        // If this is greater than 1, the inputs for a request can be sent to a worker while it is still
+        // running a previous request (e.g. when calling `infer` from multiple threads). This hides
+        // IPC and serialization latency behind compute at the cost of keeping more inputs in memory.
+        size_t max_in_flight_per_worker = 1;
+
+        // If this is nonzero, shared memory for tensors is sub-allocated from a few large shared memory
+        // segments (an arena) instead of creating a new shared memory object for each tensor. Tensors are
+        // referenced by their offset within a segment so the receiving process only has to map each segment
+        // once. This is the size of the first segment in bytes; the arena grows by adding larger segments.
+        //
+        // The arena is shared by everything that uses OPE in a process and is enabled by the first
+        // neuropod that sets this option. Arena memory is reused, but it is only freed when the process exits.
+        size_t shm_arena_segment_size_bytes = 0;
     } ope_options;
 
     // The device to run this Neuropod on.
@@ -75,6 +97,32 @@ struct RuntimeOptions
 
     // Whether or not to disable shape and type checking when running inference
     bool disable_shape_and_type_checking = false;
+
+    // The number of threads used to run `infer_async` requests on this neuropod.
+    // Values above 1 only help if the backend supports concurrent inference (see
+    // `Neuropod::supports_concurrent_inference`). The threads are started on the first async request.
+    size_t num_async_threads = 1;
+
+    // Options for recording a sample of the requests to `infer` (e.g. to replay them later with `neuropod_replay`)
+    // See `neuropod/recording.hh` for details
+    struct RecordingOptions
+    {
+        // The file to append recorded requests to. Recording is disabled if this is empty
+        std::string path;
+
+        // The fraction of requests to record (between 0 and 1)
+        double sample_rate = 1.0;
+
+        // Whether or not to also record the outputs of each recorded request so replays can be checked against them
+        bool record_outputs = false;
+
+        // Stop recording after this many requests. 0 means there is no limit
+        size_t max_requests = 0;
+
+        // Records are written to the file by a background thread. This is the maximum number of records that can be
+        // waiting to be written. Sampled requests are dropped (and not recorded) while the queue is full
+        size_t max_queued_requests = 64;
+    } recording_options;
 };
 
 } // namespace neuropod
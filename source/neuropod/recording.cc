@@ -0,0 +1,351 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/recording.hh"
+
+#include "neuropod/core/generic_tensor.hh"
+#include "neuropod/internal/error_utils.hh"
+#include "neuropod/internal/logging.hh"
+#include "neuropod/internal/neuropod_tensor_raw_data_access.hh"
+#include "neuropod/serialization/stream_serialization.hh"
+
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+#include <unistd.h>
+
+namespace neuropod
+{
+
+namespace
+{
+
+// The names of the items in the metadata map of each record
+constexpr auto REQUESTED_OUTPUTS_KEY = "requested_outputs";
+constexpr auto START_TIME_KEY        = "start_time_ns";
+constexpr auto LATENCY_KEY           = "latency_ns";
+constexpr auto HAS_OUTPUTS_KEY       = "has_outputs";
+
+uint64_t get_steady_clock_ns()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+int64_t get_scalar(const NeuropodValueMap &metadata, const char *key)
+{
+    const auto item = metadata.find(key);
+    if (item == metadata.end())
+    {
+        NEUROPOD_ERROR("Invalid recording: a record is missing '{}'", key);
+    }
+
+    return item->second->as_typed_tensor<int64_t>()->as_scalar();
+}
+
+// Copy the tensors in `values` so callers can reuse their tensors while the copies wait to be written
+NeuropodValueMap copy_values(const NeuropodValueMap &values, NeuropodTensorAllocator &allocator)
+{
+    NeuropodValueMap out;
+    for (const auto &item : values)
+    {
+        const auto &                    tensor = *item.second->as_tensor();
+        std::shared_ptr<NeuropodTensor> copy   = allocator.allocate_tensor(tensor.get_dims(), tensor.get_tensor_type());
+        if (tensor.get_tensor_type() == STRING_TENSOR)
+        {
+            const auto data = tensor.as_typed_tensor<std::string>()->get_data_as_vector();
+            copy->as_typed_tensor<std::string>()->copy_from(data);
+        }
+        else
+        {
+            using internal::NeuropodTensorRawDataAccess;
+            std::memcpy(NeuropodTensorRawDataAccess::get_untyped_data_ptr(*copy),
+                        NeuropodTensorRawDataAccess::get_untyped_data_ptr(tensor),
+                        tensor.get_num_elements() * NeuropodTensorRawDataAccess::get_bytes_per_element(tensor));
+        }
+
+        out[item.first] = std::move(copy);
+    }
+
+    return out;
+}
+
+NeuropodValueMap read_value_map(std::istream &in, NeuropodTensorAllocator &allocator)
+{
+    ValueMapStreamReader reader(*in.rdbuf(), allocator);
+    return reader.read_all();
+}
+
+void write_value_map(std::ostream &out, const NeuropodValueMap &values)
+{
+    ValueMapStreamWriter writer(*out.rdbuf());
+    writer.write(values);
+    writer.finish();
+}
+
+} // namespace
+
+std::vector<RecordedRequest> read_recording(const std::string &path, NeuropodTensorAllocator &allocator)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        NEUROPOD_ERROR("Failed to open recording '{}'", path);
+    }
+
+    std::vector<RecordedRequest> out;
+    while (in.peek() != std::ifstream::traits_type::eof())
+    {
+        const auto metadata = read_value_map(in, allocator);
+
+        RecordedRequest request;
+        request.inputs        = read_value_map(in, allocator);
+        request.start_time_ns = static_cast<uint64_t>(get_scalar(metadata, START_TIME_KEY));
+        request.latency_ns    = static_cast<uint64_t>(get_scalar(metadata, LATENCY_KEY));
+        request.has_outputs   = get_scalar(metadata, HAS_OUTPUTS_KEY) != 0;
+
+        const auto requested_outputs = metadata.find(REQUESTED_OUTPUTS_KEY);
+        if (requested_outputs != metadata.end())
+        {
+            request.requested_outputs = requested_outputs->second->as_typed_tensor<std::string>()->get_data_as_vector();
+        }
+
+        if (request.has_outputs)
+        {
+            request.outputs = read_value_map(in, allocator);
+        }
+
+        out.emplace_back(std::move(request));
+    }
+
+    return out;
+}
+
+namespace detail
+{
+
+RequestRecorder::RequestRecorder(const RuntimeOptions::RecordingOptions &options)
+    : options_(options), out_(options.path, std::ios::binary | std::ios::app)
+{
+    if (options_.sample_rate < 0 || options_.sample_rate > 1)
+    {
+        NEUROPOD_ERROR("The recording sample rate must be between 0 and 1. Got {}", options_.sample_rate);
+    }
+
+    if (!out_)
+    {
+        NEUROPOD_ERROR("Failed to open '{}' to record requests", options_.path);
+    }
+
+    if (options_.max_queued_requests == 0)
+    {
+        NEUROPOD_ERROR("The maximum number of queued recording requests must be at least 1");
+    }
+
+    // Records are appended, but we need the position of the end of the file in case a record has to be removed
+    out_.seekp(0, std::ios::end);
+
+    writer_ = std::thread(&RequestRecorder::writer_loop, this);
+
+    SPDLOG_INFO("Recording {}% of requests to '{}'", options_.sample_rate * 100, options_.path);
+}
+
+RequestRecorder::~RequestRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+
+    cv_.notify_all();
+    writer_.join();
+
+    if (num_dropped_ > 0)
+    {
+        SPDLOG_WARN("Dropped {} requests while recording to '{}' because the queue was full (max_queued_requests: {})",
+                    num_dropped_,
+                    options_.path,
+                    options_.max_queued_requests);
+    }
+}
+
+void RequestRecorder::writer_loop()
+{
+    while (true)
+    {
+        Record record;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&] { return shutdown_ || !queue_.empty(); });
+
+            // Write any queued records before shutting down
+            if (queue_.empty())
+            {
+                return;
+            }
+
+            record = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        const auto record_start = out_.tellp();
+        try
+        {
+            write_value_map(out_, record.metadata);
+            write_value_map(out_, record.inputs);
+            if (options_.record_outputs)
+            {
+                write_value_map(out_, record.outputs);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            SPDLOG_ERROR("Failed to write a recorded request to '{}': {}", options_.path, e.what());
+
+            // Remove the partially written record so the rest of the recording can still be read
+            out_.clear();
+            out_.flush();
+            if (record_start < 0 || ::truncate(options_.path.c_str(), record_start) != 0)
+            {
+                SPDLOG_ERROR("Failed to remove a partially written record from '{}'", options_.path);
+            }
+
+            out_.seekp(record_start);
+        }
+    }
+}
+
+std::shared_ptr<RequestRecorder> RequestRecorder::get(const RuntimeOptions::RecordingOptions &options)
+{
+    static std::mutex                                                      registry_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<RequestRecorder>> registry;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto &                      entry    = registry[options.path];
+    auto                        recorder = entry.lock();
+    if (!recorder)
+    {
+        recorder = std::make_shared<RequestRecorder>(options);
+        entry    = recorder;
+        return recorder;
+    }
+
+    const auto &existing = recorder->options_;
+    if (existing.sample_rate != options.sample_rate || existing.record_outputs != options.record_outputs ||
+        existing.max_requests != options.max_requests || existing.max_queued_requests != options.max_queued_requests)
+    {
+        NEUROPOD_ERROR("Requests are already being recorded to '{}' with different recording options", options.path);
+    }
+
+    return recorder;
+}
+
+bool RequestRecorder::should_record()
+{
+    if (options_.max_requests != 0 && num_recorded_ >= options_.max_requests)
+    {
+        return false;
+    }
+
+    // Record request `n` if it crosses an integer boundary of `n * sample_rate`. This records exactly
+    // the requested fraction of requests, spread evenly over time
+    const auto n = num_requests_++;
+    return static_cast<uint64_t>((n + 1) * options_.sample_rate) > static_cast<uint64_t>(n * options_.sample_rate);
+}
+
+bool RequestRecorder::reserve_slot()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Check the limit again in case other threads recorded requests since `should_record`
+    if (options_.max_requests != 0 && num_recorded_ >= options_.max_requests)
+    {
+        return false;
+    }
+
+    if (queue_.size() + num_reserved_ >= options_.max_queued_requests)
+    {
+        if (num_dropped_++ == 0)
+        {
+            SPDLOG_WARN("The recording queue for '{}' is full. Dropping sampled requests until it has room",
+                        options_.path);
+        }
+
+        return false;
+    }
+
+    num_recorded_++;
+    num_reserved_++;
+    return true;
+}
+
+std::unique_ptr<NeuropodValueMap> RequestRecorder::record(
+    const NeuropodValueMap &                                  inputs,
+    const std::vector<std::string> &                          requested_outputs,
+    const std::function<std::unique_ptr<NeuropodValueMap>()> &run_inference)
+{
+    const auto start_ns = get_steady_clock_ns();
+    auto       outputs  = run_inference();
+    const auto end_ns   = get_steady_clock_ns();
+
+    if (!reserve_slot())
+    {
+        return outputs;
+    }
+
+    Record record;
+    try
+    {
+        static const auto allocator = get_generic_tensor_allocator();
+
+        record.metadata[START_TIME_KEY]  = allocator->full<int64_t>({1}, static_cast<int64_t>(start_ns));
+        record.metadata[LATENCY_KEY]     = allocator->full<int64_t>({1}, static_cast<int64_t>(end_ns - start_ns));
+        record.metadata[HAS_OUTPUTS_KEY] = allocator->full<int64_t>({1}, options_.record_outputs ? 1 : 0);
+
+        auto requested = allocator->allocate_tensor<std::string>({static_cast<int64_t>(requested_outputs.size())});
+        requested->copy_from(requested_outputs);
+        record.metadata[REQUESTED_OUTPUTS_KEY] = requested;
+
+        // Serialization and file IO happen on the writer thread. We only copy the tensors here
+        record.inputs = copy_values(inputs, *allocator);
+        if (options_.record_outputs)
+        {
+            record.outputs = copy_values(*outputs, *allocator);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        SPDLOG_ERROR("Failed to record a request: {}", e.what());
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_reserved_--;
+        return outputs;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_reserved_--;
+        queue_.emplace_back(std::move(record));
+    }
+
+    cv_.notify_one();
+    return outputs;
+}
+
+} // namespace detail
+
+} // namespace neuropod
@@ -0,0 +1,139 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "neuropod/backends/neuropod_backend.hh"
+#include "neuropod/options.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace neuropod
+{
+
+// Neuropod can record a sample of its requests to a file (see `RuntimeOptions::recording_options`). This includes
+// requests made with `infer`, `infer_into` and `infer_async`.
+// Recordings can be replayed with the `neuropod_replay` tool to reproduce latency issues offline.
+//
+// A recording is a sequence of records, one per recorded request. Each record is a NeuropodValueMap of
+// metadata (the requested outputs and timing), the inputs and (if outputs are recorded) the outputs. These are
+// each written with a `ValueMapStreamWriter`.
+//
+// Records are written by a background thread so inference threads only copy the tensors of sampled requests.
+// If records are being produced faster than they can be written, requests are dropped instead of blocking inference
+// (see `RecordingOptions::max_queued_requests`).
+//
+// Note: records are appended to the file if it already exists. All the Neuropods in a process that record to the same
+// path (e.g. the instances in a `NeuropodPool`) share one recorder so sampling and `max_requests` apply to all of
+// their requests together
+
+// A request read from a recording
+struct RecordedRequest
+{
+    NeuropodValueMap         inputs;
+    std::vector<std::string> requested_outputs;
+
+    // The outputs of the request (only set if outputs were recorded)
+    bool             has_outputs = false;
+    NeuropodValueMap outputs;
+
+    // When the request started (in steady clock nanoseconds) and how long it took in the recording process
+    uint64_t start_time_ns = 0;
+    uint64_t latency_ns    = 0;
+};
+
+// Read all the requests in a recording
+std::vector<RecordedRequest> read_recording(const std::string &path, NeuropodTensorAllocator &allocator);
+
+namespace detail
+{
+
+// Samples requests and appends them to a recording
+// Note: this is threadsafe
+class RequestRecorder
+{
+private:
+    const RuntimeOptions::RecordingOptions options_;
+
+    // A record waiting to be written
+    struct Record
+    {
+        NeuropodValueMap metadata;
+        NeuropodValueMap inputs;
+        NeuropodValueMap outputs;
+    };
+
+    // Used for sampling
+    std::atomic<uint64_t> num_requests_{0};
+
+    // The number of requests that have been (or are being) added to the queue
+    // Note: this is only modified while holding `mutex_`
+    std::atomic<uint64_t> num_recorded_{0};
+
+    // The following are protected by `mutex_`
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    std::deque<Record>      queue_;
+    bool                    shutdown_ = false;
+
+    // The number of queue slots reserved by requests that are copying their tensors
+    size_t num_reserved_ = 0;
+
+    // The number of sampled requests that were dropped because the queue was full
+    uint64_t num_dropped_ = 0;
+
+    // Only used by the writer thread
+    std::ofstream out_;
+    std::thread   writer_;
+
+    // Reserve a slot in the queue for a sampled request. Returns false if the request shouldn't be recorded
+    bool reserve_slot();
+
+    // Write queued records to the file until the recorder is destroyed
+    void writer_loop();
+
+public:
+    explicit RequestRecorder(const RuntimeOptions::RecordingOptions &options);
+
+    // Writes any queued records before returning
+    ~RequestRecorder();
+
+    // Get the recorder for `options.path`, creating it if there isn't one in this process
+    // Throws an error if the path is already being recorded to with different options
+    static std::shared_ptr<RequestRecorder> get(const RuntimeOptions::RecordingOptions &options);
+
+    // Whether or not the next request should be recorded
+    bool should_record();
+
+    // Run `run_inference` and queue the request along with its timing (and outputs if enabled) to be recorded
+    // Errors while recording the request are logged and don't affect the request
+    std::unique_ptr<NeuropodValueMap> record(const NeuropodValueMap &                                 inputs,
+                                             const std::vector<std::string> &                         requested_outputs,
+                                             const std::function<std::unique_ptr<NeuropodValueMap>()> &run_inference);
+};
+
+} // namespace detail
+
+} // namespace neuropod
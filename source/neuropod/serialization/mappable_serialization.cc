@@ -0,0 +1,495 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/serialization/mappable_serialization.hh"
+
+#include "neuropod/backends/tensor_allocator.hh"
+#include "neuropod/internal/error_utils.hh"
+#include "neuropod/internal/neuropod_tensor.hh"
+#include "neuropod/internal/neuropod_tensor_raw_data_access.hh"
+#include "neuropod/internal/type_macros.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace neuropod
+{
+
+namespace
+{
+
+// This should be incremented on any breaking changes
+constexpr uint32_t MAPPABLE_SERIALIZATION_VERSION = 1;
+
+// The first bytes of every serialized buffer
+constexpr char MAPPABLE_MAGIC[4] = {'N', 'P', 'M', 'S'};
+
+// The alignment of the data of each tensor
+constexpr size_t DATA_ALIGNMENT = 64;
+
+struct Header
+{
+    char     magic[4];
+    uint32_t version;
+    uint64_t num_tensors;
+    uint64_t total_size;
+};
+
+// The directory (one entry per tensor) immediately follows the header
+// Offsets are from the start of the buffer
+struct DirectoryEntry
+{
+    uint64_t name_offset;
+    uint64_t name_size;
+    uint64_t dims_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+    int32_t  tensor_type;
+    uint32_t num_dims;
+};
+
+static_assert(sizeof(Header) == 24, "Unexpected padding in Header");
+static_assert(sizeof(DirectoryEntry) == 48, "Unexpected padding in DirectoryEntry");
+
+size_t align_up(size_t offset)
+{
+    return (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+}
+
+size_t get_bytes_per_element(TensorType tensor_type)
+{
+#define GET_BYTES_PER_ELEMENT(CPP_TYPE, NEUROPOD_TYPE) \
+    case NEUROPOD_TYPE:                                \
+        return sizeof(CPP_TYPE);
+
+    switch (tensor_type)
+    {
+        FOR_EACH_TYPE_MAPPING_EXCEPT_STRING(GET_BYTES_PER_ELEMENT)
+    default:
+        NEUROPOD_ERROR("Invalid serialized data: unsupported tensor type {}", tensor_type);
+    }
+
+#undef GET_BYTES_PER_ELEMENT
+}
+
+// Where each tensor goes in the serialized buffer
+struct Layout
+{
+    struct Item
+    {
+        const std::string *   name;
+        const NeuropodTensor *tensor;
+        DirectoryEntry        entry;
+
+        // The contents of string tensors
+        std::vector<std::string> strings;
+    };
+
+    std::vector<Item> items;
+    size_t            total_size = 0;
+};
+
+Layout get_layout(const NeuropodValueMap &item)
+{
+    Layout layout;
+    layout.items.reserve(item.size());
+    for (const auto &pair : item)
+    {
+        Layout::Item current{};
+        current.name              = &pair.first;
+        current.tensor            = pair.second->as_tensor();
+        current.entry.name_size   = pair.first.size();
+        current.entry.tensor_type = static_cast<int32_t>(current.tensor->get_tensor_type());
+        current.entry.num_dims    = static_cast<uint32_t>(current.tensor->get_dims().size());
+
+        if (current.tensor->get_tensor_type() == STRING_TENSOR)
+        {
+            // The lengths of all the strings followed by their contents
+            current.strings         = current.tensor->as_typed_tensor<std::string>()->get_data_as_vector();
+            current.entry.data_size = current.strings.size() * sizeof(uint64_t);
+            for (const auto &str : current.strings)
+            {
+                current.entry.data_size += str.size();
+            }
+        }
+        else
+        {
+            current.entry.data_size = current.tensor->get_num_elements() *
+                                      internal::NeuropodTensorRawDataAccess::get_bytes_per_element(*current.tensor);
+        }
+
+        layout.items.emplace_back(std::move(current));
+    }
+
+    // The directory is followed by the dims of every tensor and then their names
+    size_t offset = sizeof(Header) + layout.items.size() * sizeof(DirectoryEntry);
+    for (auto &current : layout.items)
+    {
+        current.entry.dims_offset = offset;
+        offset += current.entry.num_dims * sizeof(int64_t);
+    }
+
+    for (auto &current : layout.items)
+    {
+        current.entry.name_offset = offset;
+        offset += current.entry.name_size;
+    }
+
+    // Then the data of every tensor at aligned offsets
+    for (auto &current : layout.items)
+    {
+        offset                    = align_up(offset);
+        current.entry.data_offset = offset;
+        offset += current.entry.data_size;
+    }
+
+    layout.total_size = offset;
+    return layout;
+}
+
+// Writes to an output in order of increasing offset and zero fills any gaps
+template <typename WriteFn>
+class SequentialWriter
+{
+private:
+    WriteFn write_;
+    size_t  pos_ = 0;
+
+public:
+    explicit SequentialWriter(WriteFn write) : write_(std::move(write)) {}
+
+    void write(size_t offset, const void *data, size_t size)
+    {
+        static const char zeros[DATA_ALIGNMENT] = {0};
+        while (pos_ < offset)
+        {
+            const auto num_zeros = std::min(offset - pos_, DATA_ALIGNMENT);
+            write_(zeros, num_zeros);
+            pos_ += num_zeros;
+        }
+
+        write_(data, size);
+        pos_ += size;
+    }
+};
+
+// Write a serialized buffer by calling `write_fn(data, size)` for each consecutive part of it
+template <typename WriteFn>
+void write_layout(const Layout &layout, WriteFn write_fn)
+{
+    SequentialWriter<WriteFn> writer(std::move(write_fn));
+
+    Header header{};
+    std::memcpy(header.magic, MAPPABLE_MAGIC, sizeof(header.magic));
+    header.version     = MAPPABLE_SERIALIZATION_VERSION;
+    header.num_tensors = layout.items.size();
+    header.total_size  = layout.total_size;
+    writer.write(0, &header, sizeof(header));
+
+    size_t offset = sizeof(header);
+    for (const auto &current : layout.items)
+    {
+        writer.write(offset, &current.entry, sizeof(current.entry));
+        offset += sizeof(current.entry);
+    }
+
+    for (const auto &current : layout.items)
+    {
+        writer.write(current.entry.dims_offset,
+                     current.tensor->get_dims().data(),
+                     current.entry.num_dims * sizeof(int64_t));
+    }
+
+    for (const auto &current : layout.items)
+    {
+        writer.write(current.entry.name_offset, current.name->data(), current.entry.name_size);
+    }
+
+    for (const auto &current : layout.items)
+    {
+        if (current.tensor->get_tensor_type() == STRING_TENSOR)
+        {
+            std::vector<uint64_t> lengths;
+            lengths.reserve(current.strings.size());
+            for (const auto &str : current.strings)
+            {
+                lengths.emplace_back(str.size());
+            }
+
+            offset = current.entry.data_offset;
+            writer.write(offset, lengths.data(), lengths.size() * sizeof(uint64_t));
+            offset += lengths.size() * sizeof(uint64_t);
+            for (const auto &str : current.strings)
+            {
+                writer.write(offset, str.data(), str.size());
+                offset += str.size();
+            }
+        }
+        else
+        {
+            writer.write(current.entry.data_offset,
+                         internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*current.tensor),
+                         current.entry.data_size);
+        }
+    }
+
+    // Pad to the full size (e.g. if the last tensor is empty)
+    writer.write(layout.total_size, nullptr, 0);
+}
+
+// Get the number of elements in a tensor with shape `dims`
+uint64_t get_num_elements(const std::vector<int64_t> &dims)
+{
+    uint64_t num_elements = 1;
+    for (const auto dim : dims)
+    {
+        if (dim < 0)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: got a negative dimension {}", dim);
+        }
+
+        const auto udim = static_cast<uint64_t>(dim);
+        if (udim != 0 && num_elements > std::numeric_limits<uint64_t>::max() / udim)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: the number of elements in a tensor overflowed");
+        }
+
+        num_elements *= udim;
+    }
+
+    return num_elements;
+}
+
+std::shared_ptr<NeuropodTensor> read_string_tensor(const std::vector<int64_t> &dims,
+                                                   const uint8_t *             data,
+                                                   uint64_t                    size,
+                                                   NeuropodTensorAllocator &   allocator)
+{
+    const auto num_elements = get_num_elements(dims);
+    if (num_elements > size / sizeof(uint64_t))
+    {
+        NEUROPOD_ERROR("Invalid serialized data: string tensor data is too small");
+    }
+
+    std::vector<std::string> strings(num_elements);
+    uint64_t                 offset = num_elements * sizeof(uint64_t);
+    for (uint64_t i = 0; i < num_elements; i++)
+    {
+        uint64_t length;
+        std::memcpy(&length, data + i * sizeof(uint64_t), sizeof(length));
+        if (length > size - offset)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: string tensor data is too small");
+        }
+
+        strings[i].assign(reinterpret_cast<const char *>(data + offset), length);
+        offset += length;
+    }
+
+    std::shared_ptr<NeuropodTensor> out = allocator.allocate_tensor(dims, STRING_TENSOR);
+    out->as_typed_tensor<std::string>()->copy_from(strings);
+    return out;
+}
+
+} // namespace
+
+MappableBuffer serialize_mappable(const NeuropodValueMap &item)
+{
+    const auto layout = get_layout(item);
+
+    // `aligned_alloc` requires the size to be a nonzero multiple of the alignment
+    auto data = static_cast<uint8_t *>(aligned_alloc(DATA_ALIGNMENT, align_up(layout.total_size)));
+    if (data == nullptr)
+    {
+        NEUROPOD_ERROR("Failed to allocate {} bytes for serialization", layout.total_size);
+    }
+
+    MappableBuffer out;
+    out.data = std::shared_ptr<void>(data, [](void *ptr) { free(ptr); });
+    out.size = layout.total_size;
+
+    auto pos = data;
+    write_layout(layout, [&pos](const void *src, size_t size) {
+        if (size > 0)
+        {
+            std::memcpy(pos, src, size);
+            pos += size;
+        }
+    });
+
+    return out;
+}
+
+void serialize_mappable(std::ostream &out, const NeuropodValueMap &item)
+{
+    write_layout(get_layout(item), [&out](const void *src, size_t size) {
+        out.write(static_cast<const char *>(src), static_cast<std::streamsize>(size));
+    });
+
+    if (!out)
+    {
+        NEUROPOD_ERROR("Failed to write serialized data to stream");
+    }
+}
+
+NeuropodValueMap deserialize_mappable(const MappableBuffer &buffer, NeuropodTensorAllocator &allocator)
+{
+    const auto data = static_cast<uint8_t *>(buffer.data.get());
+    const auto size = buffer.size;
+
+    // Make sure a range is inside the buffer
+    const auto check_range = [size](uint64_t offset, uint64_t length) {
+        if (offset > size || length > size - offset)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: a range of {} bytes at offset {} is outside of a buffer of "
+                           "size {}",
+                           length,
+                           offset,
+                           size);
+        }
+    };
+
+    Header header;
+    check_range(0, sizeof(header));
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAPPABLE_MAGIC, sizeof(header.magic)) != 0)
+    {
+        NEUROPOD_ERROR("Invalid serialized data: the buffer was not created by `serialize_mappable`");
+    }
+
+    if (header.version != MAPPABLE_SERIALIZATION_VERSION)
+    {
+        NEUROPOD_ERROR("This serialized data was created with a different version of Neuropod serialization code."
+                       "Expected version {} but got {}",
+                       MAPPABLE_SERIALIZATION_VERSION,
+                       header.version);
+    }
+
+    check_range(0, header.total_size);
+    if (header.num_tensors > (size - sizeof(Header)) / sizeof(DirectoryEntry))
+    {
+        NEUROPOD_ERROR("Invalid serialized data: the directory is larger than the buffer");
+    }
+
+    // Tensors can only wrap the buffer if their data is aligned
+    const bool can_wrap = reinterpret_cast<uintptr_t>(data) % DATA_ALIGNMENT == 0;
+
+    NeuropodValueMap out;
+    for (uint64_t i = 0; i < header.num_tensors; i++)
+    {
+        DirectoryEntry entry;
+        std::memcpy(&entry, data + sizeof(Header) + i * sizeof(DirectoryEntry), sizeof(entry));
+        check_range(entry.name_offset, entry.name_size);
+        check_range(entry.dims_offset, uint64_t{entry.num_dims} * sizeof(int64_t));
+        check_range(entry.data_offset, entry.data_size);
+
+        std::string          name(reinterpret_cast<const char *>(data + entry.name_offset), entry.name_size);
+        std::vector<int64_t> dims(entry.num_dims);
+        std::memcpy(dims.data(), data + entry.dims_offset, dims.size() * sizeof(int64_t));
+
+        const auto tensor_type = static_cast<TensorType>(entry.tensor_type);
+        const auto payload     = data + entry.data_offset;
+
+        std::shared_ptr<NeuropodTensor> tensor;
+        if (tensor_type == STRING_TENSOR)
+        {
+            tensor = read_string_tensor(dims, payload, entry.data_size, allocator);
+        }
+        else
+        {
+            const auto num_elements = get_num_elements(dims);
+            const auto elem_size    = get_bytes_per_element(tensor_type);
+            if (num_elements > std::numeric_limits<uint64_t>::max() / elem_size ||
+                num_elements * elem_size != entry.data_size)
+            {
+                NEUROPOD_ERROR("Invalid serialized data: tensor '{}' has {} bytes of data, but its shape and type "
+                               "require a different size",
+                               name,
+                               entry.data_size);
+            }
+
+            if (can_wrap && entry.data_offset % DATA_ALIGNMENT == 0)
+            {
+                // Wrap the buffer directly. The deleter keeps it alive until the tensor is freed
+                auto owner = buffer.data;
+                tensor     = allocator.tensor_from_memory(dims, tensor_type, payload, [owner](void * /*unused*/) {});
+            }
+            else
+            {
+                tensor = allocator.allocate_tensor(dims, tensor_type);
+                std::memcpy(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*tensor),
+                            payload,
+                            entry.data_size);
+            }
+        }
+
+        if (!out.emplace(std::move(name), std::move(tensor)).second)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: got a duplicate tensor name");
+        }
+    }
+
+    return out;
+}
+
+NeuropodValueMap deserialize_mappable_file(const std::string &path, NeuropodTensorAllocator &allocator)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        NEUROPOD_ERROR("Failed to open '{}': {}", path, strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        const auto err = errno;
+        close(fd);
+        NEUROPOD_ERROR("Failed to stat '{}': {}", path, strerror(err));
+    }
+
+    const auto size = static_cast<size_t>(st.st_size);
+    if (size == 0)
+    {
+        close(fd);
+        NEUROPOD_ERROR("Failed to load '{}': the file is empty", path);
+    }
+
+    // Map the file privately so tensors can be written to without modifying the file
+    void *     addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    const auto err  = errno;
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        NEUROPOD_ERROR("Failed to mmap '{}': {}", path, strerror(err));
+    }
+
+    MappableBuffer buffer;
+    buffer.data = std::shared_ptr<void>(addr, [size](void *ptr) { munmap(ptr, size); });
+    buffer.size = size;
+    return deserialize_mappable(buffer, allocator);
+}
+
+} // namespace neuropod
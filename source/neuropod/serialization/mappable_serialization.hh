@@ -0,0 +1,67 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+namespace neuropod
+{
+
+// Forward declarations
+class NeuropodValue;
+class NeuropodTensorAllocator;
+
+// A map from a tensor name to a pointer to a NeuropodValue
+using NeuropodValueMap = std::unordered_map<std::string, std::shared_ptr<NeuropodValue>>;
+
+// A serialization format for a NeuropodValueMap of tensors that can be deserialized without copying.
+//
+// The format is a fixed size header, a directory with an entry for each tensor, the dims and names of the
+// tensors and then the data of each tensor. The data of every tensor starts at a 64 byte aligned offset so
+// if the serialized buffer (or mmapped file) is aligned, deserialized tensors can wrap it directly instead of
+// being allocated and copied.
+//
+// Note: string tensors are supported, but they are always copied when deserializing
+// Note: the format uses the byte order of the machine that wrote it
+
+// A buffer containing a serialized NeuropodValueMap
+struct MappableBuffer
+{
+    std::shared_ptr<void> data;
+    size_t                size = 0;
+};
+
+// Serialize to a new 64 byte aligned buffer
+MappableBuffer serialize_mappable(const NeuropodValueMap &item);
+
+// Serialize to a stream (e.g. a file that can be mmapped with `deserialize_mappable_file`)
+void serialize_mappable(std::ostream &out, const NeuropodValueMap &item);
+
+// Deserialize from a buffer. If `buffer.data` is 64 byte aligned, the returned tensors point into it (and keep
+// it alive). Otherwise, they are copied into tensors allocated by `allocator`
+// Note: writing to the returned tensors may modify `buffer`
+NeuropodValueMap deserialize_mappable(const MappableBuffer &buffer, NeuropodTensorAllocator &allocator);
+
+// mmap a file written by `serialize_mappable` and deserialize from it without copying. The file is mapped
+// privately so writes to the returned tensors don't modify the file. It is unmapped once all the returned
+// tensors are freed.
+NeuropodValueMap deserialize_mappable_file(const std::string &path, NeuropodTensorAllocator &allocator);
+
+} // namespace neuropod
@@ -0,0 +1,637 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/serialization/stream_serialization.hh"
+
+#include "neuropod/backends/tensor_allocator.hh"
+#include "neuropod/internal/error_utils.hh"
+#include "neuropod/internal/logging.hh"
+#include "neuropod/internal/memory_utils.hh"
+#include "neuropod/internal/neuropod_tensor.hh"
+#include "neuropod/internal/neuropod_tensor_raw_data_access.hh"
+#include "neuropod/internal/type_macros.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <unistd.h>
+
+namespace neuropod
+{
+
+namespace
+{
+
+// This should be incremented on any breaking changes
+constexpr uint32_t STREAM_SERIALIZATION_VERSION = 1;
+
+// The first bytes of every stream
+constexpr char STREAM_MAGIC[4] = {'N', 'P', 'S', 'S'};
+
+// Limits on the record header. The stream doesn't have a known size so these bound what a corrupt header can
+// make us allocate before the data is read
+constexpr uint64_t MAX_NAME_SIZE = 1 << 16;
+constexpr uint32_t MAX_NUM_DIMS  = 64;
+
+// Each item is preceded by a record type
+enum RecordType : uint8_t
+{
+    END_RECORD    = 0,
+    TENSOR_RECORD = 1,
+};
+
+// A streambuf that writes to a file descriptor through a fixed size buffer
+class FdOutputStreambuf : public std::streambuf
+{
+private:
+    int               fd_;
+    std::vector<char> buffer_;
+
+    void write_all(const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            const auto written = ::write(fd_, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                NEUROPOD_ERROR("Failed to write to fd {}: {}", fd_, strerror(errno));
+            }
+
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    void flush_buffer()
+    {
+        write_all(pbase(), static_cast<size_t>(pptr() - pbase()));
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        flush_buffer();
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char *data, std::streamsize count) override
+    {
+        const auto size = static_cast<size_t>(count);
+        if (size > static_cast<size_t>(epptr() - pptr()))
+        {
+            flush_buffer();
+        }
+
+        if (size >= buffer_.size())
+        {
+            // Large writes skip the buffer
+            write_all(data, size);
+        }
+        else
+        {
+            std::memcpy(pptr(), data, size);
+            pbump(static_cast<int>(size));
+        }
+
+        return count;
+    }
+
+    int sync() override
+    {
+        flush_buffer();
+        return 0;
+    }
+
+public:
+    FdOutputStreambuf(int fd, size_t buffer_size) : fd_(fd), buffer_(std::max<size_t>(buffer_size, 1))
+    {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+};
+
+// A streambuf that reads from a file descriptor through a fixed size buffer
+class FdInputStreambuf : public std::streambuf
+{
+private:
+    int               fd_;
+    std::vector<char> buffer_;
+
+    // Read up to `size` bytes. Returns 0 at the end of the file
+    size_t read_some(char *data, size_t size)
+    {
+        while (true)
+        {
+            const auto num_read = ::read(fd_, data, size);
+            if (num_read >= 0)
+            {
+                return static_cast<size_t>(num_read);
+            }
+
+            if (errno != EINTR)
+            {
+                NEUROPOD_ERROR("Failed to read from fd {}: {}", fd_, strerror(errno));
+            }
+        }
+    }
+
+protected:
+    int_type underflow() override
+    {
+        const auto num_read = read_some(buffer_.data(), buffer_.size());
+        setg(buffer_.data(), buffer_.data(), buffer_.data() + num_read);
+        if (num_read == 0)
+        {
+            return traits_type::eof();
+        }
+
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::streamsize xsgetn(char *data, std::streamsize count) override
+    {
+        auto size = static_cast<size_t>(count);
+
+        // Use anything that's already buffered
+        const auto buffered = std::min(size, static_cast<size_t>(egptr() - gptr()));
+        std::memcpy(data, gptr(), buffered);
+        gbump(static_cast<int>(buffered));
+        data += buffered;
+        size -= buffered;
+
+        while (size > 0)
+        {
+            size_t num_read;
+            if (size >= buffer_.size())
+            {
+                // Large reads skip the buffer
+                num_read = read_some(data, size);
+            }
+            else
+            {
+                if (traits_type::eq_int_type(underflow(), traits_type::eof()))
+                {
+                    break;
+                }
+
+                num_read = std::min(size, static_cast<size_t>(egptr() - gptr()));
+                std::memcpy(data, gptr(), num_read);
+                gbump(static_cast<int>(num_read));
+            }
+
+            if (num_read == 0)
+            {
+                break;
+            }
+
+            data += num_read;
+            size -= num_read;
+        }
+
+        return count - static_cast<std::streamsize>(size);
+    }
+
+public:
+    FdInputStreambuf(int fd, size_t buffer_size) : fd_(fd), buffer_(std::max<size_t>(buffer_size, 1))
+    {
+        setg(buffer_.data(), buffer_.data(), buffer_.data());
+    }
+};
+
+bool is_valid_tensor_type(int32_t tensor_type)
+{
+#define IS_VALID_TENSOR_TYPE(CPP_TYPE, NEUROPOD_TYPE) \
+    case NEUROPOD_TYPE:                               \
+        return true;
+
+    switch (tensor_type)
+    {
+        FOR_EACH_TYPE_MAPPING_INCLUDING_STRING(IS_VALID_TENSOR_TYPE)
+    default:
+        return false;
+    }
+
+#undef IS_VALID_TENSOR_TYPE
+}
+
+size_t get_bytes_per_element(TensorType tensor_type)
+{
+#define GET_BYTES_PER_ELEMENT(CPP_TYPE, NEUROPOD_TYPE) \
+    case NEUROPOD_TYPE:                                \
+        return sizeof(CPP_TYPE);
+
+    switch (tensor_type)
+    {
+        FOR_EACH_TYPE_MAPPING_EXCEPT_STRING(GET_BYTES_PER_ELEMENT)
+    default:
+        NEUROPOD_ERROR("Invalid serialized data: unsupported tensor type {}", tensor_type);
+    }
+
+#undef GET_BYTES_PER_ELEMENT
+}
+
+// Get the number of elements in a tensor with shape `dims`
+uint64_t get_num_elements(const std::string &name, const std::vector<int64_t> &dims)
+{
+    uint64_t num_elements = 1;
+    for (const auto dim : dims)
+    {
+        if (dim < 0)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: tensor '{}' has a negative dimension {}", name, dim);
+        }
+
+        const auto udim = static_cast<uint64_t>(dim);
+        if (udim != 0 && num_elements > std::numeric_limits<uint64_t>::max() / udim)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: the number of elements in tensor '{}' overflowed", name);
+        }
+
+        num_elements *= udim;
+    }
+
+    return num_elements;
+}
+
+// The size of the data of a tensor in the stream
+uint64_t get_data_size(const NeuropodTensor &tensor)
+{
+    if (tensor.get_tensor_type() != STRING_TENSOR)
+    {
+        return tensor.get_num_elements() * internal::NeuropodTensorRawDataAccess::get_bytes_per_element(tensor);
+    }
+
+    // The length of each string followed by its contents
+    // Note: `flat` doesn't support empty tensors
+    const auto num_elem = tensor.get_num_elements();
+    if (num_elem == 0)
+    {
+        return 0;
+    }
+
+    const auto flat = tensor.as_typed_tensor<std::string>()->flat();
+    uint64_t   out  = 0;
+    for (size_t i = 0; i < num_elem; i++)
+    {
+        out += sizeof(uint64_t) + static_cast<std::string>(flat[i]).size();
+    }
+
+    return out;
+}
+
+} // namespace
+
+ValueMapStreamWriter::ValueMapStreamWriter(std::streambuf &out, size_t chunk_size)
+    : out_(out), chunk_size_(std::max<size_t>(chunk_size, 1))
+{
+    write_header();
+}
+
+ValueMapStreamWriter::ValueMapStreamWriter(int fd, size_t chunk_size)
+    : owned_buf_(stdx::make_unique<FdOutputStreambuf>(fd, chunk_size)),
+      out_(*owned_buf_),
+      chunk_size_(std::max<size_t>(chunk_size, 1))
+{
+    write_header();
+}
+
+ValueMapStreamWriter::~ValueMapStreamWriter()
+{
+    if (!finished_)
+    {
+        // Make sure everything that was written reaches the underlying stream
+        try
+        {
+            out_.pubsync();
+        }
+        catch (const std::exception &e)
+        {
+            SPDLOG_ERROR("Failed to flush a ValueMapStreamWriter: {}", e.what());
+        }
+    }
+}
+
+void ValueMapStreamWriter::write_bytes(const void *data, size_t size)
+{
+    const auto bytes = static_cast<const char *>(data);
+    for (size_t offset = 0; offset < size; offset += chunk_size_)
+    {
+        const auto count = static_cast<std::streamsize>(std::min(chunk_size_, size - offset));
+        if (out_.sputn(bytes + offset, count) != count)
+        {
+            NEUROPOD_ERROR("Failed to write serialized data to stream");
+        }
+    }
+}
+
+void ValueMapStreamWriter::write_header()
+{
+    write_bytes(STREAM_MAGIC, sizeof(STREAM_MAGIC));
+    write_bytes(&STREAM_SERIALIZATION_VERSION, sizeof(STREAM_SERIALIZATION_VERSION));
+}
+
+void ValueMapStreamWriter::write(const std::string &name, const NeuropodValue &value)
+{
+    if (finished_)
+    {
+        NEUROPOD_ERROR("Tried to write to a ValueMapStreamWriter after calling `finish`");
+    }
+
+    const auto &tensor = *value.as_tensor();
+    const auto &dims   = tensor.get_dims();
+
+    // Keep everything we write readable by `ValueMapStreamReader`
+    if (name.size() > MAX_NAME_SIZE)
+    {
+        NEUROPOD_ERROR("Can't serialize tensor '{}': names can be at most {} bytes", name, MAX_NAME_SIZE);
+    }
+
+    if (dims.size() > MAX_NUM_DIMS)
+    {
+        NEUROPOD_ERROR("Can't serialize tensor '{}': tensors can have at most {} dimensions", name, MAX_NUM_DIMS);
+    }
+
+    // The record header
+    const uint8_t  record_type = TENSOR_RECORD;
+    const uint64_t name_size   = name.size();
+    const int32_t  tensor_type = tensor.get_tensor_type();
+    const uint32_t num_dims    = static_cast<uint32_t>(dims.size());
+    const uint64_t data_size   = get_data_size(tensor);
+    write_bytes(&record_type, sizeof(record_type));
+    write_bytes(&name_size, sizeof(name_size));
+    write_bytes(name.data(), name.size());
+    write_bytes(&tensor_type, sizeof(tensor_type));
+    write_bytes(&num_dims, sizeof(num_dims));
+    write_bytes(dims.data(), dims.size() * sizeof(int64_t));
+    write_bytes(&data_size, sizeof(data_size));
+
+    // The data
+    if (tensor.get_tensor_type() == STRING_TENSOR)
+    {
+        const auto num_elem = tensor.get_num_elements();
+        if (num_elem == 0)
+        {
+            return;
+        }
+
+        const auto flat = tensor.as_typed_tensor<std::string>()->flat();
+        for (size_t i = 0; i < num_elem; i++)
+        {
+            const auto     item   = static_cast<std::string>(flat[i]);
+            const uint64_t length = item.size();
+            write_bytes(&length, sizeof(length));
+            write_bytes(item.data(), item.size());
+        }
+    }
+    else
+    {
+        write_bytes(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(tensor), data_size);
+    }
+}
+
+void ValueMapStreamWriter::write(const NeuropodValueMap &items)
+{
+    for (const auto &item : items)
+    {
+        write(item.first, *item.second);
+    }
+}
+
+void ValueMapStreamWriter::finish()
+{
+    if (finished_)
+    {
+        return;
+    }
+
+    const uint8_t record_type = END_RECORD;
+    write_bytes(&record_type, sizeof(record_type));
+    finished_ = true;
+
+    if (out_.pubsync() != 0)
+    {
+        NEUROPOD_ERROR("Failed to flush serialized data to stream");
+    }
+}
+
+ValueMapStreamReader::ValueMapStreamReader(std::streambuf &in, NeuropodTensorAllocator &allocator, size_t chunk_size)
+    : in_(in), allocator_(allocator), chunk_size_(std::max<size_t>(chunk_size, 1))
+{
+    read_header();
+}
+
+ValueMapStreamReader::ValueMapStreamReader(int fd, NeuropodTensorAllocator &allocator, size_t chunk_size)
+    : owned_buf_(stdx::make_unique<FdInputStreambuf>(fd, chunk_size)),
+      in_(*owned_buf_),
+      allocator_(allocator),
+      chunk_size_(std::max<size_t>(chunk_size, 1))
+{
+    read_header();
+}
+
+ValueMapStreamReader::~ValueMapStreamReader() = default;
+
+void ValueMapStreamReader::read_bytes(void *data, size_t size)
+{
+    const auto bytes = static_cast<char *>(data);
+    for (size_t offset = 0; offset < size; offset += chunk_size_)
+    {
+        const auto count = static_cast<std::streamsize>(std::min(chunk_size_, size - offset));
+        if (in_.sgetn(bytes + offset, count) != count)
+        {
+            NEUROPOD_ERROR("Unexpected end of stream while reading serialized data");
+        }
+    }
+}
+
+void ValueMapStreamReader::read_header()
+{
+    char     magic[sizeof(STREAM_MAGIC)];
+    uint32_t version;
+    read_bytes(magic, sizeof(magic));
+    if (std::memcmp(magic, STREAM_MAGIC, sizeof(magic)) != 0)
+    {
+        NEUROPOD_ERROR("Invalid serialized data: the stream was not created by a ValueMapStreamWriter");
+    }
+
+    read_bytes(&version, sizeof(version));
+    if (version != STREAM_SERIALIZATION_VERSION)
+    {
+        NEUROPOD_ERROR("This serialized data was created with a different version of Neuropod serialization code."
+                       "Expected version {} but got {}",
+                       STREAM_SERIALIZATION_VERSION,
+                       version);
+    }
+}
+
+bool ValueMapStreamReader::read_next(std::string &name, std::shared_ptr<NeuropodValue> &value)
+{
+    if (done_)
+    {
+        return false;
+    }
+
+    uint8_t record_type;
+    read_bytes(&record_type, sizeof(record_type));
+    if (record_type == END_RECORD)
+    {
+        done_ = true;
+        return false;
+    }
+
+    if (record_type != TENSOR_RECORD)
+    {
+        NEUROPOD_ERROR("Invalid serialized data: unknown record type {}", record_type);
+    }
+
+    // The record header
+    uint64_t name_size;
+    int32_t  tensor_type;
+    uint32_t num_dims;
+    uint64_t data_size;
+
+    read_bytes(&name_size, sizeof(name_size));
+    if (name_size > MAX_NAME_SIZE)
+    {
+        NEUROPOD_ERROR("Invalid serialized data: a tensor name of {} bytes is larger than the limit of {}",
+                       name_size,
+                       MAX_NAME_SIZE);
+    }
+
+    std::string item_name;
+    item_name.resize(name_size);
+    read_bytes(&item_name[0], name_size);
+
+    read_bytes(&tensor_type, sizeof(tensor_type));
+    if (!is_valid_tensor_type(tensor_type))
+    {
+        NEUROPOD_ERROR("Invalid serialized data: tensor '{}' has an unknown tensor type {}", item_name, tensor_type);
+    }
+
+    read_bytes(&num_dims, sizeof(num_dims));
+    if (num_dims > MAX_NUM_DIMS)
+    {
+        NEUROPOD_ERROR("Invalid serialized data: tensor '{}' has {} dimensions, but the limit is {}",
+                       item_name,
+                       num_dims,
+                       MAX_NUM_DIMS);
+    }
+
+    std::vector<int64_t> dims(num_dims);
+    read_bytes(dims.data(), dims.size() * sizeof(int64_t));
+    read_bytes(&data_size, sizeof(data_size));
+
+    // Make sure the header is consistent before allocating anything
+    const auto type         = static_cast<TensorType>(tensor_type);
+    const auto num_elements = get_num_elements(item_name, dims);
+    if (type == STRING_TENSOR)
+    {
+        // Every string is preceded by its length
+        if (num_elements > data_size / sizeof(uint64_t))
+        {
+            NEUROPOD_ERROR("Invalid serialized data: string tensor '{}' is larger than its data", item_name);
+        }
+    }
+    else
+    {
+        const auto elem_size = get_bytes_per_element(type);
+        if (num_elements > std::numeric_limits<uint64_t>::max() / elem_size || num_elements * elem_size != data_size)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: tensor '{}' has {} bytes of data, but its shape needs {} "
+                           "elements of {} bytes",
+                           item_name,
+                           data_size,
+                           num_elements,
+                           elem_size);
+        }
+    }
+
+    // The data
+    std::shared_ptr<NeuropodTensor> tensor = allocator_.allocate_tensor(dims, type);
+    if (type == STRING_TENSOR)
+    {
+        uint64_t remaining = data_size;
+
+        // Note: `flat` doesn't support empty tensors
+        if (num_elements > 0)
+        {
+            auto flat = tensor->as_typed_tensor<std::string>()->flat();
+            for (uint64_t i = 0; i < num_elements; i++)
+            {
+                uint64_t length;
+                if (remaining < sizeof(length))
+                {
+                    NEUROPOD_ERROR("Invalid serialized data: string tensor '{}' is larger than its data", item_name);
+                }
+
+                read_bytes(&length, sizeof(length));
+                remaining -= sizeof(length);
+                if (remaining < length)
+                {
+                    NEUROPOD_ERROR("Invalid serialized data: string tensor '{}' is larger than its data", item_name);
+                }
+
+                std::string item;
+                item.resize(length);
+                read_bytes(&item[0], length);
+                remaining -= length;
+                flat[i] = item;
+            }
+        }
+
+        if (remaining != 0)
+        {
+            NEUROPOD_ERROR("Invalid serialized data: string tensor '{}' is smaller than its data", item_name);
+        }
+    }
+    else
+    {
+        read_bytes(internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*tensor), data_size);
+    }
+
+    name  = std::move(item_name);
+    value = std::move(tensor);
+    return true;
+}
+
+NeuropodValueMap ValueMapStreamReader::read_all()
+{
+    NeuropodValueMap               out;
+    std::string                    name;
+    std::shared_ptr<NeuropodValue> value;
+    while (read_next(name, value))
+    {
+        out[name] = std::move(value);
+    }
+
+    return out;
+}
+
+} // namespace neuropod
@@ -0,0 +1,112 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+
+namespace neuropod
+{
+
+// Forward declarations
+class NeuropodValue;
+class NeuropodTensorAllocator;
+
+// A map from a tensor name to a pointer to a NeuropodValue
+using NeuropodValueMap = std::unordered_map<std::string, std::shared_ptr<NeuropodValue>>;
+
+// The default size of the chunks that tensor data is written and read in
+constexpr size_t DEFAULT_STREAM_CHUNK_SIZE = 1 << 20;
+
+// Writes a NeuropodValueMap to a stream one tensor at a time.
+//
+// Unlike `serialize`, nothing is buffered beyond a single chunk so memory use stays constant no matter how
+// large the map is. Tensor data is written directly from the tensor in chunks of at most `chunk_size` bytes.
+// String tensors are written one element at a time.
+//
+// `finish` must be called after the last item is written
+class ValueMapStreamWriter
+{
+private:
+    // Set if this writer owns the streambuf (e.g. when writing to a file descriptor)
+    std::unique_ptr<std::streambuf> owned_buf_;
+
+    std::streambuf &out_;
+    size_t          chunk_size_;
+    bool            finished_ = false;
+
+    void write_bytes(const void *data, size_t size);
+    void write_header();
+
+public:
+    explicit ValueMapStreamWriter(std::streambuf &out, size_t chunk_size = DEFAULT_STREAM_CHUNK_SIZE);
+
+    // Write to a file descriptor through a buffer of `chunk_size` bytes
+    // Note: `fd` is not closed by the writer
+    explicit ValueMapStreamWriter(int fd, size_t chunk_size = DEFAULT_STREAM_CHUNK_SIZE);
+
+    ~ValueMapStreamWriter();
+
+    // Write a single item. `value` must be a tensor
+    void write(const std::string &name, const NeuropodValue &value);
+
+    // Write all the items in a map
+    void write(const NeuropodValueMap &items);
+
+    // Mark the end of the map and flush the stream
+    void finish();
+};
+
+// Reads a NeuropodValueMap written by `ValueMapStreamWriter` one tensor at a time.
+//
+// Tensor data is read directly into tensors from `allocator` in chunks of at most `chunk_size` bytes so
+// items can be processed (and freed) before the rest of the map is read.
+class ValueMapStreamReader
+{
+private:
+    // Set if this reader owns the streambuf (e.g. when reading from a file descriptor)
+    std::unique_ptr<std::streambuf> owned_buf_;
+
+    std::streambuf &         in_;
+    NeuropodTensorAllocator &allocator_;
+    size_t                   chunk_size_;
+    bool                     done_ = false;
+
+    void read_bytes(void *data, size_t size);
+    void read_header();
+
+public:
+    ValueMapStreamReader(std::streambuf &         in,
+                         NeuropodTensorAllocator &allocator,
+                         size_t                   chunk_size = DEFAULT_STREAM_CHUNK_SIZE);
+
+    // Read from a file descriptor through a buffer of `chunk_size` bytes
+    // Note: `fd` is not closed by the reader
+    ValueMapStreamReader(int fd, NeuropodTensorAllocator &allocator, size_t chunk_size = DEFAULT_STREAM_CHUNK_SIZE);
+
+    ~ValueMapStreamReader();
+
+    // Read the next item. Returns false (and doesn't modify `name` or `value`) once the end of the map is reached
+    bool read_next(std::string &name, std::shared_ptr<NeuropodValue> &value);
+
+    // Read all the remaining items
+    NeuropodValueMap read_all();
+};
+
+} // namespace neuropod
@@ -0,0 +1,173 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/core/generic_tensor.hh"
+#include "neuropod/internal/neuropod_tensor_raw_data_access.hh"
+#include "neuropod/serialization/mappable_serialization.hh"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+
+neuropod::NeuropodValueMap get_test_map(neuropod::NeuropodTensorAllocator &allocator)
+{
+    neuropod::NeuropodValueMap out;
+
+    auto floats = allocator.allocate_tensor<float>({2, 3});
+    floats->copy_from({1, 2, 3, 4, 5, 6});
+    out["floats"] = floats;
+
+    auto bytes = allocator.allocate_tensor<uint8_t>({5});
+    bytes->copy_from({1, 2, 3, 4, 5});
+    out["bytes"] = bytes;
+
+    auto strings = allocator.allocate_tensor<std::string>({2, 2});
+    strings->copy_from({"apple", "", "banana", "carrot"});
+    out["strings"] = strings;
+
+    out["scalar"] = allocator.full<int64_t>({}, 42);
+    out["empty"]  = allocator.allocate_tensor<double>({0, 4});
+
+    return out;
+}
+
+void expect_equal(const neuropod::NeuropodValueMap &expected, const neuropod::NeuropodValueMap &actual)
+{
+    ASSERT_EQ(expected.size(), actual.size());
+    for (const auto &item : expected)
+    {
+        EXPECT_EQ(*item.second->as_tensor(), *actual.at(item.first)->as_tensor()) << item.first;
+    }
+}
+
+const void *get_data_ptr(const neuropod::NeuropodValueMap &map, const std::string &name)
+{
+    return neuropod::internal::NeuropodTensorRawDataAccess::get_untyped_data_ptr(*map.at(name)->as_tensor());
+}
+
+} // namespace
+
+TEST(test_mappable_serialization, buffer_roundtrip)
+{
+    auto       allocator = neuropod::get_generic_tensor_allocator();
+    const auto expected  = get_test_map(*allocator);
+
+    const auto buffer = neuropod::serialize_mappable(expected);
+    const auto actual = neuropod::deserialize_mappable(buffer, *allocator);
+    expect_equal(expected, actual);
+
+    // Numeric tensors wrap the buffer at aligned offsets
+    const auto start = static_cast<const uint8_t *>(buffer.data.get());
+    const auto data  = static_cast<const uint8_t *>(get_data_ptr(actual, "floats"));
+    EXPECT_GE(data, start);
+    EXPECT_LT(data, start + buffer.size);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % 64, 0);
+}
+
+TEST(test_mappable_serialization, tensors_keep_buffer_alive)
+{
+    auto allocator = neuropod::get_generic_tensor_allocator();
+
+    std::shared_ptr<neuropod::NeuropodValue> floats;
+    std::weak_ptr<void>                      weak_buffer;
+    {
+        auto buffer = neuropod::serialize_mappable(get_test_map(*allocator));
+        weak_buffer = buffer.data;
+        floats      = neuropod::deserialize_mappable(buffer, *allocator).at("floats");
+    }
+
+    EXPECT_FALSE(weak_buffer.expired());
+    EXPECT_EQ(floats->as_typed_tensor<float>()->get_data_as_vector(), (std::vector<float>{1, 2, 3, 4, 5, 6}));
+
+    floats.reset();
+    EXPECT_TRUE(weak_buffer.expired());
+}
+
+TEST(test_mappable_serialization, unaligned_buffer)
+{
+    auto       allocator = neuropod::get_generic_tensor_allocator();
+    const auto expected  = get_test_map(*allocator);
+    const auto buffer    = neuropod::serialize_mappable(expected);
+
+    // Copy the data to an unaligned address
+    std::shared_ptr<uint8_t> storage(new uint8_t[buffer.size + 1], std::default_delete<uint8_t[]>());
+    std::memcpy(storage.get() + 1, buffer.data.get(), buffer.size);
+
+    neuropod::MappableBuffer unaligned;
+    unaligned.data = std::shared_ptr<void>(storage, storage.get() + 1);
+    unaligned.size = buffer.size;
+
+    // The tensors are copied instead of wrapping the buffer
+    const auto actual = neuropod::deserialize_mappable(unaligned, *allocator);
+    expect_equal(expected, actual);
+
+    const auto data = static_cast<const uint8_t *>(get_data_ptr(actual, "floats"));
+    EXPECT_TRUE(data < storage.get() || data >= storage.get() + buffer.size + 1);
+}
+
+TEST(test_mappable_serialization, file_roundtrip)
+{
+    auto       allocator = neuropod::get_generic_tensor_allocator();
+    const auto expected  = get_test_map(*allocator);
+
+    const std::string path = "/tmp/neuropod_test_mappable_serialization_" + std::to_string(getpid()) + ".bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        neuropod::serialize_mappable(file, expected);
+    }
+
+    // The stream and buffer formats are identical
+    std::ifstream file(path, std::ios::binary);
+    std::string   contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const auto    buffer = neuropod::serialize_mappable(expected);
+    ASSERT_EQ(contents.size(), buffer.size);
+
+    auto actual = neuropod::deserialize_mappable_file(path, *allocator);
+    std::remove(path.c_str());
+    expect_equal(expected, actual);
+
+    // Writing to a tensor doesn't modify the file
+    actual.at("bytes")->as_typed_tensor<uint8_t>()->copy_from({9, 9, 9, 9, 9});
+    EXPECT_EQ(actual.at("bytes")->as_typed_tensor<uint8_t>()->get_data_as_vector(),
+              (std::vector<uint8_t>{9, 9, 9, 9, 9}));
+}
+
+TEST(test_mappable_serialization, invalid_data)
+{
+    auto       allocator = neuropod::get_generic_tensor_allocator();
+    const auto buffer    = neuropod::serialize_mappable(get_test_map(*allocator));
+
+    // Truncated
+    neuropod::MappableBuffer truncated = buffer;
+    truncated.size                     = buffer.size - 1;
+    EXPECT_THROW(neuropod::deserialize_mappable(truncated, *allocator), std::runtime_error);
+
+    truncated.size = 8;
+    EXPECT_THROW(neuropod::deserialize_mappable(truncated, *allocator), std::runtime_error);
+
+    // Bad magic
+    const auto copy = neuropod::serialize_mappable(get_test_map(*allocator));
+
+    static_cast<char *>(copy.data.get())[0] = 'X';
+    EXPECT_THROW(neuropod::deserialize_mappable(copy, *allocator), std::runtime_error);
+
+    // Missing file
+    EXPECT_THROW(neuropod::deserialize_mappable_file("/tmp/this/file/does/not/exist", *allocator), std::runtime_error);
+}
@@ -0,0 +1,279 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/core/generic_tensor.hh"
+#include "neuropod/serialization/stream_serialization.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+
+neuropod::NeuropodValueMap get_test_map(neuropod::NeuropodTensorAllocator &allocator)
+{
+    neuropod::NeuropodValueMap out;
+
+    auto floats = allocator.allocate_tensor<float>({100, 3});
+    for (int i = 0; i < 300; i++)
+    {
+        floats->get_raw_data_ptr()[i] = static_cast<float>(i);
+    }
+
+    out["floats"] = floats;
+
+    auto strings = allocator.allocate_tensor<std::string>({2, 2});
+    strings->copy_from({"apple", "", "banana", std::string(1000, 'x')});
+    out["strings"] = strings;
+
+    out["scalar"]        = allocator.full<int64_t>({}, 42);
+    out["empty"]         = allocator.allocate_tensor<double>({0, 4});
+    out["empty_strings"] = allocator.allocate_tensor<std::string>({0});
+
+    return out;
+}
+
+void expect_equal(const neuropod::NeuropodValueMap &expected, const neuropod::NeuropodValueMap &actual)
+{
+    ASSERT_EQ(expected.size(), actual.size());
+    for (const auto &item : expected)
+    {
+        EXPECT_EQ(*item.second->as_tensor(), *actual.at(item.first)->as_tensor()) << item.first;
+    }
+}
+
+// A stringbuf that records the size of the largest write to it
+class RecordingStringbuf : public std::stringbuf
+{
+public:
+    std::streamsize max_write_size = 0;
+
+protected:
+    std::streamsize xsputn(const char *data, std::streamsize count) override
+    {
+        max_write_size = std::max(max_write_size, count);
+        return std::stringbuf::xsputn(data, count);
+    }
+};
+
+} // namespace
+
+TEST(test_stream_serialization, streambuf_roundtrip)
+{
+    auto       allocator = neuropod::get_generic_tensor_allocator();
+    const auto expected  = get_test_map(*allocator);
+
+    std::stringbuf buffer;
+    {
+        neuropod::ValueMapStreamWriter writer(buffer);
+        writer.write(expected);
+        writer.finish();
+    }
+
+    neuropod::ValueMapStreamReader reader(buffer, *allocator);
+    expect_equal(expected, reader.read_all());
+
+    // Reading after the end doesn't return any more items
+    std::string                              name;
+    std::shared_ptr<neuropod::NeuropodValue> value;
+    EXPECT_FALSE(reader.read_next(name, value));
+}
+
+TEST(test_stream_serialization, bounded_chunks)
+{
+    auto       allocator = neuropod::get_generic_tensor_allocator();
+    const auto expected  = get_test_map(*allocator);
+
+    // Tensor data is written in chunks of at most `chunk_size` bytes
+    RecordingStringbuf buffer;
+    {
+        neuropod::ValueMapStreamWriter writer(buffer, 64);
+        writer.write(expected);
+        writer.finish();
+    }
+
+    EXPECT_LE(buffer.max_write_size, 64);
+
+    neuropod::ValueMapStreamReader reader(buffer, *allocator, 64);
+    expect_equal(expected, reader.read_all());
+}
+
+TEST(test_stream_serialization, one_item_at_a_time)
+{
+    auto       allocator = neuropod::get_generic_tensor_allocator();
+    const auto expected  = get_test_map(*allocator);
+
+    std::stringbuf buffer;
+    {
+        neuropod::ValueMapStreamWriter writer(buffer);
+        writer.write("scalar", *expected.at("scalar"));
+        writer.write("strings", *expected.at("strings"));
+        writer.finish();
+    }
+
+    neuropod::ValueMapStreamReader           reader(buffer, *allocator);
+    std::string                              name;
+    std::shared_ptr<neuropod::NeuropodValue> value;
+
+    ASSERT_TRUE(reader.read_next(name, value));
+    EXPECT_EQ(name, "scalar");
+    EXPECT_EQ(*value->as_tensor(), *expected.at("scalar")->as_tensor());
+
+    ASSERT_TRUE(reader.read_next(name, value));
+    EXPECT_EQ(name, "strings");
+    EXPECT_EQ(*value->as_tensor(), *expected.at("strings")->as_tensor());
+
+    EXPECT_FALSE(reader.read_next(name, value));
+}
+
+TEST(test_stream_serialization, fd_roundtrip)
+{
+    auto       allocator = neuropod::get_generic_tensor_allocator();
+    const auto expected  = get_test_map(*allocator);
+
+    const std::string path = "/tmp/neuropod_test_stream_serialization_" + std::to_string(getpid()) + ".bin";
+
+    // Use a small buffer so both buffered and direct reads and writes are used
+    const int out_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    ASSERT_GE(out_fd, 0);
+    {
+        neuropod::ValueMapStreamWriter writer(out_fd, 100);
+        writer.write(expected);
+        writer.finish();
+    }
+
+    close(out_fd);
+
+    const int in_fd = open(path.c_str(), O_RDONLY);
+    ASSERT_GE(in_fd, 0);
+    {
+        neuropod::ValueMapStreamReader reader(in_fd, *allocator, 100);
+        expect_equal(expected, reader.read_all());
+    }
+
+    close(in_fd);
+    std::remove(path.c_str());
+}
+
+TEST(test_stream_serialization, invalid_data)
+{
+    auto allocator = neuropod::get_generic_tensor_allocator();
+
+    // Not a stream written by ValueMapStreamWriter
+    std::stringbuf bogus("bogus data");
+    EXPECT_THROW(neuropod::ValueMapStreamReader(bogus, *allocator), std::runtime_error);
+
+    // Missing the end of the map
+    std::stringbuf buffer;
+    {
+        neuropod::ValueMapStreamWriter writer(buffer);
+        writer.write(get_test_map(*allocator));
+    }
+
+    auto truncated = buffer.str();
+    truncated.resize(truncated.size() - 10);
+    std::stringbuf truncated_buffer(truncated);
+
+    neuropod::ValueMapStreamReader reader(truncated_buffer, *allocator);
+    EXPECT_THROW(reader.read_all(), std::runtime_error);
+
+    // Writing after finishing is an error
+    std::stringbuf                 other;
+    neuropod::ValueMapStreamWriter writer(other);
+    writer.finish();
+    EXPECT_THROW(writer.write(get_test_map(*allocator)), std::runtime_error);
+}
+
+namespace
+{
+
+// Write a stream with one tensor record with the specified header (and no data)
+std::string make_stream(uint64_t                    name_size,
+                        int32_t                     tensor_type,
+                        uint32_t                    num_dims,
+                        const std::vector<int64_t> &dims,
+                        uint64_t                    data_size)
+{
+    std::string out;
+    const auto  append = [&out](const void *data, size_t size) {
+        out.append(static_cast<const char *>(data), size);
+    };
+
+    const uint32_t version     = 1;
+    const uint8_t  record_type = 1;
+    append("NPSS", 4);
+    append(&version, sizeof(version));
+    append(&record_type, sizeof(record_type));
+    append(&name_size, sizeof(name_size));
+    out.append(std::min<uint64_t>(name_size, 16), 'x');
+    append(&tensor_type, sizeof(tensor_type));
+    append(&num_dims, sizeof(num_dims));
+    append(dims.data(), dims.size() * sizeof(int64_t));
+    append(&data_size, sizeof(data_size));
+    return out;
+}
+
+void expect_invalid(const std::string &data)
+{
+    auto                           allocator = neuropod::get_generic_tensor_allocator();
+    std::stringbuf                 buffer(data);
+    neuropod::ValueMapStreamReader reader(buffer, *allocator);
+    EXPECT_THROW(reader.read_all(), std::runtime_error);
+}
+
+} // namespace
+
+TEST(test_stream_serialization, invalid_header)
+{
+    // A valid header followed by its data and the end of the map
+    {
+        auto allocator = neuropod::get_generic_tensor_allocator();
+        auto valid     = make_stream(4, neuropod::FLOAT_TENSOR, 2, {2, 3}, 24);
+        valid.append(25, '\0');
+
+        std::stringbuf                 buffer(valid);
+        neuropod::ValueMapStreamReader reader(buffer, *allocator);
+        EXPECT_EQ(reader.read_all().at("xxxx")->as_tensor()->get_num_elements(), 6);
+    }
+
+    // A huge name
+    expect_invalid(make_stream(uint64_t{1} << 62, neuropod::FLOAT_TENSOR, 1, {1}, 4));
+
+    // An unknown tensor type
+    expect_invalid(make_stream(4, 1000, 1, {1}, 4));
+    expect_invalid(make_stream(4, -1, 1, {1}, 4));
+
+    // Too many dimensions
+    expect_invalid(make_stream(4, neuropod::FLOAT_TENSOR, 0xffffffff, {}, 4));
+
+    // The number of elements (or bytes) overflows
+    expect_invalid(make_stream(4, neuropod::FLOAT_TENSOR, 2, {int64_t{1} << 40, int64_t{1} << 40}, 0));
+    expect_invalid(make_stream(4, neuropod::DOUBLE_TENSOR, 1, {int64_t{1} << 62}, 0));
+
+    // Huge shapes that don't match the size of the data
+    expect_invalid(make_stream(4, neuropod::FLOAT_TENSOR, 1, {int64_t{1} << 40}, 4));
+    expect_invalid(make_stream(4, neuropod::STRING_TENSOR, 1, {int64_t{1} << 40}, 16));
+
+    // The writer rejects tensors the reader can't read
+    auto                           allocator     = neuropod::get_generic_tensor_allocator();
+    std::stringbuf                 buffer;
+    neuropod::ValueMapStreamWriter writer(buffer);
+    auto                           too_many_dims = allocator->allocate_tensor<float>(std::vector<int64_t>(65, 1));
+    EXPECT_THROW(writer.write("x", *too_many_dims), std::runtime_error);
+}
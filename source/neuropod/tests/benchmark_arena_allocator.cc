@@ -0,0 +1,59 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Don't run infer on this file
+// NEUROPOD_CI_SKIP_INFER
+
+#include "benchmark/benchmark.h"
+#include "neuropod/core/arena_allocator.hh"
+#include "neuropod/core/generic_tensor.hh"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Simulates a preprocessing step that builds `num_tensors` small tensors for a request
+void allocate_request(benchmark::State &state, neuropod::NeuropodTensorAllocator &allocator)
+{
+    const auto num_tensors = state.range(0);
+    for (auto _ : state)
+    {
+        neuropod::NeuropodValueMap inputs;
+        for (int64_t i = 0; i < num_tensors; i++)
+        {
+            inputs["input_" + std::to_string(i)] = allocator.full<float>({16, 4}, i);
+        }
+
+        benchmark::DoNotOptimize(inputs);
+    }
+}
+
+} // namespace
+
+static void benchmark_generic_allocator(benchmark::State &state)
+{
+    auto allocator = neuropod::get_generic_tensor_allocator();
+    allocate_request(state, *allocator);
+}
+BENCHMARK(benchmark_generic_allocator)->Arg(8)->Arg(128);
+
+static void benchmark_arena_allocator(benchmark::State &state)
+{
+    neuropod::ArenaTensorAllocator allocator;
+    allocate_request(state, allocator);
+}
+BENCHMARK(benchmark_arena_allocator)->Arg(8)->Arg(128);
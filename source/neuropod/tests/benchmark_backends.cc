@@ -0,0 +1,268 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// A matrix of end to end inference benchmarks across backends, tensor sizes, dtypes, input counts,
+// thread counts and in-process vs out-of-process execution. This is tagged `manual` because it takes a
+// while to run. Use `build/benchmark.sh` to run it and compare the results against a baseline
+
+// Don't run infer on this file
+// NEUROPOD_CI_SKIP_INFER
+
+#include "benchmark/benchmark.h"
+#include "neuropod/neuropod_pool.hh"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+
+// The backends to benchmark and their test models
+struct BackendModels
+{
+    std::string name;
+    std::string addition_model;
+    std::string strings_model;
+};
+
+const std::vector<BackendModels> BACKENDS = {
+    {"tensorflow", "neuropod/tests/test_data/tf_addition_model/", "neuropod/tests/test_data/tf_strings_model/"},
+    {"torchscript",
+     "neuropod/tests/test_data/torchscript_addition_model/",
+     "neuropod/tests/test_data/torchscript_strings_model/"},
+    {"python", "neuropod/tests/test_data/pytorch_addition_model/", "neuropod/tests/test_data/pytorch_strings_model/"},
+};
+
+// The value of every string in string inputs
+const std::string STRING_DATA = "some string data";
+
+using InputGenerator = std::function<neuropod::NeuropodValueMap(neuropod::NeuropodTensorAllocator &)>;
+
+// Get a pool for a model that is shared by all the threads running a benchmark. The pool is unloaded once
+// all the threads release it
+std::shared_ptr<neuropod::NeuropodPool> get_pool(const std::string &path, bool use_ope, int num_threads)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<std::string, bool, int>, std::weak_ptr<neuropod::NeuropodPool>> pools;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto &cached = pools[std::make_tuple(path, use_ope, num_threads)];
+    auto  pool   = cached.lock();
+    if (!pool)
+    {
+        neuropod::RuntimeOptions opts;
+        opts.use_ope                 = use_ope;
+        opts.ope_options.num_workers = num_threads;
+
+        pool   = std::make_shared<neuropod::NeuropodPool>(path, num_threads, opts);
+        cached = pool;
+    }
+
+    return pool;
+}
+
+// Create inputs and run inference in every iteration. Creating inputs is included because it's part of every
+// request (and uses shared memory with OPE)
+void run_inference(benchmark::State &    state,
+                   const std::string &   path,
+                   bool                  use_ope,
+                   int                   num_threads,
+                   size_t                input_bytes,
+                   const InputGenerator &make_inputs)
+{
+    std::shared_ptr<neuropod::NeuropodPool>            pool;
+    std::shared_ptr<neuropod::NeuropodTensorAllocator> allocator;
+    try
+    {
+        pool      = get_pool(path, use_ope, num_threads);
+        allocator = pool->get_tensor_allocator();
+    }
+    catch (const std::exception &e)
+    {
+        // The loop below won't run (e.g. if a backend isn't installed)
+        state.SkipWithError(e.what());
+    }
+
+    for (auto _ : state)
+    {
+        const auto inputs  = make_inputs(*allocator);
+        const auto outputs = pool->infer(inputs);
+
+        // Make sure we don't optimize it out
+        benchmark::DoNotOptimize(outputs);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input_bytes));
+}
+
+// Two float32 inputs with `num_elements` elements each
+InputGenerator float_inputs(int64_t num_elements)
+{
+    return [num_elements](neuropod::NeuropodTensorAllocator &allocator) {
+        const std::vector<float> data(num_elements, 1);
+
+        neuropod::NeuropodValueMap inputs;
+        for (const auto &name : {"x", "y"})
+        {
+            auto tensor = allocator.allocate_tensor<float>({1, num_elements});
+            tensor->copy_from(data);
+            inputs[name] = tensor;
+        }
+
+        return inputs;
+    };
+}
+
+// Two string inputs with `num_elements` strings each
+InputGenerator string_inputs(int64_t num_elements)
+{
+    return [num_elements](neuropod::NeuropodTensorAllocator &allocator) {
+        const std::vector<std::string> data(num_elements, STRING_DATA);
+
+        neuropod::NeuropodValueMap inputs;
+        for (const auto &name : {"x", "y"})
+        {
+            auto tensor = allocator.allocate_tensor<std::string>({num_elements});
+            tensor->copy_from(data);
+            inputs[name] = tensor;
+        }
+
+        return inputs;
+    };
+}
+
+// A single large uint8 input (`dummy_object_detection`)
+InputGenerator image_inputs()
+{
+    return [](neuropod::NeuropodTensorAllocator &allocator) {
+        const std::vector<uint8_t> data(1200 * 1920 * 3, 0);
+
+        auto tensor = allocator.allocate_tensor<uint8_t>({1200, 1920, 3});
+        tensor->copy_from(data);
+
+        neuropod::NeuropodValueMap inputs;
+        inputs["image"] = tensor;
+        return inputs;
+    };
+}
+
+// 100 small float32 inputs (`dummy_small_input_model`)
+InputGenerator many_small_inputs()
+{
+    return [](neuropod::NeuropodTensorAllocator &allocator) {
+        const std::vector<float> data(10 * 5, 0);
+
+        neuropod::NeuropodValueMap inputs;
+        for (int i = 0; i < 100; i++)
+        {
+            auto tensor = allocator.allocate_tensor<float>({10, 5});
+            tensor->copy_from(data);
+            inputs["small_input" + std::to_string(i)] = tensor;
+        }
+
+        return inputs;
+    };
+}
+
+// Register a benchmark named `{name}/{in_process|ope}` (plus `/threads:N` if `num_threads` > 1)
+void register_inference(const std::string &name,
+                        const std::string &path,
+                        bool               use_ope,
+                        int                num_threads,
+                        size_t             input_bytes,
+                        InputGenerator     make_inputs)
+{
+    const auto full_name = name + (use_ope ? "/ope" : "/in_process");
+    auto       bm        = benchmark::RegisterBenchmark(full_name.c_str(), [=](benchmark::State &state) {
+        run_inference(state, path, use_ope, num_threads, input_bytes, make_inputs);
+    });
+
+    // OPE runs inference in another process and multithreaded benchmarks run concurrently so CPU time of the
+    // benchmark thread isn't meaningful
+    bm->UseRealTime();
+    if (num_threads > 1)
+    {
+        bm->Threads(num_threads);
+    }
+}
+
+bool register_benchmarks()
+{
+    for (const auto use_ope : {false, true})
+    {
+        for (const auto &backend : BACKENDS)
+        {
+            // Tensor sizes
+            for (const int64_t num_elements : {16, 4 * 1024, 1024 * 1024})
+            {
+                register_inference("float32/" + backend.name + "/elements:" + std::to_string(num_elements),
+                                   backend.addition_model,
+                                   use_ope,
+                                   1,
+                                   2 * num_elements * sizeof(float),
+                                   float_inputs(num_elements));
+            }
+
+            // Thread counts
+            for (const int num_threads : {2, 4, 8})
+            {
+                register_inference("float32/" + backend.name + "/elements:4096",
+                                   backend.addition_model,
+                                   use_ope,
+                                   num_threads,
+                                   2 * 4096 * sizeof(float),
+                                   float_inputs(4096));
+            }
+
+            // String tensors
+            for (const int64_t num_elements : {1, 64, 4 * 1024})
+            {
+                register_inference("string/" + backend.name + "/elements:" + std::to_string(num_elements),
+                                   backend.strings_model,
+                                   use_ope,
+                                   1,
+                                   2 * num_elements * STRING_DATA.size(),
+                                   string_inputs(num_elements));
+            }
+        }
+
+        // A large uint8 input and many small inputs. These models are only available for TensorFlow
+        register_inference("uint8/tensorflow/image",
+                           "neuropod/tests/test_data/dummy_object_detection/",
+                           use_ope,
+                           1,
+                           1200 * 1920 * 3,
+                           image_inputs());
+
+        register_inference("float32/tensorflow/inputs:100",
+                           "neuropod/tests/test_data/dummy_small_input_model/",
+                           use_ope,
+                           1,
+                           100 * 10 * 5 * sizeof(float),
+                           many_small_inputs());
+    }
+
+    return true;
+}
+
+const bool registered = register_benchmarks();
+
+} // namespace
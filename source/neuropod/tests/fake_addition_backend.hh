@@ -0,0 +1,199 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "neuropod/backends/neuropod_backend.hh"
+#include "neuropod/core/generic_tensor.hh"
+#include "neuropod/internal/error_utils.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace neuropod
+{
+
+// A backend for the test model (`tf_addition_model`) that computes `out = x + y` without TensorFlow.
+// Tests can configure it and inspect how it was called.
+//
+// To load it by path (e.g. from a `NeuropodPool` or an OPE worker), register it in the test with
+// `REGISTER_NEUROPOD_BACKEND(FakeAdditionBackend, "tensorflow", "1.15.0")`
+class FakeAdditionBackend : public NeuropodBackendWithDefaultAllocator<GenericNeuropodTensor>
+{
+public:
+    struct Config
+    {
+        // The value returned by `supports_concurrent_inference`
+        bool supports_concurrent_inference = false;
+
+        // How long each call to `infer` takes
+        std::chrono::milliseconds infer_delay{0};
+    };
+
+    // The config used by instances that aren't given one (e.g. ones loaded by path). Use `reset` to restore the
+    // defaults
+    static Config &config()
+    {
+        static Config instance;
+        return instance;
+    }
+
+    // The number of times a model was loaded by any instance
+    static std::atomic_int &num_loads()
+    {
+        static std::atomic_int instance{0};
+        return instance;
+    }
+
+    // The maximum number of requests that ran at the same time on any single instance
+    static std::atomic_int &max_concurrent_per_instance()
+    {
+        static std::atomic_int instance{0};
+        return instance;
+    }
+
+    // Restore the default config and clear the stats shared by all instances
+    static void reset()
+    {
+        config()                      = {};
+        num_loads()                   = 0;
+        max_concurrent_per_instance() = 0;
+    }
+
+    // Stats for this instance
+    std::atomic_int              num_infers{0};
+    std::atomic_int              num_allocator_infers{0};
+    std::atomic_int              max_in_flight{0};
+    std::atomic<std::thread::id> last_thread_id;
+
+    explicit FakeAdditionBackend(const Config &backend_config = config())
+        : FakeAdditionBackend("neuropod/tests/test_data/tf_addition_model/", {}, backend_config)
+    {
+    }
+
+    FakeAdditionBackend(const std::string &   neuropod_path,
+                        const RuntimeOptions &options,
+                        const Config &        backend_config = config())
+        : NeuropodBackendWithDefaultAllocator<GenericNeuropodTensor>(neuropod_path, options), config_(backend_config)
+    {
+        load_model();
+    }
+
+    bool supports_concurrent_inference() const override { return config_.supports_concurrent_inference; }
+
+    // The batch size (the first dimension of `x`) of every call to `infer`
+    std::vector<int64_t> get_batch_sizes()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return batch_sizes_;
+    }
+
+    // The sorted names of the inputs of the last call to `infer`
+    std::vector<std::string> get_last_input_names()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_input_names_;
+    }
+
+protected:
+    void load_model_internal() override { num_loads()++; }
+
+    std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &inputs) override
+    {
+        return add(inputs, *get_tensor_allocator());
+    }
+
+    // Writes the output into a tensor from `output_allocator`
+    std::unique_ptr<NeuropodValueMap> infer_internal(const NeuropodValueMap &        inputs,
+                                                     const std::vector<std::string> &requested_outputs,
+                                                     NeuropodTensorAllocator &       output_allocator) override
+    {
+        num_allocator_infers++;
+        return filter_outputs(add(inputs, output_allocator), requested_outputs);
+    }
+
+private:
+    const Config config_;
+
+    std::atomic_int in_flight_{0};
+
+    std::mutex               mutex_;
+    std::vector<int64_t>     batch_sizes_;
+    std::vector<std::string> last_input_names_;
+
+    static void update_max(std::atomic_int &max, int value)
+    {
+        int current = max;
+        while (value > current && !max.compare_exchange_weak(current, value))
+        {
+        }
+    }
+
+    std::unique_ptr<NeuropodValueMap> add(const NeuropodValueMap &inputs, NeuropodTensorAllocator &allocator)
+    {
+        num_infers++;
+        last_thread_id = std::this_thread::get_id();
+
+        const int concurrent = ++in_flight_;
+        update_max(max_in_flight, concurrent);
+        update_max(max_concurrent_per_instance(), concurrent);
+
+        std::this_thread::sleep_for(config_.infer_delay);
+        in_flight_--;
+
+        const auto x = inputs.at("x")->as_typed_tensor<float>();
+        const auto y = inputs.at("y")->as_typed_tensor<float>();
+        if (x->get_num_elements() == 0)
+        {
+            NEUROPOD_ERROR("Empty inputs");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch_sizes_.emplace_back(x->get_dims()[0]);
+
+            last_input_names_.clear();
+            for (const auto &item : inputs)
+            {
+                last_input_names_.emplace_back(item.first);
+            }
+
+            std::sort(last_input_names_.begin(), last_input_names_.end());
+        }
+
+        // Counts as "output conversion" for the latency stats
+        ScopedLatencyTimer timer(output_conversion_latency_);
+
+        auto       out      = allocator.allocate_tensor<float>(x->get_dims());
+        const auto x_data   = x->get_raw_data_ptr();
+        const auto y_data   = y->get_raw_data_ptr();
+        auto       out_data = out->get_raw_data_ptr();
+        for (size_t i = 0; i < out->get_num_elements(); i++)
+        {
+            out_data[i] = x_data[i] + y_data[i];
+        }
+
+        auto outputs      = stdx::make_unique<NeuropodValueMap>();
+        (*outputs)["out"] = out;
+        return outputs;
+    }
+};
+
+} // namespace neuropod
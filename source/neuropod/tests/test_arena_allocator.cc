@@ -0,0 +1,155 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/core/arena_allocator.hh"
+
+#include <thread>
+#include <vector>
+
+TEST(test_arena_allocator, alignment_and_contents)
+{
+    neuropod::ArenaTensorAllocator allocator;
+
+    // Odd sizes so the tensors wouldn't be aligned without padding
+    auto a = allocator.full<float>({3}, 1.5);
+    auto b = allocator.full<uint8_t>({5}, 7);
+    auto c = allocator.arange<int64_t>(10);
+
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a->get_raw_data_ptr()) % 64, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b->get_raw_data_ptr()) % 64, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(c->get_raw_data_ptr()) % 64, 0);
+
+    EXPECT_EQ(a->get_data_as_vector(), std::vector<float>(3, 1.5));
+    EXPECT_EQ(b->get_data_as_vector(), std::vector<uint8_t>(5, 7));
+    EXPECT_EQ(c->get_data_as_vector(), (std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+    // Tensors from the same request are contiguous
+    EXPECT_EQ(reinterpret_cast<uint8_t *>(b->get_raw_data_ptr()) - reinterpret_cast<uint8_t *>(a->get_raw_data_ptr()),
+              64);
+}
+
+TEST(test_arena_allocator, reset)
+{
+    neuropod::ArenaTensorAllocator allocator(1024);
+
+    void *first;
+    {
+        auto a = allocator.allocate_tensor<float>({16});
+        auto b = allocator.allocate_tensor<float>({16});
+        first  = a->get_raw_data_ptr();
+
+        // The arena isn't reset while any tensor is alive
+        a.reset();
+        auto c = allocator.allocate_tensor<float>({16});
+        EXPECT_NE(c->get_raw_data_ptr(), first);
+    }
+
+    // Once all the tensors are gone, the memory is reused
+    auto d = allocator.allocate_tensor<float>({16});
+    EXPECT_EQ(d->get_raw_data_ptr(), first);
+}
+
+TEST(test_arena_allocator, growth)
+{
+    neuropod::ArenaTensorAllocator allocator(1024);
+    EXPECT_EQ(allocator.get_num_chunks(), 1);
+
+    {
+        // More than the initial size
+        std::vector<std::shared_ptr<neuropod::NeuropodTensor>> tensors;
+        for (int i = 0; i < 8; i++)
+        {
+            tensors.emplace_back(allocator.ones<double>({64}));
+        }
+
+        // A tensor larger than any chunk
+        tensors.emplace_back(allocator.ones<double>({4096}));
+        EXPECT_GT(allocator.get_num_chunks(), 1);
+
+        for (const auto &tensor : tensors)
+        {
+            const auto typed = tensor->as_typed_tensor<double>();
+            EXPECT_EQ(typed->get_data_as_vector(), std::vector<double>(typed->get_num_elements(), 1));
+        }
+    }
+
+    // The chunks are coalesced on reset
+    const auto capacity = allocator.get_capacity_bytes();
+    EXPECT_EQ(allocator.get_num_chunks(), 1);
+    EXPECT_GE(capacity, 8 * 64 * sizeof(double) + 4096 * sizeof(double));
+
+    // So the same request fits in one chunk
+    std::vector<std::shared_ptr<neuropod::NeuropodTensor>> tensors;
+    for (int i = 0; i < 8; i++)
+    {
+        tensors.emplace_back(allocator.ones<double>({64}));
+    }
+
+    tensors.emplace_back(allocator.ones<double>({4096}));
+    EXPECT_EQ(allocator.get_num_chunks(), 1);
+    EXPECT_EQ(allocator.get_capacity_bytes(), capacity);
+}
+
+TEST(test_arena_allocator, outlives_allocator)
+{
+    std::shared_ptr<neuropod::NeuropodTensor> tensor;
+    {
+        neuropod::ArenaTensorAllocator allocator;
+        tensor = allocator.full<int32_t>({4}, 3);
+    }
+
+    EXPECT_EQ(tensor->as_typed_tensor<int32_t>()->get_data_as_vector(), std::vector<int32_t>(4, 3));
+}
+
+TEST(test_arena_allocator, strings_and_external_memory)
+{
+    neuropod::ArenaTensorAllocator allocator;
+
+    auto strings = allocator.allocate_tensor<std::string>({2});
+    strings->copy_from({"a", "b"});
+    EXPECT_EQ(strings->get_data_as_vector(), (std::vector<std::string>{"a", "b"}));
+
+    bool  deleted = false;
+    float data[]  = {1, 2, 3};
+    {
+        auto tensor = allocator.tensor_from_memory<float>({3}, data, [&](void *unused) { deleted = true; });
+        EXPECT_EQ(tensor->get_raw_data_ptr(), data);
+    }
+
+    EXPECT_TRUE(deleted);
+}
+
+TEST(test_arena_allocator, threads)
+{
+    neuropod::ArenaTensorAllocator allocator(256);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++)
+    {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < 100; j++)
+            {
+                auto tensor = allocator.full<int32_t>({j + 1}, i);
+                EXPECT_EQ(tensor->get_data_as_vector(), std::vector<int32_t>(j + 1, i));
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
@@ -0,0 +1,157 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/batching_neuropod.hh"
+#include "neuropod/tests/fake_addition_backend.hh"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// Run `num_threads` concurrent requests where request `i` is a (batch_size, 2) tensor filled with `i`
+void run_concurrent_requests(neuropod::BatchingNeuropod &neuropod, int num_threads, int64_t batch_size = 1)
+{
+    auto                     allocator = neuropod.get_tensor_allocator();
+    std::atomic_int          num_correct{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++)
+    {
+        threads.emplace_back([&, i]() {
+            neuropod::NeuropodValueMap inputs;
+            inputs["x"] = allocator->full<float>({batch_size, 2}, i);
+            inputs["y"] = allocator->full<float>({batch_size, 2}, 1);
+
+            const auto outputs  = neuropod.infer(inputs);
+            const auto out      = outputs->at("out")->as_typed_tensor<float>();
+            const auto expected = std::vector<float>(batch_size * 2, i + 1);
+            if (out->get_dims() == std::vector<int64_t>{batch_size, 2} && out->get_data_as_vector() == expected)
+            {
+                num_correct++;
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(num_threads, num_correct);
+}
+
+} // namespace
+
+TEST(test_batching_neuropod, combines_requests)
+{
+    auto backend  = std::make_shared<neuropod::FakeAdditionBackend>();
+    auto neuropod = std::make_shared<neuropod::Neuropod>("", backend);
+
+    // A long delay so all the requests end up in one batch
+    neuropod::BatchingOptions options;
+    options.max_batch_size     = 8;
+    options.max_queue_delay_us = 10 * 1000 * 1000;
+
+    {
+        neuropod::BatchingNeuropod batching_neuropod(neuropod, options);
+        run_concurrent_requests(batching_neuropod, 8);
+    }
+
+    EXPECT_EQ(backend->get_batch_sizes(), std::vector<int64_t>{8});
+}
+
+TEST(test_batching_neuropod, max_batch_size)
+{
+    auto backend  = std::make_shared<neuropod::FakeAdditionBackend>();
+    auto neuropod = std::make_shared<neuropod::Neuropod>("", backend);
+
+    neuropod::BatchingOptions options;
+    options.max_batch_size = 4;
+
+    {
+        neuropod::BatchingNeuropod batching_neuropod(neuropod, options);
+        run_concurrent_requests(batching_neuropod, 16, 2);
+    }
+
+    // No batch should be larger than the max batch size
+    int64_t total = 0;
+    for (const auto size : backend->get_batch_sizes())
+    {
+        EXPECT_LE(size, 4);
+        total += size;
+    }
+
+    EXPECT_EQ(total, 32);
+}
+
+TEST(test_batching_neuropod, incompatible_requests)
+{
+    auto backend   = std::make_shared<neuropod::FakeAdditionBackend>();
+    auto neuropod  = std::make_shared<neuropod::Neuropod>("", backend);
+    auto allocator = neuropod->get_tensor_allocator();
+
+    neuropod::BatchingOptions options;
+    options.max_queue_delay_us = 100 * 1000;
+
+    {
+        neuropod::BatchingNeuropod batching_neuropod(neuropod, options);
+
+        // Requests with different non-batch dimensions can't be batched together
+        std::vector<std::thread> threads;
+        for (int64_t width = 1; width <= 2; width++)
+        {
+            threads.emplace_back([&, width]() {
+                neuropod::NeuropodValueMap inputs;
+                inputs["x"] = allocator->ones<float>({1, width});
+                inputs["y"] = allocator->ones<float>({1, width});
+
+                const auto outputs = batching_neuropod.infer(inputs);
+                EXPECT_EQ(outputs->at("out")->as_typed_tensor<float>()->get_data_as_vector(),
+                          std::vector<float>(width, 2));
+            });
+        }
+
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    EXPECT_EQ(backend->get_batch_sizes(), (std::vector<int64_t>{1, 1}));
+}
+
+TEST(test_batching_neuropod, errors)
+{
+    auto backend   = std::make_shared<neuropod::FakeAdditionBackend>();
+    auto neuropod  = std::make_shared<neuropod::Neuropod>("", backend);
+    auto allocator = neuropod->get_tensor_allocator();
+
+    neuropod::BatchingNeuropod batching_neuropod(neuropod);
+
+    // Errors during inference are passed to the caller
+    neuropod::NeuropodValueMap empty_inputs;
+    empty_inputs["x"] = allocator->allocate_tensor<float>({0, 2});
+    empty_inputs["y"] = allocator->allocate_tensor<float>({0, 2});
+    EXPECT_THROW(batching_neuropod.infer(empty_inputs), std::runtime_error);
+
+    // Inputs must have the same batch size
+    neuropod::NeuropodValueMap mismatched_inputs;
+    mismatched_inputs["x"] = allocator->allocate_tensor<float>({1, 2});
+    mismatched_inputs["y"] = allocator->allocate_tensor<float>({2, 2});
+    EXPECT_THROW(batching_neuropod.infer(mismatched_inputs), std::runtime_error);
+}
@@ -0,0 +1,108 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/neuropod.hh"
+#include "neuropod/tests/fake_addition_backend.hh"
+
+TEST(test_indexed_value_map, layout)
+{
+    auto layout = std::make_shared<neuropod::ValueMapLayout>(std::vector<std::string>{"a", "b"});
+    EXPECT_EQ(layout->size(), 2);
+    EXPECT_EQ(layout->get_index("b"), 1);
+    EXPECT_EQ(layout->get_name(0), "a");
+    EXPECT_THROW(layout->get_index("c"), std::runtime_error);
+
+    // Names must be unique
+    EXPECT_THROW(neuropod::ValueMapLayout({"a", "a"}), std::runtime_error);
+
+    auto                      allocator = neuropod::get_generic_tensor_allocator();
+    neuropod::IndexedValueMap map(layout);
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_TRUE(map.to_map().empty());
+
+    map[1] = allocator->ones<float>({1});
+    EXPECT_EQ(map.at("b"), map[1]);
+
+    const auto converted = map.to_map();
+    EXPECT_EQ(converted.size(), 1);
+    EXPECT_EQ(converted.at("b"), map[1]);
+
+    map.clear();
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_EQ(map[1], nullptr);
+}
+
+TEST(test_indexed_value_map, infer)
+{
+    auto               backend = std::make_shared<neuropod::FakeAdditionBackend>();
+    neuropod::Neuropod neuropod("", backend);
+    auto               allocator = neuropod.get_tensor_allocator();
+
+    // Resolve the indices once
+    auto       inputs = neuropod.make_input_map();
+    const auto x      = inputs.get_index("x");
+    const auto y      = inputs.get_index("y");
+    EXPECT_EQ(inputs.size(), 2);
+
+    for (int i = 0; i < 3; i++)
+    {
+        inputs[x] = allocator->full<float>({1, 2}, i);
+        inputs[y] = allocator->full<float>({1, 2}, 1);
+
+        const auto outputs = neuropod.infer(inputs);
+        EXPECT_EQ(outputs->at("out")->as_typed_tensor<float>()->get_data_as_vector(), std::vector<float>(2, i + 1));
+    }
+
+    // The backend gets the inputs by name
+    EXPECT_EQ(backend->get_last_input_names(), (std::vector<std::string>{"x", "y"}));
+
+    // Inputs are validated against the spec
+    inputs[y] = allocator->full<double>({1, 2}, 1);
+    EXPECT_THROW(neuropod.infer(inputs), std::runtime_error);
+}
+
+TEST(test_indexed_value_map, other_layout)
+{
+    neuropod::Neuropod neuropod("", std::make_shared<neuropod::FakeAdditionBackend>());
+    auto               allocator = neuropod.get_tensor_allocator();
+
+    // A map that wasn't created by `make_input_map` is converted to a NeuropodValueMap
+    auto layout = std::make_shared<neuropod::ValueMapLayout>(std::vector<std::string>{"y", "x"});
+
+    neuropod::IndexedValueMap inputs(layout);
+    inputs.at("x") = allocator->full<float>({1, 2}, 2);
+    inputs.at("y") = allocator->full<float>({1, 2}, 1);
+
+    const auto outputs = neuropod.infer(inputs);
+    EXPECT_EQ(outputs->at("out")->as_typed_tensor<float>()->get_data_as_vector(), std::vector<float>(2, 3));
+}
+
+TEST(test_indexed_value_map, output_allocator)
+{
+    auto               backend = std::make_shared<neuropod::FakeAdditionBackend>();
+    neuropod::Neuropod neuropod("", backend);
+    auto               allocator = neuropod.get_tensor_allocator();
+
+    auto inputs    = neuropod.make_input_map();
+    inputs.at("x") = allocator->full<float>({1, 2}, 2);
+    inputs.at("y") = allocator->full<float>({1, 2}, 1);
+
+    const auto outputs = neuropod.infer(inputs, {}, neuropod::get_generic_tensor_allocator());
+
+    // The backend got the allocator
+    EXPECT_EQ(backend->num_allocator_infers, 1);
+    EXPECT_EQ(outputs->at("out")->as_typed_tensor<float>()->get_data_as_vector(), std::vector<float>(2, 3));
+}
@@ -0,0 +1,151 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/neuropod.hh"
+#include "neuropod/tests/fake_addition_backend.hh"
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// Simulate some work so requests overlap
+std::shared_ptr<neuropod::FakeAdditionBackend> make_backend()
+{
+    neuropod::FakeAdditionBackend::Config config;
+    config.infer_delay = std::chrono::milliseconds(5);
+    return std::make_shared<neuropod::FakeAdditionBackend>(config);
+}
+
+neuropod::NeuropodValueMap make_inputs(neuropod::Neuropod &neuropod, float value)
+{
+    auto                       allocator = neuropod.get_tensor_allocator();
+    neuropod::NeuropodValueMap inputs;
+    inputs["x"] = allocator->full<float>({1, 2}, value);
+    inputs["y"] = allocator->full<float>({1, 2}, 1);
+    return inputs;
+}
+
+} // namespace
+
+TEST(test_infer_async, future)
+{
+    auto               backend = make_backend();
+    neuropod::Neuropod neuropod("", backend);
+
+    std::vector<std::future<std::unique_ptr<neuropod::NeuropodValueMap>>> futures;
+    for (int i = 0; i < 8; i++)
+    {
+        futures.emplace_back(neuropod.infer_async(make_inputs(neuropod, i)));
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        const auto outputs = futures[i].get();
+        EXPECT_EQ(outputs->at("out")->as_typed_tensor<float>()->get_data_as_vector(), std::vector<float>(2, i + 1));
+    }
+
+    // Inference runs on the executor and requests run one at a time by default
+    EXPECT_NE(backend->last_thread_id.load(), std::this_thread::get_id());
+    EXPECT_EQ(backend->max_in_flight, 1);
+}
+
+TEST(test_infer_async, inputs_released_before_ready)
+{
+    auto               backend = make_backend();
+    neuropod::Neuropod neuropod("", backend);
+
+    // The python bindings free numpy-backed inputs on the executor and rely on this ordering
+    auto inputs = make_inputs(neuropod, 1);
+    auto future = neuropod.infer_async(inputs);
+    future.wait();
+    EXPECT_EQ(inputs["x"].use_count(), 1);
+    EXPECT_EQ(inputs["y"].use_count(), 1);
+}
+
+TEST(test_infer_async, callback)
+{
+    auto               backend = make_backend();
+    neuropod::Neuropod neuropod("", backend);
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    done = false;
+    std::vector<float>      result;
+
+    neuropod.infer_async(make_inputs(neuropod, 2),
+                         {},
+                         [&](std::unique_ptr<neuropod::NeuropodValueMap> outputs, std::exception_ptr error) {
+                             EXPECT_FALSE(error);
+                             std::lock_guard<std::mutex> lock(mutex);
+                             result = outputs->at("out")->as_typed_tensor<float>()->get_data_as_vector();
+                             done   = true;
+                             cv.notify_all();
+                         });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return done; });
+    EXPECT_EQ(result, std::vector<float>(2, 3));
+}
+
+TEST(test_infer_async, errors)
+{
+    auto               backend = make_backend();
+    neuropod::Neuropod neuropod("", backend);
+
+    // Requesting an output that doesn't exist fails and the exception is rethrown by `get`
+    auto future = neuropod.infer_async(make_inputs(neuropod, 1), {"not_an_output"});
+    EXPECT_THROW(future.get(), std::runtime_error);
+
+    // The executor still works after an error
+    EXPECT_EQ(neuropod.infer_async(make_inputs(neuropod, 1)).get()->size(), 1);
+}
+
+TEST(test_infer_async, release_from_callback)
+{
+    auto neuropod = std::make_shared<neuropod::Neuropod>("", make_backend());
+    auto inputs   = make_inputs(*neuropod, 1);
+
+    std::promise<void> released;
+    std::promise<void> done;
+    auto               released_future = released.get_future();
+
+    // The callback owns the last reference to the Neuropod so the executor is destroyed on one of its own threads
+    auto *raw = neuropod.get();
+    raw->infer_async(inputs,
+                     {},
+                     [owner = neuropod, &released_future, &done](std::unique_ptr<neuropod::NeuropodValueMap> outputs,
+                                                                 std::exception_ptr error) mutable {
+                         released_future.wait();
+                         owner.reset();
+                         done.set_value();
+                     });
+
+    neuropod.reset();
+    released.set_value();
+    done.get_future().wait();
+}
+
+TEST(test_infer_async, num_async_threads)
+{
+    neuropod::RuntimeOptions options;
+    options.num_async_threads = 0;
+    EXPECT_THROW(neuropod::Neuropod("neuropod/tests/test_data/tf_addition_model/", options), std::runtime_error);
+}
@@ -0,0 +1,73 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/neuropod.hh"
+#include "neuropod/tests/fake_addition_backend.hh"
+
+TEST(test_infer_into, writes_into_provided_tensors)
+{
+    neuropod::Neuropod neuropod("", std::make_shared<neuropod::FakeAdditionBackend>());
+    auto               allocator = neuropod.get_tensor_allocator();
+
+    // Allocate the output once and reuse it for every call
+    auto                       out = allocator->allocate_tensor<float>({1, 2});
+    const auto                 ptr = out->get_raw_data_ptr();
+    neuropod::NeuropodValueMap outputs;
+    outputs["out"] = out;
+
+    for (int i = 0; i < 3; i++)
+    {
+        neuropod::NeuropodValueMap inputs;
+        inputs["x"] = allocator->full<float>({1, 2}, i);
+        inputs["y"] = allocator->full<float>({1, 2}, 1);
+
+        neuropod.infer_into(inputs, outputs);
+
+        // The results are in the tensor we passed in
+        EXPECT_EQ(outputs.at("out"), out);
+        EXPECT_EQ(out->get_raw_data_ptr(), ptr);
+        EXPECT_EQ(out->get_data_as_vector(), std::vector<float>(2, i + 1));
+    }
+}
+
+TEST(test_infer_into, errors)
+{
+    neuropod::Neuropod neuropod("", std::make_shared<neuropod::FakeAdditionBackend>());
+    auto               allocator = neuropod.get_tensor_allocator();
+
+    neuropod::NeuropodValueMap inputs;
+    inputs["x"] = allocator->ones<float>({1, 2});
+    inputs["y"] = allocator->ones<float>({1, 2});
+
+    // No outputs
+    neuropod::NeuropodValueMap no_outputs;
+    EXPECT_THROW(neuropod.infer_into(inputs, no_outputs), std::runtime_error);
+
+    // Wrong type (caught by validation against the output spec)
+    neuropod::NeuropodValueMap wrong_type;
+    wrong_type["out"] = allocator->allocate_tensor<double>({1, 2});
+    EXPECT_THROW(neuropod.infer_into(inputs, wrong_type), std::runtime_error);
+
+    // Wrong shape
+    neuropod::NeuropodValueMap wrong_shape;
+    wrong_shape["out"] = allocator->allocate_tensor<float>({2, 2});
+    EXPECT_THROW(neuropod.infer_into(inputs, wrong_shape), std::runtime_error);
+
+    // An output that the model doesn't produce
+    neuropod::NeuropodValueMap missing_output;
+    missing_output["not_an_output"] = allocator->allocate_tensor<float>({1, 2});
+    EXPECT_THROW(neuropod.infer_into(inputs, missing_output), std::runtime_error);
+}
@@ -0,0 +1,104 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/neuropod_pool.hh"
+#include "neuropod/tests/fake_addition_backend.hh"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace neuropod
+{
+
+namespace
+{
+
+REGISTER_NEUROPOD_BACKEND(FakeAdditionBackend, "tensorflow", "1.15.0")
+
+void run_concurrent_requests(NeuropodPool &pool, int num_threads)
+{
+    auto                     allocator = pool.get_tensor_allocator();
+    std::atomic_int          num_correct{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++)
+    {
+        threads.emplace_back([&, i]() {
+            NeuropodValueMap inputs;
+            inputs["x"] = allocator->full<float>({1, 2}, i);
+            inputs["y"] = allocator->full<float>({1, 2}, 1);
+
+            const auto outputs = pool.infer(inputs);
+            if (outputs->at("out")->as_typed_tensor<float>()->get_data_as_vector() == std::vector<float>(2, i + 1))
+            {
+                num_correct++;
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(num_threads, num_correct);
+}
+
+} // namespace
+
+TEST(test_neuropod_pool, separate_instances)
+{
+    FakeAdditionBackend::reset();
+    FakeAdditionBackend::config().supports_concurrent_inference = false;
+    FakeAdditionBackend::config().infer_delay                   = std::chrono::milliseconds(5);
+
+    // The backend doesn't support concurrent inference so every instance is a separately loaded model
+    NeuropodPool pool("neuropod/tests/test_data/tf_addition_model/", 3);
+    EXPECT_EQ(pool.get_num_instances(), 3);
+    EXPECT_EQ(pool.get_num_loaded_models(), 3);
+    EXPECT_EQ(FakeAdditionBackend::num_loads(), 3);
+
+    run_concurrent_requests(pool, 12);
+
+    // Each loaded model should only run one request at a time
+    EXPECT_EQ(FakeAdditionBackend::max_concurrent_per_instance(), 1);
+}
+
+TEST(test_neuropod_pool, shared_instance)
+{
+    FakeAdditionBackend::reset();
+    FakeAdditionBackend::config().supports_concurrent_inference = true;
+    FakeAdditionBackend::config().infer_delay                   = std::chrono::milliseconds(5);
+
+    // The backend supports concurrent inference so the model is only loaded once
+    NeuropodPool pool("neuropod/tests/test_data/tf_addition_model/", 3);
+    EXPECT_EQ(pool.get_num_instances(), 3);
+    EXPECT_EQ(pool.get_num_loaded_models(), 1);
+    EXPECT_EQ(FakeAdditionBackend::num_loads(), 1);
+
+    run_concurrent_requests(pool, 12);
+
+    // The number of concurrent requests is still limited by the number of instances
+    EXPECT_LE(FakeAdditionBackend::max_concurrent_per_instance(), 3);
+}
+
+TEST(test_neuropod_pool, invalid_num_instances)
+{
+    EXPECT_THROW(NeuropodPool("neuropod/tests/test_data/tf_addition_model/", 0), std::runtime_error);
+}
+
+} // namespace neuropod
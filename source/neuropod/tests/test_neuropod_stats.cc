@@ -0,0 +1,56 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/neuropod.hh"
+#include "neuropod/tests/fake_addition_backend.hh"
+
+TEST(test_neuropod_stats, stages)
+{
+    neuropod::Neuropod neuropod("", std::make_shared<neuropod::FakeAdditionBackend>());
+    auto               allocator = neuropod.get_tensor_allocator();
+
+    // Only the model load has been recorded so far
+    auto stats = neuropod.get_stats();
+    EXPECT_EQ(stats.size(), 1);
+    EXPECT_EQ(stats.at("load").count, 1);
+
+    neuropod::NeuropodValueMap inputs;
+    inputs["x"] = allocator->ones<float>({1, 2});
+    inputs["y"] = allocator->ones<float>({1, 2});
+    for (int i = 0; i < 10; i++)
+    {
+        neuropod.infer(inputs);
+    }
+
+    stats = neuropod.get_stats();
+    for (const auto &stage :
+         {"infer", "input_validation", "sealing", "infer_internal", "output_conversion", "output_validation"})
+    {
+        ASSERT_EQ(stats.count(stage), 1) << stage;
+        EXPECT_EQ(stats.at(stage).count, 10) << stage;
+        EXPECT_LE(stats.at(stage).min_us, stats.at(stage).p50_us) << stage;
+        EXPECT_LE(stats.at(stage).p50_us, stats.at(stage).max_us) << stage;
+    }
+
+    // Stages are contained in the end to end time
+    EXPECT_LE(stats.at("infer_internal").min_us, stats.at("infer").max_us);
+
+    // Failed requests aren't recorded
+    neuropod::NeuropodValueMap invalid_inputs;
+    invalid_inputs["x"] = allocator->ones<int32_t>({1, 2});
+    EXPECT_THROW(neuropod.infer(invalid_inputs), std::runtime_error);
+    EXPECT_EQ(neuropod.get_stats().at("infer").count, 10);
+}
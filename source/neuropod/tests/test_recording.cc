@@ -0,0 +1,237 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/neuropod.hh"
+#include "neuropod/neuropod_pool.hh"
+#include "neuropod/recording.hh"
+#include "neuropod/tests/fake_addition_backend.hh"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace neuropod
+{
+
+namespace
+{
+
+REGISTER_NEUROPOD_BACKEND(FakeAdditionBackend, "tensorflow", "1.15.0")
+
+// Run `num_requests` requests where the inputs of request `i` are filled with `i`
+void run_requests(Neuropod &neuropod, int num_requests)
+{
+    auto allocator = neuropod.get_tensor_allocator();
+    for (int i = 0; i < num_requests; i++)
+    {
+        NeuropodValueMap inputs;
+        inputs["x"] = allocator->full<float>({1, 2}, i);
+        inputs["y"] = allocator->full<float>({1, 2}, i);
+        neuropod.infer(inputs, {"out"});
+    }
+}
+
+} // namespace
+
+TEST(test_recording, sampled_requests)
+{
+    const std::string path = "test_recording_sampled.bin";
+    std::remove(path.c_str());
+
+    RuntimeOptions options;
+    options.recording_options.path           = path;
+    options.recording_options.sample_rate    = 0.5;
+    options.recording_options.record_outputs = true;
+
+    {
+        Neuropod neuropod("neuropod/tests/test_data/tf_addition_model/", options);
+        run_requests(neuropod, 10);
+    }
+
+    // Every other request should be recorded
+    const auto recording = read_recording(path, *get_generic_tensor_allocator());
+    ASSERT_EQ(recording.size(), 5);
+    for (const auto &request : recording)
+    {
+        const auto x = request.inputs.at("x")->as_typed_tensor<float>()->get_data_as_vector();
+        EXPECT_EQ(request.inputs.at("y")->as_typed_tensor<float>()->get_data_as_vector(), x);
+        EXPECT_EQ(request.requested_outputs, std::vector<std::string>{"out"});
+
+        ASSERT_TRUE(request.has_outputs);
+        EXPECT_EQ(request.outputs.at("out")->as_typed_tensor<float>()->get_data_as_vector(),
+                  std::vector<float>(2, x[0] * 2));
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(test_recording, max_requests)
+{
+    const std::string path = "test_recording_max_requests.bin";
+    std::remove(path.c_str());
+
+    RuntimeOptions options;
+    options.recording_options.path         = path;
+    options.recording_options.max_requests = 3;
+
+    {
+        Neuropod neuropod("neuropod/tests/test_data/tf_addition_model/", options);
+        run_requests(neuropod, 10);
+    }
+
+    // Only the first 3 requests should be recorded (without outputs)
+    const auto recording = read_recording(path, *get_generic_tensor_allocator());
+    ASSERT_EQ(recording.size(), 3);
+    for (size_t i = 0; i < recording.size(); i++)
+    {
+        EXPECT_EQ(recording[i].inputs.at("x")->as_typed_tensor<float>()->get_data_as_vector(),
+                  std::vector<float>(2, i));
+        EXPECT_FALSE(recording[i].has_outputs);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(test_recording, all_entry_points)
+{
+    const std::string path = "test_recording_all_entry_points.bin";
+    std::remove(path.c_str());
+
+    RuntimeOptions options;
+    options.recording_options.path           = path;
+    options.recording_options.record_outputs = true;
+
+    {
+        Neuropod neuropod("neuropod/tests/test_data/tf_addition_model/", options);
+        auto     allocator = neuropod.get_tensor_allocator();
+
+        NeuropodValueMap inputs;
+        inputs["x"] = allocator->full<float>({1, 2}, 0);
+        inputs["y"] = allocator->full<float>({1, 2}, 0);
+        neuropod.infer(inputs);
+
+        auto indexed_inputs    = neuropod.make_input_map();
+        indexed_inputs.at("x") = allocator->full<float>({1, 2}, 1);
+        indexed_inputs.at("y") = allocator->full<float>({1, 2}, 1);
+        neuropod.infer(indexed_inputs);
+
+        inputs["x"] = allocator->full<float>({1, 2}, 2);
+        NeuropodValueMap outputs;
+        outputs["out"] = allocator->allocate_tensor<float>({1, 2});
+        neuropod.infer_into(inputs, outputs);
+
+        inputs["x"] = allocator->full<float>({1, 2}, 3);
+        neuropod.infer_async(inputs).get();
+    }
+
+    const auto recording = read_recording(path, *get_generic_tensor_allocator());
+    ASSERT_EQ(recording.size(), 4);
+    for (size_t i = 0; i < recording.size(); i++)
+    {
+        const auto &request = recording[i];
+        EXPECT_EQ(request.inputs.at("x")->as_typed_tensor<float>()->get_data_as_vector(), std::vector<float>(2, i));
+
+        const auto x = request.inputs.at("x")->as_typed_tensor<float>()->get_data_as_vector();
+        const auto y = request.inputs.at("y")->as_typed_tensor<float>()->get_data_as_vector();
+        ASSERT_TRUE(request.has_outputs);
+        EXPECT_EQ(request.outputs.at("out")->as_typed_tensor<float>()->get_data_as_vector(),
+                  std::vector<float>(2, x[0] + y[0]));
+    }
+
+    // `infer_into` requests the outputs that were passed in
+    EXPECT_EQ(recording[2].requested_outputs, std::vector<std::string>{"out"});
+
+    std::remove(path.c_str());
+}
+
+TEST(test_recording, reused_tensors)
+{
+    const std::string path = "test_recording_reused_tensors.bin";
+    std::remove(path.c_str());
+
+    RuntimeOptions options;
+    options.recording_options.path                = path;
+    options.recording_options.record_outputs      = true;
+    options.recording_options.max_queued_requests = 1;
+
+    {
+        Neuropod neuropod("neuropod/tests/test_data/tf_addition_model/", options);
+        auto     allocator = neuropod.get_tensor_allocator();
+
+        // Reuse the same tensors for every request
+        auto             x = allocator->allocate_tensor<float>({1, 2});
+        auto             y = allocator->allocate_tensor<float>({1, 2});
+        NeuropodValueMap outputs;
+        outputs["out"] = allocator->allocate_tensor<float>({1, 2});
+        for (int i = 0; i < 20; i++)
+        {
+            x->copy_from({static_cast<float>(i), static_cast<float>(i)});
+            y->copy_from({1, 1});
+            neuropod.infer_into({{"x", x}, {"y", y}}, outputs);
+        }
+    }
+
+    // Requests may be dropped while the queue is full, but the ones that were recorded should match what was sent
+    const auto recording = read_recording(path, *get_generic_tensor_allocator());
+    ASSERT_GE(recording.size(), 1);
+    ASSERT_LE(recording.size(), 20);
+    float previous_x = -1;
+    for (const auto &request : recording)
+    {
+        const auto x = request.inputs.at("x")->as_typed_tensor<float>()->get_data_as_vector();
+        EXPECT_EQ(x[0], x[1]);
+        EXPECT_GT(x[0], previous_x);
+        previous_x = x[0];
+        EXPECT_EQ(request.outputs.at("out")->as_typed_tensor<float>()->get_data_as_vector(),
+                  std::vector<float>(2, x[0] + 1));
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(test_recording, shared_recorder)
+{
+    const std::string path = "test_recording_shared_recorder.bin";
+    std::remove(path.c_str());
+
+    RuntimeOptions options;
+    options.recording_options.path         = path;
+    options.recording_options.max_requests = 4;
+
+    {
+        // The instances in the pool share one recorder so the limit applies to the pool as a whole
+        NeuropodPool pool("neuropod/tests/test_data/tf_addition_model/", 3, options);
+        auto         allocator = pool.get_tensor_allocator();
+        for (int i = 0; i < 12; i++)
+        {
+            NeuropodValueMap inputs;
+            inputs["x"] = allocator->full<float>({1, 2}, i);
+            inputs["y"] = allocator->full<float>({1, 2}, i);
+            pool.infer(inputs);
+        }
+
+        // Recording to the same file with different options is an error
+        auto other_options                           = options;
+        other_options.recording_options.max_requests = 5;
+        EXPECT_THROW(Neuropod("neuropod/tests/test_data/tf_addition_model/", other_options), std::runtime_error);
+    }
+
+    EXPECT_EQ(read_recording(path, *get_generic_tensor_allocator()).size(), 4);
+
+    std::remove(path.c_str());
+}
+
+} // namespace neuropod
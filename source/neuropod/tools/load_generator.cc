@@ -0,0 +1,207 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "neuropod/tools/load_generator.hh"
+
+#include "neuropod/internal/error_utils.hh"
+#include "neuropod/internal/type_macros.hh"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace neuropod
+{
+
+LoadResult run_load(const LoadOptions &options, const std::function<void(size_t)> &send_request)
+{
+    if (options.concurrency == 0)
+    {
+        NEUROPOD_ERROR("The load concurrency must be at least 1");
+    }
+
+    if (options.rate < 0)
+    {
+        NEUROPOD_ERROR("The load rate must not be negative. Got {}", options.rate);
+    }
+
+    // Warmup requests aren't included in the results and errors are ignored
+    for (size_t i = 0; i < options.num_warmup_requests; i++)
+    {
+        try
+        {
+            send_request(i);
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+
+    LoadResult          result;
+    LatencyHistogram    latency;
+    std::atomic<size_t> next_request{0};
+    std::atomic<size_t> num_errors{0};
+    std::mutex          error_mutex;
+
+    const auto start    = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                      std::chrono::duration<double>(options.max_duration_s));
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < options.concurrency; t++)
+    {
+        threads.emplace_back([&]() {
+            for (size_t i = next_request++; i < options.num_requests; i = next_request++)
+            {
+                auto scheduled = std::chrono::steady_clock::now();
+                if (options.rate > 0)
+                {
+                    scheduled = start + std::chrono::nanoseconds(static_cast<int64_t>(i * 1e9 / options.rate));
+                }
+
+                if (options.max_duration_s > 0 && scheduled >= deadline)
+                {
+                    break;
+                }
+
+                std::this_thread::sleep_until(scheduled);
+
+                try
+                {
+                    send_request(i);
+                }
+                catch (const std::exception &e)
+                {
+                    if (num_errors++ == 0)
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        result.first_error = e.what();
+                    }
+
+                    continue;
+                }
+
+                const auto elapsed = std::chrono::steady_clock::now() - scheduled;
+                latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    result.duration_s   = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.latency      = latency.get_stats();
+    result.num_requests = result.latency.count;
+    result.num_errors   = num_errors;
+    return result;
+}
+
+namespace
+{
+
+template <typename T>
+void fill_random(NeuropodTensor &tensor, std::mt19937_64 &rng)
+{
+    auto       data = tensor.as_typed_tensor<T>()->get_raw_data_ptr();
+    const auto size = tensor.get_num_elements();
+    if constexpr (std::is_floating_point<T>::value)
+    {
+        std::uniform_real_distribution<T> dist(-1, 1);
+        for (size_t i = 0; i < size; i++)
+        {
+            data[i] = dist(rng);
+        }
+    }
+    else
+    {
+        // `uniform_int_distribution` doesn't support 8 bit types
+        std::uniform_int_distribution<int64_t> dist(0, 99);
+        for (size_t i = 0; i < size; i++)
+        {
+            data[i] = static_cast<T>(dist(rng));
+        }
+    }
+}
+
+void fill_random_strings(NeuropodTensor &tensor, size_t length, std::mt19937_64 &rng)
+{
+    std::uniform_int_distribution<int> dist('a', 'z');
+
+    auto flat = tensor.as_typed_tensor<std::string>()->flat();
+    for (size_t i = 0; i < tensor.get_num_elements(); i++)
+    {
+        std::string value(length, ' ');
+        for (auto &c : value)
+        {
+            c = static_cast<char>(dist(rng));
+        }
+
+        flat[i] = value;
+    }
+}
+
+} // namespace
+
+NeuropodValueMap generate_random_inputs(const std::vector<TensorSpec> &input_spec,
+                                        NeuropodTensorAllocator &      allocator,
+                                        const InputGeneratorOptions &  options,
+                                        std::mt19937_64 &              rng)
+{
+    NeuropodValueMap out;
+    for (const auto &spec : input_spec)
+    {
+        std::vector<int64_t> dims;
+        for (const auto &dim : spec.dims)
+        {
+            if (dim.value >= 0)
+            {
+                dims.emplace_back(dim.value);
+                continue;
+            }
+
+            // Unspecified dimensions and symbols without a value use the default
+            const auto symbol = options.symbol_values.find(dim.symbol);
+            dims.emplace_back(dim.value == -2 && symbol != options.symbol_values.end() ? symbol->second
+                                                                                         : options.default_dim);
+        }
+
+        std::shared_ptr<NeuropodTensor> tensor = allocator.allocate_tensor(dims, spec.type);
+
+#define FILL_RANDOM(CPP_TYPE, NEUROPOD_TYPE) \
+    case NEUROPOD_TYPE:                      \
+        fill_random<CPP_TYPE>(*tensor, rng); \
+        break;
+
+        switch (spec.type)
+        {
+            FOR_EACH_TYPE_MAPPING_EXCEPT_STRING(FILL_RANDOM)
+        case STRING_TENSOR:
+            fill_random_strings(*tensor, options.string_length, rng);
+            break;
+        }
+
+#undef FILL_RANDOM
+
+        out[spec.name] = tensor;
+    }
+
+    return out;
+}
+
+} // namespace neuropod
@@ -0,0 +1,95 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "neuropod/internal/latency_stats.hh"
+#include "neuropod/neuropod.hh"
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace neuropod
+{
+
+// Utilities shared by the load testing tools (`neuropod_loadgen` and `neuropod_replay`)
+
+struct LoadOptions
+{
+    // The number of threads sending requests
+    size_t concurrency = 1;
+
+    // The number of requests per second to send (open loop). Requests are scheduled at fixed intervals regardless
+    // of how long previous requests took.
+    // If this is 0, each thread sends its next request as soon as the previous one completes (closed loop)
+    double rate = 0;
+
+    // The number of requests to send
+    size_t num_requests = 1000;
+
+    // If this is nonzero, stop sending requests after this many seconds (even if fewer than `num_requests` were sent)
+    double max_duration_s = 0;
+
+    // The number of requests to send (sequentially) before measuring
+    size_t num_warmup_requests = 0;
+};
+
+struct LoadResult
+{
+    // The number of requests that completed successfully and failed
+    size_t num_requests = 0;
+    size_t num_errors   = 0;
+
+    // The message of the first failure (if any)
+    std::string first_error;
+
+    // The wall time of the run
+    double duration_s = 0;
+
+    // The latency of successful requests. In open loop mode, this is measured from when each request was
+    // scheduled to be sent (rather than when it was actually sent) so time spent waiting for a free thread
+    // is included. This avoids coordinated omission.
+    LatencyStats latency;
+};
+
+// Call `send_request(i)` for each request `i` in [0, num_requests) according to `options`.
+// Exceptions thrown by `send_request` are counted as errors
+LoadResult run_load(const LoadOptions &options, const std::function<void(size_t)> &send_request);
+
+// Options for synthesizing inputs from the input spec of a model
+struct InputGeneratorOptions
+{
+    // The size to use for dimensions that are unspecified (`null` in the spec) or symbols without a value
+    int64_t default_dim = 1;
+
+    // Sizes for symbols in the spec (e.g. `batch_size`)
+    std::unordered_map<std::string, int64_t> symbol_values;
+
+    // The length of generated strings
+    size_t string_length = 8;
+};
+
+// Generate inputs filled with random values that match `input_spec`
+// Floating point values are in [-1, 1), integers are in [0, 100) and strings are lowercase letters
+NeuropodValueMap generate_random_inputs(const std::vector<TensorSpec> &input_spec,
+                                        NeuropodTensorAllocator &      allocator,
+                                        const InputGeneratorOptions &  options,
+                                        std::mt19937_64 &              rng);
+
+} // namespace neuropod
@@ -0,0 +1,259 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Drives a neuropod with random inputs synthesized from its input spec and reports throughput and latency
+// percentiles as JSON. See `docs/advanced/loadgen.md` for details
+
+#include "neuropod/neuropod_pool.hh"
+#include "neuropod/tools/load_generator.hh"
+
+#include <json/json.h>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct LoadgenOptions
+{
+    std::string neuropod_path;
+
+    neuropod::RuntimeOptions        runtime_options;
+    neuropod::LoadOptions           load_options;
+    neuropod::InputGeneratorOptions input_options;
+
+    // The number of distinct sets of random inputs to cycle through
+    size_t num_input_sets = 16;
+
+    uint64_t seed = 0;
+
+    // Where to write the JSON results. Results are written to stdout if this is empty
+    std::string output_path;
+};
+
+void print_usage(const std::string &program_name)
+{
+    std::cout << "Usage: " << program_name << " --neuropod PATH [options]\n"
+              << "\n"
+              << "Options:\n"
+              << "  --use_ope              Run the neuropod out of process\n"
+              << "  --num_workers N        The number of OPE worker processes (default 1)\n"
+              << "  --device DEVICE        `cpu` or a GPU index (default 0)\n"
+              << "  --concurrency N        The number of threads sending requests (default 1)\n"
+              << "  --rate QPS             Send requests at a fixed rate (open loop). If this is 0, each thread\n"
+              << "                         sends requests back to back (closed loop) (default 0)\n"
+              << "  --num_requests N       The number of requests to send (default 1000)\n"
+              << "  --duration S           Stop after this many seconds. 0 means there is no limit (default 0)\n"
+              << "  --warmup N             The number of requests to send before measuring (default 10)\n"
+              << "  --dim SYMBOL=SIZE      The size to use for a symbol in the input spec (can be repeated)\n"
+              << "  --default_dim N        The size to use for unspecified dimensions (default 1)\n"
+              << "  --num_input_sets N     The number of distinct random inputs to cycle through (default 16)\n"
+              << "  --seed N               The seed for generating inputs (default 0)\n"
+              << "  --output PATH          Write the results to a file instead of stdout\n";
+}
+
+bool parse_args(int argc, char *argv[], LoadgenOptions &options)
+{
+    options.load_options.num_warmup_requests = 10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+
+        // Get the value of a flag that takes a value
+        const auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+
+            return argv[++i];
+        };
+
+        if (arg == "--neuropod")
+        {
+            options.neuropod_path = next();
+        }
+        else if (arg == "--use_ope")
+        {
+            options.runtime_options.use_ope = true;
+        }
+        else if (arg == "--num_workers")
+        {
+            options.runtime_options.ope_options.num_workers = std::stoul(next());
+        }
+        else if (arg == "--device")
+        {
+            const auto device                      = next();
+            options.runtime_options.visible_device = device == "cpu" ? neuropod::Device::CPU : std::stoi(device);
+        }
+        else if (arg == "--concurrency")
+        {
+            options.load_options.concurrency = std::stoul(next());
+        }
+        else if (arg == "--rate")
+        {
+            options.load_options.rate = std::stod(next());
+        }
+        else if (arg == "--num_requests")
+        {
+            options.load_options.num_requests = std::stoul(next());
+        }
+        else if (arg == "--duration")
+        {
+            options.load_options.max_duration_s = std::stod(next());
+        }
+        else if (arg == "--warmup")
+        {
+            options.load_options.num_warmup_requests = std::stoul(next());
+        }
+        else if (arg == "--dim")
+        {
+            const auto value = next();
+            const auto split = value.find('=');
+            if (split == std::string::npos)
+            {
+                throw std::invalid_argument("Expected SYMBOL=SIZE for --dim. Got " + value);
+            }
+
+            options.input_options.symbol_values[value.substr(0, split)] = std::stol(value.substr(split + 1));
+        }
+        else if (arg == "--default_dim")
+        {
+            options.input_options.default_dim = std::stol(next());
+        }
+        else if (arg == "--num_input_sets")
+        {
+            options.num_input_sets = std::stoul(next());
+        }
+        else if (arg == "--seed")
+        {
+            options.seed = std::stoull(next());
+        }
+        else if (arg == "--output")
+        {
+            options.output_path = next();
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    return !options.neuropod_path.empty() && options.load_options.concurrency > 0 && options.num_input_sets > 0;
+}
+
+Json::Value to_json(const LoadgenOptions &options, const std::string &name, const neuropod::LoadResult &result)
+{
+    Json::Value out;
+    out["neuropod"]    = options.neuropod_path;
+    out["name"]        = name;
+    out["mode"]        = options.load_options.rate > 0 ? "open_loop" : "closed_loop";
+    out["concurrency"] = static_cast<Json::UInt64>(options.load_options.concurrency);
+    if (options.load_options.rate > 0)
+    {
+        out["target_rate"] = options.load_options.rate;
+    }
+
+    out["num_requests"] = static_cast<Json::UInt64>(result.num_requests);
+    out["num_errors"]   = static_cast<Json::UInt64>(result.num_errors);
+    out["duration_s"]   = result.duration_s;
+    out["throughput"]   = result.duration_s > 0 ? result.num_requests / result.duration_s : 0;
+    if (!result.first_error.empty())
+    {
+        out["first_error"] = result.first_error;
+    }
+
+    auto &latency    = out["latency_us"];
+    latency["mean"]  = result.latency.mean_us;
+    latency["min"]   = result.latency.min_us;
+    latency["max"]   = result.latency.max_us;
+    latency["p50"]   = result.latency.p50_us;
+    latency["p90"]   = result.latency.p90_us;
+    latency["p99"]   = result.latency.p99_us;
+    latency["p99.9"] = result.latency.p999_us;
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    LoadgenOptions options;
+    try
+    {
+        if (!parse_args(argc, argv, options))
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Invalid arguments: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // The pool handles backends that don't support concurrent inference by loading multiple instances
+    neuropod::NeuropodPool pool(options.neuropod_path, options.load_options.concurrency, options.runtime_options);
+
+    // Generate inputs up front so generating them doesn't affect latency
+    std::mt19937_64                         rng(options.seed);
+    std::vector<neuropod::NeuropodValueMap> input_sets;
+    const auto                              allocator = pool.get_tensor_allocator();
+    for (size_t i = 0; i < options.num_input_sets; i++)
+    {
+        input_sets.emplace_back(
+            neuropod::generate_random_inputs(pool.get_inputs(), *allocator, options.input_options, rng));
+    }
+
+    const auto result = neuropod::run_load(
+        options.load_options, [&](size_t i) { pool.infer(input_sets[i % input_sets.size()]); });
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "    ";
+    builder["precision"]   = 6;
+    const auto json        = Json::writeString(builder, to_json(options, pool.get_name(), result));
+
+    if (options.output_path.empty())
+    {
+        std::cout << json << std::endl;
+    }
+    else
+    {
+        std::ofstream out(options.output_path);
+        out << json << std::endl;
+        if (!out)
+        {
+            std::cerr << "Failed to write results to " << options.output_path << std::endl;
+            return 1;
+        }
+    }
+
+    if (result.num_errors > 0)
+    {
+        std::cerr << result.num_errors << " requests failed. The first error was: " << result.first_error << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
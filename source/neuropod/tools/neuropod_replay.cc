@@ -0,0 +1,298 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Replays requests recorded with `RuntimeOptions::recording_options` against a neuropod and reports
+// throughput and latency. See `docs/advanced/recording.md` for details
+
+#include "neuropod/neuropod_pool.hh"
+#include "neuropod/recording.hh"
+#include "neuropod/tools/load_generator.hh"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct ReplayOptions
+{
+    std::string neuropod_path;
+    std::string recording_path;
+
+    neuropod::RuntimeOptions runtime_options;
+
+    // The number of threads sending requests
+    size_t concurrency = 1;
+
+    // The number of requests per second to send (spread evenly over time). 0 sends requests as fast as possible
+    double rate = 0;
+
+    // The number of times to replay the recording
+    size_t iterations = 1;
+
+    // Whether or not to compare outputs against recorded outputs (and the tolerance for floating point outputs)
+    bool   diff      = false;
+    double tolerance = 1e-5;
+};
+
+void print_usage(const std::string &program_name)
+{
+    std::cout << "Usage: " << program_name << " --neuropod PATH --recording PATH [options]\n"
+              << "\n"
+              << "Options:\n"
+              << "  --use_ope              Run the neuropod out of process\n"
+              << "  --num_workers N        The number of OPE worker processes (default 1)\n"
+              << "  --device DEVICE        `cpu` or a GPU index (default 0)\n"
+              << "  --concurrency N        The number of concurrent requests (default 1)\n"
+              << "  --rate QPS             Requests per second. 0 sends requests as fast as possible (default 0)\n"
+              << "  --iterations N         The number of times to replay the recording (default 1)\n"
+              << "  --diff                 Compare the outputs of the first iteration against the recorded outputs\n"
+              << "  --tolerance X          The tolerance for comparing floating point outputs (default 1e-5)\n";
+}
+
+bool parse_args(int argc, char *argv[], ReplayOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+
+        // Get the value of a flag that takes a value
+        const auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+
+            return argv[++i];
+        };
+
+        if (arg == "--neuropod")
+        {
+            options.neuropod_path = next();
+        }
+        else if (arg == "--recording")
+        {
+            options.recording_path = next();
+        }
+        else if (arg == "--use_ope")
+        {
+            options.runtime_options.use_ope = true;
+        }
+        else if (arg == "--num_workers")
+        {
+            options.runtime_options.ope_options.num_workers = std::stoul(next());
+        }
+        else if (arg == "--device")
+        {
+            const auto device                      = next();
+            options.runtime_options.visible_device = device == "cpu" ? neuropod::Device::CPU : std::stoi(device);
+        }
+        else if (arg == "--concurrency")
+        {
+            options.concurrency = std::stoul(next());
+        }
+        else if (arg == "--rate")
+        {
+            options.rate = std::stod(next());
+        }
+        else if (arg == "--iterations")
+        {
+            options.iterations = std::stoul(next());
+        }
+        else if (arg == "--diff")
+        {
+            options.diff = true;
+        }
+        else if (arg == "--tolerance")
+        {
+            options.tolerance = std::stod(next());
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    return !options.neuropod_path.empty() && !options.recording_path.empty() && options.concurrency > 0;
+}
+
+template <typename T>
+bool all_close(const neuropod::NeuropodTensor &expected, const neuropod::NeuropodTensor &actual, double tolerance)
+{
+    const auto expected_data = expected.as_typed_tensor<T>()->get_raw_data_ptr();
+    const auto actual_data   = actual.as_typed_tensor<T>()->get_raw_data_ptr();
+    for (size_t i = 0; i < expected.get_num_elements(); i++)
+    {
+        const double diff = std::abs(static_cast<double>(expected_data[i]) - static_cast<double>(actual_data[i]));
+        if (diff > tolerance + tolerance * std::abs(static_cast<double>(expected_data[i])))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns a description of the first difference between the recorded and actual outputs of a request
+// (or an empty string if they match). Outputs that weren't recorded are ignored
+std::string diff_outputs(const neuropod::NeuropodValueMap &expected,
+                         const neuropod::NeuropodValueMap &actual,
+                         double                            tolerance)
+{
+    for (const auto &item : expected)
+    {
+        const auto &name  = item.first;
+        const auto  found = actual.find(name);
+        if (found == actual.end())
+        {
+            return "output '" + name + "' is missing";
+        }
+
+        const auto &expected_tensor = *item.second->as_tensor();
+        const auto &actual_tensor   = *found->second->as_tensor();
+        if (expected_tensor.get_tensor_type() != actual_tensor.get_tensor_type() ||
+            expected_tensor.get_dims() != actual_tensor.get_dims())
+        {
+            return "output '" + name + "' has a different type or shape";
+        }
+
+        bool matches;
+        switch (expected_tensor.get_tensor_type())
+        {
+        case neuropod::FLOAT_TENSOR:
+            matches = all_close<float>(expected_tensor, actual_tensor, tolerance);
+            break;
+        case neuropod::DOUBLE_TENSOR:
+            matches = all_close<double>(expected_tensor, actual_tensor, tolerance);
+            break;
+        default:
+            matches = expected_tensor == actual_tensor;
+            break;
+        }
+
+        if (!matches)
+        {
+            return "output '" + name + "' has different values";
+        }
+    }
+
+    return "";
+}
+
+void print_stats(const std::string &title, const neuropod::LatencyStats &stats)
+{
+    std::cout << title << " (ms):" << std::fixed << std::setprecision(3) << " mean " << stats.mean_us / 1000
+              << ", p50 " << stats.p50_us / 1000 << ", p90 " << stats.p90_us / 1000 << ", p99 " << stats.p99_us / 1000
+              << ", p99.9 " << stats.p999_us / 1000 << ", max " << stats.max_us / 1000 << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    ReplayOptions options;
+    try
+    {
+        if (!parse_args(argc, argv, options))
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Invalid arguments: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // The pool handles backends that don't support concurrent inference by loading multiple instances
+    neuropod::NeuropodPool pool(options.neuropod_path, options.concurrency, options.runtime_options);
+
+    // Load the whole recording up front so reading it doesn't affect latency
+    const auto recording = neuropod::read_recording(options.recording_path, *pool.get_tensor_allocator());
+    if (recording.empty())
+    {
+        std::cerr << "The recording is empty" << std::endl;
+        return 1;
+    }
+
+    neuropod::LatencyHistogram recorded_latency;
+    for (const auto &request : recording)
+    {
+        recorded_latency.record(request.latency_ns);
+    }
+
+    neuropod::LoadOptions load_options;
+    load_options.concurrency  = options.concurrency;
+    load_options.rate         = options.rate;
+    load_options.num_requests = recording.size() * options.iterations;
+
+    // With `--diff`, the outputs of the first pass over the recording are kept and compared after the replay
+    // so the comparison doesn't affect latency
+    std::vector<std::unique_ptr<neuropod::NeuropodValueMap>> outputs(options.diff ? recording.size() : 0);
+
+    const auto result = neuropod::run_load(load_options, [&](size_t i) {
+        const auto &request = recording[i % recording.size()];
+        auto        out     = pool.infer(request.inputs, request.requested_outputs);
+        if (i < outputs.size())
+        {
+            outputs[i] = std::move(out);
+        }
+    });
+
+    std::cout << "Replayed " << result.num_requests << " requests in " << std::fixed << std::setprecision(3)
+              << result.duration_s << "s (" << result.num_requests / result.duration_s
+              << " requests/s) with concurrency " << options.concurrency << std::endl;
+    print_stats("Replay latency", result.latency);
+    print_stats("Recorded latency", recorded_latency.get_stats());
+
+    if (result.num_errors > 0)
+    {
+        std::cout << result.num_errors << " requests failed. The first error was: " << result.first_error
+                  << std::endl;
+    }
+
+    size_t num_checked    = 0;
+    size_t num_mismatches = 0;
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        // Skip failed requests and requests without recorded outputs
+        if (!outputs[i] || !recording[i].has_outputs)
+        {
+            continue;
+        }
+
+        num_checked++;
+        const auto diff = diff_outputs(recording[i].outputs, *outputs[i], options.tolerance);
+        if (!diff.empty() && num_mismatches++ < 10)
+        {
+            std::cerr << "Request " << i << ": " << diff << std::endl;
+        }
+    }
+
+    if (options.diff)
+    {
+        std::cout << "Output mismatches: " << num_mismatches << " of " << num_checked << " checked requests"
+                  << std::endl;
+    }
+
+    return result.num_errors > 0 || num_mismatches > 0 ? 1 : 0;
+}
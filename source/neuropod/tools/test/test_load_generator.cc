@@ -0,0 +1,141 @@
+/* Copyright (c) 2020 UATC, LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "gtest/gtest.h"
+#include "neuropod/core/generic_tensor.hh"
+#include "neuropod/internal/config_utils.hh"
+#include "neuropod/tools/load_generator.hh"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace neuropod
+{
+
+TEST(test_load_generator, inputs_for_test_model)
+{
+    const auto config    = load_model_config("neuropod/tests/test_data/tf_addition_model/");
+    const auto allocator = get_generic_tensor_allocator();
+
+    // Unspecified dimensions should all use the default so `x` and `y` have the same shape
+    InputGeneratorOptions options;
+    options.default_dim = 3;
+
+    std::mt19937_64 rng(0);
+    const auto      inputs = generate_random_inputs(config->inputs, *allocator, options, rng);
+    ASSERT_EQ(inputs.size(), 2);
+    for (const auto &name : {"x", "y"})
+    {
+        const auto tensor = inputs.at(name)->as_typed_tensor<float>();
+        EXPECT_EQ(tensor->get_dims(), (std::vector<int64_t>{3, 3}));
+        for (const auto value : tensor->get_data_as_vector())
+        {
+            EXPECT_GE(value, -1);
+            EXPECT_LT(value, 1);
+        }
+    }
+}
+
+TEST(test_load_generator, symbols_and_types)
+{
+    const std::vector<TensorSpec> spec = {
+        {"a", {Dimension("batch_size"), Dimension(4)}, INT32_TENSOR},
+        {"b", {Dimension("batch_size"), Dimension("other")}, UINT8_TENSOR},
+        {"c", {Dimension(-1)}, STRING_TENSOR},
+    };
+
+    InputGeneratorOptions options;
+    options.symbol_values["batch_size"] = 5;
+    options.string_length               = 6;
+
+    std::mt19937_64 rng(0);
+    const auto      inputs = generate_random_inputs(spec, *get_generic_tensor_allocator(), options, rng);
+
+    EXPECT_EQ(inputs.at("a")->as_tensor()->get_dims(), (std::vector<int64_t>{5, 4}));
+    EXPECT_EQ(inputs.at("a")->as_tensor()->get_tensor_type(), INT32_TENSOR);
+
+    // Symbols without a value use the default
+    EXPECT_EQ(inputs.at("b")->as_tensor()->get_dims(), (std::vector<int64_t>{5, 1}));
+    EXPECT_EQ(inputs.at("b")->as_tensor()->get_tensor_type(), UINT8_TENSOR);
+
+    const auto strings = inputs.at("c")->as_typed_tensor<std::string>()->get_data_as_vector();
+    ASSERT_EQ(strings.size(), 1);
+    EXPECT_EQ(strings[0].size(), 6);
+}
+
+TEST(test_load_generator, closed_loop)
+{
+    LoadOptions options;
+    options.concurrency         = 4;
+    options.num_requests        = 100;
+    options.num_warmup_requests = 5;
+
+    std::atomic<size_t> num_calls{0};
+    const auto          result = run_load(options, [&](size_t i) {
+        num_calls++;
+        if (i == 7)
+        {
+            throw std::runtime_error("failed request");
+        }
+    });
+
+    // Warmup requests aren't included in the results
+    EXPECT_EQ(num_calls, 105);
+    EXPECT_EQ(result.num_requests, 99);
+    EXPECT_EQ(result.num_errors, 1);
+    EXPECT_EQ(result.first_error, "failed request");
+    EXPECT_EQ(result.latency.count, 99);
+}
+
+TEST(test_load_generator, open_loop)
+{
+    LoadOptions options;
+    options.concurrency  = 1;
+    options.rate         = 1000;
+    options.num_requests = 50;
+
+    // Requests take longer than the interval between them so they queue up. Latency is measured from the
+    // scheduled time so it includes the time spent waiting
+    const auto result = run_load(options, [](size_t) { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+
+    EXPECT_EQ(result.num_requests, 50);
+    EXPECT_GE(result.duration_s, 0.1);
+    EXPECT_GE(result.latency.max_us, 40 * 1000);
+}
+
+TEST(test_load_generator, max_duration)
+{
+    LoadOptions options;
+    options.rate           = 100;
+    options.num_requests   = 1000;
+    options.max_duration_s = 0.1;
+
+    const auto result = run_load(options, [](size_t) {});
+
+    // Only requests scheduled in the first 100ms should be sent
+    EXPECT_LE(result.num_requests, 10);
+    EXPECT_LT(result.duration_s, 1);
+}
+
+TEST(test_load_generator, invalid_options)
+{
+    LoadOptions options;
+    options.concurrency = 0;
+    EXPECT_THROW(run_load(options, [](size_t) {}), std::runtime_error);
+}
+
+} // namespace neuropod
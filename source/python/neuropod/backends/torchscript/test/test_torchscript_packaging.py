@@ -27,6 +27,7 @@ from neuropod.tests.utils import (
     get_addition_model_spec,
     get_mixed_model_spec,
     check_addition_model,
+    check_addition_model_concurrent,
 )
 
 
@@ -136,6 +137,7 @@ class TestTorchScriptPackaging(unittest.TestCase):
 
                 # Run some additional checks
                 check_addition_model(neuropod_path)
+                check_addition_model_concurrent(neuropod_path)
 
     def test_simple_addition_model(self):
         # Tests a case where packaging works correctly and
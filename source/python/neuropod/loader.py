@@ -129,6 +129,21 @@ class NativeNeuropodExecutor:
         inputs = maybe_convert_bindings_types(inputs)
         return self.model.infer(inputs)
 
+    def infer_async(self, inputs):
+        """
+        Start running inference using the specified inputs and return immediately.
+        Inference runs on the native executor of this model (see the `num_async_threads` option of
+        `load_neuropod`) without holding the GIL.
+
+        :param  inputs:     A dict mapping input names to values. See `infer` for more details.
+
+        :returns:   A future-like object with a `result()` method that blocks until inference is
+                    complete and returns the outputs (or raises any error that occurred during
+                    inference) and a `done()` method that returns whether inference is complete.
+        """
+        inputs = maybe_convert_bindings_types(inputs)
+        return self.model.infer_async(inputs)
+
     def __enter__(self):
         # Needed in order to be used as a contextmanager
         return self
@@ -147,6 +162,8 @@ def load_neuropod(neuropod_path, _always_use_native=True, **kwargs):
                                 This is either `None` or a nonnegative integer. Setting this
                                 to `None` will attempt to run this model on CPU.
     :param  load_custom_ops:    Whether or not to load custom ops included in the model.
+    :param  num_async_threads:  The number of native threads that run `infer_async` requests.
+                                Defaults to 1.
     """
     if _always_use_native:
         return NativeNeuropodExecutor(neuropod_path, **kwargs)
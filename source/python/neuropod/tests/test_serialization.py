@@ -15,6 +15,7 @@
 import numpy as np
 from neuropod import neuropod_native
 import six
+import tempfile
 import unittest
 
 
@@ -78,6 +79,28 @@ class TestSerialization(unittest.TestCase):
 
             np.testing.assert_array_equal(expected, actual)
 
+    def test_file_serialization(self):
+        expected_valuemap = {
+            "floats": np.random.random(size=(2, 3)).astype(np.float32),
+            "ints": np.arange(10, dtype=np.int64),
+            "strings": np.array([b"apple", b"banana"]),
+        }
+
+        with tempfile.NamedTemporaryFile() as f:
+            neuropod_native.serialize_to_file(expected_valuemap, f.name)
+            actual_valuemap = neuropod_native.deserialize_dict_from_file(f.name)
+
+        self.assertEqual(len(expected_valuemap), len(actual_valuemap))
+        for key, expected in expected_valuemap.items():
+            actual = actual_valuemap[key]
+
+            # Unicode vs ascii for python 3
+            # TODO(vip): Add unicode support to the native bindings and fix this
+            if actual.dtype.type == np.unicode_:
+                actual = actual.astype(np.string_)
+
+            np.testing.assert_array_equal(expected, actual)
+
     def test_invalid_stream_deserialization(self):
         with self.assertRaises(RuntimeError if six.PY2 else TypeError):
             neuropod_native.deserialize("bogus")
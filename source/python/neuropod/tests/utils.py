@@ -13,6 +13,7 @@
 # limitations under the License.
 
 import numpy as np
+import threading
 
 from neuropod.loader import load_neuropod
 
@@ -118,6 +119,41 @@ def check_addition_model(neuropod_path):
             raise ValueError("Expected the platform field to be set")
 
 
+def check_addition_model_concurrent(neuropod_path, num_requests=8):
+    """
+    Run inference on the loaded neuropod from several python threads and
+    using `infer_async` and validate the outputs
+    """
+    spec = get_addition_model_spec()
+    inputs = spec["test_input_data"]
+    expected = spec["test_expected_out"]["out"]
+
+    with load_neuropod(neuropod_path, num_async_threads=2) as neuropod:
+        # Native inference doesn't hold the GIL so these can run in parallel
+        results = []
+
+        def run_inference():
+            results.append(neuropod.infer(inputs))
+
+        threads = [threading.Thread(target=run_inference) for _ in range(num_requests)]
+        for thread in threads:
+            thread.start()
+
+        for thread in threads:
+            thread.join()
+
+        futures = [neuropod.infer_async(inputs) for _ in range(num_requests)]
+        results.extend(future.result() for future in futures)
+
+        if len(results) != 2 * num_requests:
+            raise ValueError(
+                "Expected {} results. Got {}".format(2 * num_requests, len(results))
+            )
+
+        for out in results:
+            np.testing.assert_array_equal(out["out"], expected)
+
+
 def check_strings_model(neuropod_path):
     """
     Validate that the inputs and outputs of the loaded neuropod match